@@ -74,7 +74,9 @@ typedef enum {
 /* Native function callback */
 typedef mjs_value_t (*mjs_native_function_t)(mjs_context_t* ctx, int argc, mjs_value_t* argv);
 
-/* Runtime management */
+/* Runtime management. Runtimes share no mutable state, so separate
+ * runtimes may run in parallel, one per thread. A runtime and its
+ * contexts must only be used by one thread at a time. */
 mjs_runtime_t* mjs_new_runtime(void);
 void mjs_free_runtime(mjs_runtime_t* rt);
 
@@ -109,6 +111,8 @@ bool mjs_is_array(mjs_value_t value);
 /* Value conversion */
 bool mjs_to_boolean(mjs_value_t value);
 double mjs_to_number(mjs_value_t value);
+/* The result may live in a per-thread buffer, valid until the calling
+ * thread's next mjs_to_string */
 const char* mjs_to_string(mjs_context_t* ctx, mjs_value_t value);
 
 /* Object property access */
@@ -139,6 +143,163 @@ void mjs_clear_error(mjs_context_t* ctx);
 /* Memory management */
 void mjs_gc(mjs_context_t* ctx);
 size_t mjs_get_memory_usage(mjs_context_t* ctx);
+void mjs_set_memory_limit(mjs_runtime_t* rt, size_t limit); /* 0 for no limit */
+
+/* Request-scoped allocation. Objects allocated between mjs_region_begin
+ * and mjs_region_end cost no collection work and are all freed by
+ * mjs_region_end, except those stored into objects from before the region
+ * or global state, or still held by handles when it ends. Regions nest,
+ * and are shared by every context of the runtime. */
+bool mjs_region_begin(mjs_context_t* ctx);
+bool mjs_region_end(mjs_context_t* ctx);
+
+/* Context pools. Contexts are created ahead of time from a template the
+ * optional setup callback fills in, and checked out one per request. A
+ * checked-in context is reset to the template's globals, dropping what
+ * the request defined or replaced on its global object. Each reset gives
+ * the context fresh copies of the objects and arrays those globals refer
+ * to, cloned as mjs_serialize does, so creating the pool fails if they
+ * reach a function; functions and shared-heap objects held directly by a
+ * global are shared by all of the pool's contexts. capacity contexts are
+ * pre-warmed and at most as many kept idle.
+ * Freeing the pool leaves contexts still checked out to their owners,
+ * who free them with mjs_free_context. */
+typedef struct mjs_context_pool mjs_context_pool_t;
+typedef bool (*mjs_context_setup_t)(mjs_context_t* ctx, void* opaque);
+
+mjs_context_pool_t* mjs_new_context_pool(mjs_runtime_t* rt, size_t capacity,
+                                         mjs_context_setup_t setup, void* opaque);
+void mjs_free_context_pool(mjs_context_pool_t* pool);
+mjs_context_t* mjs_context_pool_acquire(mjs_context_pool_t* pool);
+void mjs_context_pool_release(mjs_context_pool_t* pool, mjs_context_t* ctx);
+
+/* Shared heap. Builtins and atoms are built once, into a heap of their
+ * own, and referenced read-only by every runtime attached to it; those
+ * runtimes never mark, move or free its objects and hold only what they
+ * create themselves. Build it on one thread, seal it, then attach it to
+ * runtimes before their first context, from any thread. Shared globals
+ * are found through every context's global object, which can shadow
+ * them; sealed objects cannot be changed. The heap lives until it is
+ * freed and every runtime attached to it is too. */
+typedef struct mjs_shared_heap mjs_shared_heap_t;
+
+mjs_shared_heap_t* mjs_new_shared_heap(void);
+void mjs_free_shared_heap(mjs_shared_heap_t* heap);
+mjs_value_t mjs_shared_atom(mjs_shared_heap_t* heap, const char* str);
+mjs_value_t mjs_shared_object(mjs_shared_heap_t* heap);
+mjs_value_t mjs_shared_function(mjs_shared_heap_t* heap, const char* name, mjs_native_function_t func);
+bool mjs_shared_set_property(mjs_shared_heap_t* heap, mjs_value_t object, const char* key, mjs_value_t value);
+bool mjs_shared_define_global(mjs_shared_heap_t* heap, const char* name, mjs_value_t value);
+void mjs_shared_heap_seal(mjs_shared_heap_t* heap);
+bool mjs_runtime_attach_shared_heap(mjs_runtime_t* rt, mjs_shared_heap_t* heap);
+
+/* Workers. A worker is a runtime of its own, run by a pool of threads
+ * that many workers share, and exchanges byte buffers with its parent
+ * through lock-free queues. A posted buffer is copied, or with transfer
+ * moved without copying; it must then come from malloc and belongs to
+ * the queue unless the post fails. Messages reach the worker's handler
+ * in order on a pool thread, and the parent's handler when the parent
+ * calls mjs_worker_dispatch, which only one thread may do at a time. A
+ * handler returning true keeps the buffer and frees it itself. Freeing
+ * a pool frees the workers still on it. */
+typedef struct mjs_worker_pool mjs_worker_pool_t;
+typedef struct mjs_worker mjs_worker_t;
+typedef bool (*mjs_message_handler_t)(mjs_worker_t* worker, mjs_context_t* ctx,
+                                      void* data, size_t length, void* opaque);
+
+mjs_worker_pool_t* mjs_new_worker_pool(size_t threads); /* 0 for one per core */
+void mjs_free_worker_pool(mjs_worker_pool_t* pool);
+mjs_worker_t* mjs_new_worker(mjs_worker_pool_t* pool, mjs_shared_heap_t* shared_heap,
+                             mjs_context_setup_t setup, mjs_message_handler_t on_message, void* opaque);
+void mjs_free_worker(mjs_worker_t* worker);
+bool mjs_worker_post_message(mjs_worker_t* worker, void* data, size_t length, bool transfer);
+bool mjs_worker_post_to_parent(mjs_worker_t* worker, void* data, size_t length, bool transfer);
+size_t mjs_worker_dispatch(mjs_worker_t* worker, mjs_context_t* ctx,
+                           mjs_message_handler_t handler, void* opaque);
+void mjs_worker_wait(mjs_worker_t* worker); /* until the worker has posted to the parent */
+
+/* Structured clone. mjs_serialize writes a value graph into a compact
+ * binary buffer from malloc, which the caller frees or hands to a worker
+ * with transfer; mjs_deserialize rebuilds it in any runtime. Objects and
+ * arrays reached twice or through a cycle are shared the same way in the
+ * copy. Objects keep their own enumerable properties but not their
+ * prototype or property attributes; functions and symbols cannot be
+ * cloned. Corrupt or truncated buffers are rejected. */
+mjs_result_t mjs_serialize(mjs_context_t* ctx, mjs_value_t value, void** data, size_t* length);
+mjs_result_t mjs_deserialize(mjs_context_t* ctx, const void* data, size_t length, mjs_value_t* result);
+
+/* Host hints. mjs_idle_notification does pending GC work until deadline_us,
+ * an absolute time on the mjs_now_us clock, and returns true when there is
+ * none left. mjs_memory_pressure collects and gives memory back to the
+ * system; critical pressure also compacts the heap when the GC is
+ * configured to compact. */
+typedef enum {
+    MJS_MEMORY_PRESSURE_NONE,
+    MJS_MEMORY_PRESSURE_MODERATE,
+    MJS_MEMORY_PRESSURE_CRITICAL
+} mjs_memory_pressure_t;
+
+uint64_t mjs_now_us(void);
+bool mjs_idle_notification(mjs_runtime_t* rt, uint64_t deadline_us);
+void mjs_memory_pressure(mjs_runtime_t* rt, mjs_memory_pressure_t level);
+
+/* Write the live object graph as a .heapsnapshot file for the DevTools
+ * memory panel. Runs a full collection first. */
+bool mjs_write_heap_snapshot(mjs_runtime_t* rt, const char* path);
+
+/* Sampling allocation profiler. About one allocation per interval_bytes
+ * (0 for 512 KB) is recorded with the script stack that made it. The
+ * profile is in folded stack format, "frame;frame;(type) bytes" per line,
+ * for flame graph tools; bytes are estimates scaled up from the samples.
+ * With live_only the profile covers only objects not yet collected. */
+bool mjs_start_allocation_sampling(mjs_runtime_t* rt, size_t interval_bytes);
+void mjs_stop_allocation_sampling(mjs_runtime_t* rt);
+bool mjs_write_allocation_profile(mjs_runtime_t* rt, const char* path, bool live_only);
+
+/* Tracing. While a session runs, every engine thread records begin/end
+ * events for parsing, compilation, execution and each GC phase. The export
+ * is Chrome trace event JSON, which chrome://tracing and Perfetto load;
+ * mjs_trace_to_json returns a malloc'd string the caller frees. */
+void mjs_trace_start(void);
+void mjs_trace_stop(void);
+char* mjs_trace_to_json(size_t* length);
+bool mjs_trace_write_json(const char* path);
+
+/* Handle scopes. A handle keeps a value alive until the scope it was
+ * created in closes; read the value through the handle, the collector may
+ * move the object and updates the handle when it does. Scopes nest and must
+ * be closed in reverse order of opening. */
+typedef struct {
+    mjs_context_t* ctx;
+    size_t base;
+} mjs_handle_scope_t;
+
+void mjs_handle_scope_open(mjs_context_t* ctx, mjs_handle_scope_t* scope);
+void mjs_handle_scope_close(mjs_handle_scope_t* scope);
+mjs_value_t* mjs_handle_scope_escape(mjs_handle_scope_t* scope, mjs_value_t value);
+mjs_value_t* mjs_handle_new(mjs_context_t* ctx, mjs_value_t value);
+
+/* Persistent handles keep a value alive until released. 0 is never a valid
+ * handle. */
+typedef size_t mjs_persistent_t;
+
+mjs_persistent_t mjs_persistent_new(mjs_context_t* ctx, mjs_value_t value);
+mjs_value_t mjs_persistent_get(mjs_context_t* ctx, mjs_persistent_t handle);
+void mjs_persistent_set(mjs_context_t* ctx, mjs_persistent_t handle, mjs_value_t value);
+void mjs_persistent_release(mjs_context_t* ctx, mjs_persistent_t handle);
+
+/* Weak maps. Entries are keyed weakly by objects, arrays and functions:
+ * a value stays alive only while its key is reachable from elsewhere, and
+ * the entry goes away once the key is collected, even if the value refers
+ * back to the key. Meant for caches keyed by host objects. */
+typedef struct mjs_ephemeron_table mjs_weak_map_t;
+
+mjs_weak_map_t* mjs_weak_map_new(mjs_context_t* ctx);
+void mjs_weak_map_free(mjs_weak_map_t* map);
+bool mjs_weak_map_set(mjs_weak_map_t* map, mjs_value_t key, mjs_value_t value);
+bool mjs_weak_map_get(mjs_weak_map_t* map, mjs_value_t key, mjs_value_t* value);
+bool mjs_weak_map_has(mjs_weak_map_t* map, mjs_value_t key);
+bool mjs_weak_map_delete(mjs_weak_map_t* map, mjs_value_t key);
 
 /* Utility functions */
 const char* mjs_get_version(void);
@@ -49,6 +49,11 @@ void print_help() {
     printf("  clear         - Clear the screen\n");
     printf("  .gc           - Force garbage collection\n");
     printf("  .stats        - Show runtime statistics\n");
+    printf("  .heapsnapshot <file> - Write a heap snapshot for DevTools\n");
+    printf("  .allocprofile start  - Start sampling allocations\n");
+    printf("  .allocprofile <file> - Stop sampling and save folded stacks\n");
+    printf("  .trace start  - Start recording engine trace events\n");
+    printf("  .trace <file> - Stop recording and save Chrome trace JSON\n");
     printf("\nJavaScript expressions and statements are executed directly.\n\n");
 }
 
@@ -116,6 +121,55 @@ bool handle_shell_command(const char* input, mjs_context_t* ctx) {
         return true;
     }
     
+    if (strncmp(input, ".heapsnapshot ", 14) == 0) {
+        const char* path = input + 14;
+        while (*path == ' ' || *path == '\t') path++;
+        if (ctx && mjs_write_heap_snapshot(ctx->runtime, path)) {
+            printf("Heap snapshot written to %s\n", path);
+        } else {
+            printf("Failed to write heap snapshot to %s\n", path);
+        }
+        return true;
+    }
+    
+    if (strncmp(input, ".allocprofile ", 14) == 0) {
+        const char* arg = input + 14;
+        while (*arg == ' ' || *arg == '\t') arg++;
+        if (!ctx) return true;
+        if (strcmp(arg, "start") == 0) {
+            if (mjs_start_allocation_sampling(ctx->runtime, 0)) {
+                printf("Allocation sampling started\n");
+            } else {
+                printf("Failed to start allocation sampling\n");
+            }
+        } else {
+            if (mjs_write_allocation_profile(ctx->runtime, arg, false)) {
+                printf("Allocation profile written to %s\n", arg);
+            } else {
+                printf("Failed to write allocation profile to %s\n", arg);
+            }
+            mjs_stop_allocation_sampling(ctx->runtime);
+        }
+        return true;
+    }
+    
+    if (strncmp(input, ".trace ", 7) == 0) {
+        const char* arg = input + 7;
+        while (*arg == ' ' || *arg == '\t') arg++;
+        if (strcmp(arg, "start") == 0) {
+            mjs_trace_start();
+            printf("Tracing started\n");
+        } else {
+            mjs_trace_stop();
+            if (mjs_trace_write_json(arg)) {
+                printf("Trace written to %s\n", arg);
+            } else {
+                printf("Failed to write trace to %s\n", arg);
+            }
+        }
+        return true;
+    }
+    
     return false; // Not a shell command
 }
 
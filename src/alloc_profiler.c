@@ -0,0 +1,269 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Allocation Profiler Implementation
+ */
+
+#include "alloc_profiler.h"
+#include "mikojs_internal.h"
+#include "vm.h"
+#include <math.h>
+#include <string.h>
+
+#define ALLOC_STACK_MAX_LENGTH 2048
+
+/* Leaf frame naming the object type; unknown types share slot 0 */
+static const char* const alloc_type_names[] = {
+    [0] = "(other)",
+    [GC_TYPE_STRING] = "(string)",
+    [GC_TYPE_ARRAY] = "(array)",
+    [GC_TYPE_OBJECT] = "(object)",
+    [GC_TYPE_FUNCTION] = "(function)"
+};
+
+#define ALLOC_TYPE_COUNT (sizeof(alloc_type_names) / sizeof(alloc_type_names[0]))
+
+/* Sampling intervals. Drawing the gap to the next sample from an exponential
+ * distribution makes sampling a Poisson process over allocated bytes, so
+ * allocation sites are not missed for lining up with a fixed period. */
+static uint64_t alloc_random_next(mjs_alloc_profiler_t* profiler) {
+    // xorshift64*
+    uint64_t x = profiler->random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    profiler->random_state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static size_t alloc_next_interval(mjs_alloc_profiler_t* profiler) {
+    // Uniform in (0, 1] from the top 53 bits
+    double u = ((double)(alloc_random_next(profiler) >> 11) + 1.0) / 9007199254740992.0;
+    double gap = -log(u) * (double)profiler->interval;
+    if (gap < 1.0) return 1;
+    if (gap > (double)(SIZE_MAX / 2)) return SIZE_MAX / 2;
+    return (size_t)gap;
+}
+
+/* Stacks */
+static size_t alloc_hash_string(const char* str) {
+    size_t hash = 14695981039346656037ULL;
+    for (; *str; str++) {
+        hash = (hash ^ (unsigned char)*str) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool alloc_grow_stack_table(mjs_alloc_profiler_t* profiler) {
+    size_t capacity = profiler->stack_table_capacity ? profiler->stack_table_capacity * 2 : 64;
+    size_t* table = MJS_CALLOC(capacity, sizeof(size_t));
+    if (!table) return false;
+    
+    for (size_t i = 0; i < profiler->stack_count; i++) {
+        size_t slot = alloc_hash_string(profiler->stacks[i]) & (capacity - 1);
+        while (table[slot]) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        table[slot] = i + 1;
+    }
+    
+    MJS_FREE(profiler->stack_table);
+    profiler->stack_table = table;
+    profiler->stack_table_capacity = capacity;
+    return true;
+}
+
+static size_t alloc_intern_stack(mjs_alloc_profiler_t* profiler, const char* frames) {
+    if ((profiler->stack_count + 1) * 2 > profiler->stack_table_capacity &&
+        !alloc_grow_stack_table(profiler)) {
+        return SIZE_MAX;
+    }
+    
+    size_t mask = profiler->stack_table_capacity - 1;
+    size_t slot = alloc_hash_string(frames) & mask;
+    while (profiler->stack_table[slot]) {
+        size_t index = profiler->stack_table[slot] - 1;
+        if (strcmp(profiler->stacks[index], frames) == 0) return index;
+        slot = (slot + 1) & mask;
+    }
+    
+    if (profiler->stack_count == profiler->stack_capacity) {
+        size_t capacity = profiler->stack_capacity ? profiler->stack_capacity * 2 : 32;
+        char** stacks = MJS_REALLOC(profiler->stacks, capacity * sizeof(char*));
+        if (!stacks) return SIZE_MAX;
+        profiler->stacks = stacks;
+        profiler->stack_capacity = capacity;
+    }
+    
+    size_t length = strlen(frames);
+    char* copy = MJS_MALLOC(length + 1);
+    if (!copy) return SIZE_MAX;
+    memcpy(copy, frames, length + 1);
+    
+    profiler->stacks[profiler->stack_count] = copy;
+    profiler->stack_table[slot] = ++profiler->stack_count;
+    return profiler->stack_count - 1;
+}
+
+static void alloc_append_frame(char* buffer, size_t* length, const char* name) {
+    size_t name_length = strlen(name);
+    if (*length + 1 + name_length >= ALLOC_STACK_MAX_LENGTH) return;
+    
+    buffer[(*length)++] = ';';
+    memcpy(buffer + *length, name, name_length + 1);
+    *length += name_length;
+}
+
+/* The running script's frames, outermost first. Allocations made while no
+ * script runs are attributed to "(native)". */
+static void alloc_capture_stack(mjs_gc_t* gc, char* buffer) {
+    size_t length = strlen(strcpy(buffer, "(root)"));
+    
+    mjs_vm_t* vm = gc->runtime ? gc->runtime->vms : NULL;
+    while (vm && vm->state != VM_STATE_RUNNING) {
+        vm = vm->next_vm;
+    }
+    if (!vm || vm->call_stack_top == 0) {
+        alloc_append_frame(buffer, &length, "(native)");
+        return;
+    }
+    
+    // Deep recursion keeps its outermost and innermost frames
+    size_t count = vm->call_stack_top;
+    for (size_t i = 0; i < count; i++) {
+        if (count > MJS_ALLOC_PROFILER_MAX_FRAMES && i == MJS_ALLOC_PROFILER_MAX_FRAMES / 2) {
+            alloc_append_frame(buffer, &length, "(truncated)");
+            i = count - MJS_ALLOC_PROFILER_MAX_FRAMES / 2;
+        }
+        
+        mjs_bytecode_t* bytecode = vm->call_stack[i].bytecode;
+        const char* name = bytecode && bytecode->name && bytecode->name[0] ? bytecode->name :
+                           i == 0 ? "(program)" : "(anonymous)";
+        alloc_append_frame(buffer, &length, name);
+    }
+}
+
+/* Sampling */
+static void alloc_sample_collected(void* data) {
+    mjs_alloc_sample_t* sample = data;
+    sample->weak_ref = NULL;
+    sample->profiler->live_count--;
+}
+
+void mjs_alloc_profiler_sample(mjs_alloc_profiler_t* profiler, void* object,
+                               mjs_gc_object_type_t type, size_t size) {
+    mjs_gc_t* gc = profiler->gc;
+    gc->bytes_until_sample = alloc_next_interval(profiler);
+    
+    char frames[ALLOC_STACK_MAX_LENGTH];
+    alloc_capture_stack(gc, frames);
+    size_t stack = alloc_intern_stack(profiler, frames);
+    if (stack == SIZE_MAX) return;
+    
+    mjs_alloc_sample_t* sample = MJS_MALLOC(sizeof(mjs_alloc_sample_t));
+    if (!sample) return;
+    
+    sample->weak_ref = mjs_gc_create_weak_ref(gc, object);
+    if (!sample->weak_ref) {
+        MJS_FREE(sample);
+        return;
+    }
+    sample->weak_ref->callback = alloc_sample_collected;
+    sample->weak_ref->userdata = sample;
+    
+    sample->profiler = profiler;
+    sample->stack = stack;
+    sample->type = (uint8_t)type;
+    sample->size = size;
+    sample->next = profiler->samples;
+    profiler->samples = sample;
+    profiler->sample_count++;
+    profiler->live_count++;
+}
+
+bool mjs_alloc_profiler_start(mjs_gc_t* gc, size_t interval) {
+    if (!gc) return false;
+    if (gc->alloc_profiler) return true;
+    
+    mjs_alloc_profiler_t* profiler = MJS_CALLOC(1, sizeof(mjs_alloc_profiler_t));
+    if (!profiler) return false;
+    
+    profiler->gc = gc;
+    profiler->interval = interval ? interval : MJS_ALLOC_PROFILER_DEFAULT_INTERVAL;
+    profiler->random_state = (mjs_gc_now_us() ^ (uint64_t)(uintptr_t)profiler) | 1;
+    
+    gc->bytes_until_sample = alloc_next_interval(profiler);
+    gc->alloc_profiler = profiler;
+    return true;
+}
+
+void mjs_alloc_profiler_stop(mjs_gc_t* gc) {
+    if (!gc || !gc->alloc_profiler) return;
+    
+    mjs_alloc_profiler_t* profiler = gc->alloc_profiler;
+    gc->alloc_profiler = NULL;
+    
+    mjs_alloc_sample_t* sample = profiler->samples;
+    while (sample) {
+        mjs_alloc_sample_t* next = sample->next;
+        if (sample->weak_ref) {
+            mjs_gc_destroy_weak_ref(gc, sample->weak_ref);
+        }
+        MJS_FREE(sample);
+        sample = next;
+    }
+    
+    for (size_t i = 0; i < profiler->stack_count; i++) {
+        MJS_FREE(profiler->stacks[i]);
+    }
+    MJS_FREE(profiler->stacks);
+    MJS_FREE(profiler->stack_table);
+    MJS_FREE(profiler);
+}
+
+/* Output. A cell of size s is sampled with probability 1 - e^(-s/interval),
+ * so each sample stands for s / (1 - e^(-s/interval)) allocated bytes. */
+bool mjs_alloc_profiler_write_folded(mjs_alloc_profiler_t* profiler, FILE* file, bool live_only) {
+    if (!profiler || !file) return false;
+    
+    size_t bucket_count = profiler->stack_count * ALLOC_TYPE_COUNT;
+    double* bytes = MJS_CALLOC(bucket_count ? bucket_count : 1, sizeof(double));
+    if (!bytes) return false;
+    
+    for (mjs_alloc_sample_t* sample = profiler->samples; sample; sample = sample->next) {
+        if (live_only && !sample->weak_ref) continue;
+        size_t type = sample->type < ALLOC_TYPE_COUNT ? sample->type : 0;
+        double probability = 1.0 - exp(-(double)sample->size / (double)profiler->interval);
+        bytes[sample->stack * ALLOC_TYPE_COUNT + type] += (double)sample->size / probability;
+    }
+    
+    bool ok = true;
+    for (size_t i = 0; i < bucket_count && ok; i++) {
+        if (bytes[i] <= 0.0) continue;
+        ok = fprintf(file, "%s;%s %.0f\n", profiler->stacks[i / ALLOC_TYPE_COUNT],
+                     alloc_type_names[i % ALLOC_TYPE_COUNT], bytes[i]) > 0;
+    }
+    
+    MJS_FREE(bytes);
+    return ok;
+}
@@ -0,0 +1,81 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Allocation Profiler
+ * Poisson-sampled allocations with the script stack that made them,
+ * written as folded stacks for flame graph tools
+ */
+
+#ifndef MIKOJS_ALLOC_PROFILER_H
+#define MIKOJS_ALLOC_PROFILER_H
+
+#include "gc.h"
+
+/* Mean bytes allocated between two samples */
+#define MJS_ALLOC_PROFILER_DEFAULT_INTERVAL (512 * 1024)
+#define MJS_ALLOC_PROFILER_MAX_FRAMES 64
+
+/* One sampled allocation. The weak reference is cleared by the collector
+ * when the object dies. */
+typedef struct mjs_alloc_sample {
+    struct mjs_alloc_sample* next;
+    struct mjs_alloc_profiler* profiler;
+    size_t stack;                     /* index into stacks */
+    uint8_t type;                     /* GC_TYPE_* */
+    size_t size;                      /* cell bytes */
+    mjs_weak_ref_t* weak_ref;         /* NULL once the object was collected */
+} mjs_alloc_sample_t;
+
+struct mjs_alloc_profiler {
+    mjs_gc_t* gc;
+    size_t interval;
+    uint64_t random_state;
+    
+    mjs_alloc_sample_t* samples;
+    size_t sample_count;
+    size_t live_count;
+    
+    /* Interned stacks, "(root);outer;inner" */
+    char** stacks;
+    size_t stack_count;
+    size_t stack_capacity;
+    size_t* stack_table;              /* open addressing, index + 1 of a stack */
+    size_t stack_table_capacity;
+};
+
+typedef struct mjs_alloc_profiler mjs_alloc_profiler_t;
+
+/* Start and stop sampling on a collector; interval 0 picks the default.
+ * Stopping discards the samples. */
+bool mjs_alloc_profiler_start(mjs_gc_t* gc, size_t interval);
+void mjs_alloc_profiler_stop(mjs_gc_t* gc);
+
+/* Called by mjs_gc_alloc once the sampling countdown runs out */
+void mjs_alloc_profiler_sample(mjs_alloc_profiler_t* profiler, void* object,
+                               mjs_gc_object_type_t type, size_t size);
+
+/* Estimated bytes per stack and object type, one "frames;(type) bytes" line
+ * each. With live_only, objects that have been collected are left out. */
+bool mjs_alloc_profiler_write_folded(mjs_alloc_profiler_t* profiler, FILE* file, bool live_only);
+
+#endif /* MIKOJS_ALLOC_PROFILER_H */
@@ -63,6 +63,23 @@ void mjs_array_free(mjs_array_t* arr) {
     // as it's managed by the garbage collector
 }
 
+/* In-place changes relink, overwrite or reallocate memory the concurrent
+ * marker may be tracing, so they run under the heap lock and log the
+ * references they overwrite or drop. Arrays on a shared heap are read by
+ * other runtimes at the same time and are never changed. */
+static bool mjs_array_is_mutable(mjs_context_t* ctx, mjs_array_t* arr) {
+    return ctx && arr && !mjs_gc_is_shared_object(ctx->runtime->gc, arr);
+}
+
+/* Log elements [start, end) before they are overwritten or dropped */
+static void mjs_array_drop_elements(mjs_gc_t* gc, mjs_array_t* arr, size_t start, size_t end) {
+    if (!mjs_gc_is_marking(gc)) return;
+    
+    for (size_t i = start; i < end; i++) {
+        mjs_gc_satb_barrier_value(gc, arr->elements[i]);
+    }
+}
+
 /* Array resizing */
 static bool mjs_array_ensure_capacity(mjs_array_t* arr, size_t required_capacity) {
     if (!arr || required_capacity <= arr->capacity) {
@@ -89,12 +106,16 @@ static bool mjs_array_ensure_capacity(mjs_array_t* arr, size_t required_capacity
     return true;
 }
 
-void mjs_array_resize(mjs_array_t* arr, size_t new_size) {
-    if (!arr) return;
+void mjs_array_resize(mjs_context_t* ctx, mjs_array_t* arr, size_t new_size) {
+    if (!mjs_array_is_mutable(ctx, arr)) return;
+    
+    mjs_gc_t* gc = ctx->runtime->gc;
+    bool heap_locked = mjs_gc_lock_heap(gc);
     
     if (new_size > arr->capacity) {
         // Need to expand capacity
         if (!mjs_array_ensure_capacity(arr, new_size)) {
+            mjs_gc_unlock_heap(gc, heap_locked);
             return; // Failed to resize
         }
     }
@@ -104,9 +125,12 @@ void mjs_array_resize(mjs_array_t* arr, size_t new_size) {
         for (size_t i = arr->length; i < new_size; i++) {
             arr->elements[i] = mjs_value_undefined();
         }
+    } else {
+        mjs_array_drop_elements(gc, arr, new_size, arr->length);
     }
     
     arr->length = new_size;
+    mjs_gc_unlock_heap(gc, heap_locked);
 }
 
 /* Array element access */
@@ -118,12 +142,16 @@ mjs_value_t mjs_array_get(mjs_array_t* arr, size_t index) {
     return arr->elements[index];
 }
 
-bool mjs_array_set(mjs_array_t* arr, size_t index, mjs_value_t value) {
-    if (!arr) return false;
+bool mjs_array_set(mjs_context_t* ctx, mjs_array_t* arr, size_t index, mjs_value_t value) {
+    if (!mjs_array_is_mutable(ctx, arr)) return false;
+    
+    mjs_gc_t* gc = ctx->runtime->gc;
+    bool heap_locked = mjs_gc_lock_heap(gc);
     
     // If index is beyond current length, extend the array
     if (index >= arr->length) {
         if (!mjs_array_ensure_capacity(arr, index + 1)) {
+            mjs_gc_unlock_heap(gc, heap_locked);
             return false;
         }
         
@@ -133,9 +161,13 @@ bool mjs_array_set(mjs_array_t* arr, size_t index, mjs_value_t value) {
         }
         
         arr->length = index + 1;
+    } else {
+        MJS_GC_DELETION_BARRIER_VALUE(gc, arr->elements[index]);
     }
     
+    MJS_GC_WRITE_BARRIER_VALUE(gc, arr, value);
     arr->elements[index] = value;
+    mjs_gc_unlock_heap(gc, heap_locked);
     return true;
 }
 
@@ -144,12 +176,16 @@ size_t mjs_array_length(mjs_array_t* arr) {
     return arr ? arr->length : 0;
 }
 
-bool mjs_array_set_length(mjs_array_t* arr, size_t new_length) {
-    if (!arr) return false;
+bool mjs_array_set_length(mjs_context_t* ctx, mjs_array_t* arr, size_t new_length) {
+    if (!mjs_array_is_mutable(ctx, arr)) return false;
+    
+    mjs_gc_t* gc = ctx->runtime->gc;
+    bool heap_locked = mjs_gc_lock_heap(gc);
     
     if (new_length > arr->length) {
         // Extending array
         if (!mjs_array_ensure_capacity(arr, new_length)) {
+            mjs_gc_unlock_heap(gc, heap_locked);
             return false;
         }
         
@@ -159,70 +195,96 @@ bool mjs_array_set_length(mjs_array_t* arr, size_t new_length) {
         }
     } else if (new_length < arr->length) {
         // Truncating array - elements beyond new_length become undefined
+        mjs_array_drop_elements(gc, arr, new_length, arr->length);
         for (size_t i = new_length; i < arr->length; i++) {
             arr->elements[i] = mjs_value_undefined();
         }
     }
     
     arr->length = new_length;
+    mjs_gc_unlock_heap(gc, heap_locked);
     return true;
 }
 
 /* Array manipulation methods */
-bool mjs_array_push(mjs_array_t* arr, mjs_value_t value) {
-    if (!arr) return false;
+bool mjs_array_push(mjs_context_t* ctx, mjs_array_t* arr, mjs_value_t value) {
+    if (!mjs_array_is_mutable(ctx, arr)) return false;
+    
+    mjs_gc_t* gc = ctx->runtime->gc;
+    bool heap_locked = mjs_gc_lock_heap(gc);
     
     if (!mjs_array_ensure_capacity(arr, arr->length + 1)) {
+        mjs_gc_unlock_heap(gc, heap_locked);
         return false;
     }
     
+    MJS_GC_WRITE_BARRIER_VALUE(gc, arr, value);
     arr->elements[arr->length] = value;
     arr->length++;
+    mjs_gc_unlock_heap(gc, heap_locked);
     return true;
 }
 
-mjs_value_t mjs_array_pop(mjs_array_t* arr) {
-    if (!arr || arr->length == 0) {
+mjs_value_t mjs_array_pop(mjs_context_t* ctx, mjs_array_t* arr) {
+    if (!mjs_array_is_mutable(ctx, arr) || arr->length == 0) {
         return mjs_value_undefined();
     }
     
+    mjs_gc_t* gc = ctx->runtime->gc;
+    bool heap_locked = mjs_gc_lock_heap(gc);
+    
     arr->length--;
     mjs_value_t value = arr->elements[arr->length];
+    MJS_GC_DELETION_BARRIER_VALUE(gc, value);
     arr->elements[arr->length] = mjs_value_undefined();
+    
+    mjs_gc_unlock_heap(gc, heap_locked);
     return value;
 }
 
-bool mjs_array_unshift(mjs_array_t* arr, mjs_value_t value) {
-    if (!arr) return false;
+bool mjs_array_unshift(mjs_context_t* ctx, mjs_array_t* arr, mjs_value_t value) {
+    if (!mjs_array_is_mutable(ctx, arr)) return false;
+    
+    mjs_gc_t* gc = ctx->runtime->gc;
+    bool heap_locked = mjs_gc_lock_heap(gc);
     
     if (!mjs_array_ensure_capacity(arr, arr->length + 1)) {
+        mjs_gc_unlock_heap(gc, heap_locked);
         return false;
     }
     
     // Shift all elements to the right
+    mjs_array_drop_elements(gc, arr, 0, arr->length);
     for (size_t i = arr->length; i > 0; i--) {
         arr->elements[i] = arr->elements[i - 1];
     }
     
+    MJS_GC_WRITE_BARRIER_VALUE(gc, arr, value);
     arr->elements[0] = value;
     arr->length++;
+    mjs_gc_unlock_heap(gc, heap_locked);
     return true;
 }
 
-mjs_value_t mjs_array_shift(mjs_array_t* arr) {
-    if (!arr || arr->length == 0) {
+mjs_value_t mjs_array_shift(mjs_context_t* ctx, mjs_array_t* arr) {
+    if (!mjs_array_is_mutable(ctx, arr) || arr->length == 0) {
         return mjs_value_undefined();
     }
     
+    mjs_gc_t* gc = ctx->runtime->gc;
+    bool heap_locked = mjs_gc_lock_heap(gc);
+    
     mjs_value_t value = arr->elements[0];
     
     // Shift all elements to the left
+    mjs_array_drop_elements(gc, arr, 0, arr->length);
     for (size_t i = 0; i < arr->length - 1; i++) {
         arr->elements[i] = arr->elements[i + 1];
     }
     
     arr->length--;
     arr->elements[arr->length] = mjs_value_undefined();
+    mjs_gc_unlock_heap(gc, heap_locked);
     return value;
 }
 
@@ -334,7 +396,7 @@ mjs_array_t* mjs_array_slice(mjs_context_t* ctx, mjs_array_t* arr, long start, l
 }
 
 mjs_array_t* mjs_array_splice(mjs_context_t* ctx, mjs_array_t* arr, size_t start, size_t delete_count, mjs_value_t* items, size_t item_count) {
-    if (!ctx || !arr) return NULL;
+    if (!mjs_array_is_mutable(ctx, arr)) return NULL;
     
     // Clamp start to array bounds
     if (start > arr->length) start = arr->length;
@@ -357,13 +419,20 @@ mjs_array_t* mjs_array_splice(mjs_context_t* ctx, mjs_array_t* arr, size_t start
     // Calculate new array length
     size_t new_length = arr->length - delete_count + item_count;
     
+    mjs_gc_t* gc = ctx->runtime->gc;
+    bool heap_locked = mjs_gc_lock_heap(gc);
+    
     if (new_length > arr->length) {
         // Array will grow
         if (!mjs_array_ensure_capacity(arr, new_length)) {
+            mjs_gc_unlock_heap(gc, heap_locked);
             return deleted;
         }
     }
     
+    // Everything from the splice point on is overwritten or moved
+    mjs_array_drop_elements(gc, arr, start, arr->length);
+    
     // Move elements after the splice point
     if (item_count != delete_count) {
         size_t move_count = arr->length - start - delete_count;
@@ -383,6 +452,7 @@ mjs_array_t* mjs_array_splice(mjs_context_t* ctx, mjs_array_t* arr, size_t start
     // Insert new items
     if (items && item_count > 0) {
         for (size_t i = 0; i < item_count; i++) {
+            MJS_GC_WRITE_BARRIER_VALUE(gc, arr, items[i]);
             arr->elements[start + i] = items[i];
         }
     }
@@ -395,6 +465,7 @@ mjs_array_t* mjs_array_splice(mjs_context_t* ctx, mjs_array_t* arr, size_t start
         arr->elements[i] = mjs_value_undefined();
     }
     
+    mjs_gc_unlock_heap(gc, heap_locked);
     return deleted;
 }
 
@@ -428,8 +499,12 @@ mjs_array_t* mjs_array_concat(mjs_context_t* ctx, mjs_array_t* arr1, mjs_array_t
 }
 
 /* Array reversal */
-void mjs_array_reverse(mjs_array_t* arr) {
-    if (!arr || arr->length <= 1) return;
+void mjs_array_reverse(mjs_context_t* ctx, mjs_array_t* arr) {
+    if (!mjs_array_is_mutable(ctx, arr) || arr->length <= 1) return;
+    
+    mjs_gc_t* gc = ctx->runtime->gc;
+    bool heap_locked = mjs_gc_lock_heap(gc);
+    mjs_array_drop_elements(gc, arr, 0, arr->length);
     
     size_t left = 0;
     size_t right = arr->length - 1;
@@ -441,6 +516,8 @@ void mjs_array_reverse(mjs_array_t* arr) {
         left++;
         right--;
     }
+    
+    mjs_gc_unlock_heap(gc, heap_locked);
 }
 
 /* Array to string conversion */
@@ -28,6 +28,7 @@
 #include "vm.h"
 #include "parser.h"
 #include "mikojs_internal.h"
+#include "trace.h"
 
 /* Compiler context for tracking compilation state */
 typedef struct {
@@ -101,6 +102,8 @@ mjs_bytecode_t* mjs_compile_ast(mjs_context_t* ctx, mjs_ast_node_t* ast) {
     compiler.current_scope_depth = 0;
     compiler.has_error = false;
     
+    MJS_TRACE_BEGIN("compile", "compile");
+    
     // Compile the AST
     bool success = false;
     switch (ast->type) {
@@ -113,6 +116,7 @@ mjs_bytecode_t* mjs_compile_ast(mjs_context_t* ctx, mjs_ast_node_t* ast) {
     }
     
     if (!success || compiler.has_error) {
+        MJS_TRACE_END("compile", "compile");
         mjs_bytecode_free(compiler.bytecode);
         return NULL;
     }
@@ -120,6 +124,7 @@ mjs_bytecode_t* mjs_compile_ast(mjs_context_t* ctx, mjs_ast_node_t* ast) {
     // Add final return instruction if not present
     emit_instruction(&compiler, OP_RETURN, 0);
     
+    MJS_TRACE_END1("compile", "compile", "instructions", compiler.bytecode->instruction_count);
     return compiler.bytecode;
 }
 
@@ -0,0 +1,291 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Context Pool
+ * Pre-warmed contexts handed out per request and reset on return
+ */
+
+#include "context_pool.h"
+#include "gc.h"
+#include "vm.h"
+#include "serialize.h"
+
+/* Log a property's references before it is overwritten or unlinked */
+static void context_pool_drop_property(mjs_gc_t* gc, mjs_property_t* prop) {
+    if (!mjs_gc_is_marking(gc)) return;
+    
+    if (prop->key) {
+        mjs_gc_satb_barrier(gc, prop->key);
+    }
+    mjs_gc_satb_barrier_value(gc, prop->value);
+}
+
+/* Globals whose values each context gets its own copy of. Functions and
+ * shared-heap objects are kept by reference. */
+static bool context_pool_is_copied(mjs_gc_t* gc, mjs_value_t value) {
+    return (value.tag == MJS_TAG_OBJECT || value.tag == MJS_TAG_ARRAY) &&
+           !mjs_gc_is_shared_object(gc, value.u.ptr);
+}
+
+/* Serialize the copied globals' values, in slot order, as one array so
+ * objects reached from several globals stay shared in the copies */
+static bool context_pool_take_snapshot(mjs_context_pool_t* pool) {
+    mjs_context_t* template_context = pool->template_context;
+    mjs_gc_t* gc = pool->runtime->gc;
+    mjs_object_t* layout = mjs_get_object(template_context->global_object);
+    
+    size_t count = 0;
+    for (mjs_property_t* slot = layout->properties; slot; slot = slot->next) {
+        if (context_pool_is_copied(gc, slot->value)) count++;
+    }
+    if (count == 0) return true;
+    
+    mjs_value_t values = mjs_array(template_context);
+    if (mjs_is_undefined(values)) return false;
+    
+    MJS_GC_PROTECT(gc, values.u.ptr);
+    bool ok = true;
+    for (mjs_property_t* slot = layout->properties; slot && ok; slot = slot->next) {
+        if (context_pool_is_copied(gc, slot->value)) {
+            ok = mjs_array_push(template_context, mjs_get_array(values), slot->value);
+        }
+    }
+    ok = ok && mjs_serialize(template_context, values, &pool->snapshot,
+                             &pool->snapshot_length) == MJS_OK;
+    MJS_GC_UNPROTECT(gc);
+    
+    return ok;
+}
+
+bool mjs_context_reset(mjs_context_t* ctx, mjs_context_pool_t* pool) {
+    if (!ctx || !pool) return false;
+    
+    mjs_gc_t* gc = ctx->runtime->gc;
+    mjs_object_t* global = mjs_get_object(ctx->global_object);
+    mjs_object_t* layout = mjs_get_object(pool->template_context->global_object);
+    if (!global || !layout) return false;
+    
+    // Copy the objects the globals refer to first, so a failure leaves
+    // the context as it was; the copies stay rooted until they are stored
+    mjs_array_t* copies = NULL;
+    if (pool->snapshot) {
+        mjs_value_t value;
+        if (mjs_deserialize(ctx, pool->snapshot, pool->snapshot_length, &value) != MJS_OK) {
+            return false;
+        }
+        copies = mjs_get_array(value);
+        MJS_GC_PROTECT(gc, copies);
+    }
+    
+    // Take the nodes the layout needs beyond those the context has up
+    // front, so running out of memory leaves the context as it was
+    size_t slots = 0;
+    for (mjs_property_t* slot = layout->properties; slot; slot = slot->next) {
+        slots++;
+    }
+    
+    size_t reusable = 0;
+    for (mjs_property_t* prop = global->properties;
+         prop && reusable < slots; prop = prop->next) {
+        reusable++;
+    }
+    
+    mjs_property_t* spare = NULL;
+    for (size_t i = reusable; i < slots; i++) {
+        mjs_property_t* node = MJS_MALLOC(sizeof(mjs_property_t));
+        if (!node) {
+            while (spare) {
+                mjs_property_t* next = spare->next;
+                MJS_FREE(spare);
+                spare = next;
+            }
+            if (copies) MJS_GC_UNPROTECT(gc);
+            return false;
+        }
+        node->next = spare;
+        spare = node;
+    }
+    
+    bool heap_locked = mjs_gc_lock_heap(gc);
+    
+    // Copy the template's slots over the context's nodes in list order
+    mjs_property_t** link = &global->properties;
+    size_t copied = 0;
+    for (mjs_property_t* slot = layout->properties; slot; slot = slot->next) {
+        mjs_property_t* prop = *link;
+        if (prop) {
+            context_pool_drop_property(gc, prop);
+        } else {
+            prop = spare;
+            spare = spare->next;
+            prop->next = NULL;
+            *link = prop;
+        }
+        
+        mjs_value_t value = slot->value;
+        if (copies && context_pool_is_copied(gc, value)) {
+            value = copies->elements[copied++];
+        }
+        
+        MJS_GC_WRITE_BARRIER(gc, global, slot->key);
+        MJS_GC_WRITE_BARRIER_VALUE(gc, global, value);
+        prop->key = slot->key;
+        prop->value = value;
+        prop->writable = slot->writable;
+        prop->enumerable = slot->enumerable;
+        prop->configurable = slot->configurable;
+        link = &prop->next;
+    }
+    
+    // Whatever the last request added beyond the template goes
+    mjs_property_t* extra = *link;
+    *link = NULL;
+    for (mjs_property_t* prop = extra; prop; prop = prop->next) {
+        context_pool_drop_property(gc, prop);
+    }
+    
+    if (global->prototype != layout->prototype) {
+        if (mjs_gc_is_marking(gc) && global->prototype) {
+            mjs_gc_satb_barrier(gc, global->prototype);
+        }
+        MJS_GC_WRITE_BARRIER(gc, global, layout->prototype);
+        global->prototype = layout->prototype;
+    }
+    global->extensible = layout->extensible;
+    global->property_count = slots;
+    
+    mjs_gc_unlock_heap(gc, heap_locked);
+    if (copies) MJS_GC_UNPROTECT(gc);
+    
+    while (extra) {
+        mjs_property_t* next = extra->next;
+        MJS_FREE(extra);
+        extra = next;
+    }
+    
+    // Execution state from the last request; the stacks stay allocated
+    mjs_vm_reset(ctx->vm);
+    mjs_clear_error(ctx);
+    
+    // Keep one handle block, as closing the outermost scope would
+    ctx->handle_count = 0;
+    while (ctx->handle_block_count > 1) {
+        MJS_FREE(ctx->handle_blocks[--ctx->handle_block_count]);
+    }
+    
+    return true;
+}
+
+/* A new context with the template's globals */
+static mjs_context_t* context_pool_create(mjs_context_pool_t* pool) {
+    mjs_context_t* ctx = mjs_new_context(pool->runtime);
+    if (!ctx) return NULL;
+    
+    if (!mjs_context_reset(ctx, pool)) {
+        mjs_free_context(ctx);
+        return NULL;
+    }
+    
+    return ctx;
+}
+
+mjs_context_pool_t* mjs_new_context_pool(mjs_runtime_t* rt, size_t capacity,
+                                         mjs_context_setup_t setup, void* opaque) {
+    if (!rt) return NULL;
+    
+    mjs_context_pool_t* pool = MJS_CALLOC(1, sizeof(mjs_context_pool_t));
+    if (!pool) return NULL;
+    
+    pool->runtime = rt;
+    pool->capacity = capacity;
+    pool->idle = capacity ? MJS_MALLOC(sizeof(mjs_context_t*) * capacity) : NULL;
+    pool->template_context = mjs_new_context(rt);
+    if ((capacity && !pool->idle) || !pool->template_context ||
+        (setup && !setup(pool->template_context, opaque))) {
+        mjs_free_context_pool(pool);
+        return NULL;
+    }
+    
+    // Whatever the setup left running is not part of the template
+    mjs_vm_reset(pool->template_context->vm);
+    mjs_clear_error(pool->template_context);
+    
+    if (!context_pool_take_snapshot(pool)) {
+        mjs_free_context_pool(pool);
+        return NULL;
+    }
+    
+    // Pre-warm; a shortfall is made up by later check-outs
+    while (pool->idle_count < capacity) {
+        mjs_context_t* ctx = context_pool_create(pool);
+        if (!ctx) break;
+        pool->idle[pool->idle_count++] = ctx;
+    }
+    
+    return pool;
+}
+
+void mjs_free_context_pool(mjs_context_pool_t* pool) {
+    if (!pool) return;
+    
+    // Checked-out contexts stay valid; their owners free them
+    while (pool->idle_count > 0) {
+        mjs_free_context(pool->idle[--pool->idle_count]);
+    }
+    if (pool->template_context) {
+        mjs_free_context(pool->template_context);
+    }
+    
+    MJS_FREE(pool->snapshot);
+    MJS_FREE(pool->idle);
+    MJS_FREE(pool);
+}
+
+mjs_context_t* mjs_context_pool_acquire(mjs_context_pool_t* pool) {
+    if (!pool) return NULL;
+    
+    // Most recently returned first, its memory is the likeliest cached
+    mjs_context_t* ctx = pool->idle_count > 0 ? pool->idle[--pool->idle_count]
+                                              : context_pool_create(pool);
+    if (ctx) {
+        pool->checked_out++;
+    }
+    
+    return ctx;
+}
+
+void mjs_context_pool_release(mjs_context_pool_t* pool, mjs_context_t* ctx) {
+    if (!pool || !ctx) return;
+    
+    if (pool->checked_out > 0) {
+        pool->checked_out--;
+    }
+    
+    if (pool->idle_count < pool->capacity &&
+        mjs_context_reset(ctx, pool)) {
+        pool->idle[pool->idle_count++] = ctx;
+        return;
+    }
+    
+    mjs_free_context(ctx);
+}
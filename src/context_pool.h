@@ -0,0 +1,58 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Context Pool
+ * Pre-warmed contexts handed out per request and reset on return
+ */
+
+#ifndef MIKOJS_CONTEXT_POOL_H
+#define MIKOJS_CONTEXT_POOL_H
+
+#include "mikojs_internal.h"
+
+/* Contexts are set up once, in a private template context, and copies
+ * of its global layout are checked out. The template's global object is
+ * the recorded state a returned context is reset to; the collector keeps
+ * it current when it moves objects. The objects and arrays its globals
+ * refer to are recorded as one serialized snapshot, so each reset gets
+ * its own copies and they keep sharing each other the way the
+ * template's do. */
+struct mjs_context_pool {
+    mjs_runtime_t* runtime;
+    mjs_context_t* template_context;
+    mjs_context_t** idle;       /* reset contexts ready to check out */
+    size_t idle_count;
+    size_t capacity;            /* idle contexts kept, and pre-warmed */
+    size_t checked_out;
+    void* snapshot;             /* copied globals' values, or NULL if none */
+    size_t snapshot_length;
+};
+
+/* Give ctx the template's global properties, prototype and
+ * extensibility, with fresh copies of the objects they refer to, and
+ * drop its stacks, handles and pending error. Stacks, handle blocks and
+ * property nodes are reused. Returns false, leaving the globals
+ * untouched, when memory runs out. */
+bool mjs_context_reset(mjs_context_t* ctx, mjs_context_pool_t* pool);
+
+#endif /* MIKOJS_CONTEXT_POOL_H */
@@ -25,33 +25,164 @@
  * Generational mark-and-sweep garbage collector with incremental collection
  */
 
+/* Anonymous mappings are an extension on top of the POSIX level the
+ * engine is built against */
+#ifndef _WIN32
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+#endif
+
 #include "gc.h"
 #include "mikojs_internal.h"
+#include "vm.h"
+#include "trace.h"
+#include "alloc_profiler.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 /* Internal GC constants */
 #define GC_INITIAL_HEAP_SIZE (1024 * 1024)  // 1MB
-#define GC_GROWTH_FACTOR 2
-#define GC_COLLECTION_THRESHOLD 0.8
-#define GC_YOUNG_GENERATION_SIZE (256 * 1024)  // 256KB
-#define GC_INCREMENTAL_STEP_SIZE 100
+#define GC_MAX_GROWTH_FACTOR 4  // the pacer never lets the heap grow past live * this
+#define GC_CPU_PERCENT 5  // default share of run time spent collecting
+#define GC_INCREMENTAL_STEP_SIZE 100  // objects scanned between deadline checks
+#define GC_INCREMENTAL_STEP_US 500  // keeps each marking step well under 1ms
+#define GC_INCREMENTAL_ALLOC_BYTES (64 * 1024)
+#define GC_PROMOTION_AGE 2  // minor collections a page survives before promotion
+#define GC_COMPACT_LIVE_PERCENT 50  // old pages emptier than this are evacuated
+#define GC_DECOMMIT_DELAY_US 1000000  // empty pages are kept this long in case they are needed again
+#define GC_DEDUP_MIN_LENGTH 8  // shorter strings cost less than the table entry
 
 /* GC object header manipulation */
 #define GC_HEADER_SIZE sizeof(mjs_gc_object_header_t)
+#define GC_CAGE_MAP_BITS (sizeof(size_t) * 8)
 #define GC_OBJECT_TO_HEADER(obj) ((mjs_gc_object_header_t*)((char*)(obj) - GC_HEADER_SIZE))
 #define GC_HEADER_TO_OBJECT(header) ((void*)((char*)(header) + GC_HEADER_SIZE))
 
-/* Mark bits */
-#define GC_MARK_WHITE 0
-#define GC_MARK_GRAY  1
-#define GC_MARK_BLACK 2
+/* Page layout */
+#define GC_ALIGN(size, alignment) (((size) + (alignment) - 1) & ~((size_t)(alignment) - 1))
+#define GC_PAGE_HEADER_SIZE GC_ALIGN(sizeof(mjs_gc_page_t), 16)
+#define GC_PAGE_CELL(page, i) ((mjs_gc_object_header_t*)((page)->cells + (i) * (page)->cell_size))
+#define GC_PAGE_TABLE_TOMBSTONE ((mjs_gc_page_t*)1)
+
+/* Every cell starts in the first GC_PAGE_SIZE bytes of its page, large
+ * pages included, so masking finds the page without a table lookup */
+#define GC_PAGE_OF(header) ((mjs_gc_page_t*)((uintptr_t)(header) & ~(uintptr_t)(GC_PAGE_SIZE - 1)))
+#define GC_CELL_INDEX(page, header) ((size_t)((char*)(header) - (page)->cells) / (page)->cell_size)
+
+/* Free-list link of a free cell, or the copy of an evacuated one */
+#define GC_CELL_LINK(header) (*(mjs_gc_object_header_t**)GC_HEADER_TO_OBJECT(header))
+
+/* Payload sizes of the small object size classes */
+static const size_t gc_size_classes[GC_SIZE_CLASS_COUNT] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512,
+    768, 1024, 1536, 2048, 3072, 4096, 6144, 8192
+};
 
 /* Forward declarations */
 static void gc_mark_object(mjs_gc_t* gc, void* obj);
+static void gc_mark_value(mjs_gc_t* gc, mjs_value_t value);
+static void gc_scan_object(mjs_gc_t* gc, mjs_gc_worker_t* worker, mjs_gc_object_header_t* header);
+static bool gc_drain_gray(mjs_gc_t* gc, uint64_t deadline_us);
+static void gc_drain_gray_all(mjs_gc_t* gc);
+static void gc_shade_object(mjs_gc_t* gc, mjs_gc_worker_t* worker, void* obj);
+static void gc_shade_value(mjs_gc_t* gc, mjs_gc_worker_t* worker, mjs_value_t value);
+static size_t gc_sweep_cells(mjs_gc_t* gc, mjs_gc_page_t* page, mjs_gc_free_batch_t** batch);
+static bool gc_sweep_page_finish(mjs_gc_t* gc, mjs_gc_page_t* page);
+static bool gc_parallel_sweep(mjs_gc_t* gc);
+static void gc_workers_shutdown(mjs_gc_t* gc);
+static void gc_start_marking(mjs_gc_t* gc, bool concurrent);
+static void gc_stop_marker(mjs_gc_t* gc);
+static void gc_drain_satb(mjs_gc_t* gc, bool take_partial);
+static void gc_finish_marking(mjs_gc_t* gc);
+static void gc_record_pause(mjs_gc_t* gc, uint64_t start_us);
 static void gc_mark_roots(mjs_gc_t* gc);
-static void gc_sweep(mjs_gc_t* gc);
+static bool gc_sweep_page(mjs_gc_t* gc, mjs_gc_page_t* page);
+static bool gc_sweep_next_page(mjs_gc_t* gc, int size_class);
+
+/* Which objects a weak pass treats as dead: the unmarked ones, the
+ * unmarked young ones, or only those a closing region already freed */
+typedef enum {
+    GC_WEAK_FULL,
+    GC_WEAK_YOUNG,
+    GC_WEAK_REGION
+} gc_weak_scope_t;
+
+static void gc_process_weak_refs(mjs_gc_t* gc, gc_weak_scope_t scope);
+static void gc_mark_ephemerons(mjs_gc_t* gc);
+static void gc_mark_ephemeron_values(mjs_gc_t* gc);
+static void gc_ephemeron_key_marked(mjs_gc_t* gc, void* key);
+static void gc_process_ephemeron_tables(mjs_gc_t* gc, gc_weak_scope_t scope);
+static void gc_dedup_strings(mjs_gc_t* gc);
+static void gc_ephemeron_table_rehash(mjs_ephemeron_table_t* table);
+static bool gc_collect(mjs_gc_t* gc, bool compact);
 static void gc_compact(mjs_gc_t* gc);
+static size_t gc_release_empty_pages(mjs_gc_t* gc);
+static void gc_sweep_finished(mjs_gc_t* gc);
 static bool gc_should_collect(mjs_gc_t* gc);
 static void gc_update_statistics(mjs_gc_t* gc);
+static mjs_gc_object_header_t* gc_region_allocate_cell(mjs_gc_t* gc, size_t size, mjs_gc_page_t** page_out);
+static void gc_region_clear_marks(mjs_gc_t* gc);
+static void gc_region_barrier(mjs_gc_t* gc, void* parent, void* child);
+static void gc_region_barrier_value(mjs_gc_t* gc, void* parent, mjs_value_t value);
+static void gc_region_move_page(mjs_gc_t* gc, mjs_gc_page_t* page, mjs_gc_region_t* region);
+
+/* Side mark bitmap. The concurrent marker, parallel markers and the
+ * allocating mutator can all touch cells sharing a bitmap word, so every
+ * update is an atomic read-modify-write of the whole word. */
+static inline int gc_page_get_mark(mjs_gc_page_t* page, size_t index) {
+    size_t word = mjs_atomic_load_size(&page->marks[index / GC_MARKS_PER_WORD]);
+    return (int)((word >> (index % GC_MARKS_PER_WORD * GC_MARK_BITS)) & 3);
+}
+
+static inline bool gc_page_cas_mark(mjs_gc_page_t* page, size_t index, int expected, int desired) {
+    volatile size_t* word = &page->marks[index / GC_MARKS_PER_WORD];
+    size_t shift = index % GC_MARKS_PER_WORD * GC_MARK_BITS;
+    
+    for (;;) {
+        size_t old_word = mjs_atomic_load_size(word);
+        if ((int)((old_word >> shift) & 3) != expected) return false;
+        
+        size_t new_word = (old_word & ~((size_t)3 << shift)) | ((size_t)desired << shift);
+        if (mjs_atomic_cas_size(word, old_word, new_word)) return true;
+    }
+}
+
+static inline void gc_page_set_mark(mjs_gc_page_t* page, size_t index, int mark) {
+    volatile size_t* word = &page->marks[index / GC_MARKS_PER_WORD];
+    size_t shift = index % GC_MARKS_PER_WORD * GC_MARK_BITS;
+    
+    for (;;) {
+        size_t old_word = mjs_atomic_load_size(word);
+        size_t new_word = (old_word & ~((size_t)3 << shift)) | ((size_t)mark << shift);
+        if (old_word == new_word || mjs_atomic_cas_size(word, old_word, new_word)) return;
+    }
+}
+
+/* Only while nothing else can be marking */
+static inline void gc_page_clear_marks(mjs_gc_page_t* page) {
+    memset((void*)page->marks, 0, sizeof(page->marks));
+}
+
+static inline int gc_get_mark(mjs_gc_object_header_t* header) {
+    mjs_gc_page_t* page = GC_PAGE_OF(header);
+    return gc_page_get_mark(page, GC_CELL_INDEX(page, header));
+}
+
+static inline bool gc_cas_mark(mjs_gc_object_header_t* header, int expected, int desired) {
+    mjs_gc_page_t* page = GC_PAGE_OF(header);
+    return gc_page_cas_mark(page, GC_CELL_INDEX(page, header), expected, desired);
+}
+
+static inline void gc_set_mark(mjs_gc_object_header_t* header, int mark) {
+    mjs_gc_page_t* page = GC_PAGE_OF(header);
+    gc_page_set_mark(page, GC_CELL_INDEX(page, header), mark);
+}
 
 /* GC creation and destruction */
 mjs_gc_t* mjs_gc_new(mjs_runtime_t* runtime) {
@@ -63,32 +194,28 @@ mjs_gc_t* mjs_gc_new(mjs_runtime_t* runtime) {
     // Store runtime reference
     gc->runtime = runtime;
     
-    // Initialize heap
-    size_t heap_size = GC_INITIAL_HEAP_SIZE;
-    gc->heap = MJS_MALLOC(heap_size);
-    if (!gc->heap) {
-        MJS_FREE(gc);
-        return NULL;
-    }
-    gc->heap_size = heap_size;
+    // Pages are reserved on demand; nothing is allocated up front
+    gc->heap_size = 0;
     gc->heap_used = 0;
-    gc->heap_ptr = gc->heap;
+    gc->allocation_budget = GC_INITIAL_HEAP_SIZE;
+    gc->pacing_window_start_us = mjs_gc_now_us();
+    gc->memory_limit = 0; // Unlimited
     
     // Initialize generations
-    gc->young_generation.objects = NULL;
+    gc->young_generation.pages = NULL;
     gc->young_generation.object_count = 0;
-    gc->young_generation.total_size = 0;
-    gc->young_generation.threshold = GC_YOUNG_GENERATION_SIZE;
     
-    gc->old_generation.objects = NULL;
+    gc->old_generation.pages = NULL;
     gc->old_generation.object_count = 0;
-    gc->old_generation.total_size = 0;
-    gc->old_generation.threshold = heap_size;
     
     // Initialize roots
     gc->roots = NULL;
     gc->root_count = 0;
     gc->root_capacity = 0;
+    gc->scoped_roots = NULL;
+    gc->scoped_root_count = 0;
+    gc->scoped_root_capacity = 0;
+    gc->scoped_root_dropped = 0;
     
     // Initialize gray stack for marking
     gc->gray_stack = NULL;
@@ -97,6 +224,7 @@ mjs_gc_t* mjs_gc_new(mjs_runtime_t* runtime) {
     
     // Initialize weak references
     gc->weak_refs = NULL;
+    gc->alloc_profiler = NULL;
     
     // Initialize statistics
     gc->stats.total_collections = 0;
@@ -111,8 +239,53 @@ mjs_gc_t* mjs_gc_new(mjs_runtime_t* runtime) {
     // Initialize configuration
     gc->config.incremental = true;
     gc->config.generational = true;
-    gc->config.collection_threshold = GC_COLLECTION_THRESHOLD;
     gc->config.max_heap_size = 0; // Unlimited
+    gc->config.incremental_step_us = GC_INCREMENTAL_STEP_US;
+    gc->config.incremental_alloc_bytes = GC_INCREMENTAL_ALLOC_BYTES;
+    gc->config.lazy_sweeping = true;
+    gc->config.concurrent_marking = false;
+    gc->config.parallel_threads = 0;
+    gc->config.compact_live_percent = GC_COMPACT_LIVE_PERCENT;
+    gc->config.gc_cpu_percent = GC_CPU_PERCENT;
+    gc->config.background_freeing = true;
+    gc->config.decommit_delay_us = GC_DECOMMIT_DELAY_US;
+    gc->config.huge_pages = false;
+    gc->config.string_dedup = false;
+    gc->incremental_step_size = GC_INCREMENTAL_STEP_SIZE;
+    
+    // The marker thread is started lazily by the first concurrent cycle
+    if (!mjs_mutex_init(&gc->heap_lock)) {
+        MJS_FREE(gc);
+        return NULL;
+    }
+    if (!mjs_cond_init(&gc->marker_cond)) {
+        mjs_mutex_destroy(&gc->heap_lock);
+        MJS_FREE(gc);
+        return NULL;
+    }
+    
+    // Parallel workers are likewise only started by the first big collection
+    if (!mjs_mutex_init(&gc->worker_lock)) {
+        mjs_cond_destroy(&gc->marker_cond);
+        mjs_mutex_destroy(&gc->heap_lock);
+        MJS_FREE(gc);
+        return NULL;
+    }
+    if (!mjs_cond_init(&gc->worker_cond)) {
+        mjs_mutex_destroy(&gc->worker_lock);
+        mjs_cond_destroy(&gc->marker_cond);
+        mjs_mutex_destroy(&gc->heap_lock);
+        MJS_FREE(gc);
+        return NULL;
+    }
+    if (!mjs_cond_init(&gc->worker_done_cond)) {
+        mjs_cond_destroy(&gc->worker_cond);
+        mjs_mutex_destroy(&gc->worker_lock);
+        mjs_cond_destroy(&gc->marker_cond);
+        mjs_mutex_destroy(&gc->heap_lock);
+        MJS_FREE(gc);
+        return NULL;
+    }
     
     // Initialize state
     gc->state = GC_STATE_IDLE;
@@ -121,550 +294,3509 @@ mjs_gc_t* mjs_gc_new(mjs_runtime_t* runtime) {
     return gc;
 }
 
-void mjs_gc_free(mjs_gc_t* gc) {
-    if (!gc) return;
+/* Run the type-specific cleanup for a dead object's off-heap memory */
+static void gc_finalize_object(mjs_gc_object_header_t* header) {
+    void* obj = GC_HEADER_TO_OBJECT(header);
     
-    // Free all objects
-    mjs_gc_collect(gc);
-    
-    // Free heap
-    if (gc->heap) {
-        MJS_FREE(gc->heap);
+    switch (header->type) {
+        case GC_TYPE_STRING:
+            mjs_string_free((mjs_string_t*)obj);
+            break;
+        case GC_TYPE_OBJECT:
+            mjs_object_free((mjs_object_t*)obj);
+            break;
+        case GC_TYPE_ARRAY:
+            mjs_array_free((mjs_array_t*)obj);
+            break;
+        default:
+            break;
     }
+}
+
+/* Background freeing */
+
+#define GC_FREE_PROPERTIES ((uintptr_t)1)
+
+/* The block gc_finalize_object would free for a dead object, as a batch
+ * entry, or NULL if it owns none */
+static void* gc_off_heap_memory(mjs_gc_object_header_t* header) {
+    void* obj = GC_HEADER_TO_OBJECT(header);
     
-    // Free roots array
-    if (gc->roots) {
-        MJS_FREE(gc->roots);
+    switch (header->type) {
+        case GC_TYPE_STRING: {
+            mjs_string_t* str = (mjs_string_t*)obj;
+            return str->data_owner ? NULL : str->data;
+        }
+        case GC_TYPE_OBJECT: {
+            mjs_property_t* props = ((mjs_object_t*)obj)->properties;
+            return props ? (void*)((uintptr_t)props | GC_FREE_PROPERTIES) : NULL;
+        }
+        case GC_TYPE_ARRAY:
+            return ((mjs_array_t*)obj)->elements;
+        default:
+            return NULL;
     }
-    
-    // Free gray stack
-    if (gc->gray_stack) {
-        MJS_FREE(gc->gray_stack);
+}
+
+static size_t gc_release_off_heap(void* entry) {
+    if (!((uintptr_t)entry & GC_FREE_PROPERTIES)) {
+        MJS_FREE(entry);
+        return 1;
     }
     
-    // Free weak references
-    mjs_weak_ref_t* weak_ref = gc->weak_refs;
-    while (weak_ref) {
-        mjs_weak_ref_t* next = weak_ref->next;
-        MJS_FREE(weak_ref);
-        weak_ref = next;
+    size_t freed = 0;
+    mjs_property_t* prop = (mjs_property_t*)((uintptr_t)entry & ~GC_FREE_PROPERTIES);
+    while (prop) {
+        mjs_property_t* next = prop->next;
+        MJS_FREE(prop);
+        prop = next;
+        freed++;
     }
-    
-    MJS_FREE(gc);
+    return freed;
 }
 
-/* Memory allocation */
-void* mjs_gc_alloc(mjs_gc_t* gc, size_t size, mjs_gc_object_type_t type) {
-    if (!gc || size == 0) return NULL;
-    
-    // Check if collection is needed
-    if (gc_should_collect(gc)) {
-        mjs_gc_collect(gc);
-    }
+static void gc_finalizer_main(void* arg) {
+    mjs_gc_t* gc = (mjs_gc_t*)arg;
     
-    // Calculate total size including header
-    size_t total_size = size + GC_HEADER_SIZE;
-    
-    // Check if we have enough space
-    if (gc->heap_used + total_size > gc->heap_size) {
-        // Try to collect first
-        mjs_gc_collect(gc);
+    mjs_mutex_lock(&gc->finalizer_lock);
+    for (;;) {
+        while (!gc->free_queue && !gc->finalizer_shutdown) {
+            mjs_cond_wait(&gc->finalizer_cond, &gc->finalizer_lock);
+        }
         
-        // If still not enough space, try to expand heap
-        if (gc->heap_used + total_size > gc->heap_size) {
-            size_t new_heap_size = gc->heap_size * GC_GROWTH_FACTOR;
-            if (gc->config.max_heap_size > 0 && new_heap_size > gc->config.max_heap_size) {
-                return NULL; // Out of memory
-            }
-            
-            void* new_heap = MJS_REALLOC(gc->heap, new_heap_size);
-            if (!new_heap) {
-                return NULL; // Out of memory
+        // Shutdown waits for the queue to run dry
+        mjs_gc_free_batch_t* batch = gc->free_queue;
+        if (!batch) break;
+        gc->free_queue = NULL;
+        gc->finalizer_busy = true;
+        mjs_mutex_unlock(&gc->finalizer_lock);
+        
+        MJS_TRACE_BEGIN("gc", "gc.background_free");
+        size_t freed = 0;
+        while (batch) {
+            mjs_gc_free_batch_t* next = batch->next;
+            for (size_t i = 0; i < batch->count; i++) {
+                freed += gc_release_off_heap(batch->entries[i]);
             }
-            
-            gc->heap = new_heap;
-            gc->heap_size = new_heap_size;
-            gc->heap_ptr = (char*)gc->heap + gc->heap_used;
+            MJS_FREE(batch);
+            batch = next;
         }
+        mjs_atomic_fetch_add_size(&gc->background_frees, freed);
+        MJS_TRACE_END1("gc", "gc.background_free", "blocks", freed);
+        
+        mjs_mutex_lock(&gc->finalizer_lock);
+        gc->finalizer_busy = false;
+        mjs_cond_broadcast(&gc->finalizer_idle_cond);
     }
-    
-    // Allocate object
-    mjs_gc_object_header_t* header = (mjs_gc_object_header_t*)gc->heap_ptr;
-    void* object = GC_HEADER_TO_OBJECT(header);
-    
-    // Initialize header
-    header->type = type;
-    header->size = size;
-    header->mark = GC_MARK_WHITE;
-    header->generation = 0; // Start in young generation
-    header->next = NULL;
-    
-    // Add to young generation
-    header->next = gc->young_generation.objects;
-    gc->young_generation.objects = header;
-    gc->young_generation.size += total_size;
-    
-    // Update heap pointers
-    gc->heap_used += total_size;
-    gc->heap_ptr = (char*)gc->heap_ptr + total_size;
-    
-    // Update statistics
-    gc->stats.total_allocations++;
-    gc->stats.total_bytes_allocated += total_size;
-    
-    return object;
+    mjs_mutex_unlock(&gc->finalizer_lock);
 }
 
-void mjs_gc_free_object(mjs_gc_t* gc, void* obj) {
-    if (!gc || !obj) return;
-    
-    mjs_gc_object_header_t* header = GC_OBJECT_TO_HEADER(obj);
+/* Start the finalizer thread if background freeing is on. Returns whether
+ * sweeps should record dead objects' memory instead of freeing it. */
+static bool gc_finalizer_ready(mjs_gc_t* gc) {
+    if (!gc->config.background_freeing) return false;
+    if (gc->finalizer_started) return true;
+    if (gc->finalizer_failed) return false;
     
-    // Remove from generation list
-    mjs_gc_generation_t* gen = (header->generation == 0) ? 
-        &gc->young_generation : &gc->old_generation;
+    gc->finalizer_failed = true;
+    if (!mjs_mutex_init(&gc->finalizer_lock)) return false;
+    if (!mjs_cond_init(&gc->finalizer_cond)) {
+        mjs_mutex_destroy(&gc->finalizer_lock);
+        return false;
+    }
+    if (!mjs_cond_init(&gc->finalizer_idle_cond)) {
+        mjs_cond_destroy(&gc->finalizer_cond);
+        mjs_mutex_destroy(&gc->finalizer_lock);
+        return false;
+    }
+    if (!mjs_thread_create(&gc->finalizer_thread, gc_finalizer_main, gc)) {
+        mjs_cond_destroy(&gc->finalizer_idle_cond);
+        mjs_cond_destroy(&gc->finalizer_cond);
+        mjs_mutex_destroy(&gc->finalizer_lock);
+        return false;
+    }
     
-    if (gen->objects == header) {
-        gen->objects = header->next;
-    } else {
-        mjs_gc_object_header_t* prev = gen->objects;
-        while (prev && prev->next != header) {
-            prev = prev->next;
+    gc->finalizer_failed = false;
+    gc->finalizer_started = true;
+    return true;
+}
+
+static void gc_queue_free_batch(mjs_gc_t* gc, mjs_gc_free_batch_t* batch) {
+    mjs_mutex_lock(&gc->finalizer_lock);
+    batch->next = gc->free_queue;
+    gc->free_queue = batch;
+    mjs_cond_signal(&gc->finalizer_cond);
+    mjs_mutex_unlock(&gc->finalizer_lock);
+}
+
+/* Record a block in the sweeping thread's batch, handing the batch over
+ * once it is full. Without memory for a new batch the block is freed on
+ * the spot. */
+static void gc_defer_free(mjs_gc_t* gc, mjs_gc_free_batch_t** slot, void* entry) {
+    mjs_gc_free_batch_t* batch = *slot;
+    if (!batch || batch->count == GC_FREE_BATCH_SIZE) {
+        if (batch) {
+            gc_queue_free_batch(gc, batch);
         }
-        if (prev) {
-            prev->next = header->next;
+        batch = MJS_MALLOC(sizeof(mjs_gc_free_batch_t));
+        *slot = batch;
+        if (!batch) {
+            gc_release_off_heap(entry);
+            return;
         }
+        batch->count = 0;
     }
-    
-    gen->size -= (header->size + GC_HEADER_SIZE);
-    
-    // Update statistics
-    gc->stats.total_deallocations++;
-    gc->stats.total_bytes_freed += (header->size + GC_HEADER_SIZE);
-    
-    // Note: We don't actually free the memory here in a real GC,
-    // as it would fragment the heap. Instead, we mark it as free
-    // and it will be reclaimed during compaction.
+    batch->entries[batch->count++] = entry;
 }
 
-/* Root management */
-bool mjs_gc_add_root(mjs_gc_t* gc, void* root) {
-    if (!gc || !root) return false;
-    
-    // Expand roots array if needed
-    if (gc->root_count >= gc->root_capacity) {
-        size_t new_capacity = gc->root_capacity == 0 ? 16 : gc->root_capacity * 2;
-        void** new_roots = MJS_REALLOC(gc->roots, sizeof(void*) * new_capacity);
-        if (!new_roots) return false;
-        
-        gc->roots = new_roots;
-        gc->root_capacity = new_capacity;
+static void gc_defer_finalize(mjs_gc_t* gc, mjs_gc_free_batch_t** slot, mjs_gc_object_header_t* header) {
+    void* entry = gc_off_heap_memory(header);
+    if (entry) {
+        gc_defer_free(gc, slot, entry);
     }
-    
-    gc->roots[gc->root_count++] = root;
-    return true;
 }
 
-bool mjs_gc_remove_root(mjs_gc_t* gc, void* root) {
-    if (!gc || !root) return false;
+/* Hand a partially filled batch to the finalizer thread */
+static void gc_flush_free_batch(mjs_gc_t* gc, mjs_gc_free_batch_t** slot) {
+    if (!*slot) return;
+    gc_queue_free_batch(gc, *slot);
+    *slot = NULL;
+}
+
+/* Flush the mutator's batch and wait until everything queued is freed */
+static void gc_finalizer_wait(mjs_gc_t* gc) {
+    if (!gc->finalizer_started) return;
+    gc_flush_free_batch(gc, &gc->free_batch);
     
-    for (size_t i = 0; i < gc->root_count; i++) {
-        if (gc->roots[i] == root) {
-            // Move last element to this position
-            gc->roots[i] = gc->roots[gc->root_count - 1];
-            gc->root_count--;
-            return true;
-        }
+    mjs_mutex_lock(&gc->finalizer_lock);
+    while (gc->free_queue || gc->finalizer_busy) {
+        mjs_cond_wait(&gc->finalizer_idle_cond, &gc->finalizer_lock);
     }
+    mjs_mutex_unlock(&gc->finalizer_lock);
+}
+
+static void gc_finalizer_shutdown(mjs_gc_t* gc) {
+    if (!gc->finalizer_started) return;
+    gc_flush_free_batch(gc, &gc->free_batch);
     
-    return false;
+    mjs_mutex_lock(&gc->finalizer_lock);
+    gc->finalizer_shutdown = true;
+    mjs_cond_signal(&gc->finalizer_cond);
+    mjs_mutex_unlock(&gc->finalizer_lock);
+    mjs_thread_join(gc->finalizer_thread);
+    
+    mjs_cond_destroy(&gc->finalizer_idle_cond);
+    mjs_cond_destroy(&gc->finalizer_cond);
+    mjs_mutex_destroy(&gc->finalizer_lock);
+    gc->finalizer_started = false;
 }
 
-/* Collection triggers */
-bool mjs_gc_collect(mjs_gc_t* gc) {
-    if (!gc) return false;
+static void gc_page_memory_free(void* memory) {
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+static void gc_page_release(mjs_gc_t* gc, mjs_gc_page_t* page);
+static void gc_unmap_chunk(void* memory, size_t size);
+
+void mjs_gc_free(mjs_gc_t* gc) {
+    if (!gc) return;
     
-    clock_t start_time = clock();
+    // Stop the marker thread before tearing down the heap it traces
+    gc_stop_marker(gc);
+    if (gc->marker_started) {
+        mjs_mutex_lock(&gc->heap_lock);
+        gc->marker_shutdown = true;
+        mjs_cond_signal(&gc->marker_cond);
+        mjs_mutex_unlock(&gc->heap_lock);
+        mjs_thread_join(gc->marker_thread);
+    }
+    gc_drain_satb(gc, true);
+    mjs_mutex_destroy(&gc->heap_lock);
+    mjs_cond_destroy(&gc->marker_cond);
     
-    // Mark phase
-    gc->state = GC_STATE_MARKING;
-    gc_mark_roots(gc);
+    gc_workers_shutdown(gc);
+    gc_finalizer_shutdown(gc);
+    mjs_alloc_profiler_stop(gc);
+    mjs_mutex_destroy(&gc->worker_lock);
+    mjs_cond_destroy(&gc->worker_cond);
+    mjs_cond_destroy(&gc->worker_done_cond);
     
-    // Process gray stack
-    while (gc->gray_count > 0) {
-        mjs_gc_object_header_t* obj = gc->gray_stack[--gc->gray_count];
-        gc_mark_object(gc, GC_HEADER_TO_OBJECT(obj));
+    // Pages of open regions, and emptied ones kept for the next region,
+    // go down with the rest of the heap
+    while (gc->region) {
+        mjs_gc_region_t* region = gc->region;
+        while (region->pages.pages) {
+            gc_region_move_page(gc, region->pages.pages, NULL);
+        }
+        gc->region = region->outer;
+        MJS_FREE(region);
     }
+    while (gc->region_pool.pages.pages) {
+        gc_region_move_page(gc, gc->region_pool.pages.pages, NULL);
+    }
+    MJS_FREE(gc->region_escapes);
     
-    // Sweep phase
-    gc->state = GC_STATE_SWEEPING;
-    gc_sweep(gc);
+    // Finalize every object still alive and release the pages
+    mjs_gc_generation_t* generations[2] = { &gc->young_generation, &gc->old_generation };
+    for (int g = 0; g < 2; g++) {
+        while (generations[g]->pages) {
+            mjs_gc_page_t* page = generations[g]->pages;
+            for (size_t i = 0; i < page->cell_count; i++) {
+                mjs_gc_object_header_t* header = GC_PAGE_CELL(page, i);
+                if (header->in_use) {
+                    gc_finalize_object(header);
+                }
+            }
+            gc_page_release(gc, page);
+        }
+    }
+    if (gc->cage_base) {
+        gc_unmap_chunk(gc->cage_base, (size_t)GC_CAGE_SIZE);
+    } else {
+        for (size_t i = 0; i < gc->page_cache_count; i++) {
+            gc_unmap_chunk(gc->page_cache[i], GC_PAGE_SIZE);
+        }
+    }
+    MJS_FREE(gc->page_cache);
+    MJS_FREE(gc->cage_free);
+    MJS_FREE(gc->cage_page_map);
     
-    // Compact phase (optional)
-    if (gc->config.compact) {
-        gc->state = GC_STATE_COMPACTING;
-        gc_compact(gc);
+    // Free page table
+    if (gc->page_table) {
+        MJS_FREE(gc->page_table);
     }
     
-    gc->state = GC_STATE_IDLE;
+    // Free roots array
+    if (gc->roots) {
+        MJS_FREE(gc->roots);
+    }
     
-    // Update statistics
-    clock_t end_time = clock();
-    gc->stats.collection_time += (end_time - start_time);
-    gc->stats.collections++;
+    if (gc->scoped_roots) {
+        MJS_FREE(gc->scoped_roots);
+    }
     
-    gc_update_statistics(gc);
+    if (gc->pinned) {
+        MJS_FREE(gc->pinned);
+    }
     
-    return true;
-}
-
-bool mjs_gc_collect_young(mjs_gc_t* gc) {
-    if (!gc || !gc->config.generational) {
-        return mjs_gc_collect(gc);
+    // Free gray stack
+    if (gc->gray_stack) {
+        MJS_FREE(gc->gray_stack);
     }
     
-    // Minor collection - only collect young generation
-    clock_t start_time = clock();
+    // Free weak references and ephemeron tables
+    for (size_t i = 0; i < gc->weak_ref_count; i++) {
+        MJS_FREE(gc->weak_refs[i]);
+    }
+    MJS_FREE(gc->weak_refs);
+    MJS_FREE(gc->cleared_weak_refs);
+    for (size_t i = 0; i < gc->ephemeron_table_count; i++) {
+        MJS_FREE(gc->ephemeron_tables[i]->entries);
+        MJS_FREE(gc->ephemeron_tables[i]);
+    }
+    MJS_FREE(gc->ephemeron_tables);
     
-    gc->state = GC_STATE_MARKING;
+    MJS_FREE(gc);
+}
+
+/* Page table: maps page addresses to pages so interior checks on arbitrary
+ * pointers never touch memory the collector does not own */
+static size_t gc_page_hash(mjs_gc_page_t* page, size_t capacity) {
+    uint64_t key = (uint64_t)((uintptr_t)page / GC_PAGE_SIZE);
+    return (size_t)(key * 0x9E3779B97F4A7C15ULL) & (capacity - 1);
+}
+
+static void gc_page_table_put(mjs_gc_page_t** table, size_t capacity, mjs_gc_page_t* page) {
+    size_t i = gc_page_hash(page, capacity);
+    while (table[i] && table[i] != GC_PAGE_TABLE_TOMBSTONE) {
+        i = (i + 1) & (capacity - 1);
+    }
+    table[i] = page;
+}
+
+static bool gc_page_table_insert(mjs_gc_t* gc, mjs_gc_page_t* page) {
+    if (gc->cage_base) {
+        size_t index = (size_t)((char*)page - gc->cage_base) / GC_PAGE_SIZE;
+        gc->cage_page_map[index / GC_CAGE_MAP_BITS] |= (size_t)1 << (index % GC_CAGE_MAP_BITS);
+        return true;
+    }
     
-    // Mark roots that point to young generation
-    for (size_t i = 0; i < gc->root_count; i++) {
-        void* obj = gc->roots[i];
-        if (obj) {
-            mjs_gc_object_header_t* header = GC_OBJECT_TO_HEADER(obj);
-            if (header->generation == 0) {
-                gc_mark_object(gc, obj);
+    // Keep the load factor (tombstones included) under one half
+    if ((gc->page_table_count + 1) * 2 > gc->page_table_capacity) {
+        size_t new_capacity = gc->page_table_capacity == 0 ? 64 : gc->page_table_capacity * 2;
+        mjs_gc_page_t** new_table = MJS_MALLOC(sizeof(mjs_gc_page_t*) * new_capacity);
+        if (!new_table) return false;
+        memset(new_table, 0, sizeof(mjs_gc_page_t*) * new_capacity);
+        
+        size_t count = 0;
+        for (size_t i = 0; i < gc->page_table_capacity; i++) {
+            mjs_gc_page_t* entry = gc->page_table[i];
+            if (entry && entry != GC_PAGE_TABLE_TOMBSTONE) {
+                gc_page_table_put(new_table, new_capacity, entry);
+                count++;
             }
         }
+        
+        if (gc->page_table) {
+            MJS_FREE(gc->page_table);
+        }
+        gc->page_table = new_table;
+        gc->page_table_capacity = new_capacity;
+        gc->page_table_count = count;
     }
     
-    // Mark objects in old generation that reference young objects
-    mjs_gc_object_header_t* old_obj = gc->old_generation.objects;
-    while (old_obj) {
-        // TODO: Implement remembered set or card marking
-        // For now, we'll skip this optimization
-        old_obj = old_obj->next;
+    gc_page_table_put(gc->page_table, gc->page_table_capacity, page);
+    gc->page_table_count++;
+    return true;
+}
+
+static void gc_page_table_remove(mjs_gc_t* gc, mjs_gc_page_t* page) {
+    if (gc->cage_base) {
+        size_t index = (size_t)((char*)page - gc->cage_base) / GC_PAGE_SIZE;
+        gc->cage_page_map[index / GC_CAGE_MAP_BITS] &= ~((size_t)1 << (index % GC_CAGE_MAP_BITS));
+        return;
     }
+    if (!gc->page_table) return;
     
-    // Process gray stack
-    while (gc->gray_count > 0) {
-        mjs_gc_object_header_t* obj = gc->gray_stack[--gc->gray_count];
-        if (obj->generation == 0) {
-            gc_mark_object(gc, GC_HEADER_TO_OBJECT(obj));
+    size_t i = gc_page_hash(page, gc->page_table_capacity);
+    while (gc->page_table[i]) {
+        if (gc->page_table[i] == page) {
+            gc->page_table[i] = GC_PAGE_TABLE_TOMBSTONE;
+            return;
         }
+        i = (i + 1) & (gc->page_table_capacity - 1);
     }
+}
+
+mjs_gc_page_t* mjs_gc_page_of(mjs_gc_t* gc, void* ptr) {
+    if (!gc || !ptr) return NULL;
     
-    // Sweep young generation
-    gc->state = GC_STATE_SWEEPING;
-    mjs_gc_object_header_t* young_obj = gc->young_generation.objects;
-    mjs_gc_object_header_t* prev = NULL;
+    mjs_gc_page_t* page = (mjs_gc_page_t*)((uintptr_t)ptr & ~(uintptr_t)(GC_PAGE_SIZE - 1));
     
-    while (young_obj) {
-        mjs_gc_object_header_t* next = young_obj->next;
-        
-        if (young_obj->mark == GC_MARK_WHITE) {
-            // Object is garbage - remove from list
-            if (prev) {
-                prev->next = next;
-            } else {
-                gc->young_generation.objects = next;
-            }
-            
-            gc->young_generation.size -= (young_obj->size + GC_HEADER_SIZE);
-            gc->stats.objects_freed++;
-            gc->stats.bytes_freed += (young_obj->size + GC_HEADER_SIZE);
-        } else {
-            // Object survived - promote to old generation if it's old enough
-            young_obj->generation++;
-            if (young_obj->generation >= 2) {
-                // Move to old generation
-                if (prev) {
-                    prev->next = next;
-                } else {
-                    gc->young_generation.objects = next;
-                }
-                
-                young_obj->next = gc->old_generation.objects;
-                gc->old_generation.objects = young_obj;
-                
-                size_t obj_size = young_obj->size + GC_HEADER_SIZE;
-                gc->young_generation.size -= obj_size;
-                gc->old_generation.size += obj_size;
-            } else {
-                prev = young_obj;
-            }
-            
-            // Reset mark for next collection
-            young_obj->mark = GC_MARK_WHITE;
-        }
-        
-        young_obj = next;
+    // In a cage the lookup is a range check and a bit test
+    if (gc->cage_base) {
+        uint64_t offset = (uint64_t)((uintptr_t)page - (uintptr_t)gc->cage_base);
+        if (offset >= GC_CAGE_SIZE) return NULL;
+        size_t index = (size_t)(offset / GC_PAGE_SIZE);
+        size_t word = gc->cage_page_map[index / GC_CAGE_MAP_BITS];
+        return (word >> (index % GC_CAGE_MAP_BITS)) & 1 ? page : NULL;
     }
     
-    gc->state = GC_STATE_IDLE;
-    
-    // Update statistics
-    clock_t end_time = clock();
-    gc->stats.collection_time += (end_time - start_time);
-    gc->stats.collections++;
+    if (!gc->page_table) return NULL;
+    size_t i = gc_page_hash(page, gc->page_table_capacity);
+    while (gc->page_table[i]) {
+        if (gc->page_table[i] == page) {
+            return page;
+        }
+        i = (i + 1) & (gc->page_table_capacity - 1);
+    }
     
-    return true;
+    return NULL;
 }
 
-bool mjs_gc_collect_incremental(mjs_gc_t* gc, uint64_t time_limit_us) {
-    if (!gc || !gc->config.incremental) {
-        return mjs_gc_collect(gc);
+/* Page management */
+static mjs_gc_generation_t* gc_page_generation(mjs_gc_t* gc, mjs_gc_page_t* page) {
+    if (page->region) {
+        return &page->region->pages;
     }
-    
-    // Perform incremental collection step
-    switch (gc->state) {
-        case GC_STATE_IDLE:
-            gc->state = GC_STATE_MARKING;
-            gc->incremental_step = 0;
-            gc_mark_roots(gc);
-            break;
-            
-        case GC_STATE_MARKING: {
-            // Process some objects from gray stack
-            size_t processed = 0;
-            while (gc->gray_count > 0 && processed < GC_INCREMENTAL_STEP_SIZE) {
-                mjs_gc_object_header_t* obj = gc->gray_stack[--gc->gray_count];
-                gc_mark_object(gc, GC_HEADER_TO_OBJECT(obj));
-                processed++;
-            }
-            
-            if (gc->gray_count == 0) {
-                gc->state = GC_STATE_SWEEPING;
-                gc->incremental_step = 0;
-            }
-            break;
+    return page->generation == 0 ? &gc->young_generation : &gc->old_generation;
+}
+
+static void gc_page_link(mjs_gc_generation_t* gen, mjs_gc_page_t* page) {
+    page->prev = NULL;
+    page->next = gen->pages;
+    if (gen->pages) {
+        gen->pages->prev = page;
+    }
+    gen->pages = page;
+    gen->page_count++;
+}
+
+static void gc_page_unlink(mjs_gc_generation_t* gen, mjs_gc_page_t* page) {
+    if (page->prev) {
+        page->prev->next = page->next;
+    } else {
+        gen->pages = page->next;
+    }
+    if (page->next) {
+        page->next->prev = page->prev;
+    }
+    page->next = page->prev = NULL;
+    gen->page_count--;
+}
+
+static void* gc_page_memory_alloc(size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, GC_PAGE_SIZE);
+#else
+    void* memory = NULL;
+    if (posix_memalign(&memory, GC_PAGE_SIZE, size) != 0) {
+        return NULL;
+    }
+    return memory;
+#endif
+}
+
+static size_t gc_os_page_size(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    long page_size = sysconf(_SC_PAGESIZE);
+    return page_size > 0 ? (size_t)page_size : 4096;
+#endif
+}
+
+/* Map a zeroed, GC_PAGE_SIZE aligned chunk, or without commit only
+ * reserve the address range. The size is a multiple of the OS page size. */
+static void* gc_map_chunk(size_t size, bool commit) {
+#ifdef _WIN32
+    // Allocations start on the 64KB allocation granularity already
+    if (!commit) {
+        return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+    }
+    return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    // Over-map by one page and trim the unaligned ends
+    size_t span = size + GC_PAGE_SIZE;
+    int prot = commit ? PROT_READ | PROT_WRITE : PROT_NONE;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | (commit ? 0 : MAP_NORESERVE);
+    char* memory = mmap(NULL, span, prot, flags, -1, 0);
+    if (memory == MAP_FAILED) return NULL;
+    
+    char* aligned = (char*)GC_ALIGN((uintptr_t)memory, GC_PAGE_SIZE);
+    size_t head = (size_t)(aligned - memory);
+    if (head > 0) {
+        munmap(memory, head);
+    }
+    size_t tail = span - head - size;
+    if (tail > 0) {
+        munmap(aligned + size, tail);
+    }
+    return aligned;
+#endif
+}
+
+static void gc_unmap_chunk(void* memory, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munmap(memory, size);
+#endif
+}
+
+/* Cage ranges are committed and decommitted in place */
+static bool gc_cage_commit(void* memory, size_t size) {
+#ifdef _WIN32
+    return VirtualAlloc(memory, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    return mprotect(memory, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+static void gc_cage_decommit(void* memory, size_t size) {
+#ifdef _WIN32
+    VirtualFree(memory, size, MEM_DECOMMIT);
+#else
+    madvise(memory, size, MADV_DONTNEED);
+    mprotect(memory, size, PROT_NONE);
+#endif
+}
+
+/* Take a chunk from the cage: the first released range that fits, or
+ * the untouched space at the front. Ranges are whole GC_PAGE_SIZE
+ * granules so every chunk stays page aligned. */
+static void* gc_cage_alloc(mjs_gc_t* gc, size_t size) {
+    size_t span = GC_ALIGN(size, GC_PAGE_SIZE);
+    
+    size_t i = 0;
+    while (i < gc->cage_free_count && gc->cage_free[i].size < span) {
+        i++;
+    }
+    
+    size_t offset = i < gc->cage_free_count ? gc->cage_free[i].offset : gc->cage_top;
+    if (i == gc->cage_free_count && span > (size_t)GC_CAGE_SIZE - gc->cage_top) {
+        return NULL;
+    }
+    if (!gc_cage_commit(gc->cage_base + offset, size)) return NULL;
+    
+    if (i < gc->cage_free_count) {
+        mjs_gc_cage_range_t* range = &gc->cage_free[i];
+        range->offset += span;
+        range->size -= span;
+        if (range->size == 0) {
+            *range = gc->cage_free[--gc->cage_free_count];
+        }
+    } else {
+        gc->cage_top += span;
+    }
+    return gc->cage_base + offset;
+}
+
+static void gc_cage_release(mjs_gc_t* gc, void* memory, size_t size) {
+    size_t span = GC_ALIGN(size, GC_PAGE_SIZE);
+    size_t offset = (size_t)((char*)memory - gc->cage_base);
+    gc_cage_decommit(memory, size);
+    
+    if (offset + span == gc->cage_top) {
+        gc->cage_top = offset;
+        return;
+    }
+    
+    if (gc->cage_free_count == gc->cage_free_capacity) {
+        size_t capacity = gc->cage_free_capacity == 0 ? 16 : gc->cage_free_capacity * 2;
+        mjs_gc_cage_range_t* ranges = MJS_REALLOC(gc->cage_free, sizeof(mjs_gc_cage_range_t) * capacity);
+        // Without room the address range is lost, the memory is not
+        if (!ranges) return;
+        gc->cage_free = ranges;
+        gc->cage_free_capacity = capacity;
+    }
+    gc->cage_free[gc->cage_free_count].offset = offset;
+    gc->cage_free[gc->cage_free_count].size = span;
+    gc->cage_free_count++;
+}
+
+/* Heap chunks come from the cage when one is reserved */
+static void* gc_chunk_map(mjs_gc_t* gc, size_t size) {
+    return gc->cage_base ? gc_cage_alloc(gc, size) : gc_map_chunk(size, true);
+}
+
+static void gc_chunk_unmap(mjs_gc_t* gc, void* memory, size_t size) {
+    if (gc->cage_base) {
+        gc_cage_release(gc, memory, size);
+    } else {
+        gc_unmap_chunk(memory, size);
+    }
+}
+
+bool mjs_gc_reserve_cage(mjs_gc_t* gc) {
+    if (!gc) return false;
+    if (gc->cage_base) return true;
+#if UINTPTR_MAX <= 0xFFFFFFFFu
+    return false;
+#else
+    if (gc->young_generation.page_count > 0 || gc->old_generation.page_count > 0) {
+        return false;
+    }
+    
+    size_t* page_map = MJS_CALLOC(GC_CAGE_PAGES / GC_CAGE_MAP_BITS, sizeof(size_t));
+    if (!page_map) return false;
+    char* base = gc_map_chunk((size_t)GC_CAGE_SIZE, false);
+    if (!base) {
+        MJS_FREE(page_map);
+        return false;
+    }
+    
+    // Cached pages lie outside the cage
+    while (gc->page_cache_count > 0) {
+        gc_unmap_chunk(gc->page_cache[--gc->page_cache_count], GC_PAGE_SIZE);
+    }
+    
+    gc->cage_base = base;
+    gc->cage_top = 0;
+    gc->cage_page_map = page_map;
+    return true;
+#endif
+}
+
+/* Hand a mapped chunk's memory back to the OS but keep the range.
+ * MADV_DONTNEED rather than MADV_FREE: the drop in RSS is immediate, which
+ * is what container memory limits look at. */
+static void gc_decommit_chunk(void* memory, size_t size) {
+#ifdef _WIN32
+    VirtualFree(memory, size, MEM_DECOMMIT);
+#else
+    madvise(memory, size, MADV_DONTNEED);
+#endif
+}
+
+/* Back a decommitted chunk again; on POSIX it refaults as zero pages */
+static bool gc_recommit_chunk(void* memory, size_t size) {
+#ifdef _WIN32
+    return VirtualAlloc(memory, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    (void)memory;
+    (void)size;
+    return true;
+#endif
+}
+
+/* Transparent huge pages only form where a 2MB aligned extent of one
+ * mapping carries the advice, so neighbouring old pages have to merge */
+static void gc_advise_huge_pages(mjs_gc_page_t* page) {
+#ifdef MADV_HUGEPAGE
+    madvise(page, page->chunk_size, MADV_HUGEPAGE);
+#else
+    (void)page;
+#endif
+}
+
+static void gc_page_cache_put(mjs_gc_t* gc, void* memory) {
+    if (gc->page_cache_count == gc->page_cache_capacity) {
+        size_t capacity = gc->page_cache_capacity == 0 ? 16 : gc->page_cache_capacity * 2;
+        if (capacity > GC_PAGE_CACHE_MAX) {
+            capacity = GC_PAGE_CACHE_MAX;
+        }
+        void** cache = capacity > gc->page_cache_capacity ?
+            MJS_REALLOC(gc->page_cache, sizeof(void*) * capacity) : NULL;
+        if (!cache) {
+            gc_chunk_unmap(gc, memory, GC_PAGE_SIZE);
+            return;
+        }
+        gc->page_cache = cache;
+        gc->page_cache_capacity = capacity;
+    }
+    
+    gc_decommit_chunk(memory, GC_PAGE_SIZE);
+    gc->page_cache[gc->page_cache_count++] = memory;
+    gc->stats.pages_decommitted++;
+}
+
+static void* gc_page_cache_take(mjs_gc_t* gc) {
+    while (gc->page_cache_count > 0) {
+        void* memory = gc->page_cache[--gc->page_cache_count];
+        if (gc_recommit_chunk(memory, GC_PAGE_SIZE)) {
+            return memory;
+        }
+        gc_chunk_unmap(gc, memory, GC_PAGE_SIZE);
+    }
+    return NULL;
+}
+
+/* Thread every cell of an empty page onto its free list in address order */
+static void gc_page_thread_cells(mjs_gc_page_t* page) {
+    page->free_cells = NULL;
+    for (size_t i = page->cell_count; i-- > 0;) {
+        mjs_gc_object_header_t* header = GC_PAGE_CELL(page, i);
+        header->in_use = false;
+        GC_CELL_LINK(header) = page->free_cells;
+        page->free_cells = header;
+    }
+}
+
+static mjs_gc_page_t* gc_page_new(mjs_gc_t* gc, int size_class, size_t object_size) {
+    size_t cell_size;
+    size_t chunk_size;
+    bool mapped = false;
+    
+    if (size_class == GC_LARGE_SIZE_CLASS) {
+        cell_size = GC_ALIGN(GC_HEADER_SIZE + object_size, 8);
+        chunk_size = GC_PAGE_HEADER_SIZE + cell_size;
+        // Inside a cage malloc is no option, so every large object is mapped
+        if (object_size >= GC_LARGE_OBJECT_THRESHOLD || gc->cage_base) {
+            chunk_size = GC_ALIGN(chunk_size, gc_os_page_size());
+            mapped = true;
+        }
+    } else {
+        cell_size = GC_ALIGN(GC_HEADER_SIZE + gc_size_classes[size_class], 8);
+        chunk_size = GC_PAGE_SIZE;
+    }
+    
+    if (gc->config.max_heap_size > 0 && gc->heap_size + chunk_size > gc->config.max_heap_size) {
+        return NULL;
+    }
+    if (gc->memory_limit > 0 && gc->heap_size + chunk_size > gc->memory_limit) {
+        return NULL;
+    }
+    
+    // Small pages are mapped too, so they can be decommitted once empty
+    mjs_gc_page_t* page;
+    if (size_class != GC_LARGE_SIZE_CLASS) {
+        page = gc_page_cache_take(gc);
+        if (!page) {
+            page = gc_chunk_map(gc, chunk_size);
+        }
+    } else {
+        page = mapped ? gc_chunk_map(gc, chunk_size) : gc_page_memory_alloc(chunk_size);
+    }
+    if (!page) return NULL;
+    
+    // The concurrent marker validates pointers against the page table
+    bool heap_locked = mjs_gc_lock_heap(gc);
+    bool inserted = gc_page_table_insert(gc, page);
+    mjs_gc_unlock_heap(gc, heap_locked);
+    if (!inserted) {
+        if (size_class != GC_LARGE_SIZE_CLASS || mapped) {
+            gc_chunk_unmap(gc, page, chunk_size);
+        } else {
+            gc_page_memory_free(page);
+        }
+        return NULL;
+    }
+    
+    memset(page, 0, sizeof(mjs_gc_page_t));
+    page->chunk_size = chunk_size;
+    page->cell_size = cell_size;
+    page->size_class = size_class;
+    page->cells = (char*)page + GC_PAGE_HEADER_SIZE;
+    page->cell_count = (chunk_size - GC_PAGE_HEADER_SIZE) / cell_size;
+    page->swept = true;
+    page->mapped = mapped;
+    gc_page_thread_cells(page);
+    
+    gc_page_link(&gc->young_generation, page);
+    gc->heap_size += chunk_size;
+    
+    if (mapped) {
+        page->next_large = gc->large_objects;
+        if (gc->large_objects) {
+            gc->large_objects->prev_large = page;
+        }
+        gc->large_objects = page;
+        gc->large_object_count++;
+        gc->large_object_bytes += chunk_size;
+    }
+    
+    return page;
+}
+
+static void gc_page_release(mjs_gc_t* gc, mjs_gc_page_t* page) {
+    gc_page_unlink(gc_page_generation(gc, page), page);
+    bool heap_locked = mjs_gc_lock_heap(gc);
+    gc_page_table_remove(gc, page);
+    mjs_gc_unlock_heap(gc, heap_locked);
+    gc->heap_size -= page->chunk_size;
+    
+    if (page->size_class != GC_LARGE_SIZE_CLASS) {
+        gc_page_cache_put(gc, page);
+        return;
+    }
+    if (!page->mapped) {
+        gc_page_memory_free(page);
+        return;
+    }
+    
+    if (page->prev_large) {
+        page->prev_large->next_large = page->next_large;
+    } else {
+        gc->large_objects = page->next_large;
+    }
+    if (page->next_large) {
+        page->next_large->prev_large = page->prev_large;
+    }
+    gc->large_object_count--;
+    gc->large_object_bytes -= page->chunk_size;
+    gc_chunk_unmap(gc, page, page->chunk_size);
+}
+
+static void gc_free_list_push(mjs_gc_t* gc, mjs_gc_page_t* page) {
+    // Region pages are only ever filled by their region
+    if (page->in_free_list || page->size_class == GC_LARGE_SIZE_CLASS || page->region) return;
+    
+    page->next_free = gc->free_pages[page->size_class];
+    gc->free_pages[page->size_class] = page;
+    page->in_free_list = true;
+}
+
+/* Put a cell back on its page's free list. Touches nothing but the page,
+ * so parallel sweepers can do this for the pages they own. */
+static void gc_release_cell(mjs_gc_page_t* page, mjs_gc_object_header_t* header) {
+    header->in_use = false;
+    gc_page_set_mark(page, GC_CELL_INDEX(page, header), GC_MARK_WHITE);
+    GC_CELL_LINK(header) = page->free_cells;
+    page->free_cells = header;
+    page->live_count--;
+}
+
+static void gc_account_freed(mjs_gc_t* gc, mjs_gc_generation_t* gen, size_t objects, size_t bytes) {
+    gc->heap_used -= bytes;
+    gen->size -= bytes;
+    gen->object_count -= objects;
+    
+    // Update statistics
+    gc->stats.objects_freed += objects;
+    gc->stats.bytes_freed += bytes;
+    gc->stats.total_deallocations += objects;
+    gc->stats.total_bytes_freed += bytes;
+}
+
+/* Return a cell to its page. Does not run the finalizer. */
+static void gc_free_cell(mjs_gc_t* gc, mjs_gc_page_t* page, mjs_gc_object_header_t* header) {
+    gc_release_cell(page, header);
+    gc_account_freed(gc, gc_page_generation(gc, page), 1, page->cell_size);
+}
+
+static int gc_size_class(size_t size) {
+    for (int i = 0; i < GC_SIZE_CLASS_COUNT; i++) {
+        if (size <= gc_size_classes[i]) {
+            return i;
+        }
+    }
+    return GC_LARGE_SIZE_CLASS;
+}
+
+/* Find a free cell for an object of the given size. Small size classes are
+ * served from pages with free cells first, then by lazily sweeping a page
+ * left over from the last cycle, and only then by reserving a new page.
+ * Inside a region the region's own pages serve instead. */
+static mjs_gc_object_header_t* gc_allocate_cell(mjs_gc_t* gc, size_t size, mjs_gc_page_t** page_out) {
+    if (gc->region) {
+        return gc_region_allocate_cell(gc, size, page_out);
+    }
+    
+    int size_class = gc_size_class(size);
+    mjs_gc_page_t* page;
+    
+    if (size_class == GC_LARGE_SIZE_CLASS) {
+        // Reclaim dead large objects before reserving more memory
+        while (gc_sweep_next_page(gc, GC_LARGE_SIZE_CLASS)) {
+        }
+        
+        page = gc_page_new(gc, GC_LARGE_SIZE_CLASS, size);
+        if (!page) return NULL;
+    } else {
+        for (;;) {
+            page = gc->free_pages[size_class];
+            if (page) break;
+            
+            if (gc_sweep_next_page(gc, size_class)) continue;
+            
+            page = gc_page_new(gc, size_class, 0);
+            if (!page) return NULL;
+            gc_free_list_push(gc, page);
+        }
+    }
+    
+    mjs_gc_object_header_t* header = page->free_cells;
+    page->free_cells = GC_CELL_LINK(header);
+    page->live_count++;
+    page->empty_since_us = 0;
+    
+    if (!page->free_cells && page->in_free_list) {
+        // Pages are only ever taken from the head of the list
+        gc->free_pages[size_class] = page->next_free;
+        page->next_free = NULL;
+        page->in_free_list = false;
+    }
+    
+    *page_out = page;
+    return header;
+}
+
+/* Objects allocated during a cycle must survive it: black while marking,
+ * and black on pages the sweeper has not reached yet */
+static int gc_allocation_color(mjs_gc_t* gc, mjs_gc_page_t* page) {
+    switch (gc->state) {
+        case GC_STATE_MARKING:
+            return GC_MARK_BLACK;
+        case GC_STATE_SWEEPING:
+            return page->swept ? GC_MARK_WHITE : GC_MARK_BLACK;
+        default:
+            return GC_MARK_WHITE;
+    }
+}
+
+/* Memory allocation */
+void* mjs_gc_alloc(mjs_gc_t* gc, size_t size, mjs_gc_object_type_t type) {
+    if (!gc || size == 0 || size > UINT32_MAX) return NULL;
+    
+    // Interleave marking with allocation: every incremental_alloc_bytes
+    // allocated during a cycle pays for one time-bounded marking step.
+    // Sweeping needs no help here; the allocator sweeps pages on demand.
+    // Region allocations are freed with their region and pay for nothing.
+    if (gc->region) {
+        // Collection is left to the region's end
+    } else if (gc->state == GC_STATE_MARKING) {
+        gc->bytes_since_step += size + GC_HEADER_SIZE;
+        if (gc->bytes_since_step >= gc->config.incremental_alloc_bytes) {
+            gc->bytes_since_step = 0;
+            mjs_gc_collect_incremental(gc, gc->config.incremental_step_us);
+        }
+    } else if (gc_should_collect(gc)) {
+        // Check if collection is needed
+        if (gc->config.incremental) {
+            mjs_gc_collect_incremental(gc, gc->config.incremental_step_us);
+        } else {
+            gc_collect(gc, false);
+        }
+    }
+    
+    mjs_gc_page_t* page = NULL;
+    mjs_gc_object_header_t* header = gc_allocate_cell(gc, size, &page);
+    if (!header) {
+        // Heap limit reached - collect everything and try once more
+        gc_collect(gc, false);
+        mjs_gc_finish_sweeping(gc);
+        
+        header = gc_allocate_cell(gc, size, &page);
+        if (!header && gc_release_empty_pages(gc) > 0) {
+            // Empty pages of other size classes made room
+            header = gc_allocate_cell(gc, size, &page);
+        }
+        if (!header) {
+            // Out of memory; the embedder or the VM reports it
+            gc->out_of_memory = true;
+            gc->stats.out_of_memory_errors++;
+            return NULL;
+        }
+    }
+    
+    void* object = GC_HEADER_TO_OBJECT(header);
+    
+    // Initialize header
+    header->type = (uint8_t)type;
+    header->size = (uint32_t)size;
+    header->in_use = true;
+    header->escaped_to = 0;
+    gc_page_set_mark(page, GC_CELL_INDEX(page, header), gc_allocation_color(gc, page));
+    
+    // Cells are reused, so clear whatever the previous occupant left behind
+    // before tracing or a finalizer can see it
+    memset(object, 0, size);
+    
+    if (gc->alloc_profiler) {
+        if (page->cell_size >= gc->bytes_until_sample) {
+            mjs_alloc_profiler_sample(gc->alloc_profiler, object, type, page->cell_size);
+        } else {
+            gc->bytes_until_sample -= page->cell_size;
+        }
+    }
+    
+    mjs_gc_generation_t* gen = gc_page_generation(gc, page);
+    gen->size += page->cell_size;
+    gen->object_count++;
+    gc->heap_used += page->cell_size;
+    if (!page->region) {
+        gc->bytes_since_collection += page->cell_size;
+        gc->pacing_allocated += page->cell_size;
+    }
+    
+    // Update statistics
+    gc->stats.total_allocations++;
+    gc->stats.total_bytes_allocated += page->cell_size;
+    gc->stats.objects_allocated++;
+    gc->stats.bytes_allocated += page->cell_size;
+    if (gc->heap_size > gc->stats.peak_memory_usage) {
+        gc->stats.peak_memory_usage = gc->heap_size;
+    }
+    
+    return object;
+}
+
+void mjs_gc_free_object(mjs_gc_t* gc, void* obj) {
+    if (!gc || !obj || !mjs_gc_is_valid_object(gc, obj)) return;
+    
+    mjs_gc_page_t* page = mjs_gc_page_of(gc, obj);
+    gc_free_cell(gc, page, GC_OBJECT_TO_HEADER(obj));
+    
+    if (page->size_class == GC_LARGE_SIZE_CLASS) {
+        // An unswept large page is still queued; the sweeper releases it
+        if (page->swept) {
+            gc_page_release(gc, page);
+        }
+    } else {
+        gc_free_list_push(gc, page);
+    }
+}
+
+/* Root management */
+bool mjs_gc_add_root(mjs_gc_t* gc, void* root) {
+    if (!gc || !root) return false;
+    
+    // Expand roots array if needed
+    if (gc->root_count >= gc->root_capacity) {
+        size_t new_capacity = gc->root_capacity == 0 ? 16 : gc->root_capacity * 2;
+        void** new_roots = MJS_REALLOC(gc->roots, sizeof(void*) * new_capacity);
+        if (!new_roots) return false;
+        
+        gc->roots = new_roots;
+        gc->root_capacity = new_capacity;
+    }
+    
+    gc->roots[gc->root_count++] = root;
+    return true;
+}
+
+bool mjs_gc_remove_root(mjs_gc_t* gc, void* root) {
+    if (!gc || !root) return false;
+    
+    for (size_t i = 0; i < gc->root_count; i++) {
+        if (gc->roots[i] == root) {
+            // Move last element to this position
+            gc->roots[i] = gc->roots[gc->root_count - 1];
+            gc->root_count--;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void mjs_gc_push_root(mjs_gc_t* gc, mjs_gc_object_t* obj) {
+    if (!gc) return;
+    
+    // Once a push is lost every later one is too, until the pops unwind
+    // past it; that keeps the drop count a suffix of the stack
+    if (gc->scoped_root_dropped > 0) {
+        gc->scoped_root_dropped++;
+        return;
+    }
+    
+    if (gc->scoped_root_count >= gc->scoped_root_capacity) {
+        size_t new_capacity = gc->scoped_root_capacity == 0 ? 64 : gc->scoped_root_capacity * 2;
+        void** new_roots = MJS_REALLOC(gc->scoped_roots, sizeof(void*) * new_capacity);
+        if (!new_roots) {
+            gc->scoped_root_dropped++;
+            return;
+        }
+        
+        gc->scoped_roots = new_roots;
+        gc->scoped_root_capacity = new_capacity;
+    }
+    
+    gc->scoped_roots[gc->scoped_root_count++] = obj;
+}
+
+void mjs_gc_pop_root(mjs_gc_t* gc) {
+    if (!gc) return;
+    
+    if (gc->scoped_root_dropped > 0) {
+        gc->scoped_root_dropped--;
+    } else if (gc->scoped_root_count > 0) {
+        gc->scoped_root_count--;
+    }
+}
+
+bool mjs_gc_pin_object(mjs_gc_t* gc, void* obj) {
+    if (!gc || !obj) return false;
+    
+    if (gc->pinned_count >= gc->pinned_capacity) {
+        size_t new_capacity = gc->pinned_capacity == 0 ? 16 : gc->pinned_capacity * 2;
+        void** new_pinned = MJS_REALLOC(gc->pinned, sizeof(void*) * new_capacity);
+        if (!new_pinned) return false;
+        
+        gc->pinned = new_pinned;
+        gc->pinned_capacity = new_capacity;
+    }
+    
+    gc->pinned[gc->pinned_count++] = obj;
+    return true;
+}
+
+bool mjs_gc_unpin_object(mjs_gc_t* gc, void* obj) {
+    if (!gc || !obj) return false;
+    
+    // Pins nest: each unpin drops one
+    for (size_t i = 0; i < gc->pinned_count; i++) {
+        if (gc->pinned[i] == obj) {
+            gc->pinned[i] = gc->pinned[gc->pinned_count - 1];
+            gc->pinned_count--;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+/* Collection triggers */
+bool mjs_gc_collect(mjs_gc_t* gc) {
+    if (!gc) return false;
+    return gc_collect(gc, gc->config.compact);
+}
+
+/* Full collection. Compaction moves objects, so it is only done when the
+ * embedder asks for a collection: whoever calls into the allocator may be
+ * holding raw pointers to unpinned objects. */
+static bool gc_collect(mjs_gc_t* gc, bool compact) {
+    uint64_t start_us = mjs_gc_now_us();
+    clock_t start_time = clock();
+    MJS_TRACE_BEGIN1("gc", "gc.full", "heap_used", gc->heap_used);
+    
+    // Mark phase - finishes an incremental cycle if one is in progress
+    if (gc->state != GC_STATE_MARKING) {
+        gc_start_marking(gc, false);
+    }
+    gc_finish_marking(gc);
+    
+    // Sweep phase - left to the allocator unless lazy sweeping is off.
+    // Compaction needs an exact picture of the live cells.
+    if (!gc->config.lazy_sweeping || compact) {
+        mjs_gc_finish_sweeping(gc);
+    }
+    
+    // Compact phase (optional)
+    if (compact) {
+        gc->state = GC_STATE_COMPACTING;
+        gc_compact(gc);
+        gc->state = GC_STATE_IDLE;
+    }
+    
+    gc->bytes_since_step = 0;
+    
+    // Update statistics
+    clock_t end_time = clock();
+    gc->stats.collection_time += (end_time - start_time);
+    gc_record_pause(gc, start_us);
+    
+    gc_update_statistics(gc);
+    MJS_TRACE_END1("gc", "gc.full", "heap_used", gc->heap_used);
+    
+    return true;
+}
+
+/* Promote a page that survived enough minor collections, with every object
+ * on it, to the old generation */
+static void gc_promote_page(mjs_gc_t* gc, mjs_gc_page_t* page) {
+    size_t live_bytes = page->live_count * page->cell_size;
+    
+    gc_page_unlink(&gc->young_generation, page);
+    gc->young_generation.size -= live_bytes;
+    gc->young_generation.object_count -= page->live_count;
+    
+    page->generation = 1;
+    gc_page_link(&gc->old_generation, page);
+    if (gc->config.huge_pages && (page->size_class != GC_LARGE_SIZE_CLASS || page->mapped)) {
+        gc_advise_huge_pages(page);
+    }
+    gc->old_generation.size += live_bytes;
+    gc->old_generation.object_count += page->live_count;
+}
+
+bool mjs_gc_collect_young(mjs_gc_t* gc) {
+    if (!gc || !gc->config.generational) {
+        return mjs_gc_collect(gc);
+    }
+    
+    // A major cycle in progress owns the mark bits; finish it instead
+    if (gc->state == GC_STATE_MARKING) {
+        return mjs_gc_collect(gc);
+    }
+    
+    // Leftover sweeping from the last cycle must not see the young marks
+    mjs_gc_finish_sweeping(gc);
+    gc_region_clear_marks(gc);
+    
+    // Minor collection - only collect young generation
+    clock_t start_time = clock();
+    MJS_TRACE_BEGIN1("gc", "gc.young", "young_bytes", gc->young_generation.size);
+    
+    gc->state = GC_STATE_MARKING;
+    
+    // Mark from the roots; old objects reached this way are reset below
+    gc_mark_roots(gc);
+    
+    // Mark objects in old generation that reference young objects.
+    // TODO: Implement remembered set or card marking; until then every
+    // old object is scanned as a root.
+    for (mjs_gc_page_t* page = gc->old_generation.pages; page; page = page->next) {
+        for (size_t i = 0; i < page->cell_count; i++) {
+            mjs_gc_object_header_t* header = GC_PAGE_CELL(page, i);
+            if (header->in_use) {
+                gc_scan_object(gc, NULL, header);
+            }
+        }
+    }
+    
+    // Ephemeron values are treated as strong; the next full collection
+    // resolves them
+    gc_mark_ephemeron_values(gc);
+    
+    // Process gray stack
+    while (gc->gray_count > 0) {
+        mjs_gc_object_header_t* obj = gc->gray_stack[--gc->gray_count];
+        if (GC_PAGE_OF(obj)->generation == 0) {
+            gc_scan_object(gc, NULL, obj);
+        } else {
+            gc_set_mark(obj, GC_MARK_WHITE);
+        }
+    }
+    
+    gc_process_weak_refs(gc, GC_WEAK_YOUNG);
+    gc_process_ephemeron_tables(gc, GC_WEAK_YOUNG);
+    
+    // Old objects were scanned as roots; leave them white for the next cycle
+    for (mjs_gc_page_t* page = gc->old_generation.pages; page; page = page->next) {
+        gc_page_clear_marks(page);
+    }
+    
+    // Sweep young pages; survivors age with their page
+    gc->state = GC_STATE_SWEEPING;
+    mjs_gc_page_t* page = gc->young_generation.pages;
+    while (page) {
+        mjs_gc_page_t* next = page->next;
+        
+        if (gc_sweep_page(gc, page)) {
+            page->age++;
+            if (page->age >= GC_PROMOTION_AGE && page->live_count > 0) {
+                gc_promote_page(gc, page);
+            }
+        }
+        
+        page = next;
+    }
+    
+    gc->state = GC_STATE_IDLE;
+    gc_sweep_finished(gc);
+    
+    // Update statistics
+    clock_t end_time = clock();
+    gc->stats.collection_time += (end_time - start_time);
+    gc->stats.collections++;
+    gc_update_statistics(gc);
+    MJS_TRACE_END1("gc", "gc.young", "young_bytes", gc->young_generation.size);
+    
+    return true;
+}
+
+bool mjs_gc_collect_incremental(mjs_gc_t* gc, uint64_t time_limit_us) {
+    if (!gc || !gc->config.incremental) {
+        gc_collect(gc, false);
+        return false;
+    }
+    
+    uint64_t start_us = mjs_gc_now_us();
+    uint64_t budget_us = time_limit_us ? time_limit_us : gc->config.incremental_step_us;
+    uint64_t deadline_us = start_us + budget_us;
+    MJS_TRACE_BEGIN1("gc", "gc.incremental", "budget_us", budget_us);
+    
+    // Start a new cycle: shading the roots is the only work proportional
+    // to something other than the step budget
+    if (gc->state == GC_STATE_IDLE) {
+        gc_start_marking(gc, gc->config.concurrent_marking);
+    }
+    
+    if (gc->state == GC_STATE_MARKING) {
+        if (gc->marker_active) {
+            // The marker thread does the tracing; remark once it runs dry
+            if (mjs_atomic_load_int(&gc->marker_done)) {
+                gc_finish_marking(gc);
+            }
+        } else if (gc_drain_gray(gc, deadline_us)) {
+            gc_finish_marking(gc);
+        }
+    }
+    
+    if (gc->state == GC_STATE_SWEEPING && mjs_gc_now_us() < deadline_us) {
+        mjs_gc_sweep_step(gc, deadline_us);
+    }
+    
+    gc->stats.incremental_steps++;
+    gc_record_pause(gc, start_us);
+    MJS_TRACE_END1("gc", "gc.incremental", "state", gc->state);
+    
+    return gc->state != GC_STATE_IDLE;
+}
+
+bool mjs_gc_mark_step(mjs_gc_t* gc, uint64_t deadline_us) {
+    if (!gc || gc->state != GC_STATE_MARKING) return true;
+    if (gc->marker_active) {
+        return mjs_atomic_load_int(&gc->marker_done) != 0;
+    }
+    return gc_drain_gray(gc, deadline_us);
+}
+
+/* Idle-time collection. Work is done in order of how much it helps the
+ * next request: finish the cycle in progress, start the next one early if
+ * the budget is half spent, compact a fragmented heap if a full cycle fits
+ * the deadline, and hand empty pages back to the system. */
+static size_t gc_fragmented_pages(mjs_gc_t* gc) {
+    size_t count = 0;
+    for (mjs_gc_page_t* page = gc->old_generation.pages; page; page = page->next) {
+        if (page->size_class != GC_LARGE_SIZE_CLASS && !page->pinned &&
+            page->live_count * 100 < page->cell_count * gc->config.compact_live_percent) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool mjs_gc_idle_notification(mjs_gc_t* gc, uint64_t deadline_us) {
+    if (!gc) return true;
+    
+    uint64_t start_us = mjs_gc_now_us();
+    if (start_us >= deadline_us) {
+        return gc->state == GC_STATE_IDLE;
+    }
+    gc->stats.idle_notifications++;
+    MJS_TRACE_BEGIN1("gc", "gc.idle", "budget_us", deadline_us - start_us);
+    
+    // Finish what the mutator left behind, then start early on the next cycle
+    bool start_cycle = gc->state == GC_STATE_IDLE &&
+        gc->bytes_since_collection >= gc->allocation_budget / 2;
+    if (gc->state == GC_STATE_MARKING || start_cycle) {
+        if (gc->config.incremental) {
+            mjs_gc_collect_incremental(gc, deadline_us - start_us);
+        } else if (start_us + (uint64_t)gc->cycle_cost_us < deadline_us) {
+            gc_collect(gc, false);
+        }
+    }
+    
+    // Leftover sweeping is cheap; do it all so the pages can be released
+    if (gc->state == GC_STATE_SWEEPING) {
+        mjs_gc_sweep_step(gc, deadline_us);
+        if (gc->unswept_count == 0) {
+            gc->state = GC_STATE_IDLE;
+        }
+    }
+    
+    bool done = gc->state == GC_STATE_IDLE;
+    if (done) {
+        // A compacting cycle is not incremental; only run it if the last
+        // cycle's cost says it fits
+        uint64_t now_us = mjs_gc_now_us();
+        if (gc->config.compact && gc_fragmented_pages(gc) >= 2) {
+            if (now_us + (uint64_t)gc->cycle_cost_us * 2 < deadline_us) {
+                gc_collect(gc, true);
+            } else {
+                done = false;
+            }
+        }
+        
+        if (gc->unswept_count == 0) {
+            gc_release_empty_pages(gc);
+        }
+        gc_update_statistics(gc);
+    }
+    
+    gc->stats.idle_time_us += mjs_gc_now_us() - start_us;
+    MJS_TRACE_END1("gc", "gc.idle", "done", done);
+    return done;
+}
+
+/* Drop the interned strings nothing else refers to. Only valid right after
+ * a marking that left the string table out of the roots. */
+static void gc_flush_string_table(mjs_gc_t* gc) {
+    if (!gc->runtime) return;
+    
+    mjs_string_t** link = &gc->runtime->string_table;
+    while (*link) {
+        mjs_string_t* str = *link;
+        if (gc_get_mark(GC_OBJECT_TO_HEADER(str)) == GC_MARK_WHITE) {
+            *link = str->next;
+            str->next = NULL;
+            str->is_interned = false;
+        } else {
+            link = &str->next;
+        }
+    }
+}
+
+/* String deduplication, run once an old-generation marking is complete.
+ * Live old strings with equal characters are pointed at one canonical
+ * buffer; each duplicate's own buffer is freed and its data_owner keeps
+ * the canonical string alive. Interned strings are unique already. A
+ * string that owns data from an earlier pass stays canonical, since its
+ * duplicates still point into its buffer. */
+static bool gc_dedup_candidate(mjs_gc_page_t* page, size_t index) {
+    mjs_gc_object_header_t* header = GC_PAGE_CELL(page, index);
+    if (!header->in_use || header->type != GC_TYPE_STRING) return false;
+    if (gc_page_get_mark(page, index) == GC_MARK_WHITE) return false;
+    
+    mjs_string_t* str = (mjs_string_t*)GC_HEADER_TO_OBJECT(header);
+    return str->data && !str->data_owner && !str->is_interned && str->length >= GC_DEDUP_MIN_LENGTH;
+}
+
+static size_t gc_hash_chars(const char* data, size_t length) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 0x100000001B3ULL;
+    }
+    return (size_t)hash;
+}
+
+/* The table slot holding str's characters, or the empty slot they go in */
+static size_t gc_dedup_slot(mjs_string_t** table, size_t capacity, mjs_string_t* str) {
+    size_t slot = gc_hash_chars(str->data, str->length) & (capacity - 1);
+    while (table[slot] && (table[slot]->length != str->length ||
+                           memcmp(table[slot]->data, str->data, str->length) != 0)) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    return slot;
+}
+
+static void gc_dedup_strings(mjs_gc_t* gc) {
+    size_t candidates = 0;
+    for (mjs_gc_page_t* page = gc->old_generation.pages; page; page = page->next) {
+        for (size_t i = 0; i < page->cell_count; i++) {
+            if (gc_dedup_candidate(page, i)) {
+                candidates++;
+            }
+        }
+    }
+    if (candidates < 2) return;
+    
+    size_t capacity = 16;
+    while (capacity < candidates * 2) {
+        capacity *= 2;
+    }
+    mjs_string_t** table = MJS_CALLOC(capacity, sizeof(mjs_string_t*));
+    if (!table) return;
+    MJS_TRACE_BEGIN1("gc", "gc.string_dedup", "strings", candidates);
+    
+    // Owners from earlier passes go in first, whatever order the pages
+    // list them in, so newer equal strings become their duplicates
+    for (mjs_gc_page_t* page = gc->old_generation.pages; page; page = page->next) {
+        for (size_t i = 0; i < page->cell_count; i++) {
+            if (!gc_dedup_candidate(page, i)) continue;
+            mjs_string_t* str = (mjs_string_t*)GC_HEADER_TO_OBJECT(GC_PAGE_CELL(page, i));
+            if (!str->data_shared) continue;
+            
+            size_t slot = gc_dedup_slot(table, capacity, str);
+            if (!table[slot]) {
+                table[slot] = str;
+            }
+        }
+    }
+    
+    bool deferred = gc_finalizer_ready(gc);
+    size_t deduplicated = 0;
+    for (mjs_gc_page_t* page = gc->old_generation.pages; page; page = page->next) {
+        for (size_t i = 0; i < page->cell_count; i++) {
+            if (!gc_dedup_candidate(page, i)) continue;
+            mjs_string_t* str = (mjs_string_t*)GC_HEADER_TO_OBJECT(GC_PAGE_CELL(page, i));
+            if (str->data_shared) continue;
+            
+            size_t slot = gc_dedup_slot(table, capacity, str);
+            mjs_string_t* canonical = table[slot];
+            if (!canonical) {
+                table[slot] = str;
+                continue;
+            }
+            
+            if (deferred) {
+                gc_defer_free(gc, &gc->free_batch, str->data);
+            } else {
+                MJS_FREE(str->data);
+            }
+            gc->stats.dedup_bytes_saved += str->capacity;
+            str->data = canonical->data;
+            str->capacity = canonical->capacity;
+            str->data_owner = canonical;
+            canonical->data_shared = true;
+            deduplicated++;
+        }
+    }
+    
+    MJS_FREE(table);
+    gc->stats.strings_deduplicated += deduplicated;
+    MJS_TRACE_END1("gc", "gc.string_dedup", "deduplicated", deduplicated);
+}
+
+void mjs_gc_memory_pressure(mjs_gc_t* gc, mjs_memory_pressure_t level) {
+    if (!gc || level == MJS_MEMORY_PRESSURE_NONE) return;
+    MJS_TRACE_BEGIN1("gc", "gc.memory_pressure", "level", level);
+    
+    // A cycle in progress marked the string table as a root; finish it so
+    // the next one starts without
+    if (gc->state == GC_STATE_MARKING) {
+        gc_collect(gc, false);
+    }
+    
+    gc->flush_string_table = true;
+    gc_collect(gc, level == MJS_MEMORY_PRESSURE_CRITICAL && gc->config.compact);
+    gc->flush_string_table = false;
+    
+    mjs_gc_finish_sweeping(gc);
+    gc_release_empty_pages(gc);
+    gc_finalizer_wait(gc);
+    
+    // Marking grows the gray stack again on demand
+    MJS_FREE(gc->gray_stack);
+    gc->gray_stack = NULL;
+    gc->gray_capacity = 0;
+    
+    // Helper threads and their deques are recreated by the next parallel
+    // phase
+    if (level == MJS_MEMORY_PRESSURE_CRITICAL) {
+        gc_workers_shutdown(gc);
+    }
+    
+    gc->stats.memory_pressure_collections++;
+    gc_update_statistics(gc);
+    MJS_TRACE_END1("gc", "gc.memory_pressure", "heap_size", gc->heap_size);
+}
+
+/* Write barrier */
+void mjs_gc_write_barrier(mjs_gc_t* gc, void* parent, void* child) {
+    if (!gc || !child) return;
+    
+    if (gc->region) {
+        gc_region_barrier(gc, parent, child);
+    }
+    
+    // The concurrent marker relies on the deletion barrier instead
+    if (gc->state != GC_STATE_MARKING || gc->marker_active) return;
+    
+    // Only a black parent can hide a white child from the marker: gray and
+    // white parents are still going to be scanned in this cycle.
+    if (parent && mjs_gc_is_valid_object(gc, parent) &&
+        gc_get_mark(GC_OBJECT_TO_HEADER(parent)) != GC_MARK_BLACK) {
+        return;
+    }
+    
+    gc_mark_object(gc, child);
+}
+
+void mjs_gc_write_barrier_value(mjs_gc_t* gc, void* parent, mjs_value_t value) {
+    switch (value.tag) {
+        case MJS_TAG_STRING:
+        case MJS_TAG_OBJECT:
+        case MJS_TAG_FUNCTION:
+        case MJS_TAG_ARRAY:
+            mjs_gc_write_barrier(gc, parent, value.u.ptr);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Log a reference the mutator is about to overwrite. Everything reachable
+ * when the cycle started is then marked even if the mutator moves it
+ * behind an object the marker has already scanned. */
+void mjs_gc_satb_barrier(mjs_gc_t* gc, void* old_child) {
+    if (!gc || !old_child || !gc->marker_active) return;
+    
+    mjs_gc_satb_buffer_t* buffer = gc->satb_buffer;
+    if (!buffer) {
+        buffer = MJS_MALLOC(sizeof(mjs_gc_satb_buffer_t));
+        if (!buffer) {
+            // Out of memory - shade the object directly under the heap
+            // lock, which stores made through mjs_gc_lock_heap already
+            // hold; the mutex is not recursive
+            bool locked = !gc->heap_lock_held;
+            if (locked) {
+                mjs_mutex_lock(&gc->heap_lock);
+            }
+            gc_mark_object(gc, old_child);
+            if (locked) {
+                mjs_mutex_unlock(&gc->heap_lock);
+            }
+            return;
+        }
+        buffer->count = 0;
+        buffer->next = NULL;
+        gc->satb_buffer = buffer;
+    }
+    
+    buffer->entries[buffer->count++] = old_child;
+    
+    if (buffer->count == GC_SATB_BUFFER_SIZE) {
+        // Publish the full buffer; the marker takes the whole stack at once
+        void* head;
+        do {
+            head = mjs_atomic_load_ptr(&gc->satb_full);
+            buffer->next = head;
+        } while (!mjs_atomic_cas_ptr(&gc->satb_full, head, buffer));
+        gc->satb_buffer = NULL;
+    }
+}
+
+void mjs_gc_satb_barrier_value(mjs_gc_t* gc, mjs_value_t old_value) {
+    switch (old_value.tag) {
+        case MJS_TAG_STRING:
+        case MJS_TAG_OBJECT:
+        case MJS_TAG_FUNCTION:
+        case MJS_TAG_ARRAY:
+            mjs_gc_satb_barrier(gc, old_value.u.ptr);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Shade every logged reference. Called by whichever thread owns the gray
+ * stack; only the mutator thread may take its own partial buffer, and
+ * only once the marker has stopped. */
+static void gc_drain_satb(mjs_gc_t* gc, bool take_partial) {
+    mjs_gc_satb_buffer_t* buffer = mjs_atomic_exchange_ptr(&gc->satb_full, NULL);
+    bool shade = true;
+    
+    if (take_partial) {
+        if (gc->satb_buffer) {
+            gc->satb_buffer->next = buffer;
+            buffer = gc->satb_buffer;
+            gc->satb_buffer = NULL;
+        }
+        shade = gc->state == GC_STATE_MARKING;
+    }
+    
+    while (buffer) {
+        mjs_gc_satb_buffer_t* next = buffer->next;
+        if (shade) {
+            for (size_t i = 0; i < buffer->count; i++) {
+                gc_mark_object(gc, buffer->entries[i]);
+            }
+        }
+        MJS_FREE(buffer);
+        buffer = next;
+    }
+}
+
+/* Background marker: scans gray objects in batches while holding the
+ * heap lock, dropping it between batches so the mutator can get in */
+static void gc_marker_main(void* arg) {
+    mjs_gc_t* gc = (mjs_gc_t*)arg;
+    size_t batch_size = gc->incremental_step_size ? gc->incremental_step_size : GC_INCREMENTAL_STEP_SIZE;
+    
+    mjs_mutex_lock(&gc->heap_lock);
+    for (;;) {
+        while (!gc->marker_work && !gc->marker_shutdown) {
+            mjs_cond_wait(&gc->marker_cond, &gc->heap_lock);
+        }
+        if (gc->marker_shutdown) break;
+        
+        MJS_TRACE_BEGIN1("gc", "gc.concurrent_mark", "gray", gc->gray_count);
+        gc_drain_satb(gc, false);
+        for (size_t i = 0; i < batch_size && gc->gray_count > 0; i++) {
+            gc_scan_object(gc, NULL, gc->gray_stack[--gc->gray_count]);
+        }
+        MJS_TRACE_END("gc", "gc.concurrent_mark");
+        
+        if (gc->gray_count == 0 && !mjs_atomic_load_ptr(&gc->satb_full)) {
+            gc->marker_work = false;
+            mjs_atomic_store_int(&gc->marker_done, 1);
+            continue;
+        }
+        
+        mjs_mutex_unlock(&gc->heap_lock);
+        mjs_thread_yield();
+        mjs_mutex_lock(&gc->heap_lock);
+    }
+    mjs_mutex_unlock(&gc->heap_lock);
+}
+
+/* Hand the gray stack to the marker thread, starting it if needed */
+static bool gc_start_marker(mjs_gc_t* gc) {
+    if (!gc->marker_started) {
+        if (!mjs_thread_create(&gc->marker_thread, gc_marker_main, gc)) {
+            return false;
+        }
+        gc->marker_started = true;
+    }
+    
+    mjs_mutex_lock(&gc->heap_lock);
+    gc->marker_active = true;
+    gc->marker_work = true;
+    mjs_atomic_store_int(&gc->marker_done, 0);
+    mjs_cond_signal(&gc->marker_cond);
+    mjs_mutex_unlock(&gc->heap_lock);
+    
+    gc->stats.concurrent_cycles++;
+    return true;
+}
+
+/* Take the gray stack back from the marker. Once the marker sees
+ * marker_work cleared under the lock it parks without touching the heap. */
+static void gc_stop_marker(mjs_gc_t* gc) {
+    if (!gc->marker_active) return;
+    
+    mjs_mutex_lock(&gc->heap_lock);
+    gc->marker_work = false;
+    mjs_mutex_unlock(&gc->heap_lock);
+    
+    gc->marker_active = false;
+}
+
+/* Root enumeration. Besides the registered and temporary roots, the
+ * runtime's contexts and VMs are scanned: global objects, open and
+ * persistent handles, each VM's operand stack up to stack_top, each call
+ * frame's receiver and code, and pending exceptions. The operand stack
+ * holds only values still in use - instructions that call anything able
+ * to allocate (stores, string conversion, OP_ADD) peek their operands and
+ * drop them once done - so stack_top is the stack map of every frame. Handles are updated in place when compaction moves an
+ * object; temporary roots are raw pointers and pin their pages instead. */
+typedef void (*gc_value_visitor_t)(mjs_gc_t* gc, mjs_value_t* slot);
+typedef void (*gc_pointer_visitor_t)(mjs_gc_t* gc, void** slot);
+
+static void gc_visit_bytecode(mjs_gc_t* gc, mjs_bytecode_t* bytecode,
+                              gc_value_visitor_t visit_value, gc_pointer_visitor_t visit_pointer) {
+    if (!bytecode) return;
+    
+    for (size_t i = 0; i < bytecode->constant_count; i++) {
+        visit_value(gc, &bytecode->constants[i]);
+    }
+    for (size_t i = 0; i < bytecode->string_count; i++) {
+        visit_pointer(gc, (void**)&bytecode->strings[i]);
+    }
+}
+
+static void gc_visit_vm(mjs_gc_t* gc, mjs_vm_t* vm,
+                        gc_value_visitor_t visit_value, gc_pointer_visitor_t visit_pointer) {
+    for (size_t i = 0; i < vm->stack_top; i++) {
+        visit_value(gc, &vm->stack[i]);
+    }
+    
+    for (size_t i = 0; i < vm->call_stack_top; i++) {
+        mjs_call_frame_t* frame = &vm->call_stack[i];
+        visit_value(gc, &frame->this_value);
+        gc_visit_bytecode(gc, frame->bytecode, visit_value, visit_pointer);
+    }
+    
+    if (vm->has_exception) {
+        visit_value(gc, &vm->exception_value);
+    }
+}
+
+static void gc_visit_context_roots(mjs_gc_t* gc, gc_value_visitor_t visit_value,
+                                   gc_pointer_visitor_t visit_pointer) {
+    if (!gc->runtime) return;
+    
+    for (mjs_context_t* ctx = gc->runtime->contexts; ctx; ctx = ctx->next_context) {
+        visit_value(gc, &ctx->global_object);
+        visit_value(gc, &ctx->error_value);
+        
+        for (size_t i = 0; i < ctx->handle_count; i++) {
+            visit_value(gc, &ctx->handle_blocks[i / MJS_HANDLE_BLOCK_SIZE][i % MJS_HANDLE_BLOCK_SIZE]);
+        }
+    }
+    for (size_t i = 0; i < gc->runtime->persistent_capacity; i++) {
+        if (gc->runtime->persistents[i].in_use) {
+            visit_value(gc, &gc->runtime->persistents[i].value);
+        }
+    }
+    for (mjs_vm_t* vm = gc->runtime->vms; vm; vm = vm->next_vm) {
+        gc_visit_vm(gc, vm, visit_value, visit_pointer);
+    }
+}
+
+/* Visit every reference slot of an object. Mirrors gc_scan_object. */
+static void gc_visit_object(mjs_gc_t* gc, mjs_gc_object_header_t* header,
+                            gc_value_visitor_t visit_value, gc_pointer_visitor_t visit_pointer) {
+    void* obj = GC_HEADER_TO_OBJECT(header);
+    
+    switch (header->type) {
+        case GC_TYPE_STRING: {
+            mjs_string_t* str = (mjs_string_t*)obj;
+            visit_pointer(gc, (void**)&str->next);
+            visit_pointer(gc, (void**)&str->data_owner);
+            break;
+        }
+        
+        case GC_TYPE_OBJECT: {
+            mjs_object_t* object = (mjs_object_t*)obj;
+            visit_pointer(gc, (void**)&object->prototype);
+            for (mjs_property_t* prop = object->properties; prop; prop = prop->next) {
+                visit_pointer(gc, (void**)&prop->key);
+                visit_value(gc, &prop->value);
+            }
+            break;
+        }
+        
+        case GC_TYPE_ARRAY: {
+            mjs_array_t* array = (mjs_array_t*)obj;
+            if (array->elements) {
+                for (size_t i = 0; i < array->length; i++) {
+                    visit_value(gc, &array->elements[i]);
+                }
+            }
+            break;
+        }
+        
+        case GC_TYPE_FUNCTION: {
+            mjs_function_t* function = (mjs_function_t*)obj;
+            visit_pointer(gc, (void**)&function->name);
+            visit_pointer(gc, (void**)&function->scope);
+            if (function->type == MJS_FUNCTION_BYTECODE) {
+                gc_visit_bytecode(gc, function->u.bytecode.bytecode, visit_value, visit_pointer);
+            }
+            break;
+        }
+        
+        default:
+            break;
+    }
+}
+
+static void gc_mark_value_slot(mjs_gc_t* gc, mjs_value_t* slot) {
+    gc_mark_value(gc, *slot);
+}
+
+static void gc_mark_pointer_slot(mjs_gc_t* gc, void** slot) {
+    gc_mark_object(gc, *slot);
+}
+
+/* Marking implementation */
+static void gc_mark_roots(mjs_gc_t* gc) {
+    for (size_t i = 0; i < gc->root_count; i++) {
+        void* obj = gc->roots[i];
+        if (obj) {
+            gc_mark_object(gc, obj);
+        }
+    }
+    
+    for (size_t i = 0; i < gc->scoped_root_count; i++) {
+        if (gc->scoped_roots[i]) {
+            gc_mark_object(gc, gc->scoped_roots[i]);
+        }
+    }
+    
+    gc_visit_context_roots(gc, gc_mark_value_slot, gc_mark_pointer_slot);
+    
+    // Interned strings are owned by the runtime's string table, unless
+    // memory pressure asked for the unused ones to be dropped
+    if (gc->runtime && !gc->flush_string_table) {
+        for (mjs_string_t* str = gc->runtime->string_table; str; str = str->next) {
+            gc_mark_object(gc, str);
+        }
+    }
+}
+
+static void gc_start_marking(mjs_gc_t* gc, bool concurrent) {
+    // The previous cycle's sweep must finish before mark bits are reused.
+    // Region pages are never swept, so their marks are reset here.
+    mjs_gc_finish_sweeping(gc);
+    gc_region_clear_marks(gc);
+    
+    gc->state = GC_STATE_MARKING;
+    gc->bytes_since_step = 0;
+    gc->marked_bytes = 0;
+    gc_mark_roots(gc);
+    
+    // The roots are the snapshot; the marker traces from them while the
+    // mutator runs. Without a thread the cycle simply runs incrementally.
+    if (concurrent) {
+        gc_start_marker(gc);
+    }
+}
+
+/* Shade an object: white objects turn gray and are queued for scanning */
+static void gc_mark_object(mjs_gc_t* gc, void* obj) {
+    if (!obj || !mjs_gc_is_valid_object(gc, obj)) return;
+    
+    mjs_gc_object_header_t* header = GC_OBJECT_TO_HEADER(obj);
+    mjs_gc_page_t* page = GC_PAGE_OF(header);
+    size_t index = GC_CELL_INDEX(page, header);
+    
+    // Skip if already marked
+    if (gc_page_get_mark(page, index) != GC_MARK_WHITE) return;
+    
+    // Add to gray stack for processing
+    if (gc->gray_count >= gc->gray_capacity) {
+        size_t new_capacity = gc->gray_capacity == 0 ? 256 : gc->gray_capacity * 2;
+        mjs_gc_object_header_t** new_stack = MJS_REALLOC(gc->gray_stack,
+            sizeof(mjs_gc_object_header_t*) * new_capacity);
+        if (!new_stack) return; // Out of memory during GC
+        
+        gc->gray_stack = new_stack;
+        gc->gray_capacity = new_capacity;
+    }
+    
+    // Mark as gray (being processed)
+    gc_page_set_mark(page, index, GC_MARK_GRAY);
+    gc->gray_stack[gc->gray_count++] = header;
+    
+    // While ephemerons are resolved, values waiting on this key are released
+    if (gc->ephemeron_keys) {
+        gc_ephemeron_key_marked(gc, obj);
+    }
+}
+
+static void gc_mark_value(mjs_gc_t* gc, mjs_value_t value) {
+    switch (value.tag) {
+        case MJS_TAG_STRING:
+        case MJS_TAG_OBJECT:
+        case MJS_TAG_FUNCTION:
+        case MJS_TAG_ARRAY:
+            gc_mark_object(gc, value.u.ptr);
+            break;
+        default:
+            break;
+    }
+}
+
+void mjs_gc_mark_value(mjs_gc_t* gc, mjs_value_t value) {
+    if (!gc || gc->state != GC_STATE_MARKING) return;
+    gc_mark_value(gc, value);
+}
+
+/* Scan a gray object: shade its children and turn it black. A worker is
+ * passed while several threads mark in parallel. */
+static void gc_scan_object(mjs_gc_t* gc, mjs_gc_worker_t* worker, mjs_gc_object_header_t* header) {
+    void* obj = GC_HEADER_TO_OBJECT(header);
+    
+    // Mark object's children based on type
+    switch (header->type) {
+        case GC_TYPE_STRING: {
+            // A deduplicated string keeps the owner of its characters
+            mjs_string_t* str = (mjs_string_t*)obj;
+            if (str->data_owner) {
+                gc_shade_object(gc, worker, str->data_owner);
+            }
+            break;
+        }
+        
+        case GC_TYPE_OBJECT: {
+            mjs_object_t* object = (mjs_object_t*)obj;
+            
+            // Mark prototype
+            if (object->prototype) {
+                gc_shade_object(gc, worker, object->prototype);
+            }
+            
+            // Mark properties
+            mjs_property_t* prop = object->properties;
+            while (prop) {
+                if (prop->key) {
+                    gc_shade_object(gc, worker, prop->key);
+                }
+                gc_shade_value(gc, worker, prop->value);
+                prop = prop->next;
+            }
+            break;
+        }
+        
+        case GC_TYPE_ARRAY: {
+            mjs_array_t* array = (mjs_array_t*)obj;
+            
+            // Mark elements
+            if (array->elements) {
+                for (size_t i = 0; i < array->length; i++) {
+                    gc_shade_value(gc, worker, array->elements[i]);
+                }
+            }
+            break;
+        }
+        
+        case GC_TYPE_FUNCTION: {
+            mjs_function_t* function = (mjs_function_t*)obj;
+            
+            // Mark function name
+            if (function->name) {
+                gc_shade_object(gc, worker, function->name);
+            }
+            
+            // Mark closure scope
+            if (function->scope) {
+                gc_shade_object(gc, worker, function->scope);
+            }
+            
+            // Mark the constants and names the code refers to
+            if (function->type == MJS_FUNCTION_BYTECODE && function->u.bytecode.bytecode) {
+                mjs_bytecode_t* bytecode = function->u.bytecode.bytecode;
+                for (size_t i = 0; i < bytecode->constant_count; i++) {
+                    gc_shade_value(gc, worker, bytecode->constants[i]);
+                }
+                for (size_t i = 0; i < bytecode->string_count; i++) {
+                    gc_shade_object(gc, worker, bytecode->strings[i]);
+                }
+            }
+            break;
+        }
+        
+        default:
+            break;
+    }
+    
+    // Mark as black (fully processed)
+    gc_set_mark(header, GC_MARK_BLACK);
+    if (worker) {
+        worker->marked_bytes += header->size + GC_HEADER_SIZE;
+    } else {
+        gc->marked_bytes += header->size + GC_HEADER_SIZE;
+    }
+}
+
+/* Scan gray objects until the stack is empty or the deadline passes.
+ * The clock is only read every incremental_step_size objects. A zero
+ * deadline drains the whole stack. Returns true once the stack is empty. */
+static bool gc_drain_gray(mjs_gc_t* gc, uint64_t deadline_us) {
+    size_t check_interval = gc->incremental_step_size ? gc->incremental_step_size : GC_INCREMENTAL_STEP_SIZE;
+    size_t budget = check_interval;
+    
+    while (gc->gray_count > 0) {
+        mjs_gc_object_header_t* obj = gc->gray_stack[--gc->gray_count];
+        gc_scan_object(gc, NULL, obj);
+        
+        if (deadline_us && --budget == 0) {
+            if (mjs_gc_now_us() >= deadline_us) {
+                break;
+            }
+            budget = check_interval;
+        }
+    }
+    
+    return gc->gray_count == 0;
+}
+
+/* Parallel stop-the-world marking and sweeping */
+
+/* Jobs handed to the worker threads */
+enum {
+    GC_JOB_MARK,
+    GC_JOB_SWEEP
+};
+
+#define GC_DEQUE_INITIAL_CAPACITY 1024
+
+static mjs_gc_deque_array_t* gc_deque_array_new(size_t capacity) {
+    mjs_gc_deque_array_t* array = MJS_MALLOC(sizeof(mjs_gc_deque_array_t) + sizeof(void*) * capacity);
+    if (!array) return NULL;
+    
+    array->retired = NULL;
+    array->capacity = capacity;
+    return array;
+}
+
+static bool gc_deque_init(mjs_gc_deque_t* deque) {
+    deque->top = 0;
+    deque->bottom = 0;
+    deque->array = gc_deque_array_new(GC_DEQUE_INITIAL_CAPACITY);
+    return deque->array != NULL;
+}
+
+/* Drop the arrays that were outgrown during the last phase. Only called
+ * while no other thread can be looking at the deque. */
+static void gc_deque_reset(mjs_gc_deque_t* deque) {
+    mjs_gc_deque_array_t* array = (mjs_gc_deque_array_t*)deque->array;
+    
+    while (array->retired) {
+        mjs_gc_deque_array_t* retired = array->retired;
+        array->retired = retired->retired;
+        MJS_FREE(retired);
+    }
+    
+    deque->top = 0;
+    deque->bottom = 0;
+}
+
+static void gc_deque_destroy(mjs_gc_deque_t* deque) {
+    if (!deque->array) return;
+    
+    gc_deque_reset(deque);
+    MJS_FREE(deque->array);
+    deque->array = NULL;
+}
+
+/* Owner only. Thieves may still be reading an outgrown array, so it is
+ * kept alive until the phase ends. */
+static bool gc_deque_push(mjs_gc_deque_t* deque, void* item) {
+    size_t bottom = mjs_atomic_load_size(&deque->bottom);
+    size_t top = mjs_atomic_load_size(&deque->top);
+    mjs_gc_deque_array_t* array = mjs_atomic_load_ptr(&deque->array);
+    
+    if (bottom - top >= array->capacity) {
+        mjs_gc_deque_array_t* grown = gc_deque_array_new(array->capacity * 2);
+        if (!grown) return false;
+        
+        for (size_t i = top; i < bottom; i++) {
+            grown->entries[i % grown->capacity] = array->entries[i % array->capacity];
+        }
+        grown->retired = array;
+        mjs_atomic_store_ptr(&deque->array, grown);
+        array = grown;
+    }
+    
+    mjs_atomic_store_ptr(&array->entries[bottom % array->capacity], item);
+    mjs_atomic_store_size(&deque->bottom, bottom + 1);
+    return true;
+}
+
+/* Owner only. Races with thieves for the last item. */
+static void* gc_deque_take(mjs_gc_deque_t* deque) {
+    size_t bottom = mjs_atomic_load_size(&deque->bottom);
+    if (bottom == 0) return NULL;
+    
+    bottom--;
+    mjs_gc_deque_array_t* array = mjs_atomic_load_ptr(&deque->array);
+    mjs_atomic_store_size(&deque->bottom, bottom);
+    mjs_atomic_fence();
+    size_t top = mjs_atomic_load_size(&deque->top);
+    
+    if (top > bottom) {
+        // Empty
+        mjs_atomic_store_size(&deque->bottom, bottom + 1);
+        return NULL;
+    }
+    
+    void* item = mjs_atomic_load_ptr(&array->entries[bottom % array->capacity]);
+    if (top == bottom) {
+        if (!mjs_atomic_cas_size(&deque->top, top, top + 1)) {
+            item = NULL; // A thief got it first
+        }
+        mjs_atomic_store_size(&deque->bottom, bottom + 1);
+    }
+    
+    return item;
+}
+
+static void* gc_deque_steal(mjs_gc_deque_t* deque) {
+    size_t top = mjs_atomic_load_size(&deque->top);
+    mjs_atomic_fence();
+    size_t bottom = mjs_atomic_load_size(&deque->bottom);
+    
+    if ((ptrdiff_t)(bottom - top) <= 0) return NULL;
+    
+    mjs_gc_deque_array_t* array = mjs_atomic_load_ptr(&deque->array);
+    void* item = mjs_atomic_load_ptr(&array->entries[top % array->capacity]);
+    if (!mjs_atomic_cas_size(&deque->top, top, top + 1)) {
+        return NULL;
+    }
+    
+    return item;
+}
+
+static bool gc_deque_is_empty(mjs_gc_deque_t* deque) {
+    size_t top = mjs_atomic_load_size(&deque->top);
+    size_t bottom = mjs_atomic_load_size(&deque->bottom);
+    return (ptrdiff_t)(bottom - top) <= 0;
+}
+
+/* Shade an object on behalf of a scanning thread. In parallel mode the
+ * white-to-gray transition is a CAS so each object is queued once. */
+static void gc_shade_object(mjs_gc_t* gc, mjs_gc_worker_t* worker, void* obj) {
+    if (!worker) {
+        gc_mark_object(gc, obj);
+        return;
+    }
+    
+    if (!obj || !mjs_gc_is_valid_object(gc, obj)) return;
+    
+    mjs_gc_object_header_t* header = GC_OBJECT_TO_HEADER(obj);
+    if (!gc_cas_mark(header, GC_MARK_WHITE, GC_MARK_GRAY)) return;
+    
+    if (!gc_deque_push(&worker->deque, header)) {
+        // Out of memory growing the deque - scan it right here instead
+        gc_scan_object(gc, worker, header);
+    }
+}
+
+static void gc_shade_value(mjs_gc_t* gc, mjs_gc_worker_t* worker, mjs_value_t value) {
+    switch (value.tag) {
+        case MJS_TAG_STRING:
+        case MJS_TAG_OBJECT:
+        case MJS_TAG_FUNCTION:
+        case MJS_TAG_ARRAY:
+            gc_shade_object(gc, worker, value.u.ptr);
+            break;
+        default:
+            break;
+    }
+}
+
+static bool gc_work_available(mjs_gc_t* gc) {
+    for (size_t i = 0; i < gc->worker_count; i++) {
+        if (!gc_deque_is_empty(&gc->workers[i].deque)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void* gc_steal_work(mjs_gc_worker_t* worker) {
+    mjs_gc_t* gc = worker->gc;
+    
+    for (size_t i = 1; i < gc->worker_count; i++) {
+        mjs_gc_worker_t* victim = &gc->workers[(worker->index + i) % gc->worker_count];
+        void* item = gc_deque_steal(&victim->deque);
+        if (item) return item;
+    }
+    
+    return NULL;
+}
+
+/* Drain the local deque, then steal. Marking is over once every worker is
+ * idle: an idle worker's deque is empty and only its owner can refill it,
+ * so nobody can produce more work. */
+static void gc_parallel_mark_worker(mjs_gc_worker_t* worker) {
+    mjs_gc_t* gc = worker->gc;
+    
+    for (;;) {
+        mjs_gc_object_header_t* header;
+        while ((header = gc_deque_take(&worker->deque))) {
+            gc_scan_object(gc, worker, header);
+        }
+        
+        header = gc_steal_work(worker);
+        if (header) {
+            gc_scan_object(gc, worker, header);
+            continue;
+        }
+        
+        mjs_atomic_fetch_add_size(&gc->idle_workers, 1);
+        for (;;) {
+            if (mjs_atomic_load_size(&gc->idle_workers) == gc->worker_count) {
+                return;
+            }
+            if (gc_work_available(gc)) {
+                mjs_atomic_fetch_add_size(&gc->idle_workers, (size_t)-1);
+                break;
+            }
+            mjs_thread_yield();
+        }
+    }
+}
+
+/* Pages are claimed one at a time from a shared cursor. Only the cells and
+ * the page's own free list are touched; the heap-wide bookkeeping is done
+ * by the collecting thread afterwards. */
+static void gc_parallel_sweep_worker(mjs_gc_worker_t* worker) {
+    mjs_gc_t* gc = worker->gc;
+    
+    for (;;) {
+        size_t i = mjs_atomic_fetch_add_size(&gc->sweep_next, 1);
+        if (i >= gc->sweep_page_count) break;
+        
+        mjs_gc_page_t* page = gc->sweep_pages[i];
+        int generation = page->generation == 0 ? 0 : 1;
+        size_t freed = gc_sweep_cells(gc, page, gc->sweep_deferred ? &worker->free_batch : NULL);
+        worker->freed_objects[generation] += freed;
+        worker->freed_bytes[generation] += freed * page->cell_size;
+    }
+    
+    if (worker->free_batch) {
+        gc_flush_free_batch(gc, &worker->free_batch);
+    }
+}
+
+static void gc_worker_run(mjs_gc_worker_t* worker, int job) {
+    switch (job) {
+        case GC_JOB_MARK:
+            MJS_TRACE_BEGIN1("gc", "gc.parallel_mark", "worker", worker->index);
+            gc_parallel_mark_worker(worker);
+            MJS_TRACE_END1("gc", "gc.parallel_mark", "marked_bytes", worker->marked_bytes);
+            break;
+        case GC_JOB_SWEEP:
+            MJS_TRACE_BEGIN1("gc", "gc.parallel_sweep", "worker", worker->index);
+            gc_parallel_sweep_worker(worker);
+            MJS_TRACE_END("gc", "gc.parallel_sweep");
+            break;
+        default:
+            break;
+    }
+}
+
+static void gc_worker_main(void* arg) {
+    mjs_gc_worker_t* worker = (mjs_gc_worker_t*)arg;
+    mjs_gc_t* gc = worker->gc;
+    
+    mjs_mutex_lock(&gc->worker_lock);
+    for (;;) {
+        while (gc->worker_epoch == worker->epoch && !gc->workers_shutdown) {
+            mjs_cond_wait(&gc->worker_cond, &gc->worker_lock);
+        }
+        if (gc->workers_shutdown) break;
+        
+        worker->epoch = gc->worker_epoch;
+        int job = gc->worker_job;
+        mjs_mutex_unlock(&gc->worker_lock);
+        
+        gc_worker_run(worker, job);
+        
+        mjs_mutex_lock(&gc->worker_lock);
+        if (--gc->workers_running == 0) {
+            mjs_cond_signal(&gc->worker_done_cond);
+        }
+    }
+    mjs_mutex_unlock(&gc->worker_lock);
+}
+
+static size_t gc_parallel_thread_count(mjs_gc_t* gc) {
+    size_t count = gc->config.parallel_threads;
+    if (count == 0) {
+        count = mjs_thread_hardware_concurrency();
+    }
+    return count > GC_MAX_PARALLEL_THREADS ? GC_MAX_PARALLEL_THREADS : count;
+}
+
+/* Waking the workers costs more than it saves on small heaps */
+static bool gc_parallel_worthwhile(mjs_gc_t* gc) {
+    return gc->heap_size >= GC_PARALLEL_MIN_HEAP && gc_parallel_thread_count(gc) > 1;
+}
+
+static void gc_workers_shutdown(mjs_gc_t* gc) {
+    if (!gc->workers) return;
+    
+    mjs_mutex_lock(&gc->worker_lock);
+    gc->workers_shutdown = true;
+    mjs_cond_broadcast(&gc->worker_cond);
+    mjs_mutex_unlock(&gc->worker_lock);
+    
+    for (size_t i = 1; i < gc->worker_count; i++) {
+        mjs_thread_join(gc->workers[i].thread);
+    }
+    for (size_t i = 0; i < gc->worker_count; i++) {
+        gc_deque_destroy(&gc->workers[i].deque);
+    }
+    
+    MJS_FREE(gc->workers);
+    gc->workers = NULL;
+    gc->worker_count = 0;
+    gc->workers_shutdown = false;
+}
+
+/* Make sure the configured number of workers is running. Falls back to
+ * fewer threads if some cannot be created; false means run serially. */
+static bool gc_workers_prepare(mjs_gc_t* gc) {
+    size_t count = gc_parallel_thread_count(gc);
+    if (count <= 1) return false;
+    if (gc->worker_count == count) return true;
+    
+    gc_workers_shutdown(gc);
+    
+    mjs_gc_worker_t* workers = MJS_MALLOC(sizeof(mjs_gc_worker_t) * count);
+    if (!workers) return false;
+    memset(workers, 0, sizeof(mjs_gc_worker_t) * count);
+    
+    for (size_t i = 0; i < count; i++) {
+        workers[i].gc = gc;
+        workers[i].index = i;
+        workers[i].epoch = gc->worker_epoch;
+        if (!gc_deque_init(&workers[i].deque)) {
+            count = i;
+            break;
+        }
+    }
+    
+    gc->workers = workers;
+    gc->worker_count = count;
+    
+    // Worker 0 is the collecting thread itself
+    for (size_t i = 1; i < count; i++) {
+        if (!mjs_thread_create(&workers[i].thread, gc_worker_main, &workers[i])) {
+            for (size_t j = i; j < count; j++) {
+                gc_deque_destroy(&workers[j].deque);
+            }
+            gc->worker_count = i;
+            break;
+        }
+    }
+    
+    if (gc->worker_count <= 1) {
+        gc_workers_shutdown(gc);
+        return false;
+    }
+    
+    return true;
+}
+
+/* Run a job on every worker, the calling thread included, and wait for
+ * all of them to finish */
+static void gc_workers_run(mjs_gc_t* gc, int job) {
+    mjs_mutex_lock(&gc->worker_lock);
+    gc->worker_job = job;
+    gc->workers_running = gc->worker_count - 1;
+    gc->worker_epoch++;
+    mjs_cond_broadcast(&gc->worker_cond);
+    mjs_mutex_unlock(&gc->worker_lock);
+    
+    gc_worker_run(&gc->workers[0], job);
+    
+    mjs_mutex_lock(&gc->worker_lock);
+    while (gc->workers_running > 0) {
+        mjs_cond_wait(&gc->worker_done_cond, &gc->worker_lock);
+    }
+    mjs_mutex_unlock(&gc->worker_lock);
+}
+
+/* Trace everything reachable from the gray stack on all workers. The gray
+ * stack is dealt out round-robin to seed the deques. */
+static bool gc_parallel_mark(mjs_gc_t* gc) {
+    if (!gc_workers_prepare(gc)) return false;
+    
+    size_t seeded = 0;
+    while (gc->gray_count > 0) {
+        mjs_gc_worker_t* worker = &gc->workers[seeded % gc->worker_count];
+        if (!gc_deque_push(&worker->deque, gc->gray_stack[gc->gray_count - 1])) {
+            break; // The rest is drained serially
+        }
+        gc->gray_count--;
+        seeded++;
+    }
+    
+    for (size_t i = 0; i < gc->worker_count; i++) {
+        gc->workers[i].marked_bytes = 0;
+    }
+    gc->idle_workers = 0;
+    
+    gc_workers_run(gc, GC_JOB_MARK);
+    
+    for (size_t i = 0; i < gc->worker_count; i++) {
+        gc->marked_bytes += gc->workers[i].marked_bytes;
+        gc_deque_reset(&gc->workers[i].deque);
+    }
+    
+    gc->stats.parallel_marks++;
+    return true;
+}
+
+/* Sweep every queued page on all workers */
+static bool gc_parallel_sweep(mjs_gc_t* gc) {
+    if (!gc_workers_prepare(gc)) return false;
+    
+    mjs_gc_page_t** pages = MJS_MALLOC(sizeof(mjs_gc_page_t*) * gc->unswept_count);
+    if (!pages) return false;
+    
+    size_t count = 0;
+    for (int size_class = 0; size_class <= GC_LARGE_SIZE_CLASS; size_class++) {
+        while (gc->unswept_pages[size_class]) {
+            mjs_gc_page_t* page = gc->unswept_pages[size_class];
+            gc->unswept_pages[size_class] = page->next_unswept;
+            page->next_unswept = NULL;
+            pages[count++] = page;
+        }
+    }
+    gc->unswept_count = 0;
+    
+    for (size_t i = 0; i < gc->worker_count; i++) {
+        mjs_gc_worker_t* worker = &gc->workers[i];
+        worker->freed_objects[0] = worker->freed_objects[1] = 0;
+        worker->freed_bytes[0] = worker->freed_bytes[1] = 0;
+    }
+    gc->sweep_pages = pages;
+    gc->sweep_page_count = count;
+    gc->sweep_next = 0;
+    
+    gc->sweep_deferred = gc_finalizer_ready(gc);
+    gc_workers_run(gc, GC_JOB_SWEEP);
+    
+    for (size_t i = 0; i < gc->worker_count; i++) {
+        mjs_gc_worker_t* worker = &gc->workers[i];
+        gc_account_freed(gc, &gc->young_generation, worker->freed_objects[0], worker->freed_bytes[0]);
+        gc_account_freed(gc, &gc->old_generation, worker->freed_objects[1], worker->freed_bytes[1]);
+    }
+    for (size_t i = 0; i < count; i++) {
+        gc_sweep_page_finish(gc, pages[i]);
+    }
+    
+    gc->sweep_pages = NULL;
+    gc->sweep_page_count = 0;
+    MJS_FREE(pages);
+    
+    if (gc->state == GC_STATE_SWEEPING) {
+        gc->state = GC_STATE_IDLE;
+    }
+    gc_sweep_finished(gc);
+    gc->stats.parallel_sweeps++;
+    gc_update_statistics(gc);
+    return true;
+}
+
+/* Drain the gray stack completely, on all workers if the heap is big */
+static void gc_drain_gray_all(mjs_gc_t* gc) {
+    if (gc->gray_count > 0 && gc_parallel_worthwhile(gc)) {
+        gc_parallel_mark(gc);
+    }
+    gc_drain_gray(gc, 0);
+}
+
+/* Final marking pause. The insertion barrier does not cover stores into
+ * roots, so they are rescanned atomically before sweeping. After a
+ * concurrent cycle this is also where the last logged references are
+ * shaded. Sweeping itself only queues the pages; the cells are reclaimed
+ * as they are needed. */
+static void gc_finish_marking(mjs_gc_t* gc) {
+    MJS_TRACE_BEGIN("gc", "gc.mark");
+    gc_stop_marker(gc);
+    gc_drain_satb(gc, true);
+    gc_drain_gray_all(gc);
+    gc_mark_roots(gc);
+    gc_drain_gray_all(gc);
+    gc_mark_ephemerons(gc);
+    gc_process_weak_refs(gc, GC_WEAK_FULL);
+    gc_process_ephemeron_tables(gc, GC_WEAK_FULL);
+    if (gc->flush_string_table) {
+        gc_flush_string_table(gc);
+    }
+    if (gc->config.string_dedup) {
+        gc_dedup_strings(gc);
+    }
+    
+    gc->stats.collections++;
+    
+    // The next budget is sized once the pause ends and its cost is known
+    double survival = gc->heap_used > 0 ? (double)gc->marked_bytes / (double)gc->heap_used : 1.0;
+    gc->survival_rate = gc->stats.collections == 1 ? survival : (gc->survival_rate + survival) / 2;
+    gc->cycle_finished = true;
+    gc->bytes_since_collection = 0;
+    
+    mjs_gc_generation_t* generations[2] = { &gc->young_generation, &gc->old_generation };
+    for (int g = 0; g < 2; g++) {
+        for (mjs_gc_page_t* page = generations[g]->pages; page; page = page->next) {
+            page->swept = false;
+            page->next_unswept = gc->unswept_pages[page->size_class];
+            gc->unswept_pages[page->size_class] = page;
+            gc->unswept_count++;
+        }
+    }
+    
+    gc->state = gc->unswept_count > 0 ? GC_STATE_SWEEPING : GC_STATE_IDLE;
+    MJS_TRACE_END1("gc", "gc.mark", "marked_bytes", gc->marked_bytes);
+}
+
+/* Size the allocation budget for the next cycle. Collection should take
+ * gc_cpu_percent of the run time: a cycle costing C microseconds buys
+ * C * (100 - p) / p of mutator time, worth that much allocation at the
+ * measured rate. When most of the heap survives, collecting sooner frees
+ * little, so the budget never drops below the bytes the last cycle kept.
+ * The budget is capped at GC_MAX_GROWTH_FACTOR times the live heap and
+ * at half the room left under the memory limit. */
+static void gc_update_pacing(mjs_gc_t* gc, uint64_t now_us) {
+    uint64_t window_us = now_us - gc->pacing_window_start_us;
+    uint64_t mutator_us = window_us > gc->cycle_gc_us ? window_us - gc->cycle_gc_us : 1;
+    double rate = (double)gc->pacing_allocated * 1e6 / (double)mutator_us;
+    
+    bool first_cycle = gc->cycle_cost_us == 0;
+    gc->allocation_rate = first_cycle ? rate : (gc->allocation_rate + rate) / 2;
+    gc->cycle_cost_us = first_cycle ? (double)gc->cycle_gc_us : (gc->cycle_cost_us + (double)gc->cycle_gc_us) / 2;
+    
+    size_t percent = gc->config.gc_cpu_percent;
+    if (percent == 0 || percent >= 100) {
+        percent = GC_CPU_PERCENT;
+    }
+    double paced = gc->allocation_rate * gc->cycle_cost_us / 1e6 * (double)(100 - percent) / (double)percent;
+    
+    size_t live = gc->marked_bytes;
+    double floor = (double)live * gc->survival_rate;
+    if (floor < GC_INITIAL_HEAP_SIZE) {
+        floor = GC_INITIAL_HEAP_SIZE;
+    }
+    double ceiling = (double)live * (GC_MAX_GROWTH_FACTOR - 1);
+    if (ceiling < floor) {
+        ceiling = floor;
+    }
+    
+    double budget = paced < floor ? floor : paced > ceiling ? ceiling : paced;
+    if (gc->memory_limit > 0) {
+        double headroom = gc->memory_limit > live ? (double)(gc->memory_limit - live) / 2 : 0;
+        if (budget > headroom) {
+            budget = headroom > GC_PAGE_SIZE ? headroom : GC_PAGE_SIZE;
+        }
+    }
+    
+    gc->allocation_budget = (size_t)budget;
+    gc->stats.allocation_budget = gc->allocation_budget;
+    gc->pacing_window_start_us = now_us;
+    gc->pacing_allocated = 0;
+    gc->cycle_gc_us = 0;
+}
+
+static void gc_record_pause(mjs_gc_t* gc, uint64_t start_us) {
+    uint64_t now_us = mjs_gc_now_us();
+    uint64_t pause_us = now_us - start_us;
+    gc->stats.last_pause_us = pause_us;
+    if (pause_us > gc->stats.max_pause_us) {
+        gc->stats.max_pause_us = pause_us;
+    }
+    
+    gc->cycle_gc_us += pause_us;
+    if (gc->cycle_finished) {
+        gc->cycle_finished = false;
+        gc_update_pacing(gc, now_us);
+    }
+}
+
+/* Sweeping implementation */
+
+/* Free the white cells of a page and reset survivors to white. Returns
+ * the number of cells freed; only the page itself and the sweeping
+ * thread's free batch are modified. */
+static size_t gc_sweep_cells(mjs_gc_t* gc, mjs_gc_page_t* page, mjs_gc_free_batch_t** batch) {
+    size_t freed = 0;
+    
+    for (size_t i = 0; i < page->cell_count; i++) {
+        mjs_gc_object_header_t* header = GC_PAGE_CELL(page, i);
+        if (!header->in_use) continue;
+        
+        if (gc_page_get_mark(page, i) == GC_MARK_WHITE) {
+            // Object is garbage; its side buffers go to the finalizer
+            // thread when there is one
+            if (batch) {
+                gc_defer_finalize(gc, batch, header);
+            } else {
+                gc_finalize_object(header);
+            }
+            gc_release_cell(page, header);
+            freed++;
+        }
+    }
+    
+    // Reset every mark for the next collection in one go
+    gc_page_clear_marks(page);
+    
+    return freed;
+}
+
+/* Hand a swept page back to the allocator. Returns false if the page
+ * itself was released (a dead large object). */
+static bool gc_sweep_page_finish(mjs_gc_t* gc, mjs_gc_page_t* page) {
+    page->swept = true;
+    
+    if (page->size_class == GC_LARGE_SIZE_CLASS) {
+        if (page->live_count == 0) {
+            gc_page_release(gc, page);
+            return false;
+        }
+    } else {
+        if (page->live_count == 0 && page->empty_since_us == 0) {
+            page->empty_since_us = mjs_gc_now_us();
+        }
+        if (page->free_cells) {
+            gc_free_list_push(gc, page);
+        }
+    }
+    
+    return true;
+}
+
+static bool gc_sweep_page(mjs_gc_t* gc, mjs_gc_page_t* page) {
+    size_t freed = gc_sweep_cells(gc, page, gc_finalizer_ready(gc) ? &gc->free_batch : NULL);
+    gc_account_freed(gc, gc_page_generation(gc, page), freed, freed * page->cell_size);
+    return gc_sweep_page_finish(gc, page);
+}
+
+/* Sweep one queued page of a size class. Returns false if none is left. */
+static bool gc_sweep_next_page(mjs_gc_t* gc, int size_class) {
+    mjs_gc_page_t* page = gc->unswept_pages[size_class];
+    if (!page) return false;
+    
+    gc->unswept_pages[size_class] = page->next_unswept;
+    page->next_unswept = NULL;
+    gc->unswept_count--;
+    
+    gc_sweep_page(gc, page);
+    
+    if (gc->unswept_count == 0 && gc->state == GC_STATE_SWEEPING) {
+        gc->state = GC_STATE_IDLE;
+        gc_sweep_finished(gc);
+        gc_update_statistics(gc);
+    }
+    
+    return true;
+}
+
+bool mjs_gc_sweep_step(mjs_gc_t* gc, uint64_t deadline_us) {
+    if (!gc || gc->unswept_count == 0) return true;
+    
+    MJS_TRACE_BEGIN1("gc", "gc.sweep", "pages", gc->unswept_count);
+    for (int size_class = 0; size_class <= GC_LARGE_SIZE_CLASS; size_class++) {
+        while (gc_sweep_next_page(gc, size_class)) {
+            if (deadline_us && mjs_gc_now_us() >= deadline_us) {
+                MJS_TRACE_END1("gc", "gc.sweep", "unswept", gc->unswept_count);
+                return gc->unswept_count == 0;
+            }
+        }
+    }
+    MJS_TRACE_END1("gc", "gc.sweep", "unswept", gc->unswept_count);
+    
+    return true;
+}
+
+void mjs_gc_finish_sweeping(mjs_gc_t* gc) {
+    if (!gc) return;
+    
+    if (gc->unswept_count > 1 && gc_parallel_worthwhile(gc)) {
+        gc_parallel_sweep(gc);
+    }
+    mjs_gc_sweep_step(gc, 0);
+}
+
+/* Clear weak references whose target was not marked. The survivors are
+ * compacted to the front of the array; callbacks run once the array is
+ * consistent again, so they may create or destroy weak references. */
+static bool gc_is_dead(mjs_gc_t* gc, void* obj, gc_weak_scope_t scope) {
+    if (!mjs_gc_is_valid_object(gc, obj)) return !mjs_gc_is_shared_object(gc, obj);
+    
+    // A closing region frees its garbage before the weak pass
+    if (scope == GC_WEAK_REGION) return false;
+    
+    mjs_gc_object_header_t* header = GC_OBJECT_TO_HEADER(obj);
+    return gc_get_mark(header) == GC_MARK_WHITE &&
+           (scope == GC_WEAK_FULL || GC_PAGE_OF(header)->generation == 0);
+}
+
+static void gc_process_weak_refs(mjs_gc_t* gc, gc_weak_scope_t scope) {
+    // Room to defer every callback; without it they run as found
+    mjs_weak_ref_t** cleared = gc->cleared_weak_refs;
+    if (gc->cleared_weak_ref_capacity < gc->weak_ref_count) {
+        cleared = MJS_REALLOC(gc->cleared_weak_refs, sizeof(mjs_weak_ref_t*) * gc->weak_ref_capacity);
+        if (cleared) {
+            gc->cleared_weak_refs = cleared;
+            gc->cleared_weak_ref_capacity = gc->weak_ref_capacity;
+        }
+    }
+    
+    size_t live = 0;
+    size_t cleared_count = 0;
+    for (size_t i = 0; i < gc->weak_ref_count; i++) {
+        mjs_weak_ref_t* weak_ref = gc->weak_refs[i];
+        
+        if (weak_ref->object && !gc_is_dead(gc, weak_ref->object, scope)) {
+            weak_ref->index = live;
+            gc->weak_refs[live++] = weak_ref;
+            continue;
+        }
+        
+        // Referenced object is gone or about to be collected
+        weak_ref->object = NULL;
+        if (cleared) {
+            cleared[cleared_count++] = weak_ref;
+        } else {
+            if (weak_ref->callback) {
+                weak_ref->callback(weak_ref->userdata);
+            }
+            MJS_FREE(weak_ref);
+        }
+    }
+    gc->weak_ref_count = live;
+    
+    for (size_t i = 0; i < cleared_count; i++) {
+        if (cleared[i]->callback) {
+            cleared[i]->callback(cleared[i]->userdata);
+        }
+        MJS_FREE(cleared[i]);
+    }
+}
+
+void mjs_gc_process_weak_refs(mjs_gc_t* gc) {
+    if (!gc || gc->state != GC_STATE_MARKING) return;
+    gc_process_weak_refs(gc, GC_WEAK_FULL);
+}
+
+/* Ephemerons. In the final pause every entry whose key is marked gets its
+ * value marked, and the other entries wait in a map from key to the chain
+ * of its values. Marking a waiting key moves its chain to the ready list;
+ * draining the gray stack alternates with releasing ready chains until
+ * neither has work. Every entry is looked at a bounded number of times,
+ * where iterating over the tables to a fixpoint is quadratic in the
+ * length of key -> value -> key chains. This runs on the serial marking
+ * path, which is where the key hook sits. */
+static size_t gc_ephemeron_hash(void* key, size_t capacity) {
+    uintptr_t hash = (uintptr_t)key;
+    hash ^= hash >> 17;
+    hash *= (uintptr_t)0x9E3779B97F4A7C15ULL;
+    return (size_t)(hash ^ (hash >> 29)) & (capacity - 1);
+}
+
+static inline bool gc_ephemeron_is_key(void* key) {
+    return key && key != GC_EPHEMERON_TOMBSTONE;
+}
+
+static void gc_ephemeron_wait(mjs_gc_t* gc, void* key, mjs_value_t value) {
+    size_t mask = gc->ephemeron_key_capacity - 1;
+    size_t slot = gc_ephemeron_hash(key, gc->ephemeron_key_capacity);
+    while (gc->ephemeron_keys[slot].key && gc->ephemeron_keys[slot].key != key) {
+        slot = (slot + 1) & mask;
+    }
+    
+    size_t index = gc->ephemeron_value_count++;
+    gc->ephemeron_values[index].value = value;
+    gc->ephemeron_values[index].next = gc->ephemeron_keys[slot].key ? gc->ephemeron_keys[slot].head : SIZE_MAX;
+    gc->ephemeron_keys[slot].key = key;
+    gc->ephemeron_keys[slot].head = index;
+}
+
+static void gc_ephemeron_key_marked(mjs_gc_t* gc, void* key) {
+    size_t mask = gc->ephemeron_key_capacity - 1;
+    size_t slot = gc_ephemeron_hash(key, gc->ephemeron_key_capacity);
+    while (gc->ephemeron_keys[slot].key) {
+        if (gc->ephemeron_keys[slot].key == key) {
+            // A key is marked once, so the slot is retired rather than emptied
+            gc->ephemeron_ready[gc->ephemeron_ready_count++] = gc->ephemeron_keys[slot].head;
+            gc->ephemeron_keys[slot].key = GC_EPHEMERON_TOMBSTONE;
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+static void gc_ephemeron_release(mjs_gc_t* gc) {
+    MJS_FREE(gc->ephemeron_keys);
+    MJS_FREE(gc->ephemeron_values);
+    MJS_FREE(gc->ephemeron_ready);
+    gc->ephemeron_keys = NULL;
+    gc->ephemeron_values = NULL;
+    gc->ephemeron_ready = NULL;
+    gc->ephemeron_key_capacity = 0;
+    gc->ephemeron_value_count = 0;
+    gc->ephemeron_ready_count = 0;
+}
+
+/* Mark every value regardless of its key */
+static void gc_mark_ephemeron_values(mjs_gc_t* gc) {
+    for (size_t i = 0; i < gc->ephemeron_table_count; i++) {
+        mjs_ephemeron_table_t* table = gc->ephemeron_tables[i];
+        for (size_t j = 0; j < table->capacity; j++) {
+            if (gc_ephemeron_is_key(table->entries[j].key)) {
+                gc_mark_value(gc, table->entries[j].value);
+            }
+        }
+    }
+}
+
+static void gc_mark_ephemerons(mjs_gc_t* gc) {
+    size_t total = 0;
+    for (size_t i = 0; i < gc->ephemeron_table_count; i++) {
+        total += gc->ephemeron_tables[i]->count;
+    }
+    if (total == 0) return;
+    
+    size_t capacity = 16;
+    while (capacity < total * 2) {
+        capacity *= 2;
+    }
+    gc->ephemeron_keys = MJS_CALLOC(capacity, sizeof(mjs_gc_ephemeron_key_t));
+    gc->ephemeron_values = MJS_MALLOC(sizeof(mjs_gc_ephemeron_value_t) * total);
+    gc->ephemeron_ready = MJS_MALLOC(sizeof(size_t) * total);
+    if (!gc->ephemeron_keys || !gc->ephemeron_values || !gc->ephemeron_ready) {
+        // Out of memory - keep every value alive for this cycle instead
+        gc_ephemeron_release(gc);
+        gc_mark_ephemeron_values(gc);
+        gc_drain_gray(gc, 0);
+        return;
+    }
+    gc->ephemeron_key_capacity = capacity;
+    
+    for (size_t i = 0; i < gc->ephemeron_table_count; i++) {
+        mjs_ephemeron_table_t* table = gc->ephemeron_tables[i];
+        for (size_t j = 0; j < table->capacity; j++) {
+            mjs_ephemeron_entry_t* entry = &table->entries[j];
+            if (!gc_ephemeron_is_key(entry->key)) continue;
+            
+            if (gc_is_dead(gc, entry->key, GC_WEAK_FULL)) {
+                gc_ephemeron_wait(gc, entry->key, entry->value);
+            } else {
+                gc_mark_value(gc, entry->value);
+            }
+        }
+    }
+    
+    do {
+        gc_drain_gray(gc, 0);
+        while (gc->ephemeron_ready_count > 0) {
+            size_t index = gc->ephemeron_ready[--gc->ephemeron_ready_count];
+            for (; index != SIZE_MAX; index = gc->ephemeron_values[index].next) {
+                gc_mark_value(gc, gc->ephemeron_values[index].value);
+            }
+        }
+    } while (gc->gray_count > 0);
+    
+    gc_ephemeron_release(gc);
+}
+
+/* Drop the entries whose key is about to be collected */
+static void gc_process_ephemeron_tables(mjs_gc_t* gc, gc_weak_scope_t scope) {
+    for (size_t i = 0; i < gc->ephemeron_table_count; i++) {
+        mjs_ephemeron_table_t* table = gc->ephemeron_tables[i];
+        for (size_t j = 0; j < table->capacity; j++) {
+            mjs_ephemeron_entry_t* entry = &table->entries[j];
+            if (gc_ephemeron_is_key(entry->key) && gc_is_dead(gc, entry->key, scope)) {
+                entry->key = GC_EPHEMERON_TOMBSTONE;
+                entry->value = mjs_value_undefined();
+                table->count--;
+            }
+        }
+    }
+}
+
+/* Compaction implementation. Sparse old-generation pages are evacuated
+ * into the other pages of their size class, every reference is redirected
+ * through the forwarding pointers left behind, and the emptied pages are
+ * released. Runs right after a full sweep, so every cell in use is live. */
+
+static void gc_pin_page_of(mjs_gc_t* gc, void* obj) {
+    mjs_gc_page_t* page = mjs_gc_page_of(gc, obj);
+    if (page) {
+        page->pinned = true;
+    }
+}
+
+/* Pages holding roots, pinned objects or interned strings stay put: native
+ * code refers to those objects by address */
+static void gc_compact_pin_pages(mjs_gc_t* gc) {
+    for (mjs_gc_page_t* page = gc->old_generation.pages; page; page = page->next) {
+        page->pinned = false;
+        page->evacuating = false;
+    }
+    
+    for (size_t i = 0; i < gc->root_count; i++) {
+        gc_pin_page_of(gc, gc->roots[i]);
+    }
+    for (size_t i = 0; i < gc->scoped_root_count; i++) {
+        gc_pin_page_of(gc, gc->scoped_roots[i]);
+    }
+    for (size_t i = 0; i < gc->pinned_count; i++) {
+        gc_pin_page_of(gc, gc->pinned[i]);
+    }
+    if (gc->runtime) {
+        for (mjs_string_t* str = gc->runtime->string_table; str; str = str->next) {
+            gc_pin_page_of(gc, str);
+        }
+    }
+}
+
+/* Pick the evacuation candidates of one size class. Evacuating only pays
+ * off if it frees more pages than the survivors need new ones. */
+static size_t gc_compact_select(mjs_gc_t* gc, int size_class) {
+    size_t live_cells = 0;
+    size_t free_cells = 0;
+    size_t cells_per_page = 0;
+    size_t candidates = 0;
+    
+    for (mjs_gc_page_t* page = gc->old_generation.pages; page; page = page->next) {
+        if (page->size_class != size_class) continue;
+        
+        cells_per_page = page->cell_count;
+        if (!page->pinned && page->live_count * 100 < page->cell_count * gc->config.compact_live_percent) {
+            page->evacuating = true;
+            live_cells += page->live_count;
+            candidates++;
+        } else {
+            free_cells += page->cell_count - page->live_count;
+        }
+    }
+    
+    size_t pages_needed = 0;
+    if (live_cells > free_cells) {
+        pages_needed = (live_cells - free_cells + cells_per_page - 1) / cells_per_page;
+    }
+    
+    if (candidates <= pages_needed) {
+        for (mjs_gc_page_t* page = gc->old_generation.pages; page; page = page->next) {
+            if (page->size_class == size_class) {
+                page->evacuating = false;
+            }
+        }
+        return 0;
+    }
+    
+    return candidates;
+}
+
+/* Free lists hold exactly the pages with free cells that are not being
+ * evacuated. While compacting, only old pages are listed so survivors
+ * stay in the old generation. */
+static void gc_clear_free_lists(mjs_gc_t* gc) {
+    for (int size_class = 0; size_class < GC_SIZE_CLASS_COUNT; size_class++) {
+        for (mjs_gc_page_t* page = gc->free_pages[size_class]; page;) {
+            mjs_gc_page_t* next = page->next_free;
+            page->next_free = NULL;
+            page->in_free_list = false;
+            page = next;
+        }
+        gc->free_pages[size_class] = NULL;
+    }
+}
+
+static void gc_rebuild_free_lists(mjs_gc_t* gc, bool old_only) {
+    gc_clear_free_lists(gc);
+    
+    mjs_gc_generation_t* generations[2] = { &gc->old_generation, &gc->young_generation };
+    for (int g = 0; g < (old_only ? 1 : 2); g++) {
+        for (mjs_gc_page_t* page = generations[g]->pages; page; page = page->next) {
+            if (page->free_cells && !page->evacuating) {
+                gc_free_list_push(gc, page);
+            }
+        }
+    }
+}
+
+/* Return fully empty pages to the system so another size class can use
+ * the memory. Only called with sweeping finished. */
+static size_t gc_release_empty_pages(mjs_gc_t* gc) {
+    size_t released = 0;
+    
+    // Unlink every page first so none of the released ones stays on a list
+    gc_clear_free_lists(gc);
+    
+    mjs_gc_generation_t* generations[3] = { &gc->young_generation, &gc->old_generation, &gc->region_pool.pages };
+    for (int g = 0; g < 3; g++) {
+        mjs_gc_page_t* page = generations[g]->pages;
+        while (page) {
+            mjs_gc_page_t* next = page->next;
+            if (page->live_count == 0 && page->swept) {
+                gc_page_release(gc, page);
+                released++;
+            }
+            page = next;
+        }
+    }
+    
+    gc_rebuild_free_lists(gc, false);
+    return released;
+}
+
+/* Release small pages a sweep found empty at least decommit_delay_us ago.
+ * The delay keeps pages that are refilled right away from being
+ * decommitted and faulted in again every cycle. */
+static bool gc_page_idle(mjs_gc_t* gc, mjs_gc_page_t* page, uint64_t now_us) {
+    return page->size_class != GC_LARGE_SIZE_CLASS && page->live_count == 0 && page->swept &&
+           page->empty_since_us != 0 && now_us - page->empty_since_us >= gc->config.decommit_delay_us;
+}
+
+static void gc_release_idle_pages(mjs_gc_t* gc) {
+    uint64_t now_us = mjs_gc_now_us();
+    mjs_gc_generation_t* generations[3] = { &gc->young_generation, &gc->old_generation, &gc->region_pool.pages };
+    
+    size_t idle = 0;
+    for (int g = 0; g < 3; g++) {
+        for (mjs_gc_page_t* page = generations[g]->pages; page; page = page->next) {
+            if (gc_page_idle(gc, page, now_us)) {
+                idle++;
+            }
+        }
+    }
+    if (idle == 0) return;
+    
+    gc_clear_free_lists(gc);
+    for (int g = 0; g < 3; g++) {
+        mjs_gc_page_t* page = generations[g]->pages;
+        while (page) {
+            mjs_gc_page_t* next = page->next;
+            if (gc_page_idle(gc, page, now_us)) {
+                gc_page_release(gc, page);
+            }
+            page = next;
+        }
+    }
+    gc_rebuild_free_lists(gc, false);
+}
+
+/* Sweeping caught up: hand the recorded side buffers to the finalizer
+ * thread and give long-empty pages back to the OS */
+static void gc_sweep_finished(mjs_gc_t* gc) {
+    if (gc->free_batch) {
+        gc_flush_free_batch(gc, &gc->free_batch);
+    }
+    gc_release_idle_pages(gc);
+}
+
+/* Take a cell in the old generation for an evacuated object */
+static mjs_gc_object_header_t* gc_compact_allocate(mjs_gc_t* gc, int size_class) {
+    mjs_gc_page_t* page = gc->free_pages[size_class];
+    if (!page) {
+        page = gc_page_new(gc, size_class, 0);
+        if (!page) return NULL;
+        gc_promote_page(gc, page);
+        gc_free_list_push(gc, page);
+    }
+    
+    mjs_gc_object_header_t* header = page->free_cells;
+    page->free_cells = GC_CELL_LINK(header);
+    page->live_count++;
+    gc->old_generation.size += page->cell_size;
+    gc->old_generation.object_count++;
+    gc->heap_used += page->cell_size;
+    
+    if (!page->free_cells) {
+        gc->free_pages[size_class] = page->next_free;
+        page->next_free = NULL;
+        page->in_free_list = false;
+    }
+    
+    return header;
+}
+
+/* Move the objects off an evacuation candidate. Returns false if the heap
+ * ran out of room; whatever did not move stays where it is. */
+static bool gc_evacuate_page(mjs_gc_t* gc, mjs_gc_page_t* page) {
+    for (size_t i = 0; i < page->cell_count; i++) {
+        mjs_gc_object_header_t* header = GC_PAGE_CELL(page, i);
+        if (!header->in_use) continue;
+        
+        mjs_gc_object_header_t* copy = gc_compact_allocate(gc, page->size_class);
+        if (!copy) return false;
+        
+        memcpy(copy, header, GC_HEADER_SIZE + header->size);
+        gc_set_mark(copy, GC_MARK_WHITE);
+        
+        gc_page_set_mark(page, i, GC_MARK_FORWARDED);
+        GC_CELL_LINK(header) = copy;
+        gc->stats.objects_moved++;
+    }
+    
+    return true;
+}
+
+static void* gc_forward(mjs_gc_t* gc, void* ptr) {
+    if (!ptr || !mjs_gc_is_valid_object(gc, ptr)) return ptr;
+    
+    mjs_gc_object_header_t* header = GC_OBJECT_TO_HEADER(ptr);
+    if (gc_get_mark(header) != GC_MARK_FORWARDED) return ptr;
+    
+    return GC_HEADER_TO_OBJECT(GC_CELL_LINK(header));
+}
+
+static void gc_forward_pointer(mjs_gc_t* gc, void** slot) {
+    *slot = gc_forward(gc, *slot);
+}
+
+static void gc_forward_value(mjs_gc_t* gc, mjs_value_t* value) {
+    switch (value->tag) {
+        case MJS_TAG_STRING:
+        case MJS_TAG_OBJECT:
+        case MJS_TAG_FUNCTION:
+        case MJS_TAG_ARRAY:
+            value->u.ptr = gc_forward(gc, value->u.ptr);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Redirect every reference slot of a live object */
+static void gc_update_references(mjs_gc_t* gc, mjs_gc_object_header_t* header) {
+    gc_visit_object(gc, header, gc_forward_value, gc_forward_pointer);
+}
+
+static void gc_update_page_references(mjs_gc_t* gc, mjs_gc_page_t* page) {
+    for (size_t i = 0; i < page->cell_count; i++) {
+        mjs_gc_object_header_t* header = GC_PAGE_CELL(page, i);
+        if (header->in_use && gc_page_get_mark(page, i) != GC_MARK_FORWARDED) {
+            gc_update_references(gc, header);
+        }
+    }
+}
+
+static void gc_compact(mjs_gc_t* gc) {
+    gc_compact_pin_pages(gc);
+    
+    size_t candidates = 0;
+    for (int size_class = 0; size_class < GC_SIZE_CLASS_COUNT; size_class++) {
+        candidates += gc_compact_select(gc, size_class);
+    }
+    if (candidates == 0) return;
+    
+    MJS_TRACE_BEGIN1("gc", "gc.compact", "pages", candidates);
+    size_t moved_before = gc->stats.objects_moved;
+    
+    // Evacuate. Pages reserved for survivors are linked in at the head of
+    // the old generation, behind the iteration.
+    gc_rebuild_free_lists(gc, true);
+    for (mjs_gc_page_t* page = gc->old_generation.pages; page; page = page->next) {
+        if (page->evacuating && !gc_evacuate_page(gc, page)) {
+            break;
+        }
+    }
+    
+    // Update references held by the heap, the open regions, the roots,
+    // the contexts, the weak refs and the ephemeron tables
+    mjs_gc_generation_t* generations[2] = { &gc->young_generation, &gc->old_generation };
+    for (int g = 0; g < 2; g++) {
+        for (mjs_gc_page_t* page = generations[g]->pages; page; page = page->next) {
+            gc_update_page_references(gc, page);
+        }
+    }
+    for (mjs_gc_region_t* region = gc->region; region; region = region->outer) {
+        for (mjs_gc_page_t* page = region->pages.pages; page; page = page->next) {
+            gc_update_page_references(gc, page);
+        }
+    }
+    for (size_t i = 0; i < gc->root_count; i++) {
+        gc->roots[i] = gc_forward(gc, gc->roots[i]);
+    }
+    gc_visit_context_roots(gc, gc_forward_value, gc_forward_pointer);
+    for (size_t i = 0; i < gc->weak_ref_count; i++) {
+        gc->weak_refs[i]->object = gc_forward(gc, gc->weak_refs[i]->object);
+    }
+    for (size_t i = 0; i < gc->ephemeron_table_count; i++) {
+        mjs_ephemeron_table_t* table = gc->ephemeron_tables[i];
+        for (size_t j = 0; j < table->capacity; j++) {
+            mjs_ephemeron_entry_t* entry = &table->entries[j];
+            if (entry->key && entry->key != GC_EPHEMERON_TOMBSTONE) {
+                entry->key = gc_forward(gc, entry->key);
+                gc_forward_value(gc, &entry->value);
+            }
+        }
+        gc_ephemeron_table_rehash(table);
+    }
+    
+    // Release the forwarded cells; no finalizer runs, the copy owns the
+    // off-heap memory now
+    mjs_gc_page_t* page = gc->old_generation.pages;
+    while (page) {
+        mjs_gc_page_t* next = page->next;
+        
+        if (page->evacuating) {
+            for (size_t i = 0; i < page->cell_count; i++) {
+                mjs_gc_object_header_t* header = GC_PAGE_CELL(page, i);
+                if (header->in_use && gc_page_get_mark(page, i) == GC_MARK_FORWARDED) {
+                    gc_release_cell(page, header);
+                    gc->old_generation.size -= page->cell_size;
+                    gc->old_generation.object_count--;
+                    gc->heap_used -= page->cell_size;
+                }
+            }
+            page->evacuating = false;
+            
+            if (page->live_count == 0) {
+                gc_page_release(gc, page);
+                gc->stats.pages_compacted++;
+            }
         }
         
-        case GC_STATE_SWEEPING:
-            // TODO: Implement incremental sweeping
-            gc_sweep(gc);
-            gc->state = GC_STATE_IDLE;
-            gc->stats.collections++;
-            break;
-            
-        case GC_STATE_COMPACTING:
-            // TODO: Implement incremental compaction
-            gc_compact(gc);
-            gc->state = GC_STATE_IDLE;
-            break;
+        page = next;
     }
     
-    return true;
+    gc_rebuild_free_lists(gc, false);
+    gc->stats.compactions++;
+    MJS_TRACE_END1("gc", "gc.compact", "objects_moved", gc->stats.objects_moved - moved_before);
 }
 
-/* Marking implementation */
-static void gc_mark_roots(mjs_gc_t* gc) {
-    for (size_t i = 0; i < gc->root_count; i++) {
-        void* obj = gc->roots[i];
-        if (obj) {
-            gc_mark_object(gc, obj);
+/* Allocation regions. While a region is open every allocation fills pages
+ * owned by the region: no collection is started or paced by them and
+ * their pages are never swept. Closing the region frees what is left on
+ * its pages in one pass, with no marking, and keeps the pages for the
+ * next region.
+ *
+ * Liveness is kept by an escape barrier instead of tracing. An object
+ * stored into anything older than its region - an object of the heap or
+ * of an outer region, or global state such as the string table - is
+ * flagged with the depth it escaped to, and so is everything it refers
+ * to, transitively. When the region closes, whatever the roots still
+ * refer to escapes the same way; flagged objects stay where they are and
+ * their pages pass to the outer region, or to the young generation. The
+ * barrier is the write barrier, so stores that skip it are not seen. */
+static void gc_region_clear_marks(mjs_gc_t* gc) {
+    for (mjs_gc_region_t* region = gc->region; region; region = region->outer) {
+        for (mjs_gc_page_t* page = region->pages.pages; page; page = page->next) {
+            gc_page_clear_marks(page);
         }
     }
 }
 
-static void gc_mark_object(mjs_gc_t* gc, void* obj) {
-    if (!obj) return;
-    
-    mjs_gc_object_header_t* header = GC_OBJECT_TO_HEADER(obj);
+/* Hand a page and every object on it to a region, or to the young
+ * generation when region is NULL */
+static void gc_region_move_page(mjs_gc_t* gc, mjs_gc_page_t* page, mjs_gc_region_t* region) {
+    mjs_gc_generation_t* from = gc_page_generation(gc, page);
+    size_t live_bytes = page->live_count * page->cell_size;
     
-    // Skip if already marked
-    if (header->mark != GC_MARK_WHITE) return;
+    if (page->region && page->size_class != GC_LARGE_SIZE_CLASS &&
+        page->region->current[page->size_class] == page) {
+        page->region->current[page->size_class] = NULL;
+    }
+    gc_page_unlink(from, page);
+    from->size -= live_bytes;
+    from->object_count -= page->live_count;
     
-    // Mark as gray (being processed)
-    header->mark = GC_MARK_GRAY;
+    page->region = region;
+    mjs_gc_generation_t* to = gc_page_generation(gc, page);
+    gc_page_link(to, page);
+    to->size += live_bytes;
+    to->object_count += page->live_count;
+}
+
+/* Depth of the region an object lives as long as; 0 for the heap */
+static size_t gc_region_depth_of(mjs_gc_object_header_t* header) {
+    mjs_gc_page_t* page = GC_PAGE_OF(header);
+    if (!page->region) return 0;
+    return header->escaped_to ? (size_t)header->escaped_to - 1 : page->region->depth;
+}
+
+/* Let an object deeper than region_escape_depth escape to that depth, and
+ * queue it so that what it refers to follows */
+static void gc_region_escape_object(mjs_gc_t* gc, void* obj) {
+    if (!obj || !mjs_gc_is_valid_object(gc, obj)) return;
     
-    // Add to gray stack for processing
-    if (gc->gray_count >= gc->gray_capacity) {
-        size_t new_capacity = gc->gray_capacity == 0 ? 256 : gc->gray_capacity * 2;
-        mjs_gc_object_header_t** new_stack = MJS_REALLOC(gc->gray_stack, 
-            sizeof(mjs_gc_object_header_t*) * new_capacity);
-        if (!new_stack) return; // Out of memory during GC
-        
-        gc->gray_stack = new_stack;
-        gc->gray_capacity = new_capacity;
-    }
+    mjs_gc_object_header_t* header = GC_OBJECT_TO_HEADER(obj);
+    if (gc_region_depth_of(header) <= gc->region_escape_depth) return;
     
-    gc->gray_stack[gc->gray_count++] = header;
+    header->escaped_to = (uint8_t)(gc->region_escape_depth + 1);
+    gc->stats.region_objects_escaped++;
     
-    // Mark object's children based on type
-    switch (header->type) {
-        case GC_TYPE_STRING:
-            // Strings have no references
-            break;
-            
-        case GC_TYPE_OBJECT: {
-            mjs_object_t* object = (mjs_object_t*)obj;
-            
-            // Mark prototype
-            if (object->prototype) {
-                gc_mark_object(gc, object->prototype);
-            }
-            
-            // Mark properties
-            mjs_property_t* prop = object->properties;
-            while (prop) {
-                if (prop->key) {
-                    gc_mark_object(gc, prop->key);
-                }
-                // TODO: Mark property value if it's an object
-                prop = prop->next;
-            }
-            break;
-        }
-        
-        case GC_TYPE_ARRAY: {
-            mjs_array_t* array = (mjs_array_t*)obj;
-            
-            // Mark array elements
-            for (size_t i = 0; i < array->length; i++) {
-                // TODO: Mark array element if it's an object
-            }
-            break;
+    if (gc->region_escape_count >= gc->region_escape_capacity) {
+        size_t new_capacity = gc->region_escape_capacity == 0 ? 64 : gc->region_escape_capacity * 2;
+        void** new_escapes = MJS_REALLOC(gc->region_escapes, sizeof(void*) * new_capacity);
+        if (!new_escapes) {
+            // What obj refers to is not followed, so keep everything
+            gc->region_escape_overflow = true;
+            return;
         }
-        
-        case GC_TYPE_FUNCTION: {
-            mjs_function_t* function = (mjs_function_t*)obj;
-            
-            // Mark function name
-            if (function->name) {
-                gc_mark_object(gc, function->name);
-            }
-            
-            // Mark closure variables
-            // TODO: Implement closure marking
+        gc->region_escapes = new_escapes;
+        gc->region_escape_capacity = new_capacity;
+    }
+    gc->region_escapes[gc->region_escape_count++] = obj;
+}
+
+static void gc_region_escape_value(mjs_gc_t* gc, mjs_value_t* slot) {
+    switch (slot->tag) {
+        case MJS_TAG_STRING:
+        case MJS_TAG_OBJECT:
+        case MJS_TAG_FUNCTION:
+        case MJS_TAG_ARRAY:
+            gc_region_escape_object(gc, slot->u.ptr);
             break;
-        }
-        
         default:
             break;
     }
+}
+
+static void gc_region_escape_pointer(mjs_gc_t* gc, void** slot) {
+    gc_region_escape_object(gc, *slot);
+}
+
+static void gc_region_drain_escapes(mjs_gc_t* gc) {
+    while (gc->region_escape_count > 0) {
+        void* obj = gc->region_escapes[--gc->region_escape_count];
+        gc_visit_object(gc, GC_OBJECT_TO_HEADER(obj), gc_region_escape_value, gc_region_escape_pointer);
+    }
+}
+
+/* A store of child into parent, or into global state when parent is NULL */
+static void gc_region_barrier(mjs_gc_t* gc, void* parent, void* child) {
+    if (!mjs_gc_is_valid_object(gc, child)) return;
     
-    // Mark as black (fully processed)
-    header->mark = GC_MARK_BLACK;
+    mjs_gc_object_header_t* header = GC_OBJECT_TO_HEADER(child);
+    if (!GC_PAGE_OF(header)->region) return;
+    
+    size_t depth = 0;
+    if (parent && mjs_gc_is_valid_object(gc, parent)) {
+        depth = gc_region_depth_of(GC_OBJECT_TO_HEADER(parent));
+    }
+    if (gc_region_depth_of(header) <= depth) return;
+    
+    gc->region_escape_depth = depth;
+    gc_region_escape_object(gc, child);
+    gc_region_drain_escapes(gc);
 }
 
-/* Sweeping implementation */
-static void gc_sweep(mjs_gc_t* gc) {
-    // Sweep young generation
-    mjs_gc_object_header_t* obj = gc->young_generation.objects;
-    mjs_gc_object_header_t* prev = NULL;
-    
-    while (obj) {
-        mjs_gc_object_header_t* next = obj->next;
-        
-        if (obj->mark == GC_MARK_WHITE) {
-            // Object is garbage
-            if (prev) {
-                prev->next = next;
-            } else {
-                gc->young_generation.objects = next;
-            }
-            
-            gc->young_generation.size -= (obj->size + GC_HEADER_SIZE);
-            gc->stats.objects_freed++;
-            gc->stats.bytes_freed += (obj->size + GC_HEADER_SIZE);
-        } else {
-            // Reset mark for next collection
-            obj->mark = GC_MARK_WHITE;
-            prev = obj;
-        }
-        
-        obj = next;
+static void gc_region_barrier_value(mjs_gc_t* gc, void* parent, mjs_value_t value) {
+    switch (value.tag) {
+        case MJS_TAG_STRING:
+        case MJS_TAG_OBJECT:
+        case MJS_TAG_FUNCTION:
+        case MJS_TAG_ARRAY:
+            gc_region_barrier(gc, parent, value.u.ptr);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Take a page for a region: one emptied by an earlier region if there is
+ * one, laid out again for the size class, or else a fresh page */
+static mjs_gc_page_t* gc_region_page_new(mjs_gc_t* gc, int size_class, size_t size) {
+    mjs_gc_page_t* page = size_class == GC_LARGE_SIZE_CLASS ? NULL : gc->region_pool.pages.pages;
+    if (!page) {
+        return gc_page_new(gc, size_class, size);
     }
     
-    // Sweep old generation
-    obj = gc->old_generation.objects;
-    prev = NULL;
+    page->size_class = size_class;
+    page->cell_size = GC_ALIGN(GC_HEADER_SIZE + gc_size_classes[size_class], 8);
+    page->cell_count = (page->chunk_size - GC_PAGE_HEADER_SIZE) / page->cell_size;
+    gc_page_thread_cells(page);
+    return page;
+}
+
+static mjs_gc_object_header_t* gc_region_allocate_cell(mjs_gc_t* gc, size_t size, mjs_gc_page_t** page_out) {
+    mjs_gc_region_t* region = gc->region;
+    int size_class = gc_size_class(size);
+    mjs_gc_page_t* page = size_class == GC_LARGE_SIZE_CLASS ? NULL : region->current[size_class];
     
-    while (obj) {
-        mjs_gc_object_header_t* next = obj->next;
+    if (!page || !page->free_cells) {
+        page = gc_region_page_new(gc, size_class, size);
+        if (!page) return NULL;
         
-        if (obj->mark == GC_MARK_WHITE) {
-            // Object is garbage
-            if (prev) {
-                prev->next = next;
-            } else {
-                gc->old_generation.objects = next;
-            }
-            
-            gc->old_generation.size -= (obj->size + GC_HEADER_SIZE);
-            gc->stats.objects_freed++;
-            gc->stats.bytes_freed += (obj->size + GC_HEADER_SIZE);
-        } else {
-            // Reset mark for next collection
-            obj->mark = GC_MARK_WHITE;
-            prev = obj;
+        gc_region_move_page(gc, page, region);
+        if (size_class != GC_LARGE_SIZE_CLASS) {
+            region->current[size_class] = page;
         }
-        
-        obj = next;
     }
     
-    // Process weak references
-    mjs_weak_ref_t* weak_ref = gc->weak_refs;
-    mjs_weak_ref_t* prev_weak = NULL;
+    mjs_gc_object_header_t* header = page->free_cells;
+    page->free_cells = GC_CELL_LINK(header);
+    page->live_count++;
+    page->empty_since_us = 0;
+    
+    *page_out = page;
+    return header;
+}
+
+bool mjs_gc_region_begin(mjs_gc_t* gc) {
+    if (!gc || (gc->region && gc->region->depth >= GC_REGION_MAX_DEPTH)) return false;
+    
+    mjs_gc_region_t* region = MJS_CALLOC(1, sizeof(mjs_gc_region_t));
+    if (!region) return false;
+    
+    region->outer = gc->region;
+    region->depth = gc->region ? gc->region->depth + 1 : 1;
+    gc->region = region;
+    return true;
+}
+
+bool mjs_gc_region_end(mjs_gc_t* gc) {
+    if (!gc || !gc->region) return false;
+    
+    mjs_gc_region_t* region = gc->region;
+    MJS_TRACE_BEGIN1("gc", "gc.region", "pages", region->pages.page_count);
+    
+    // A cycle in progress may have region objects queued for marking
+    if (gc->state == GC_STATE_MARKING) {
+        gc_collect(gc, false);
+    }
+    
+    // Whatever the roots still refer to outlives the region
+    size_t outer_depth = region->depth - 1;
+    gc->region_escape_depth = outer_depth;
+    for (size_t i = 0; i < gc->root_count; i++) {
+        gc_region_escape_object(gc, gc->roots[i]);
+    }
+    for (size_t i = 0; i < gc->scoped_root_count; i++) {
+        gc_region_escape_object(gc, gc->scoped_roots[i]);
+    }
+    gc_visit_context_roots(gc, gc_region_escape_value, gc_region_escape_pointer);
+    gc_region_drain_escapes(gc);
+    gc->region = region->outer;
     
-    while (weak_ref) {
-        mjs_weak_ref_t* next_weak = weak_ref->next;
+    // Free the rest. Pages with survivors pass to the outer region, where
+    // objects that escaped exactly that far are at home; the others are
+    // kept for the next region, or go back to the OS if large.
+    mjs_gc_free_batch_t** batch = gc_finalizer_ready(gc) ? &gc->free_batch : NULL;
+    uint64_t now_us = mjs_gc_now_us();
+    size_t released = 0;
+    while (region->pages.pages) {
+        mjs_gc_page_t* page = region->pages.pages;
         
-        if (weak_ref->object) {
-            mjs_gc_object_header_t* header = GC_OBJECT_TO_HEADER(weak_ref->object);
-            if (header->mark == GC_MARK_WHITE) {
-                // Referenced object was collected
-                weak_ref->object = NULL;
-                if (weak_ref->callback) {
-                    weak_ref->callback(weak_ref->userdata);
-                }
+        size_t kept = 0;
+        gc_page_clear_marks(page);
+        for (size_t i = 0; i < page->cell_count; i++) {
+            mjs_gc_object_header_t* header = GC_PAGE_CELL(page, i);
+            if (!header->in_use || (!header->escaped_to && !gc->region_escape_overflow)) continue;
+            
+            gc_page_set_mark(page, i, GC_MARK_BLACK);
+            if (header->escaped_to == outer_depth + 1 || !gc->region) {
+                header->escaped_to = 0;
             }
+            kept++;
         }
         
-        if (!weak_ref->object) {
-            // Remove dead weak reference
-            if (prev_weak) {
-                prev_weak->next = next_weak;
-            } else {
-                gc->weak_refs = next_weak;
+        size_t freed = gc_sweep_cells(gc, page, batch);
+        gc_account_freed(gc, &region->pages, freed, freed * page->cell_size);
+        released += freed;
+        
+        if (kept > 0) {
+            gc_region_move_page(gc, page, gc->region);
+            if (!gc->region && page->free_cells) {
+                gc_free_list_push(gc, page);
             }
-            MJS_FREE(weak_ref);
+        } else if (page->size_class == GC_LARGE_SIZE_CLASS) {
+            gc_page_release(gc, page);
         } else {
-            prev_weak = weak_ref;
+            page->empty_since_us = now_us;
+            gc_region_move_page(gc, page, &gc->region_pool);
         }
-        
-        weak_ref = next_weak;
     }
-}
-
-/* Compaction implementation */
-static void gc_compact(mjs_gc_t* gc) {
-    // TODO: Implement heap compaction
-    // This is a complex operation that involves:
-    // 1. Moving live objects to eliminate fragmentation
-    // 2. Updating all pointers to moved objects
-    // 3. Updating the heap pointer
+    if (gc->free_batch) {
+        gc_flush_free_batch(gc, &gc->free_batch);
+    }
+    MJS_FREE(region);
+    if (!gc->region) {
+        gc->region_escape_overflow = false;
+    }
+    
+    // Weak references and ephemeron keys into the freed cells are cleared
+    gc_process_weak_refs(gc, GC_WEAK_REGION);
+    gc_process_ephemeron_tables(gc, GC_WEAK_REGION);
+    
+    gc->stats.regions_released++;
+    gc->stats.region_objects_released += released;
+    gc_update_statistics(gc);
+    MJS_TRACE_END1("gc", "gc.region", "objects", released);
+    
+    return true;
 }
 
 /* Collection heuristics */
 static bool gc_should_collect(mjs_gc_t* gc) {
     if (!gc) return false;
     
-    // Check heap usage threshold
-    double usage_ratio = (double)gc->heap_used / gc->heap_size;
-    if (usage_ratio >= gc->config.collection_threshold) {
-        return true;
-    }
-    
-    // Check young generation size
-    if (gc->config.generational && 
-        gc->young_generation.size >= gc->young_generation.capacity) {
-        return true;
-    }
-    
-    return false;
+    // Start a cycle once the allocation budget from the last one is spent
+    return gc->bytes_since_collection >= gc->allocation_budget;
 }
 
 /* Statistics and configuration */
@@ -673,6 +3805,9 @@ static void gc_update_statistics(mjs_gc_t* gc) {
     gc->stats.heap_used = gc->heap_used;
     gc->stats.young_generation_size = gc->young_generation.size;
     gc->stats.old_generation_size = gc->old_generation.size;
+    gc->stats.large_objects = gc->large_object_count;
+    gc->stats.large_object_bytes = gc->large_object_bytes;
+    gc->stats.decommitted_bytes = gc->page_cache_count * GC_PAGE_SIZE;
 }
 
 mjs_gc_stats_t mjs_gc_get_stats(mjs_gc_t* gc) {
@@ -681,6 +3816,7 @@ mjs_gc_stats_t mjs_gc_get_stats(mjs_gc_t* gc) {
         return empty_stats;
     }
     
+    gc->stats.background_frees = mjs_atomic_load_size(&gc->background_frees);
     return gc->stats;
 }
 
@@ -702,13 +3838,32 @@ mjs_gc_config_t mjs_gc_get_config(mjs_gc_t* gc) {
 size_t mjs_gc_get_memory_usage(mjs_gc_t* gc) {
     if (!gc) return 0;
     
-    return gc->young_generation.total_size + gc->old_generation.total_size;
+    return gc->heap_used;
+}
+
+size_t mjs_gc_get_object_count(mjs_gc_t* gc) {
+    if (!gc) return 0;
+    
+    size_t count = gc->young_generation.object_count + gc->old_generation.object_count;
+    for (mjs_gc_region_t* region = gc->region; region; region = region->outer) {
+        count += region->pages.object_count;
+    }
+    return count;
 }
 
 /* Weak references */
 mjs_weak_ref_t* mjs_gc_create_weak_ref(mjs_gc_t* gc, void* target) {
     if (!gc || !target) return NULL;
     
+    if (gc->weak_ref_count >= gc->weak_ref_capacity) {
+        size_t new_capacity = gc->weak_ref_capacity == 0 ? 16 : gc->weak_ref_capacity * 2;
+        mjs_weak_ref_t** new_refs = MJS_REALLOC(gc->weak_refs, sizeof(mjs_weak_ref_t*) * new_capacity);
+        if (!new_refs) return NULL;
+        
+        gc->weak_refs = new_refs;
+        gc->weak_ref_capacity = new_capacity;
+    }
+    
     mjs_weak_ref_t* weak_ref = MJS_MALLOC(sizeof(mjs_weak_ref_t));
     if (!weak_ref) return NULL;
     
@@ -717,9 +3872,9 @@ mjs_weak_ref_t* mjs_gc_create_weak_ref(mjs_gc_t* gc, void* target) {
     weak_ref->callback_data = NULL;
     weak_ref->userdata = NULL;
     weak_ref->cleared = false;
-    weak_ref->next = gc->weak_refs;
+    weak_ref->index = gc->weak_ref_count;
     
-    gc->weak_refs = weak_ref;
+    gc->weak_refs[gc->weak_ref_count++] = weak_ref;
     
     return weak_ref;
 }
@@ -727,18 +3882,10 @@ mjs_weak_ref_t* mjs_gc_create_weak_ref(mjs_gc_t* gc, void* target) {
 void mjs_gc_destroy_weak_ref(mjs_gc_t* gc, mjs_weak_ref_t* weak_ref) {
     if (!gc || !weak_ref) return;
     
-    // Remove from list
-    if (gc->weak_refs == weak_ref) {
-        gc->weak_refs = weak_ref->next;
-    } else {
-        mjs_weak_ref_t* current = gc->weak_refs;
-        while (current && current->next != weak_ref) {
-            current = current->next;
-        }
-        if (current) {
-            current->next = weak_ref->next;
-        }
-    }
+    // Move the last reference into this slot
+    mjs_weak_ref_t* last = gc->weak_refs[--gc->weak_ref_count];
+    gc->weak_refs[weak_ref->index] = last;
+    last->index = weak_ref->index;
     
     MJS_FREE(weak_ref);
 }
@@ -747,6 +3894,152 @@ void* mjs_weak_ref_get(mjs_weak_ref_t* weak_ref) {
     return weak_ref ? weak_ref->object : NULL;
 }
 
+/* Ephemeron tables */
+static bool gc_ephemeron_table_resize(mjs_ephemeron_table_t* table, size_t capacity) {
+    mjs_ephemeron_entry_t* entries = MJS_CALLOC(capacity, sizeof(mjs_ephemeron_entry_t));
+    if (!entries) return false;
+    
+    for (size_t i = 0; i < table->capacity; i++) {
+        mjs_ephemeron_entry_t* entry = &table->entries[i];
+        if (!gc_ephemeron_is_key(entry->key)) continue;
+        
+        size_t slot = gc_ephemeron_hash(entry->key, capacity);
+        while (entries[slot].key) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        entries[slot] = *entry;
+    }
+    
+    MJS_FREE(table->entries);
+    table->entries = entries;
+    table->capacity = capacity;
+    table->used = table->count;
+    table->stale = false;
+    return true;
+}
+
+/* Called after compaction moved keys. Until a rehash succeeds lookups scan
+ * the whole table. */
+static void gc_ephemeron_table_rehash(mjs_ephemeron_table_t* table) {
+    if (table->capacity > 0 && !gc_ephemeron_table_resize(table, table->capacity)) {
+        table->stale = true;
+    }
+}
+
+static mjs_ephemeron_entry_t* gc_ephemeron_table_find(mjs_ephemeron_table_t* table, void* key) {
+    if (table->capacity == 0) return NULL;
+    
+    if (table->stale) {
+        for (size_t i = 0; i < table->capacity; i++) {
+            if (table->entries[i].key == key) return &table->entries[i];
+        }
+        return NULL;
+    }
+    
+    size_t mask = table->capacity - 1;
+    size_t slot = gc_ephemeron_hash(key, table->capacity);
+    while (table->entries[slot].key) {
+        if (table->entries[slot].key == key) return &table->entries[slot];
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+mjs_ephemeron_table_t* mjs_gc_create_ephemeron_table(mjs_gc_t* gc) {
+    if (!gc) return NULL;
+    
+    if (gc->ephemeron_table_count >= gc->ephemeron_table_capacity) {
+        size_t new_capacity = gc->ephemeron_table_capacity == 0 ? 8 : gc->ephemeron_table_capacity * 2;
+        mjs_ephemeron_table_t** new_tables = MJS_REALLOC(gc->ephemeron_tables,
+            sizeof(mjs_ephemeron_table_t*) * new_capacity);
+        if (!new_tables) return NULL;
+        
+        gc->ephemeron_tables = new_tables;
+        gc->ephemeron_table_capacity = new_capacity;
+    }
+    
+    mjs_ephemeron_table_t* table = MJS_CALLOC(1, sizeof(mjs_ephemeron_table_t));
+    if (!table) return NULL;
+    
+    table->gc = gc;
+    table->index = gc->ephemeron_table_count;
+    gc->ephemeron_tables[gc->ephemeron_table_count++] = table;
+    return table;
+}
+
+void mjs_gc_destroy_ephemeron_table(mjs_ephemeron_table_t* table) {
+    if (!table) return;
+    
+    mjs_gc_t* gc = table->gc;
+    mjs_ephemeron_table_t* last = gc->ephemeron_tables[--gc->ephemeron_table_count];
+    gc->ephemeron_tables[table->index] = last;
+    last->index = table->index;
+    
+    MJS_FREE(table->entries);
+    MJS_FREE(table);
+}
+
+bool mjs_ephemeron_table_set(mjs_ephemeron_table_t* table, void* key, mjs_value_t value) {
+    if (!table || !gc_ephemeron_is_key(key) || !mjs_gc_is_valid_object(table->gc, key)) return false;
+    
+    // The table outlives any region, and so must the values it holds
+    if (table->gc->region) {
+        gc_region_barrier_value(table->gc, NULL, value);
+    }
+    
+    mjs_ephemeron_entry_t* entry = gc_ephemeron_table_find(table, key);
+    if (entry) {
+        MJS_GC_DELETION_BARRIER_VALUE(table->gc, entry->value);
+        entry->value = value;
+        return true;
+    }
+    
+    // Keep the load under 3/4, counting tombstones
+    if (table->stale || (table->used + 1) * 4 > table->capacity * 3) {
+        size_t capacity = table->capacity ? table->capacity : 8;
+        while ((table->count + 1) * 2 > capacity) {
+            capacity *= 2;
+        }
+        if (!gc_ephemeron_table_resize(table, capacity)) return false;
+    }
+    
+    size_t mask = table->capacity - 1;
+    size_t slot = gc_ephemeron_hash(key, table->capacity);
+    while (gc_ephemeron_is_key(table->entries[slot].key)) {
+        slot = (slot + 1) & mask;
+    }
+    if (!table->entries[slot].key) {
+        table->used++;
+    }
+    table->entries[slot].key = key;
+    table->entries[slot].value = value;
+    table->count++;
+    return true;
+}
+
+bool mjs_ephemeron_table_get(mjs_ephemeron_table_t* table, void* key, mjs_value_t* value) {
+    if (!table || !gc_ephemeron_is_key(key)) return false;
+    
+    mjs_ephemeron_entry_t* entry = gc_ephemeron_table_find(table, key);
+    if (!entry) return false;
+    
+    if (value) *value = entry->value;
+    return true;
+}
+
+bool mjs_ephemeron_table_delete(mjs_ephemeron_table_t* table, void* key) {
+    if (!table || !gc_ephemeron_is_key(key)) return false;
+    
+    mjs_ephemeron_entry_t* entry = gc_ephemeron_table_find(table, key);
+    if (!entry) return false;
+    
+    MJS_GC_DELETION_BARRIER_VALUE(table->gc, entry->value);
+    entry->key = GC_EPHEMERON_TOMBSTONE;
+    entry->value = mjs_value_undefined();
+    table->count--;
+    return true;
+}
+
 /* Debug utilities */
 void mjs_gc_dump_heap(mjs_gc_t* gc) {
     if (!gc) return;
@@ -754,6 +4047,8 @@ void mjs_gc_dump_heap(mjs_gc_t* gc) {
     printf("=== GC Heap Dump ===\n");
     printf("Heap size: %zu bytes\n", gc->heap_size);
     printf("Heap used: %zu bytes\n", gc->heap_used);
+    printf("Pages: %zu young, %zu old (%zu unswept)\n",
+           gc->young_generation.page_count, gc->old_generation.page_count, gc->unswept_count);
     printf("Young generation: %zu bytes\n", gc->young_generation.size);
     printf("Old generation: %zu bytes\n", gc->old_generation.size);
     printf("Collections: %zu\n", gc->stats.collections);
@@ -765,26 +4060,108 @@ void mjs_gc_dump_heap(mjs_gc_t* gc) {
     printf("==================\n");
 }
 
+static void gc_dump_generation(mjs_gc_generation_t* gen) {
+    for (mjs_gc_page_t* page = gen->pages; page; page = page->next) {
+        for (size_t i = 0; i < page->cell_count; i++) {
+            mjs_gc_object_header_t* obj = GC_PAGE_CELL(page, i);
+            if (!obj->in_use) continue;
+            printf("  Object: %p, Type: %d, Size: %u, Mark: %d\n",
+                   GC_HEADER_TO_OBJECT(obj), obj->type, obj->size, gc_page_get_mark(page, i));
+        }
+    }
+}
+
 void mjs_gc_dump_objects(mjs_gc_t* gc) {
     if (!gc) return;
     
     printf("=== GC Objects ===\n");
     
     printf("Young generation objects:\n");
-    mjs_gc_object_header_t* obj = gc->young_generation.objects;
-    while (obj) {
-        printf("  Object: %p, Type: %d, Size: %zu, Mark: %d\n", 
-               GC_HEADER_TO_OBJECT(obj), obj->type, obj->size, obj->mark);
-        obj = obj->next;
-    }
+    gc_dump_generation(&gc->young_generation);
     
     printf("Old generation objects:\n");
-    obj = gc->old_generation.objects;
-    while (obj) {
-        printf("  Object: %p, Type: %d, Size: %zu, Mark: %d\n", 
-               GC_HEADER_TO_OBJECT(obj), obj->type, obj->size, obj->mark);
-        obj = obj->next;
-    }
+    gc_dump_generation(&gc->old_generation);
     
     printf("==================\n");
-}
\ No newline at end of file
+}
+
+/* Reports and clears an allocation failure at the memory limit */
+bool mjs_gc_take_out_of_memory(mjs_gc_t* gc) {
+    if (!gc || !gc->out_of_memory) return false;
+    
+    gc->out_of_memory = false;
+    return true;
+}
+
+bool mjs_gc_is_valid_object(mjs_gc_t* gc, void* ptr) {
+    mjs_gc_page_t* page = mjs_gc_page_of(gc, ptr);
+    if (!page) return false;
+    
+    // Must point exactly at the payload of a cell that is in use
+    char* cell = (char*)ptr - GC_HEADER_SIZE;
+    if (cell < page->cells) return false;
+    
+    size_t offset = (size_t)(cell - page->cells);
+    if (offset % page->cell_size != 0 || offset / page->cell_size >= page->cell_count) {
+        return false;
+    }
+    
+    return ((mjs_gc_object_header_t*)cell)->in_use;
+}
+
+/* Shared objects outlive every heap that refers to them */
+bool mjs_gc_is_shared_object(mjs_gc_t* gc, void* ptr) {
+    return gc && gc->shared && mjs_gc_is_valid_object(gc->shared, ptr);
+}
+
+int mjs_gc_get_mark(void* obj) {
+    return gc_get_mark(GC_OBJECT_TO_HEADER(obj));
+}
+
+int mjs_gc_get_generation(void* obj) {
+    return GC_PAGE_OF(GC_OBJECT_TO_HEADER(obj))->generation;
+}
+
+void mjs_gc_set_memory_limit(mjs_gc_t* gc, size_t limit) {
+    if (gc) {
+        gc->memory_limit = limit;
+    }
+}
+
+void mjs_gc_set_incremental_mode(mjs_gc_t* gc, bool enabled) {
+    if (gc) {
+        gc->config.incremental = enabled;
+    }
+}
+
+void mjs_gc_set_incremental_step_size(mjs_gc_t* gc, size_t step_size) {
+    if (gc) {
+        gc->incremental_step_size = step_size;
+    }
+}
+
+void mjs_gc_set_concurrent_marking(mjs_gc_t* gc, bool enabled) {
+    if (gc) {
+        gc->config.concurrent_marking = enabled;
+    }
+}
+
+void mjs_gc_set_parallel_threads(mjs_gc_t* gc, size_t thread_count) {
+    if (gc) {
+        gc->config.parallel_threads = thread_count;
+    }
+}
+
+/* Monotonic clock in microseconds */
+uint64_t mjs_gc_now_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart * 1000000 / frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+#endif
+}
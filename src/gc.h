@@ -29,12 +29,57 @@
 #define MIKOJS_GC_H
 
 #include "mikojs_internal.h"
+#include "thread.h"
 #include <time.h>
 
 /* GC mark colors */
 #define GC_MARK_WHITE 0
 #define GC_MARK_GRAY  1
 #define GC_MARK_BLACK 2
+#define GC_MARK_FORWARDED 3  /* evacuated by compaction; the payload points at the copy */
+
+/* Heap pages. Small objects live in fixed-size cells of GC_PAGE_SIZE
+ * aligned pages, one size class per page; larger objects get a page of
+ * their own. The page owning an object is found by masking its address. */
+#define GC_PAGE_SIZE (64 * 1024)
+#define GC_SIZE_CLASS_COUNT 18
+#define GC_MAX_SMALL_OBJECT_SIZE 8192
+#define GC_LARGE_SIZE_CLASS GC_SIZE_CLASS_COUNT
+
+/* Large-object space: objects at least this big are mapped from the OS one
+ * at a time and unmapped as soon as they die, instead of going through
+ * malloc, which may keep the memory */
+#define GC_LARGE_OBJECT_THRESHOLD (128 * 1024)
+
+/* Released small pages keep their address range, with the memory handed
+ * back to the OS, so a later page can reuse it; at most this many */
+#define GC_PAGE_CACHE_MAX 1024
+
+/* Heap cage. With one reserved every heap chunk lies in a single 4GB
+ * range, so telling a heap pointer from any other is a range check and a
+ * bit test. Heap fields still hold full pointers; nothing is stored as a
+ * 32-bit offset from the base. */
+#define GC_CAGE_SIZE ((uint64_t)1 << 32)
+#define GC_CAGE_PAGES (GC_CAGE_SIZE / GC_PAGE_SIZE)
+
+/* Released range of the cage, reused first fit */
+typedef struct {
+    size_t offset;
+    size_t size;
+} mjs_gc_cage_range_t;
+
+/* References the mutator overwrites while the background marker runs are
+ * logged in fixed-size buffers and handed to the marker once full */
+#define GC_SATB_BUFFER_SIZE 256
+
+/* Off-heap memory of dead objects is recorded in batches of this many
+ * blocks and freed on the finalizer thread */
+#define GC_FREE_BATCH_SIZE 1024
+
+/* Stop-the-world marking and sweeping are split across at most this many
+ * threads, and only once the heap is big enough to pay for the handoff */
+#define GC_MAX_PARALLEL_THREADS 64
+#define GC_PARALLEL_MIN_HEAP (4 * 1024 * 1024)
 
 /* Weak reference callback type */
 typedef void (*mjs_weak_ref_callback_t)(void* data);
@@ -53,38 +98,145 @@ typedef enum {
 typedef struct {
     bool incremental;
     bool generational;
-    bool compact;
-    size_t threshold_factor;
-    size_t collection_threshold;
+    bool compact;                   /* full, idle and critical-pressure collections compact */
     size_t max_heap_size;
-    bool enable_compaction;
+    uint64_t incremental_step_us;   /* time budget for one incremental marking step */
+    size_t incremental_alloc_bytes; /* bytes allocated between marking steps */
+    bool lazy_sweeping;             /* sweep pages on demand instead of in the pause */
+    bool concurrent_marking;        /* trace on a background thread while scripts run */
+    size_t parallel_threads;        /* threads for stop-the-world phases, 0 = one per core */
+    size_t compact_live_percent;    /* old pages less occupied than this are evacuated */
+    size_t gc_cpu_percent;          /* share of run time the pacer lets collection take */
+    bool background_freeing;        /* free dead objects' side buffers on a thread */
+    uint64_t decommit_delay_us;     /* empty pages go back to the OS after this long */
+    bool huge_pages;                /* ask for transparent huge pages on old pages */
+    bool string_dedup;              /* share the characters of equal old strings */
 } mjs_gc_config_t;
 
-/* GC object header */
+/* GC object header: 8 bytes in front of every object. The mark color
+ * lives in the page's side bitmap and the generation is the page's. A free
+ * cell keeps its free-list link in the payload, as does an evacuated cell
+ * its forwarding address. */
 typedef struct mjs_gc_object {
-    mjs_gc_object_type_t type;
-    bool marked;
-    int mark;
-    int generation;
+    uint32_t size;                    /* payload bytes */
+    uint8_t type;                     /* mjs_gc_object_type_t */
     bool in_use;
-    size_t size;
-    struct mjs_gc_object* next;
-    struct mjs_gc_object* prev;
+    uint8_t escaped_to;               /* on a region page: depth + 1 it escaped to, or 0 */
 } mjs_gc_object_t;
 
+/* Side mark bitmap: two bits per cell, sized for the smallest cells */
+#define GC_MARK_BITS 2
+#define GC_MARKS_PER_WORD (sizeof(size_t) * 8 / GC_MARK_BITS)
+#define GC_PAGE_MAX_CELLS (GC_PAGE_SIZE / (sizeof(mjs_gc_object_t) + 16))
+#define GC_MARK_WORDS ((GC_PAGE_MAX_CELLS + GC_MARKS_PER_WORD - 1) / GC_MARKS_PER_WORD)
+
 /* Type alias for compatibility */
 typedef mjs_gc_object_t mjs_gc_object_header_t;
 
+/* Heap page header, stored at the start of every page */
+typedef struct mjs_gc_page {
+    struct mjs_gc_page* next;         /* generation page list */
+    struct mjs_gc_page* prev;
+    struct mjs_gc_page* next_free;    /* size class pages with free cells */
+    struct mjs_gc_page* next_unswept; /* size class pages waiting for the sweeper */
+    struct mjs_gc_page* next_large;   /* large-object space list */
+    struct mjs_gc_page* prev_large;
+    struct mjs_gc_region* region;     /* owning region, NULL in the heap */
+    size_t chunk_size;                /* bytes reserved for the page */
+    size_t cell_size;                 /* header + payload */
+    size_t cell_count;
+    size_t live_count;                /* cells in use (including unswept garbage) */
+    int size_class;                   /* GC_LARGE_SIZE_CLASS for a large object */
+    int generation;
+    int age;                          /* minor collections survived */
+    bool swept;
+    bool in_free_list;
+    bool pinned;                      /* holds an object that must not move */
+    bool evacuating;                  /* compaction is moving its objects out */
+    bool mapped;                      /* in the large-object space */
+    uint64_t empty_since_us;          /* when a sweep found it empty, 0 once reused */
+    mjs_gc_object_t* free_cells;
+    char* cells;
+    volatile size_t marks[GC_MARK_WORDS];  /* mark colors of the cells */
+} mjs_gc_page_t;
+
+/* Snapshot-at-the-beginning log buffer */
+typedef struct mjs_gc_satb_buffer {
+    struct mjs_gc_satb_buffer* next;
+    size_t count;
+    void* entries[GC_SATB_BUFFER_SIZE];
+} mjs_gc_satb_buffer_t;
+
+/* Blocks waiting for the finalizer thread. An entry with the low bit set
+ * is the head of a property list, which is freed node by node. */
+typedef struct mjs_gc_free_batch {
+    struct mjs_gc_free_batch* next;
+    size_t count;
+    void* entries[GC_FREE_BATCH_SIZE];
+} mjs_gc_free_batch_t;
+
+/* Work-stealing deque of gray objects (Chase-Lev). The owning worker
+ * pushes and takes at the bottom; other workers steal from the top. */
+typedef struct mjs_gc_deque_array {
+    struct mjs_gc_deque_array* retired;  /* smaller arrays still visible to thieves */
+    size_t capacity;
+    void* volatile entries[];
+} mjs_gc_deque_array_t;
+
+typedef struct {
+    volatile size_t top;
+    volatile size_t bottom;
+    void* volatile array;
+} mjs_gc_deque_t;
+
+/* Per-thread state of a parallel marking or sweeping phase. Worker 0 is
+ * the thread that started the collection. */
+typedef struct mjs_gc_worker {
+    struct mjs_gc* gc;
+    size_t index;
+    size_t epoch;             /* last phase this worker picked up */
+    mjs_thread_t thread;
+    mjs_gc_deque_t deque;
+    size_t marked_bytes;
+    size_t freed_objects[2];  /* per generation */
+    size_t freed_bytes[2];
+    struct mjs_gc_free_batch* free_batch;  /* partially filled while sweeping */
+} mjs_gc_worker_t;
+
+/* Ephemeron resolution state: a value waiting for its key to be marked,
+ * and the head of the waiting values of one key */
+typedef struct {
+    mjs_value_t value;
+    size_t next;                      /* SIZE_MAX ends the chain */
+} mjs_gc_ephemeron_value_t;
+
+typedef struct {
+    void* key;
+    size_t head;
+} mjs_gc_ephemeron_key_t;
+
 /* GC generation */
 typedef struct {
-    mjs_gc_object_t* objects;
+    mjs_gc_page_t* pages;
+    size_t page_count;
     size_t object_count;
-    size_t total_size;
-    size_t size;
-    size_t capacity;
-    size_t threshold;
+    size_t size;                      /* bytes in occupied cells */
 } mjs_gc_generation_t;
 
+/* Allocation region. Pages allocated while a region is open belong to it
+ * rather than to a generation and are not swept; closing the region frees
+ * whatever did not escape and keeps the emptied pages for the next region.
+ * Regions nest; the depth of the heap is 0, and escape depths are kept in
+ * a byte of the object header. */
+#define GC_REGION_MAX_DEPTH 254
+
+typedef struct mjs_gc_region {
+    struct mjs_gc_region* outer;
+    size_t depth;
+    mjs_gc_generation_t pages;
+    mjs_gc_page_t* current[GC_SIZE_CLASS_COUNT];  /* page being filled per size class */
+} mjs_gc_region_t;
+
 /* GC statistics */
 typedef struct {
     size_t total_allocations;
@@ -105,6 +257,30 @@ typedef struct {
     double last_collection_time;
     double total_collection_time;
     size_t collection_time;
+    size_t incremental_steps;
+    uint64_t last_pause_us;
+    uint64_t max_pause_us;
+    size_t concurrent_cycles;
+    size_t parallel_marks;
+    size_t parallel_sweeps;
+    size_t compactions;
+    size_t objects_moved;
+    size_t pages_compacted;
+    size_t allocation_budget;
+    size_t out_of_memory_errors;
+    size_t idle_notifications;
+    uint64_t idle_time_us;
+    size_t memory_pressure_collections;
+    size_t background_frees;        /* blocks freed by the finalizer thread */
+    size_t large_objects;           /* live mappings in the large-object space */
+    size_t large_object_bytes;
+    size_t pages_decommitted;
+    size_t decommitted_bytes;       /* cached page ranges not backed by memory */
+    size_t strings_deduplicated;
+    size_t dedup_bytes_saved;
+    size_t regions_released;
+    size_t region_objects_released; /* freed without tracing when their region closed */
+    size_t region_objects_escaped;  /* kept past their region by the escape barrier */
 } mjs_gc_stats_t;
 
 /* Garbage collector structure */
@@ -116,21 +292,77 @@ struct mjs_gc {
     mjs_gc_state_t state;
     
     /* Heap management */
-    void* heap;
-    void* heap_ptr;
     size_t heap_used;
     size_t heap_size;
     size_t incremental_step;
     
+    /* Pages with free cells, and pages not yet swept, per size class */
+    mjs_gc_page_t* free_pages[GC_SIZE_CLASS_COUNT];
+    mjs_gc_page_t* unswept_pages[GC_SIZE_CLASS_COUNT + 1];
+    size_t unswept_count;
+    
+    /* Open-addressing set of page addresses for pointer validation */
+    mjs_gc_page_t** page_table;
+    size_t page_table_count;
+    size_t page_table_capacity;
+    
     /* Generations (young, old) */
     mjs_gc_generation_t young_generation;
     mjs_gc_generation_t old_generation;
     
+    /* Large-object space. Its pages also belong to a generation; this
+     * list tracks the mappings themselves. */
+    mjs_gc_page_t* large_objects;
+    size_t large_object_count;
+    size_t large_object_bytes;
+    
+    /* Innermost open allocation region, and the emptied region pages
+     * waiting for the next one. Escaping objects wait on region_escapes
+     * until what they refer to has been followed; if that stack cannot
+     * grow, nothing in a region is freed until the last one closes. */
+    mjs_gc_region_t* region;
+    mjs_gc_region_t region_pool;
+    void** region_escapes;
+    size_t region_escape_count;
+    size_t region_escape_capacity;
+    size_t region_escape_depth;
+    bool region_escape_overflow;
+    
+    /* Heap of a process-wide shared heap this one refers into, NULL if
+     * none. Its objects are never marked, moved or freed from here. */
+    struct mjs_gc* shared;
+    
+    /* Decommitted small pages waiting for reuse */
+    void** page_cache;
+    size_t page_cache_count;
+    size_t page_cache_capacity;
+    
+    /* Heap cage, NULL unless reserved. Chunks are carved from the front;
+     * a bit per GC_PAGE_SIZE granule marks where a page starts and
+     * replaces the page table. */
+    char* cage_base;
+    size_t cage_top;
+    mjs_gc_cage_range_t* cage_free;
+    size_t cage_free_count;
+    size_t cage_free_capacity;
+    size_t* cage_page_map;
+    
     /* Root objects */
     void** roots;
     size_t root_count;
     size_t root_capacity;
     
+    /* Temporary roots pushed by MJS_GC_PROTECT, released in LIFO order */
+    void** scoped_roots;
+    size_t scoped_root_count;
+    size_t scoped_root_capacity;
+    size_t scoped_root_dropped;       /* pushes lost to allocation failure */
+    
+    /* Objects native code holds raw pointers to; compaction leaves them in place */
+    void** pinned;
+    size_t pinned_count;
+    size_t pinned_capacity;
+    
     /* Gray stack for tri-color marking */
     mjs_gc_object_t** gray_stack;
     size_t gray_count;
@@ -139,20 +371,103 @@ struct mjs_gc {
     /* Collection state */
     bool collecting;
     bool incremental_mode;
-    size_t incremental_step_size;
+    size_t incremental_step_size; /* objects scanned between deadline checks */
+    size_t bytes_since_step;      /* allocation debt since the last marking step */
+    size_t marked_bytes;          /* live bytes found by the last marking */
+    size_t bytes_since_collection;
+    size_t allocation_budget;     /* bytes to allocate before the next cycle */
+    bool flush_string_table;      /* mark without the string table as a root */
     
-    /* Thresholds */
-    size_t young_threshold;
-    size_t old_threshold;
+    /* Pacing: the allocation budget is sized from the measured allocation
+     * rate, survival rate and cycle cost so that collection takes about
+     * config.gc_cpu_percent of the run time */
+    uint64_t pacing_window_start_us;  /* end of the last cycle */
+    uint64_t cycle_gc_us;             /* pause time spent on the current cycle */
+    size_t pacing_allocated;          /* bytes allocated since the last cycle ended */
+    double allocation_rate;           /* bytes per second of mutator time, smoothed */
+    double survival_rate;             /* share of the heap found live, smoothed */
+    double cycle_cost_us;             /* pause time per cycle, smoothed */
+    bool cycle_finished;              /* marking finished in the current pause */
+    
+    /* Hard limit on reserved heap; allocations beyond it fail */
     size_t memory_limit;
+    bool out_of_memory;
+    
+    /* Concurrent marking. While marker_active the marker thread owns the
+     * gray stack and mark bits, and holds heap_lock while it scans. The
+     * mutator takes heap_lock around changes that free or move memory the
+     * marker may be reading. */
+    mjs_thread_t marker_thread;
+    mjs_mutex_t heap_lock;
+    mjs_cond_t marker_cond;
+    bool marker_started;
+    bool marker_active;           /* written by the mutator thread only */
+    bool heap_lock_held;          /* the mutator holds heap_lock via mjs_gc_lock_heap */
+    bool marker_work;             /* protected by heap_lock */
+    bool marker_shutdown;         /* protected by heap_lock */
+    volatile int marker_done;     /* marker ran out of work */
+    mjs_gc_satb_buffer_t* satb_buffer;  /* mutator's partially filled buffer */
+    void* volatile satb_full;           /* lock-free stack of full buffers */
+    
+    /* Parallel stop-the-world phases. Helper threads park on worker_cond
+     * between phases and pick up worker_job when worker_epoch changes. */
+    mjs_gc_worker_t* workers;
+    size_t worker_count;          /* including the collecting thread */
+    mjs_mutex_t worker_lock;
+    mjs_cond_t worker_cond;
+    mjs_cond_t worker_done_cond;
+    int worker_job;
+    size_t worker_epoch;
+    size_t workers_running;
+    bool workers_shutdown;
+    volatile size_t idle_workers;       /* termination detection while marking */
+    mjs_gc_page_t** sweep_pages;
+    size_t sweep_page_count;
+    volatile size_t sweep_next;
+    bool sweep_deferred;          /* workers record dead objects' side buffers */
+    
+    /* Background freeing. Sweeps only record the side buffers of dead
+     * objects; the finalizer thread, started on first use, frees them. */
+    mjs_thread_t finalizer_thread;
+    mjs_mutex_t finalizer_lock;
+    mjs_cond_t finalizer_cond;
+    mjs_cond_t finalizer_idle_cond;
+    bool finalizer_started;
+    bool finalizer_failed;        /* could not start; sweeps free inline */
+    bool finalizer_busy;          /* protected by finalizer_lock */
+    bool finalizer_shutdown;      /* protected by finalizer_lock */
+    mjs_gc_free_batch_t* free_queue;    /* protected by finalizer_lock */
+    mjs_gc_free_batch_t* free_batch;    /* mutator's partially filled batch */
+    volatile size_t background_frees;
     
     /* Statistics */
     mjs_gc_stats_t stats;
     
-    /* Weak references */
-    struct mjs_weak_ref* weak_refs;
+    /* Weak references, unordered; each knows its slot for O(1) removal.
+     * Cleared references wait in cleared_weak_refs until the sweep of the
+     * list is done, then their callbacks run. */
+    struct mjs_weak_ref** weak_refs;
     size_t weak_ref_count;
     size_t weak_ref_capacity;
+    struct mjs_weak_ref** cleared_weak_refs;
+    size_t cleared_weak_ref_capacity;
+    
+    /* Ephemeron tables, and while the final pause resolves them the
+     * entries whose key is not marked yet, chained per key */
+    struct mjs_ephemeron_table** ephemeron_tables;
+    size_t ephemeron_table_count;
+    size_t ephemeron_table_capacity;
+    mjs_gc_ephemeron_key_t* ephemeron_keys;      /* open addressing on the key */
+    size_t ephemeron_key_capacity;
+    mjs_gc_ephemeron_value_t* ephemeron_values;
+    size_t ephemeron_value_count;
+    size_t* ephemeron_ready;                      /* chains whose key got marked */
+    size_t ephemeron_ready_count;
+    
+    /* Sampling allocation profiler; allocation checks the countdown only
+     * while one is attached */
+    struct mjs_alloc_profiler* alloc_profiler;
+    size_t bytes_until_sample;
 };
 
 /* Weak reference structure */
@@ -162,9 +477,31 @@ typedef struct mjs_weak_ref {
     void* callback_data;
     void* userdata;
     bool cleared;
-    struct mjs_weak_ref* next;
+    size_t index;                     /* slot in gc->weak_refs */
 } mjs_weak_ref_t;
 
+/* Ephemeron table: a hash table keyed weakly by heap objects, whose values
+ * are reachable only while their key is. Holding a value does not keep its
+ * key alive, even when the value refers back to the key. Entries are
+ * found by key address, so a table is rehashed after compaction moves
+ * its keys. */
+#define GC_EPHEMERON_TOMBSTONE ((void*)1)
+
+typedef struct {
+    void* key;                        /* NULL if empty, GC_EPHEMERON_TOMBSTONE if deleted */
+    mjs_value_t value;
+} mjs_ephemeron_entry_t;
+
+typedef struct mjs_ephemeron_table {
+    mjs_gc_t* gc;
+    mjs_ephemeron_entry_t* entries;
+    size_t capacity;                  /* power of two, or 0 */
+    size_t count;                     /* live entries */
+    size_t used;                      /* live entries and tombstones */
+    size_t index;                     /* slot in gc->ephemeron_tables */
+    bool stale;                       /* keys moved and the rehash failed */
+} mjs_ephemeron_table_t;
+
 /* GC functions */
 mjs_gc_t* mjs_gc_new(mjs_runtime_t* runtime);
 void mjs_gc_free(mjs_gc_t* gc);
@@ -179,13 +516,43 @@ bool mjs_gc_collect(mjs_gc_t* gc);
 bool mjs_gc_collect_young(mjs_gc_t* gc);
 bool mjs_gc_collect_full(mjs_gc_t* gc);
 bool mjs_gc_collect_incremental(mjs_gc_t* gc, uint64_t time_limit_us);
+bool mjs_gc_mark_step(mjs_gc_t* gc, uint64_t deadline_us);
+bool mjs_gc_sweep_step(mjs_gc_t* gc, uint64_t deadline_us);
+void mjs_gc_finish_sweeping(mjs_gc_t* gc);
+
+/* Allocation regions: everything allocated between begin and end is freed
+ * at end, except what the roots or an object outside the region refer to */
+bool mjs_gc_region_begin(mjs_gc_t* gc);
+bool mjs_gc_region_end(mjs_gc_t* gc);
+
+/* Embedder hints: GC work to do before an absolute deadline on the
+ * mjs_gc_now_us clock (true when none is left), and shrinking on request */
+bool mjs_gc_idle_notification(mjs_gc_t* gc, uint64_t deadline_us);
+void mjs_gc_memory_pressure(mjs_gc_t* gc, mjs_memory_pressure_t level);
+
+/* Write barrier (Dijkstra insertion barrier for incremental marking, and
+ * the escape barrier of allocation regions) */
+void mjs_gc_write_barrier(mjs_gc_t* gc, void* parent, void* child);
+void mjs_gc_write_barrier_value(mjs_gc_t* gc, void* parent, mjs_value_t value);
+
+/* Deletion barrier (snapshot-at-the-beginning for concurrent marking) */
+void mjs_gc_satb_barrier(mjs_gc_t* gc, void* old_child);
+void mjs_gc_satb_barrier_value(mjs_gc_t* gc, mjs_value_t old_value);
 
 /* Root management */
 bool mjs_gc_add_root(mjs_gc_t* gc, void* obj);
 bool mjs_gc_remove_root(mjs_gc_t* gc, void* obj);
+
+/* Temporary roots: push and pop are O(1) and must be balanced. Roots
+ * registered with mjs_gc_add_root are meant to be long-lived. */
 void mjs_gc_push_root(mjs_gc_t* gc, mjs_gc_object_t* obj);
 void mjs_gc_pop_root(mjs_gc_t* gc);
 
+/* Pinning: a pinned object is never moved by compaction. Pinning does not
+ * keep an object alive; roots are always pinned. */
+bool mjs_gc_pin_object(mjs_gc_t* gc, void* obj);
+bool mjs_gc_unpin_object(mjs_gc_t* gc, void* obj);
+
 /* Marking functions */
 void mjs_gc_mark_object(mjs_gc_t* gc, mjs_gc_object_t* obj);
 void mjs_gc_mark_value(mjs_gc_t* gc, mjs_value_t value);
@@ -196,28 +563,43 @@ void mjs_gc_mark_function(mjs_gc_t* gc, mjs_function_t* func);
 
 /* Weak reference management */
 mjs_weak_ref_t* mjs_gc_create_weak_ref(mjs_gc_t* gc, void* target);
+void mjs_gc_destroy_weak_ref(mjs_gc_t* gc, mjs_weak_ref_t* weak_ref);
 void mjs_weak_ref_free(mjs_weak_ref_t* weak_ref);
 void* mjs_weak_ref_get(mjs_weak_ref_t* weak_ref);
 void mjs_gc_clear_weak_ref(mjs_gc_t* gc, mjs_weak_ref_t* weak_ref);
 void mjs_gc_process_weak_refs(mjs_gc_t* gc);
 
+/* Ephemeron tables. Keys must be heap objects. */
+mjs_ephemeron_table_t* mjs_gc_create_ephemeron_table(mjs_gc_t* gc);
+void mjs_gc_destroy_ephemeron_table(mjs_ephemeron_table_t* table);
+bool mjs_ephemeron_table_set(mjs_ephemeron_table_t* table, void* key, mjs_value_t value);
+bool mjs_ephemeron_table_get(mjs_ephemeron_table_t* table, void* key, mjs_value_t* value);
+bool mjs_ephemeron_table_delete(mjs_ephemeron_table_t* table, void* key);
+
 /* Statistics and monitoring */
 mjs_gc_stats_t mjs_gc_get_stats(mjs_gc_t* gc);
 size_t mjs_gc_get_memory_usage(mjs_gc_t* gc);
 size_t mjs_gc_get_object_count(mjs_gc_t* gc);
+bool mjs_gc_take_out_of_memory(mjs_gc_t* gc);
 void mjs_gc_print_stats(mjs_gc_t* gc);
 
 /* Configuration */
 void mjs_gc_set_memory_limit(mjs_gc_t* gc, size_t limit);
-void mjs_gc_set_young_threshold(mjs_gc_t* gc, size_t threshold);
-void mjs_gc_set_old_threshold(mjs_gc_t* gc, size_t threshold);
 void mjs_gc_set_incremental_mode(mjs_gc_t* gc, bool enabled);
 void mjs_gc_set_incremental_step_size(mjs_gc_t* gc, size_t step_size);
+void mjs_gc_set_concurrent_marking(mjs_gc_t* gc, bool enabled);
+void mjs_gc_set_parallel_threads(mjs_gc_t* gc, size_t thread_count);
+bool mjs_gc_reserve_cage(mjs_gc_t* gc);  /* before the first allocation */
 
 /* Debugging */
 void mjs_gc_dump_heap(mjs_gc_t* gc);
 void mjs_gc_verify_heap(mjs_gc_t* gc);
 bool mjs_gc_is_valid_object(mjs_gc_t* gc, void* ptr);
+bool mjs_gc_is_shared_object(mjs_gc_t* gc, void* ptr);
+mjs_gc_page_t* mjs_gc_page_of(mjs_gc_t* gc, void* ptr);
+int mjs_gc_get_mark(void* obj);
+int mjs_gc_get_generation(void* obj);
+uint64_t mjs_gc_now_us(void);
 
 /* Internal helpers */
 static inline mjs_gc_object_t* mjs_gc_get_header(void* ptr) {
@@ -228,9 +610,28 @@ static inline void* mjs_gc_get_data(mjs_gc_object_t* header) {
     return (char*)header + sizeof(mjs_gc_object_t);
 }
 
-static inline bool mjs_gc_should_collect(mjs_gc_t* gc) {
-    return (gc->young_generation.total_size >= gc->young_threshold) ||
-           (gc->old_generation.total_size >= gc->old_threshold);
+static inline bool mjs_gc_is_marking(mjs_gc_t* gc) {
+    return gc && gc->state == GC_STATE_MARKING;
+}
+
+static inline bool mjs_gc_needs_write_barrier(mjs_gc_t* gc) {
+    return gc && (gc->state == GC_STATE_MARKING || gc->region);
+}
+
+/* Heap lock for mutator code that frees, moves or links memory the
+ * concurrent marker may be tracing. Never allocate while holding it. */
+static inline bool mjs_gc_lock_heap(mjs_gc_t* gc) {
+    if (!gc || !gc->marker_active) return false;
+    mjs_mutex_lock(&gc->heap_lock);
+    gc->heap_lock_held = true;
+    return true;
+}
+
+static inline void mjs_gc_unlock_heap(mjs_gc_t* gc, bool locked) {
+    if (locked) {
+        gc->heap_lock_held = false;
+        mjs_mutex_unlock(&gc->heap_lock);
+    }
 }
 
 /* Macros for convenient allocation */
@@ -243,6 +644,20 @@ static inline bool mjs_gc_should_collect(mjs_gc_t* gc) {
 #define MJS_GC_FREE(gc, ptr) \
     mjs_gc_free_object(gc, ptr)
 
+/* Store barriers: callers storing a heap reference into an existing heap
+ * object must go through these so incremental marking and allocation
+ * regions stay sound. A NULL parent stands for state outside the heap.
+ * The check is a single branch when no marking cycle or region is open. */
+#define MJS_GC_WRITE_BARRIER(gc, parent, child) \
+    do { if (mjs_gc_needs_write_barrier(gc)) mjs_gc_write_barrier(gc, parent, child); } while(0)
+
+#define MJS_GC_WRITE_BARRIER_VALUE(gc, parent, value) \
+    do { if (mjs_gc_needs_write_barrier(gc)) mjs_gc_write_barrier_value(gc, parent, value); } while(0)
+
+/* Callers overwriting or removing a heap reference log the old value */
+#define MJS_GC_DELETION_BARRIER_VALUE(gc, old_value) \
+    do { if (mjs_gc_is_marking(gc)) mjs_gc_satb_barrier_value(gc, old_value); } while(0)
+
 /* GC-safe macros for temporary root management */
 #define MJS_GC_PROTECT(gc, obj) \
     do { mjs_gc_push_root(gc, (mjs_gc_object_t*)(obj)); } while(0)
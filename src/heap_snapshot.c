@@ -0,0 +1,690 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Heap Snapshot Implementation
+ */
+
+#include "heap_snapshot.h"
+#include "mikojs_internal.h"
+#include "vm.h"
+#include <string.h>
+
+#define SNAPSHOT_NAME_MAX 80       /* string contents shown as a node name */
+#define SNAPSHOT_NO_NODE SIZE_MAX
+
+/* Synthetic nodes grouping the root set, in node order after the root */
+enum {
+    SNAPSHOT_ROOT,
+    SNAPSHOT_EMBEDDER_ROOTS,
+    SNAPSHOT_SCOPED_ROOTS,
+    SNAPSHOT_GLOBALS,
+    SNAPSHOT_HANDLES,
+    SNAPSHOT_PERSISTENTS,
+    SNAPSHOT_STACK,
+    SNAPSHOT_STRING_TABLE,
+    SNAPSHOT_SYNTHETIC_COUNT
+};
+
+static const char* const snapshot_synthetic_names[SNAPSHOT_SYNTHETIC_COUNT] = {
+    "(GC roots)",
+    "(Embedder roots)",
+    "(Scoped roots)",
+    "(Global objects)",
+    "(Handle scopes)",
+    "(Persistent handles)",
+    "(Stack)",
+    "(String table)"
+};
+
+/* Build state: the object to node map lives only while taking the snapshot */
+typedef struct {
+    mjs_heap_snapshot_t* snapshot;
+    size_t* object_table;          /* open addressing, index + 1 of a node */
+    size_t object_table_capacity;
+    bool failed;
+} snapshot_builder_t;
+
+/* Strings */
+static size_t snapshot_hash_bytes(const char* data, size_t length) {
+    size_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool snapshot_grow_strings(mjs_heap_snapshot_t* snapshot) {
+    size_t capacity = snapshot->string_table_capacity ? snapshot->string_table_capacity * 2 : 256;
+    size_t* table = MJS_CALLOC(capacity, sizeof(size_t));
+    if (!table) return false;
+    
+    for (size_t i = 0; i < snapshot->string_count; i++) {
+        const char* str = snapshot->strings[i];
+        size_t slot = snapshot_hash_bytes(str, strlen(str)) & (capacity - 1);
+        while (table[slot]) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        table[slot] = i + 1;
+    }
+    
+    MJS_FREE(snapshot->string_table);
+    snapshot->string_table = table;
+    snapshot->string_table_capacity = capacity;
+    return true;
+}
+
+/* Index of the string, added if new. SIZE_MAX when out of memory. */
+static size_t snapshot_intern(mjs_heap_snapshot_t* snapshot, const char* data, size_t length) {
+    if ((snapshot->string_count + 1) * 2 > snapshot->string_table_capacity &&
+        !snapshot_grow_strings(snapshot)) {
+        return SIZE_MAX;
+    }
+    
+    size_t mask = snapshot->string_table_capacity - 1;
+    size_t slot = snapshot_hash_bytes(data, length) & mask;
+    while (snapshot->string_table[slot]) {
+        const char* str = snapshot->strings[snapshot->string_table[slot] - 1];
+        if (strncmp(str, data, length) == 0 && str[length] == '\0') {
+            return snapshot->string_table[slot] - 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+    
+    if (snapshot->string_count == snapshot->string_capacity) {
+        size_t capacity = snapshot->string_capacity ? snapshot->string_capacity * 2 : 256;
+        char** strings = MJS_REALLOC(snapshot->strings, capacity * sizeof(char*));
+        if (!strings) return SIZE_MAX;
+        snapshot->strings = strings;
+        snapshot->string_capacity = capacity;
+    }
+    
+    char* copy = MJS_MALLOC(length + 1);
+    if (!copy) return SIZE_MAX;
+    memcpy(copy, data, length);
+    copy[length] = '\0';
+    
+    snapshot->strings[snapshot->string_count] = copy;
+    snapshot->string_table[slot] = ++snapshot->string_count;
+    return snapshot->string_count - 1;
+}
+
+static size_t snapshot_intern_cstr(snapshot_builder_t* builder, const char* str) {
+    size_t index = snapshot_intern(builder->snapshot, str, strlen(str));
+    if (index == SIZE_MAX) builder->failed = true;
+    return index;
+}
+
+/* Object to node map */
+static size_t snapshot_hash_pointer(void* ptr, size_t capacity) {
+    uintptr_t key = (uintptr_t)ptr;
+    key ^= key >> 17;
+    key *= (uintptr_t)0x9E3779B97F4A7C15ULL;
+    return (size_t)(key ^ (key >> 29)) & (capacity - 1);
+}
+
+static size_t snapshot_find_node(snapshot_builder_t* builder, void* object) {
+    if (!object) return SNAPSHOT_NO_NODE;
+    
+    size_t mask = builder->object_table_capacity - 1;
+    size_t slot = snapshot_hash_pointer(object, builder->object_table_capacity);
+    while (builder->object_table[slot]) {
+        size_t index = builder->object_table[slot] - 1;
+        if (builder->snapshot->nodes[index].object == object) return index;
+        slot = (slot + 1) & mask;
+    }
+    return SNAPSHOT_NO_NODE;
+}
+
+/* Edges */
+static void snapshot_add_edge(snapshot_builder_t* builder, mjs_snapshot_edge_type_t type,
+                              size_t name_or_index, size_t to) {
+    mjs_heap_snapshot_t* snapshot = builder->snapshot;
+    if (to == SNAPSHOT_NO_NODE || builder->failed) return;
+    
+    if (snapshot->edge_count == snapshot->edge_capacity) {
+        size_t capacity = snapshot->edge_capacity ? snapshot->edge_capacity * 2 : 1024;
+        mjs_snapshot_edge_t* edges = MJS_REALLOC(snapshot->edges, capacity * sizeof(mjs_snapshot_edge_t));
+        if (!edges) {
+            builder->failed = true;
+            return;
+        }
+        snapshot->edges = edges;
+        snapshot->edge_capacity = capacity;
+    }
+    
+    mjs_snapshot_edge_t* edge = &snapshot->edges[snapshot->edge_count++];
+    edge->type = type;
+    edge->name_or_index = name_or_index;
+    edge->to = to;
+}
+
+static void snapshot_add_object_edge(snapshot_builder_t* builder, mjs_snapshot_edge_type_t type,
+                                     size_t name_or_index, void* object) {
+    snapshot_add_edge(builder, type, name_or_index, snapshot_find_node(builder, object));
+}
+
+static void snapshot_add_value_edge(snapshot_builder_t* builder, mjs_snapshot_edge_type_t type,
+                                    size_t name_or_index, mjs_value_t value) {
+    switch (value.tag) {
+        case MJS_TAG_STRING:
+        case MJS_TAG_OBJECT:
+        case MJS_TAG_FUNCTION:
+        case MJS_TAG_ARRAY:
+            snapshot_add_object_edge(builder, type, name_or_index, value.u.ptr);
+            break;
+        default:
+            break;
+    }
+}
+
+static void snapshot_add_named_edge(snapshot_builder_t* builder, mjs_snapshot_edge_type_t type,
+                                    const char* name, mjs_value_t value) {
+    size_t index = snapshot_intern_cstr(builder, name);
+    if (index != SIZE_MAX) {
+        snapshot_add_value_edge(builder, type, index, value);
+    }
+}
+
+static void snapshot_add_bytecode_edges(snapshot_builder_t* builder, mjs_bytecode_t* bytecode, size_t* element) {
+    if (!bytecode) return;
+    
+    for (size_t i = 0; i < bytecode->constant_count; i++) {
+        snapshot_add_value_edge(builder, MJS_SNAPSHOT_EDGE_HIDDEN, (*element)++, bytecode->constants[i]);
+    }
+    for (size_t i = 0; i < bytecode->string_count; i++) {
+        snapshot_add_object_edge(builder, MJS_SNAPSHOT_EDGE_HIDDEN, (*element)++, bytecode->strings[i]);
+    }
+}
+
+/* The references of one root group, the same set gc_mark_roots marks */
+static void snapshot_add_root_edges(snapshot_builder_t* builder, mjs_gc_t* gc, int group) {
+    mjs_runtime_t* runtime = gc->runtime;
+    size_t element = 0;
+    
+    switch (group) {
+        case SNAPSHOT_ROOT:
+            for (int i = SNAPSHOT_ROOT + 1; i < SNAPSHOT_SYNTHETIC_COUNT; i++) {
+                snapshot_add_edge(builder, MJS_SNAPSHOT_EDGE_ELEMENT, element++, (size_t)i);
+            }
+            break;
+        
+        case SNAPSHOT_EMBEDDER_ROOTS:
+            for (size_t i = 0; i < gc->root_count; i++) {
+                snapshot_add_object_edge(builder, MJS_SNAPSHOT_EDGE_ELEMENT, element++, gc->roots[i]);
+            }
+            break;
+        
+        case SNAPSHOT_SCOPED_ROOTS:
+            for (size_t i = 0; i < gc->scoped_root_count; i++) {
+                snapshot_add_object_edge(builder, MJS_SNAPSHOT_EDGE_ELEMENT, element++, gc->scoped_roots[i]);
+            }
+            break;
+        
+        case SNAPSHOT_GLOBALS:
+            for (mjs_context_t* ctx = runtime ? runtime->contexts : NULL; ctx; ctx = ctx->next_context) {
+                snapshot_add_named_edge(builder, MJS_SNAPSHOT_EDGE_PROPERTY, "global", ctx->global_object);
+                snapshot_add_named_edge(builder, MJS_SNAPSHOT_EDGE_INTERNAL, "error", ctx->error_value);
+            }
+            break;
+        
+        case SNAPSHOT_HANDLES:
+            for (mjs_context_t* ctx = runtime ? runtime->contexts : NULL; ctx; ctx = ctx->next_context) {
+                for (size_t i = 0; i < ctx->handle_count; i++) {
+                    mjs_value_t value = ctx->handle_blocks[i / MJS_HANDLE_BLOCK_SIZE][i % MJS_HANDLE_BLOCK_SIZE];
+                    snapshot_add_value_edge(builder, MJS_SNAPSHOT_EDGE_ELEMENT, element++, value);
+                }
+            }
+            break;
+        
+        case SNAPSHOT_PERSISTENTS:
+            for (size_t i = 0; runtime && i < runtime->persistent_capacity; i++) {
+                if (runtime->persistents[i].in_use) {
+                    snapshot_add_value_edge(builder, MJS_SNAPSHOT_EDGE_ELEMENT, i, runtime->persistents[i].value);
+                }
+            }
+            break;
+        
+        case SNAPSHOT_STACK:
+            for (mjs_vm_t* vm = runtime ? runtime->vms : NULL; vm; vm = vm->next_vm) {
+                for (size_t i = 0; i < vm->stack_top; i++) {
+                    snapshot_add_value_edge(builder, MJS_SNAPSHOT_EDGE_ELEMENT, element++, vm->stack[i]);
+                }
+                for (size_t i = 0; i < vm->call_stack_top; i++) {
+                    snapshot_add_value_edge(builder, MJS_SNAPSHOT_EDGE_HIDDEN, element++, vm->call_stack[i].this_value);
+                    snapshot_add_bytecode_edges(builder, vm->call_stack[i].bytecode, &element);
+                }
+                if (vm->has_exception) {
+                    snapshot_add_named_edge(builder, MJS_SNAPSHOT_EDGE_INTERNAL, "exception", vm->exception_value);
+                }
+            }
+            break;
+        
+        case SNAPSHOT_STRING_TABLE:
+            for (mjs_string_t* str = runtime ? runtime->string_table : NULL; str; str = str->next) {
+                snapshot_add_object_edge(builder, MJS_SNAPSHOT_EDGE_ELEMENT, element++, str);
+            }
+            break;
+        
+        default:
+            break;
+    }
+}
+
+/* The references of one object, the same set gc_scan_object follows */
+static void snapshot_add_object_edges(snapshot_builder_t* builder, mjs_gc_object_t* header, void* object) {
+    size_t element = 0;
+    
+    switch (header->type) {
+        case GC_TYPE_STRING: {
+            mjs_string_t* str = (mjs_string_t*)object;
+            if (str->data_owner) {
+                mjs_value_t owner = { .tag = MJS_TAG_STRING, .u.string = str->data_owner };
+                snapshot_add_named_edge(builder, MJS_SNAPSHOT_EDGE_INTERNAL, "data", owner);
+            }
+            break;
+        }
+        
+        case GC_TYPE_OBJECT: {
+            mjs_object_t* obj = (mjs_object_t*)object;
+            for (mjs_property_t* prop = obj->properties; prop; prop = prop->next) {
+                if (prop->key && prop->key->data) {
+                    size_t name = snapshot_intern(builder->snapshot, prop->key->data, prop->key->length);
+                    if (name == SIZE_MAX) {
+                        builder->failed = true;
+                        return;
+                    }
+                    snapshot_add_value_edge(builder, MJS_SNAPSHOT_EDGE_PROPERTY, name, prop->value);
+                    snapshot_add_object_edge(builder, MJS_SNAPSHOT_EDGE_HIDDEN, element++, prop->key);
+                } else {
+                    snapshot_add_value_edge(builder, MJS_SNAPSHOT_EDGE_HIDDEN, element++, prop->value);
+                }
+            }
+            if (obj->prototype) {
+                mjs_value_t proto = { .tag = MJS_TAG_OBJECT, .u.object = obj->prototype };
+                snapshot_add_named_edge(builder, MJS_SNAPSHOT_EDGE_PROPERTY, "__proto__", proto);
+            }
+            break;
+        }
+        
+        case GC_TYPE_ARRAY: {
+            mjs_array_t* array = (mjs_array_t*)object;
+            for (size_t i = 0; array->elements && i < array->length; i++) {
+                snapshot_add_value_edge(builder, MJS_SNAPSHOT_EDGE_ELEMENT, i, array->elements[i]);
+            }
+            break;
+        }
+        
+        case GC_TYPE_FUNCTION: {
+            mjs_function_t* function = (mjs_function_t*)object;
+            if (function->name) {
+                mjs_value_t name = { .tag = MJS_TAG_STRING, .u.string = function->name };
+                snapshot_add_named_edge(builder, MJS_SNAPSHOT_EDGE_INTERNAL, "name", name);
+            }
+            if (function->scope) {
+                mjs_value_t scope = { .tag = MJS_TAG_OBJECT, .u.object = function->scope };
+                snapshot_add_named_edge(builder, MJS_SNAPSHOT_EDGE_CONTEXT, "scope", scope);
+            }
+            if (function->type == MJS_FUNCTION_BYTECODE) {
+                snapshot_add_bytecode_edges(builder, function->u.bytecode.bytecode, &element);
+            }
+            break;
+        }
+        
+        default:
+            break;
+    }
+}
+
+/* Nodes */
+static void snapshot_describe_object(snapshot_builder_t* builder, mjs_snapshot_node_t* node,
+                                     mjs_gc_object_t* header, void* object) {
+    switch (header->type) {
+        case GC_TYPE_STRING: {
+            mjs_string_t* str = (mjs_string_t*)object;
+            size_t length = str->data ? str->length : 0;
+            if (length > SNAPSHOT_NAME_MAX) {
+                // Cut at a UTF-8 character boundary
+                length = SNAPSHOT_NAME_MAX;
+                while (length > 0 && ((unsigned char)str->data[length] & 0xC0) == 0x80) length--;
+            }
+            node->type = MJS_SNAPSHOT_NODE_STRING;
+            node->name = snapshot_intern(builder->snapshot, str->data ? str->data : "", length);
+            if (node->name == SIZE_MAX) builder->failed = true;
+            // The characters are off-heap but owned by the string, or by
+            // the string it was deduplicated against
+            if (!str->data_owner) {
+                node->self_size += str->capacity;
+            }
+            break;
+        }
+        
+        case GC_TYPE_ARRAY: {
+            mjs_array_t* array = (mjs_array_t*)object;
+            node->type = MJS_SNAPSHOT_NODE_ARRAY;
+            node->name = snapshot_intern_cstr(builder, "Array");
+            node->self_size += array->capacity * sizeof(mjs_value_t);
+            break;
+        }
+        
+        case GC_TYPE_OBJECT: {
+            mjs_object_t* obj = (mjs_object_t*)object;
+            node->type = MJS_SNAPSHOT_NODE_OBJECT;
+            node->name = snapshot_intern_cstr(builder, "Object");
+            node->self_size += obj->property_count * sizeof(mjs_property_t);
+            break;
+        }
+        
+        case GC_TYPE_FUNCTION: {
+            mjs_function_t* function = (mjs_function_t*)object;
+            node->type = MJS_SNAPSHOT_NODE_CLOSURE;
+            if (function->name && function->name->data) {
+                node->name = snapshot_intern(builder->snapshot, function->name->data, function->name->length);
+                if (node->name == SIZE_MAX) builder->failed = true;
+            } else {
+                node->name = snapshot_intern_cstr(builder, "(anonymous function)");
+            }
+            break;
+        }
+        
+        default:
+            node->type = MJS_SNAPSHOT_NODE_HIDDEN;
+            node->name = snapshot_intern_cstr(builder, "(internal)");
+            break;
+    }
+}
+
+static bool snapshot_collect_nodes(snapshot_builder_t* builder, mjs_gc_t* gc) {
+    mjs_heap_snapshot_t* snapshot = builder->snapshot;
+    mjs_gc_generation_t* generations[2] = { &gc->young_generation, &gc->old_generation };
+    
+    size_t object_count = 0;
+    for (int g = 0; g < 2; g++) {
+        for (mjs_gc_page_t* page = generations[g]->pages; page; page = page->next) {
+            object_count += page->live_count;
+        }
+    }
+    
+    snapshot->nodes = MJS_CALLOC(SNAPSHOT_SYNTHETIC_COUNT + object_count, sizeof(mjs_snapshot_node_t));
+    builder->object_table_capacity = 64;
+    while (builder->object_table_capacity < object_count * 2) {
+        builder->object_table_capacity *= 2;
+    }
+    builder->object_table = MJS_CALLOC(builder->object_table_capacity, sizeof(size_t));
+    if (!snapshot->nodes || !builder->object_table) return false;
+    
+    for (int i = 0; i < SNAPSHOT_SYNTHETIC_COUNT; i++) {
+        mjs_snapshot_node_t* node = &snapshot->nodes[snapshot->node_count++];
+        node->type = MJS_SNAPSHOT_NODE_SYNTHETIC;
+        node->name = snapshot_intern_cstr(builder, snapshot_synthetic_names[i]);
+    }
+    
+    size_t mask = builder->object_table_capacity - 1;
+    for (int g = 0; g < 2; g++) {
+        for (mjs_gc_page_t* page = generations[g]->pages; page; page = page->next) {
+            for (size_t i = 0; i < page->cell_count; i++) {
+                mjs_gc_object_t* header = (mjs_gc_object_t*)(page->cells + i * page->cell_size);
+                if (!header->in_use) continue;
+                if (snapshot->node_count == SNAPSHOT_SYNTHETIC_COUNT + object_count) break;
+                
+                mjs_snapshot_node_t* node = &snapshot->nodes[snapshot->node_count];
+                node->object = mjs_gc_get_data(header);
+                node->self_size = page->cell_size;
+                snapshot_describe_object(builder, node, header, node->object);
+                
+                size_t slot = snapshot_hash_pointer(node->object, builder->object_table_capacity);
+                while (builder->object_table[slot]) {
+                    slot = (slot + 1) & mask;
+                }
+                builder->object_table[slot] = ++snapshot->node_count;
+            }
+        }
+    }
+    
+    return !builder->failed;
+}
+
+/* Dominators, by the iterative algorithm of Cooper, Harvey and Kennedy
+ * over a reverse postorder from the root. A node's dominator finishes
+ * after it in a depth-first walk, so summing sizes in postorder yields
+ * the retained sizes. */
+static size_t snapshot_intersect(size_t a, size_t b, const size_t* dominators, const size_t* postorder) {
+    while (a != b) {
+        while (postorder[a] < postorder[b]) a = dominators[a];
+        while (postorder[b] < postorder[a]) b = dominators[b];
+    }
+    return a;
+}
+
+static bool snapshot_compute_dominators(mjs_heap_snapshot_t* snapshot) {
+    size_t count = snapshot->node_count;
+    size_t* postorder = MJS_MALLOC(count * sizeof(size_t));    /* node -> number */
+    size_t* order = MJS_MALLOC(count * sizeof(size_t));        /* number -> node */
+    size_t* dominators = MJS_MALLOC(count * sizeof(size_t));
+    size_t* stack = MJS_MALLOC(count * sizeof(size_t));
+    size_t* next_edge = MJS_MALLOC(count * sizeof(size_t));
+    size_t* pred_start = MJS_CALLOC(count + 1, sizeof(size_t));
+    size_t* preds = MJS_MALLOC((snapshot->edge_count + 1) * sizeof(size_t));
+    bool ok = postorder && order && dominators && stack && next_edge && pred_start && preds;
+    
+    if (ok) {
+        // Iterative depth-first walk
+        for (size_t i = 0; i < count; i++) {
+            postorder[i] = SNAPSHOT_NO_NODE;
+            dominators[i] = SNAPSHOT_NO_NODE;
+            next_edge[i] = SNAPSHOT_NO_NODE;
+        }
+        
+        size_t visited = 0;
+        size_t depth = 0;
+        stack[depth++] = SNAPSHOT_ROOT;
+        next_edge[SNAPSHOT_ROOT] = 0;
+        while (depth > 0) {
+            mjs_snapshot_node_t* node = &snapshot->nodes[stack[depth - 1]];
+            size_t* edge = &next_edge[stack[depth - 1]];
+            
+            if (*edge < node->edge_count) {
+                size_t to = snapshot->edges[node->first_edge + (*edge)++].to;
+                if (next_edge[to] == SNAPSHOT_NO_NODE) {
+                    next_edge[to] = 0;
+                    stack[depth++] = to;
+                }
+            } else {
+                order[visited] = stack[depth - 1];
+                postorder[stack[depth - 1]] = visited++;
+                depth--;
+            }
+        }
+        
+        // Predecessor lists of the reachable nodes
+        for (size_t i = 0; i < snapshot->edge_count; i++) {
+            pred_start[snapshot->edges[i].to + 1]++;
+        }
+        for (size_t i = 0; i < count; i++) {
+            pred_start[i + 1] += pred_start[i];
+            next_edge[i] = 0;
+        }
+        for (size_t from = 0; from < count; from++) {
+            mjs_snapshot_node_t* node = &snapshot->nodes[from];
+            for (size_t e = 0; e < node->edge_count; e++) {
+                size_t to = snapshot->edges[node->first_edge + e].to;
+                preds[pred_start[to] + next_edge[to]++] = from;
+            }
+        }
+        
+        dominators[SNAPSHOT_ROOT] = SNAPSHOT_ROOT;
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t k = visited - 1; k-- > 0;) {
+                size_t node = order[k];
+                size_t idom = SNAPSHOT_NO_NODE;
+                
+                for (size_t p = pred_start[node]; p < pred_start[node + 1]; p++) {
+                    size_t pred = preds[p];
+                    if (dominators[pred] == SNAPSHOT_NO_NODE) continue;
+                    idom = idom == SNAPSHOT_NO_NODE ? pred : snapshot_intersect(pred, idom, dominators, postorder);
+                }
+                
+                if (dominators[node] != idom) {
+                    dominators[node] = idom;
+                    changed = true;
+                }
+            }
+        }
+        
+        // Unreachable objects hang directly off the root
+        for (size_t i = 0; i < count; i++) {
+            mjs_snapshot_node_t* node = &snapshot->nodes[i];
+            node->dominator = dominators[i] == SNAPSHOT_NO_NODE ? SNAPSHOT_ROOT : dominators[i];
+            node->retained_size = node->self_size;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (postorder[i] == SNAPSHOT_NO_NODE) {
+                snapshot->nodes[SNAPSHOT_ROOT].retained_size += snapshot->nodes[i].retained_size;
+            }
+        }
+        for (size_t k = 0; k + 1 < visited; k++) {
+            mjs_snapshot_node_t* node = &snapshot->nodes[order[k]];
+            snapshot->nodes[node->dominator].retained_size += node->retained_size;
+        }
+    }
+    
+    MJS_FREE(postorder);
+    MJS_FREE(order);
+    MJS_FREE(dominators);
+    MJS_FREE(stack);
+    MJS_FREE(next_edge);
+    MJS_FREE(pred_start);
+    MJS_FREE(preds);
+    return ok;
+}
+
+mjs_heap_snapshot_t* mjs_heap_snapshot_take(mjs_gc_t* gc) {
+    if (!gc) return NULL;
+    
+    // Only live objects, and no cycle in progress touching the mark bits
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    
+    mjs_heap_snapshot_t* snapshot = MJS_CALLOC(1, sizeof(mjs_heap_snapshot_t));
+    if (!snapshot) return NULL;
+    
+    snapshot_builder_t builder = { snapshot, NULL, 0, false };
+    bool ok = snapshot_collect_nodes(&builder, gc);
+    
+    // Edges are appended node by node, so each node's run is contiguous
+    for (size_t i = 0; ok && i < snapshot->node_count; i++) {
+        mjs_snapshot_node_t* node = &snapshot->nodes[i];
+        node->first_edge = snapshot->edge_count;
+        if (i < SNAPSHOT_SYNTHETIC_COUNT) {
+            snapshot_add_root_edges(&builder, gc, (int)i);
+        } else {
+            snapshot_add_object_edges(&builder, mjs_gc_get_header(node->object), node->object);
+        }
+        node->edge_count = snapshot->edge_count - node->first_edge;
+        ok = !builder.failed;
+    }
+    MJS_FREE(builder.object_table);
+    
+    if (!ok || !snapshot_compute_dominators(snapshot)) {
+        mjs_heap_snapshot_free(snapshot);
+        return NULL;
+    }
+    
+    return snapshot;
+}
+
+void mjs_heap_snapshot_free(mjs_heap_snapshot_t* snapshot) {
+    if (!snapshot) return;
+    
+    for (size_t i = 0; i < snapshot->string_count; i++) {
+        MJS_FREE(snapshot->strings[i]);
+    }
+    MJS_FREE(snapshot->strings);
+    MJS_FREE(snapshot->string_table);
+    MJS_FREE(snapshot->nodes);
+    MJS_FREE(snapshot->edges);
+    MJS_FREE(snapshot);
+}
+
+/* Writer */
+static void snapshot_write_string(FILE* file, const char* str) {
+    fputc('"', file);
+    for (const unsigned char* p = (const unsigned char*)str; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', file);
+            fputc(*p, file);
+        } else if (*p < 0x20) {
+            fprintf(file, "\\u%04x", *p);
+        } else {
+            fputc(*p, file);
+        }
+    }
+    fputc('"', file);
+}
+
+/* The DevTools format: flat integer arrays described by the meta section.
+ * Edges name their target by its offset in the nodes array. */
+bool mjs_heap_snapshot_write(mjs_heap_snapshot_t* snapshot, FILE* file) {
+    if (!snapshot || !file) return false;
+    
+    const size_t node_fields = 7;
+    
+    fputs("{\"snapshot\":{\"meta\":{"
+          "\"node_fields\":[\"type\",\"name\",\"id\",\"self_size\",\"edge_count\",\"trace_node_id\",\"detachedness\"],"
+          "\"node_types\":[[\"hidden\",\"array\",\"string\",\"object\",\"code\",\"closure\",\"regexp\",\"number\","
+          "\"native\",\"synthetic\",\"concatenated string\",\"sliced string\",\"symbol\",\"bigint\",\"object shape\"],"
+          "\"string\",\"number\",\"number\",\"number\",\"number\",\"number\"],"
+          "\"edge_fields\":[\"type\",\"name_or_index\",\"to_node\"],"
+          "\"edge_types\":[[\"context\",\"element\",\"property\",\"internal\",\"hidden\",\"shortcut\",\"weak\"],"
+          "\"string_or_number\",\"node\"],"
+          "\"trace_function_info_fields\":[\"function_id\",\"name\",\"script_name\",\"script_id\",\"line\",\"column\"],"
+          "\"trace_node_fields\":[\"id\",\"function_info_index\",\"count\",\"size\",\"children\"],"
+          "\"sample_fields\":[\"timestamp_us\",\"last_assigned_id\"],"
+          "\"location_fields\":[\"object_index\",\"script_id\",\"line\",\"column\"]},", file);
+    fprintf(file, "\"node_count\":%zu,\"edge_count\":%zu,\"trace_function_count\":0},\n",
+            snapshot->node_count, snapshot->edge_count);
+    
+    fputs("\"nodes\":[", file);
+    for (size_t i = 0; i < snapshot->node_count; i++) {
+        mjs_snapshot_node_t* node = &snapshot->nodes[i];
+        fprintf(file, "%s%d,%zu,%zu,%zu,%zu,0,0", i ? ",\n" : "", (int)node->type, node->name,
+                i * 2 + 1, node->self_size, node->edge_count);
+    }
+    
+    fputs("],\n\"edges\":[", file);
+    for (size_t i = 0; i < snapshot->edge_count; i++) {
+        mjs_snapshot_edge_t* edge = &snapshot->edges[i];
+        fprintf(file, "%s%d,%zu,%zu", i ? ",\n" : "", (int)edge->type, edge->name_or_index,
+                edge->to * node_fields);
+    }
+    
+    fputs("],\n\"trace_function_infos\":[],\"trace_tree\":[],\"samples\":[],\"locations\":[],\n\"strings\":[", file);
+    for (size_t i = 0; i < snapshot->string_count; i++) {
+        if (i) fputs(",\n", file);
+        snapshot_write_string(file, snapshot->strings[i]);
+    }
+    fputs("]}\n", file);
+    
+    return !ferror(file);
+}
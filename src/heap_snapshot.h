@@ -0,0 +1,93 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Heap Snapshots
+ * Object graph capture with dominator-tree retained sizes, written in the
+ * DevTools .heapsnapshot format
+ */
+
+#ifndef MIKOJS_HEAP_SNAPSHOT_H
+#define MIKOJS_HEAP_SNAPSHOT_H
+
+#include "gc.h"
+
+/* Node and edge types, numbered as in the meta section of the format */
+typedef enum {
+    MJS_SNAPSHOT_NODE_HIDDEN,
+    MJS_SNAPSHOT_NODE_ARRAY,
+    MJS_SNAPSHOT_NODE_STRING,
+    MJS_SNAPSHOT_NODE_OBJECT,
+    MJS_SNAPSHOT_NODE_CODE,
+    MJS_SNAPSHOT_NODE_CLOSURE,
+    MJS_SNAPSHOT_NODE_REGEXP,
+    MJS_SNAPSHOT_NODE_NUMBER,
+    MJS_SNAPSHOT_NODE_NATIVE,
+    MJS_SNAPSHOT_NODE_SYNTHETIC
+} mjs_snapshot_node_type_t;
+
+typedef enum {
+    MJS_SNAPSHOT_EDGE_CONTEXT,
+    MJS_SNAPSHOT_EDGE_ELEMENT,
+    MJS_SNAPSHOT_EDGE_PROPERTY,
+    MJS_SNAPSHOT_EDGE_INTERNAL,
+    MJS_SNAPSHOT_EDGE_HIDDEN
+} mjs_snapshot_edge_type_t;
+
+/* A node's edges are edges[first_edge .. first_edge + edge_count) */
+typedef struct {
+    mjs_snapshot_node_type_t type;
+    size_t name;              /* index into strings */
+    void* object;             /* NULL for synthetic nodes */
+    size_t self_size;
+    size_t retained_size;     /* bytes freed if this node became unreachable */
+    size_t dominator;         /* node index; the root dominates itself */
+    size_t first_edge;
+    size_t edge_count;
+} mjs_snapshot_node_t;
+
+typedef struct {
+    mjs_snapshot_edge_type_t type;
+    size_t name_or_index;     /* string index for named edge types */
+    size_t to;                /* node index */
+} mjs_snapshot_edge_t;
+
+/* Node 0 is the synthetic root; its children group the root set */
+typedef struct {
+    mjs_snapshot_node_t* nodes;
+    size_t node_count;
+    mjs_snapshot_edge_t* edges;
+    size_t edge_count;
+    size_t edge_capacity;
+    char** strings;
+    size_t string_count;
+    size_t string_capacity;
+    size_t* string_table;     /* open addressing, index + 1 of a string */
+    size_t string_table_capacity;
+} mjs_heap_snapshot_t;
+
+/* Runs a full collection first so the snapshot holds live objects only */
+mjs_heap_snapshot_t* mjs_heap_snapshot_take(mjs_gc_t* gc);
+void mjs_heap_snapshot_free(mjs_heap_snapshot_t* snapshot);
+bool mjs_heap_snapshot_write(mjs_heap_snapshot_t* snapshot, FILE* file);
+
+#endif /* MIKOJS_HEAP_SNAPSHOT_H */
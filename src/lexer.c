@@ -169,6 +169,132 @@ static void skip_block_comment(mjs_lexer_t* lexer) {
     }
 }
 
+/* Token strings live as long as the lexer, so the parser can hold on to
+ * them until it is done with the source */
+static char* lexer_keep_value(mjs_lexer_t* lexer, char* value) {
+    if (!value) return NULL;
+    
+    if (lexer->value_count == lexer->value_capacity) {
+        size_t new_capacity = lexer->value_capacity == 0 ? 16 : lexer->value_capacity * 2;
+        char** new_values = MJS_REALLOC(lexer->values, new_capacity * sizeof(char*));
+        if (!new_values) {
+            MJS_FREE(value);
+            return NULL;
+        }
+        lexer->values = new_values;
+        lexer->value_capacity = new_capacity;
+    }
+    
+    lexer->values[lexer->value_count++] = value;
+    return value;
+}
+
+static int hex_digit_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static double parse_number_value(const char* start, size_t length) {
+    // 0x, 0b and 0o literals; strtod would take only the first of them
+    if (length > 2 && start[0] == '0' && isalpha((unsigned char)start[1])) {
+        int base = (start[1] == 'x' || start[1] == 'X') ? 16 :
+                   (start[1] == 'b' || start[1] == 'B') ? 2 : 8;
+        double value = 0;
+        for (size_t i = 2; i < length; i++) {
+            value = value * base + hex_digit_value(start[i]);
+        }
+        return value;
+    }
+    
+    char buffer[64];
+    char* text = length < sizeof(buffer) ? buffer : MJS_MALLOC(length + 1);
+    if (!text) return 0;
+    
+    memcpy(text, start, length);
+    text[length] = '\0';
+    double value = strtod(text, NULL);
+    if (text != buffer) {
+        MJS_FREE(text);
+    }
+    return value;
+}
+
+/* Append code point cp to out as UTF-8 */
+static size_t encode_utf8(char* out, unsigned long cp) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    out[0] = (char)(0xE0 | (cp >> 12));
+    out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (cp & 0x3F));
+    return 3;
+}
+
+/* The characters between the quotes, with escapes resolved. No escape
+ * produces more bytes than it takes up in the source. */
+static char* parse_string_value(const char* start, size_t length) {
+    const char* src = start + 1;
+    const char* end = start + length - 1;
+    char* value = MJS_MALLOC(length);
+    if (!value) return NULL;
+    
+    char* out = value;
+    while (src < end) {
+        if (*src != '\\' || src + 1 >= end) {
+            *out++ = *src++;
+            continue;
+        }
+        
+        src++;
+        char c = *src++;
+        switch (c) {
+            case 'n': *out++ = '\n'; break;
+            case 't': *out++ = '\t'; break;
+            case 'r': *out++ = '\r'; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'v': *out++ = '\v'; break;
+            case '0': *out++ = '\0'; break;
+            case 'x':
+            case 'u': {
+                size_t digits = c == 'x' ? 2 : 4;
+                unsigned long cp = 0;
+                size_t i = 0;
+                for (; i < digits && src + i < end && hex_digit_value(src[i]) >= 0; i++) {
+                    cp = cp * 16 + (unsigned long)hex_digit_value(src[i]);
+                }
+                if (i < digits) {
+                    *out++ = c; // Not a complete escape, keep it as written
+                    break;
+                }
+                src += digits;
+                out += encode_utf8(out, cp);
+                break;
+            }
+            default: *out++ = c; break;
+        }
+    }
+    *out = '\0';
+    return value;
+}
+
+static char* copy_identifier(const char* start, size_t length) {
+    char* value = MJS_MALLOC(length + 1);
+    if (!value) return NULL;
+    
+    memcpy(value, start, length);
+    value[length] = '\0';
+    return value;
+}
+
 static mjs_token_t make_token(mjs_lexer_t* lexer, mjs_token_type_t type) {
     mjs_token_t token;
     token.type = type;
@@ -176,12 +302,32 @@ static mjs_token_t make_token(mjs_lexer_t* lexer, mjs_token_type_t type) {
     token.length = lexer->current - lexer->start;
     token.line = lexer->line;
     token.column = lexer->column - token.length;
+    memset(&token.value, 0, sizeof(token.value));
+    
+    switch (type) {
+        case TOKEN_NUMBER:
+            token.value.number = parse_number_value(token.start, token.length);
+            break;
+        case TOKEN_STRING:
+            token.value.string = lexer_keep_value(lexer, parse_string_value(token.start, token.length));
+            break;
+        case TOKEN_IDENTIFIER:
+            token.value.string = lexer_keep_value(lexer, copy_identifier(token.start, token.length));
+            break;
+        case TOKEN_TRUE:
+        case TOKEN_FALSE:
+            token.value.boolean = type == TOKEN_TRUE;
+            break;
+        default:
+            break;
+    }
     return token;
 }
 
 static mjs_token_t make_error_token(mjs_lexer_t* lexer, const char* message) {
     lexer_error(lexer, "%s", message);
     mjs_token_t token;
+    memset(&token.value, 0, sizeof(token.value));
     token.type = TOKEN_ERROR;
     token.start = lexer->start;
     token.length = lexer->current - lexer->start;
@@ -325,6 +471,9 @@ mjs_lexer_t* mjs_lexer_new(const char* source, size_t length) {
     lexer->length = length;
     lexer->has_error = false;
     lexer->error_message = NULL;
+    lexer->values = NULL;
+    lexer->value_count = 0;
+    lexer->value_capacity = 0;
     
     return lexer;
 }
@@ -335,6 +484,10 @@ void mjs_lexer_free(mjs_lexer_t* lexer) {
     if (lexer->error_message) {
         MJS_FREE(lexer->error_message);
     }
+    for (size_t i = 0; i < lexer->value_count; i++) {
+        MJS_FREE(lexer->values[i]);
+    }
+    MJS_FREE(lexer->values);
     MJS_FREE(lexer);
 }
 
@@ -179,6 +179,9 @@ struct mjs_lexer {
     mjs_token_t current_token;
     bool has_error;
     char* error_message;
+    char** values;              /* token strings, freed with the lexer */
+    size_t value_count;
+    size_t value_capacity;
 };
 
 /* Lexer functions */
@@ -133,6 +133,8 @@ struct mjs_string {
     size_t capacity;
     bool is_interned;
     struct mjs_string* next; /* for string interning */
+    struct mjs_string* data_owner; /* owns data when deduplicated by the GC */
+    bool data_shared; /* other strings' data_owner; stays canonical */
 };
 
 /* Property structure */
@@ -178,12 +180,28 @@ struct mjs_array {
     size_t capacity;
 };
 
+/* Handles live in fixed-size blocks so a handle's address stays valid
+ * while more are created */
+#define MJS_HANDLE_BLOCK_SIZE 1024
+
+/* Persistent handle slot; free slots are chained through next_free */
+typedef struct mjs_persistent_slot {
+    mjs_value_t value;
+    size_t next_free;           /* index + 1 of the next free slot, 0 ends the list */
+    bool in_use;
+} mjs_persistent_slot_t;
+
 /* Runtime structure */
 struct mjs_runtime {
     mjs_gc_t* gc;
     mjs_string_t* string_table; /* interned strings */
-    size_t memory_limit;
-    size_t memory_usage;
+    mjs_context_t* contexts;    /* live contexts, scanned for roots */
+    mjs_vm_t* vms;              /* live VMs, their stacks are scanned for roots */
+    mjs_persistent_slot_t* persistents;
+    size_t persistent_capacity;
+    size_t persistent_free;     /* index + 1 of the first free slot, 0 if none */
+    size_t memory_limit;        /* hard cap on the GC heap, 0 for none */
+    mjs_shared_heap_t* shared_heap; /* read-only builtins and atoms, NULL if none */
 };
 
 /* Context structure */
@@ -194,6 +212,10 @@ struct mjs_context {
     mjs_value_t error_value;
     char* error_message;
     bool has_error;
+    struct mjs_context* next_context;
+    mjs_value_t** handle_blocks;
+    size_t handle_block_count;
+    size_t handle_count;        /* handles in use across all open scopes */
 };
 
 /* Internal function declarations */
@@ -210,18 +232,22 @@ mjs_object_t* mjs_object_new(mjs_context_t* ctx);
 void mjs_object_free(mjs_object_t* obj);
 mjs_property_t* mjs_object_get_property(mjs_object_t* obj, const char* key);
 mjs_value_t mjs_object_get_property_value(mjs_object_t* obj, const char* key);
-void mjs_object_set_property(mjs_object_t* obj, const char* key, mjs_value_t value);
+mjs_result_t mjs_object_set_property(mjs_context_t* ctx, mjs_object_t* obj, const char* key,
+                                     mjs_value_t value);
+bool mjs_object_delete_property(mjs_context_t* ctx, mjs_object_t* obj, const char* key);
+mjs_result_t mjs_object_define_property(mjs_context_t* ctx, mjs_object_t* obj, const char* key,
+                                       mjs_value_t value, bool writable, bool enumerable, bool configurable);
 mjs_object_t* mjs_get_object(mjs_value_t value);
 
 /* Array management */
 mjs_array_t* mjs_array_new(mjs_context_t* ctx, size_t initial_capacity, size_t element_size);
 void mjs_array_free(mjs_array_t* arr);
-void mjs_array_resize(mjs_array_t* arr, size_t new_size);
+void mjs_array_resize(mjs_context_t* ctx, mjs_array_t* arr, size_t new_size);
 size_t mjs_array_length(mjs_array_t* arr);
 mjs_value_t mjs_array_get(mjs_array_t* arr, size_t index);
-bool mjs_array_set(mjs_array_t* arr, size_t index, mjs_value_t value);
-bool mjs_array_push(mjs_array_t* arr, mjs_value_t value);
-mjs_value_t mjs_array_pop(mjs_array_t* arr);
+bool mjs_array_set(mjs_context_t* ctx, mjs_array_t* arr, size_t index, mjs_value_t value);
+bool mjs_array_push(mjs_context_t* ctx, mjs_array_t* arr, mjs_value_t value);
+mjs_value_t mjs_array_pop(mjs_context_t* ctx, mjs_array_t* arr);
 mjs_array_t* mjs_get_array(mjs_value_t value);
 
 /* Function management */
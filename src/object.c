@@ -46,13 +46,10 @@ mjs_object_t* mjs_object_new(mjs_context_t* ctx) {
 void mjs_object_free(mjs_object_t* obj) {
     if (!obj) return;
     
-    // Free all properties
+    // Free all properties (keys are GC strings and are collected separately)
     mjs_property_t* prop = obj->properties;
     while (prop) {
         mjs_property_t* next = prop->next;
-        if (prop->key) {
-            mjs_string_free(prop->key);
-        }
         MJS_FREE(prop);
         prop = next;
     }
@@ -87,41 +84,44 @@ mjs_value_t mjs_object_get_property_value(mjs_object_t* obj, const char* key) {
     return mjs_value_undefined();
 }
 
-void mjs_object_set_property(mjs_object_t* obj, const char* key, mjs_value_t value) {
-    if (!obj || !key) return;
+/* Stores and deletes relink, overwrite or free memory the concurrent
+ * marker may be tracing, so they run under the heap lock and log the
+ * references they drop. Shared-heap objects are read by other runtimes
+ * at the same time and refuse every change. */
+mjs_result_t mjs_object_set_property(mjs_context_t* ctx, mjs_object_t* obj, const char* key,
+                                     mjs_value_t value) {
+    if (!ctx || !obj || !key) return MJS_ERROR_TYPE;
+    
+    mjs_gc_t* gc = ctx->runtime->gc;
+    if (mjs_gc_is_shared_object(gc, obj)) {
+        return MJS_ERROR_TYPE;
+    }
     
     // Check if property already exists
     mjs_property_t* existing = mjs_object_get_property(obj, key);
-    if (existing) {
-        if (existing->writable) {
-            existing->value = value;
-        }
-        return;
+    if (!existing) {
+        return mjs_object_define_property(ctx, obj, key, value, true, true, true);
     }
     
-    // Create new property
-    mjs_property_t* prop = MJS_MALLOC(sizeof(mjs_property_t));
-    if (!prop) return;
-    
-    // Note: This is a simplified implementation
-    // In a real implementation, we'd need to get the context to create the string
-    prop->key = NULL; // TODO: Create string from key
-    prop->value = value;
-    prop->writable = true;
-    prop->enumerable = true;
-    prop->configurable = true;
-    prop->next = obj->properties;
-    
-    obj->properties = prop;
-    obj->property_count++;
+    if (existing->writable) {
+        bool heap_locked = mjs_gc_lock_heap(gc);
+        MJS_GC_DELETION_BARRIER_VALUE(gc, existing->value);
+        MJS_GC_WRITE_BARRIER_VALUE(gc, obj, value);
+        existing->value = value;
+        mjs_gc_unlock_heap(gc, heap_locked);
+    }
+    return MJS_OK;
 }
 
 bool mjs_object_has_property(mjs_object_t* obj, const char* key) {
     return mjs_object_get_property(obj, key) != NULL;
 }
 
-bool mjs_object_delete_property(mjs_object_t* obj, const char* key) {
-    if (!obj || !key) return false;
+bool mjs_object_delete_property(mjs_context_t* ctx, mjs_object_t* obj, const char* key) {
+    if (!ctx || !obj || !key) return false;
+    
+    mjs_gc_t* gc = ctx->runtime->gc;
+    if (mjs_gc_is_shared_object(gc, obj)) return false;
     
     mjs_property_t* prev = NULL;
     mjs_property_t* prop = obj->properties;
@@ -132,17 +132,20 @@ bool mjs_object_delete_property(mjs_object_t* obj, const char* key) {
                 return false; // Cannot delete non-configurable property
             }
             
+            bool heap_locked = mjs_gc_lock_heap(gc);
+            if (mjs_gc_is_marking(gc)) {
+                mjs_gc_satb_barrier(gc, prop->key);
+                mjs_gc_satb_barrier_value(gc, prop->value);
+            }
             if (prev) {
                 prev->next = prop->next;
             } else {
                 obj->properties = prop->next;
             }
+            obj->property_count--;
+            mjs_gc_unlock_heap(gc, heap_locked);
             
-            if (prop->key) {
-                mjs_string_free(prop->key);
-            }
             MJS_FREE(prop);
-            obj->property_count--;
             return true;
         }
         prev = prop;
@@ -157,6 +160,11 @@ mjs_result_t mjs_object_define_property(mjs_context_t* ctx, mjs_object_t* obj, c
                                        mjs_value_t value, bool writable, bool enumerable, bool configurable) {
     if (!ctx || !obj || !key) return MJS_ERROR_TYPE;
     
+    // Other runtimes read shared objects concurrently
+    if (mjs_gc_is_shared_object(ctx->runtime->gc, obj)) {
+        return MJS_ERROR_TYPE;
+    }
+    
     if (!obj->extensible) {
         return MJS_ERROR_TYPE; // Cannot add property to non-extensible object
     }
@@ -168,10 +176,14 @@ mjs_result_t mjs_object_define_property(mjs_context_t* ctx, mjs_object_t* obj, c
             return MJS_ERROR_TYPE; // Cannot redefine non-configurable property
         }
         
+        bool heap_locked = mjs_gc_lock_heap(ctx->runtime->gc);
+        MJS_GC_DELETION_BARRIER_VALUE(ctx->runtime->gc, existing->value);
+        MJS_GC_WRITE_BARRIER_VALUE(ctx->runtime->gc, obj, value);
         existing->value = value;
         existing->writable = writable;
         existing->enumerable = enumerable;
         existing->configurable = configurable;
+        mjs_gc_unlock_heap(ctx->runtime->gc, heap_locked);
         return MJS_OK;
     }
     
@@ -185,14 +197,18 @@ mjs_result_t mjs_object_define_property(mjs_context_t* ctx, mjs_object_t* obj, c
         return MJS_ERROR_MEMORY;
     }
     
+    MJS_GC_WRITE_BARRIER(ctx->runtime->gc, obj, prop->key);
+    MJS_GC_WRITE_BARRIER_VALUE(ctx->runtime->gc, obj, value);
     prop->value = value;
     prop->writable = writable;
     prop->enumerable = enumerable;
     prop->configurable = configurable;
-    prop->next = obj->properties;
     
+    bool heap_locked = mjs_gc_lock_heap(ctx->runtime->gc);
+    prop->next = obj->properties;
     obj->properties = prop;
     obj->property_count++;
+    mjs_gc_unlock_heap(ctx->runtime->gc, heap_locked);
     
     return MJS_OK;
 }
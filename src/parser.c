@@ -28,6 +28,7 @@
 #include "parser.h"
 #include "lexer.h"
 #include "mikojs_internal.h"
+#include "trace.h"
 #include <string.h>
 
 /* Forward declarations for recursive parsing functions */
@@ -599,6 +600,17 @@ static mjs_ast_node_t* parse_function_declaration(mjs_parser_t* parser) {
     return func;
 }
 
+/* Public entry points */
+mjs_ast_node_t* mjs_parser_parse_expression(mjs_parser_t* parser) {
+    if (!parser) return NULL;
+    return parse_expression(parser);
+}
+
+mjs_ast_node_t* mjs_parser_parse_statement(mjs_parser_t* parser) {
+    if (!parser) return NULL;
+    return parse_statement(parser);
+}
+
 /* Public parsing functions */
 mjs_ast_node_t* mjs_parse_expression(mjs_parser_t* parser) {
     if (!parser || parser->has_error) return NULL;
@@ -619,12 +631,16 @@ mjs_ast_node_t* mjs_parse_program(mjs_parser_t* parser) {
     program->u.program.body = NULL;
     program->u.program.statement_count = 0;
     
+    // Tokens are lexed on demand, so this span covers lexing too
+    MJS_TRACE_BEGIN1("compile", "parse", "bytes", parser->lexer->length);
+    
     // Parse all statements until EOF
     while (parser->current_token.type != TOKEN_EOF) {
         mjs_ast_node_t* stmt = parse_statement(parser);
         if (!stmt) {
             mjs_ast_node_free(program);
-            return NULL;
+            program = NULL;
+            break;
         }
         
         // TODO: Add statement to program's statement list
@@ -632,6 +648,7 @@ mjs_ast_node_t* mjs_parse_program(mjs_parser_t* parser) {
         mjs_ast_free(stmt);
     }
     
+    MJS_TRACE_END("compile", "parse");
     return program;
 }
 
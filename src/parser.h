@@ -270,7 +270,7 @@ struct mjs_parser {
     mjs_token_t current_token;
     mjs_token_t previous_token;
     bool has_error;
-    char* error_message;
+    char error_message[256];
     mjs_context_t* context;
 };
 
@@ -27,6 +27,10 @@
 
 #include "mikojs_internal.h"
 #include "gc.h"
+#include "heap_snapshot.h"
+#include "shared_heap.h"
+#include "thread.h"
+#include "alloc_profiler.h"
 #include "vm.h"
 #include <stdarg.h>
 #include <stdio.h>
@@ -54,8 +58,14 @@ mjs_runtime_t* mjs_new_runtime(void) {
     }
     
     rt->string_table = NULL;
+    rt->contexts = NULL;
+    rt->vms = NULL;
+    rt->persistents = NULL;
+    rt->persistent_capacity = 0;
+    rt->persistent_free = 0;
+    rt->shared_heap = NULL;
     rt->memory_limit = 64 * 1024 * 1024; // 64MB default
-    rt->memory_usage = 0;
+    mjs_gc_set_memory_limit(rt->gc, rt->memory_limit);
     
     return rt;
 }
@@ -63,18 +73,20 @@ mjs_runtime_t* mjs_new_runtime(void) {
 void mjs_free_runtime(mjs_runtime_t* rt) {
     if (!rt) return;
     
-    // Free string table
-    mjs_string_t* str = rt->string_table;
-    while (str) {
-        mjs_string_t* next = str->next;
-        mjs_string_free(str);
-        str = next;
-    }
+    // Interned strings are GC objects; tearing down the heap frees them
+    rt->string_table = NULL;
     
     if (rt->gc) {
         mjs_gc_free(rt->gc);
     }
     
+    // Only after the heap that referred into it is gone
+    mjs_shared_heap_release(rt->shared_heap);
+    
+    if (rt->persistents) {
+        MJS_FREE(rt->persistents);
+    }
+    
     MJS_FREE(rt);
 }
 
@@ -86,28 +98,51 @@ mjs_context_t* mjs_new_context(mjs_runtime_t* rt) {
     if (!ctx) return NULL;
     
     ctx->runtime = rt;
+    ctx->global_object = mjs_undefined();
+    ctx->error_value = mjs_undefined();
+    ctx->error_message = NULL;
+    ctx->has_error = false;
+    ctx->handle_blocks = NULL;
+    ctx->handle_block_count = 0;
+    ctx->handle_count = 0;
     ctx->vm = mjs_vm_new(ctx);
     if (!ctx->vm) {
         MJS_FREE(ctx);
         return NULL;
     }
     
+    // The collector finds the global object, the VM stack and the code
+    // being run through the runtime's context list
+    ctx->next_context = rt->contexts;
+    rt->contexts = ctx;
+    
     // Create global object
     ctx->global_object = mjs_object(ctx);
     
+    // Builtins of the shared heap are found through the global's prototype,
+    // so a context holds only the globals it defines itself
+    mjs_object_t* global = mjs_get_object(ctx->global_object);
+    if (global && rt->shared_heap) {
+        global->prototype = rt->shared_heap->globals;
+    }
+    
     // Initialize built-in objects and functions
     // TODO: Add built-in objects like Object, Array, Function, etc.
     
-    ctx->error_value = mjs_undefined();
-    ctx->error_message = NULL;
-    ctx->has_error = false;
-    
     return ctx;
 }
 
 void mjs_free_context(mjs_context_t* ctx) {
     if (!ctx) return;
     
+    mjs_context_t** link = &ctx->runtime->contexts;
+    while (*link && *link != ctx) {
+        link = &(*link)->next_context;
+    }
+    if (*link) {
+        *link = ctx->next_context;
+    }
+    
     if (ctx->vm) {
         mjs_vm_free(ctx->vm);
     }
@@ -116,9 +151,171 @@ void mjs_free_context(mjs_context_t* ctx) {
         MJS_FREE(ctx->error_message);
     }
     
+    for (size_t i = 0; i < ctx->handle_block_count; i++) {
+        MJS_FREE(ctx->handle_blocks[i]);
+    }
+    if (ctx->handle_blocks) {
+        MJS_FREE(ctx->handle_blocks);
+    }
+    
     MJS_FREE(ctx);
 }
 
+/* Handle scopes */
+void mjs_handle_scope_open(mjs_context_t* ctx, mjs_handle_scope_t* scope) {
+    if (!scope) return;
+    
+    scope->ctx = ctx;
+    scope->base = ctx ? ctx->handle_count : 0;
+}
+
+void mjs_handle_scope_close(mjs_handle_scope_t* scope) {
+    if (!scope || !scope->ctx) return;
+    
+    mjs_context_t* ctx = scope->ctx;
+    ctx->handle_count = scope->base;
+    scope->ctx = NULL;
+    
+    // Keep one spare block so a scope opened and closed in a loop does
+    // not allocate; release anything a burst of handles left behind
+    size_t keep = ctx->handle_count / MJS_HANDLE_BLOCK_SIZE + 2;
+    while (ctx->handle_block_count > keep) {
+        MJS_FREE(ctx->handle_blocks[--ctx->handle_block_count]);
+    }
+}
+
+mjs_value_t* mjs_handle_scope_escape(mjs_handle_scope_t* scope, mjs_value_t value) {
+    if (!scope || !scope->ctx) return NULL;
+    
+    // The value was copied out before the scope's handles are dropped, so
+    // the new handle in the enclosing scope can reuse their slots
+    mjs_context_t* ctx = scope->ctx;
+    mjs_handle_scope_close(scope);
+    return mjs_handle_new(ctx, value);
+}
+
+mjs_value_t* mjs_handle_new(mjs_context_t* ctx, mjs_value_t value) {
+    if (!ctx) return NULL;
+    
+    size_t block = ctx->handle_count / MJS_HANDLE_BLOCK_SIZE;
+    if (block >= ctx->handle_block_count) {
+        mjs_value_t** new_blocks = MJS_REALLOC(ctx->handle_blocks,
+                                               sizeof(mjs_value_t*) * (block + 1));
+        if (!new_blocks) return NULL;
+        ctx->handle_blocks = new_blocks;
+        
+        new_blocks[block] = MJS_MALLOC(sizeof(mjs_value_t) * MJS_HANDLE_BLOCK_SIZE);
+        if (!new_blocks[block]) return NULL;
+        ctx->handle_block_count = block + 1;
+    }
+    
+    mjs_value_t* handle = &ctx->handle_blocks[block][ctx->handle_count % MJS_HANDLE_BLOCK_SIZE];
+    *handle = value;
+    ctx->handle_count++;
+    return handle;
+}
+
+/* Persistent handles */
+mjs_persistent_t mjs_persistent_new(mjs_context_t* ctx, mjs_value_t value) {
+    if (!ctx) return 0;
+    
+    mjs_runtime_t* rt = ctx->runtime;
+    if (rt->persistent_free == 0) {
+        size_t old_capacity = rt->persistent_capacity;
+        size_t new_capacity = old_capacity == 0 ? 64 : old_capacity * 2;
+        mjs_persistent_slot_t* new_slots = MJS_REALLOC(rt->persistents,
+                                                       sizeof(mjs_persistent_slot_t) * new_capacity);
+        if (!new_slots) return 0;
+        
+        // Chain the new slots onto the free list in index order
+        for (size_t i = old_capacity; i < new_capacity; i++) {
+            new_slots[i].value = mjs_undefined();
+            new_slots[i].in_use = false;
+            new_slots[i].next_free = i + 1 < new_capacity ? i + 2 : 0;
+        }
+        rt->persistents = new_slots;
+        rt->persistent_capacity = new_capacity;
+        rt->persistent_free = old_capacity + 1;
+    }
+    
+    mjs_persistent_t handle = rt->persistent_free;
+    mjs_persistent_slot_t* slot = &rt->persistents[handle - 1];
+    rt->persistent_free = slot->next_free;
+    slot->value = value;
+    slot->in_use = true;
+    slot->next_free = 0;
+    return handle;
+}
+
+static mjs_persistent_slot_t* persistent_slot(mjs_context_t* ctx, mjs_persistent_t handle) {
+    if (!ctx || handle == 0 || handle > ctx->runtime->persistent_capacity) return NULL;
+    
+    mjs_persistent_slot_t* slot = &ctx->runtime->persistents[handle - 1];
+    return slot->in_use ? slot : NULL;
+}
+
+mjs_value_t mjs_persistent_get(mjs_context_t* ctx, mjs_persistent_t handle) {
+    mjs_persistent_slot_t* slot = persistent_slot(ctx, handle);
+    return slot ? slot->value : mjs_undefined();
+}
+
+void mjs_persistent_set(mjs_context_t* ctx, mjs_persistent_t handle, mjs_value_t value) {
+    mjs_persistent_slot_t* slot = persistent_slot(ctx, handle);
+    if (slot) {
+        slot->value = value;
+    }
+}
+
+void mjs_persistent_release(mjs_context_t* ctx, mjs_persistent_t handle) {
+    mjs_persistent_slot_t* slot = persistent_slot(ctx, handle);
+    if (!slot) return;
+    
+    slot->value = mjs_undefined();
+    slot->in_use = false;
+    slot->next_free = ctx->runtime->persistent_free;
+    ctx->runtime->persistent_free = handle;
+}
+
+/* Weak maps are ephemeron tables keyed by the object pointer */
+static void* weak_map_key(mjs_value_t key) {
+    switch (key.tag) {
+        case MJS_TAG_OBJECT:
+        case MJS_TAG_ARRAY:
+        case MJS_TAG_FUNCTION:
+            return key.u.ptr;
+        default:
+            return NULL;
+    }
+}
+
+mjs_weak_map_t* mjs_weak_map_new(mjs_context_t* ctx) {
+    if (!ctx || !ctx->runtime) return NULL;
+    return mjs_gc_create_ephemeron_table(ctx->runtime->gc);
+}
+
+void mjs_weak_map_free(mjs_weak_map_t* map) {
+    mjs_gc_destroy_ephemeron_table(map);
+}
+
+bool mjs_weak_map_set(mjs_weak_map_t* map, mjs_value_t key, mjs_value_t value) {
+    void* object = weak_map_key(key);
+    return object && mjs_ephemeron_table_set(map, object, value);
+}
+
+bool mjs_weak_map_get(mjs_weak_map_t* map, mjs_value_t key, mjs_value_t* value) {
+    void* object = weak_map_key(key);
+    return object && mjs_ephemeron_table_get(map, object, value);
+}
+
+bool mjs_weak_map_has(mjs_weak_map_t* map, mjs_value_t key) {
+    return mjs_weak_map_get(map, key, NULL);
+}
+
+bool mjs_weak_map_delete(mjs_weak_map_t* map, mjs_value_t key) {
+    void* object = weak_map_key(key);
+    return object && mjs_ephemeron_table_delete(map, object);
+}
+
 /* Value creation */
 mjs_value_t mjs_undefined(void) {
     mjs_value_t value;
@@ -283,7 +480,8 @@ const char* mjs_to_string(mjs_context_t* ctx, mjs_value_t value) {
             return value.u.boolean ? "true" : "false";
         case MJS_TAG_NUMBER: {
             // TODO: Implement proper number to string conversion
-            static char buffer[32];
+            // Per thread, so runtimes on other threads never share it
+            static MJS_THREAD_LOCAL char buffer[32];
             snprintf(buffer, sizeof(buffer), "%.15g", value.u.number);
             return buffer;
         }
@@ -441,14 +639,17 @@ bool mjs_context_get_variable(mjs_context_t* ctx, const char* name, mjs_value_t*
         return false;
     }
     
-    // Search through properties linked list
-    mjs_property_t* prop = global->properties;
-    while (prop) {
-        if (prop->key && prop->key->data && strcmp(prop->key->data, name) == 0) {
-            *value = prop->value;
-            return true;
+    // Search through properties linked list, then the prototype chain
+    // holding the shared builtins
+    for (; global; global = global->prototype) {
+        mjs_property_t* prop = global->properties;
+        while (prop) {
+            if (prop->key && prop->key->data && strcmp(prop->key->data, name) == 0) {
+                *value = prop->value;
+                return true;
+            }
+            prop = prop->next;
         }
-        prop = prop->next;
     }
     
     *value = mjs_undefined();
@@ -466,7 +667,11 @@ bool mjs_context_set_variable(mjs_context_t* ctx, const char* name, mjs_value_t
     mjs_property_t* prop = global->properties;
     while (prop) {
         if (prop->key && prop->key->data && strcmp(prop->key->data, name) == 0) {
+            bool heap_locked = mjs_gc_lock_heap(ctx->runtime->gc);
+            MJS_GC_DELETION_BARRIER_VALUE(ctx->runtime->gc, prop->value);
+            MJS_GC_WRITE_BARRIER_VALUE(ctx->runtime->gc, global, value);
             prop->value = value;
+            mjs_gc_unlock_heap(ctx->runtime->gc, heap_locked);
             return true;
         }
         prop = prop->next;
@@ -477,13 +682,18 @@ bool mjs_context_set_variable(mjs_context_t* ctx, const char* name, mjs_value_t
     if (!new_prop) return false;
     
     new_prop->key = mjs_string_new(ctx, name, strlen(name));
+    MJS_GC_WRITE_BARRIER(ctx->runtime->gc, global, new_prop->key);
+    MJS_GC_WRITE_BARRIER_VALUE(ctx->runtime->gc, global, value);
     new_prop->value = value;
     new_prop->writable = true;
     new_prop->enumerable = true;
     new_prop->configurable = true;
+    
+    bool heap_locked = mjs_gc_lock_heap(ctx->runtime->gc);
     new_prop->next = global->properties;
     global->properties = new_prop;
     global->property_count++;
+    mjs_gc_unlock_heap(ctx->runtime->gc, heap_locked);
     
     return true;
 }
@@ -552,6 +762,83 @@ mjs_result_t mjs_eval_file(mjs_context_t* ctx, const char* filename, mjs_value_t
 void mjs_gc(mjs_context_t* ctx) {
     if (!ctx || !ctx->runtime || !ctx->runtime->gc) return;
     mjs_gc_collect(ctx->runtime->gc);
+    mjs_gc_finish_sweeping(ctx->runtime->gc);
+}
+
+void mjs_set_memory_limit(mjs_runtime_t* rt, size_t limit) {
+    if (!rt) return;
+    rt->memory_limit = limit;
+    mjs_gc_set_memory_limit(rt->gc, limit);
+}
+
+bool mjs_region_begin(mjs_context_t* ctx) {
+    if (!ctx || !ctx->runtime) return false;
+    return mjs_gc_region_begin(ctx->runtime->gc);
+}
+
+bool mjs_region_end(mjs_context_t* ctx) {
+    if (!ctx || !ctx->runtime) return false;
+    return mjs_gc_region_end(ctx->runtime->gc);
+}
+
+uint64_t mjs_now_us(void) {
+    return mjs_gc_now_us();
+}
+
+bool mjs_idle_notification(mjs_runtime_t* rt, uint64_t deadline_us) {
+    if (!rt || !rt->gc) return true;
+    return mjs_gc_idle_notification(rt->gc, deadline_us);
+}
+
+void mjs_memory_pressure(mjs_runtime_t* rt, mjs_memory_pressure_t level) {
+    if (!rt || !rt->gc || level == MJS_MEMORY_PRESSURE_NONE) return;
+    
+    // Handle blocks beyond the open scopes' needs are a per-context cache
+    for (mjs_context_t* ctx = rt->contexts; ctx; ctx = ctx->next_context) {
+        size_t keep = (ctx->handle_count + MJS_HANDLE_BLOCK_SIZE - 1) / MJS_HANDLE_BLOCK_SIZE;
+        while (ctx->handle_block_count > keep) {
+            MJS_FREE(ctx->handle_blocks[--ctx->handle_block_count]);
+        }
+    }
+    
+    mjs_gc_memory_pressure(rt->gc, level);
+}
+
+bool mjs_write_heap_snapshot(mjs_runtime_t* rt, const char* path) {
+    if (!rt || !rt->gc || !path) return false;
+    
+    mjs_heap_snapshot_t* snapshot = mjs_heap_snapshot_take(rt->gc);
+    if (!snapshot) return false;
+    
+    FILE* file = fopen(path, "w");
+    bool ok = file && mjs_heap_snapshot_write(snapshot, file);
+    if (file && fclose(file) != 0) {
+        ok = false;
+    }
+    
+    mjs_heap_snapshot_free(snapshot);
+    return ok;
+}
+
+bool mjs_start_allocation_sampling(mjs_runtime_t* rt, size_t interval_bytes) {
+    if (!rt || !rt->gc) return false;
+    return mjs_alloc_profiler_start(rt->gc, interval_bytes);
+}
+
+void mjs_stop_allocation_sampling(mjs_runtime_t* rt) {
+    if (!rt || !rt->gc) return;
+    mjs_alloc_profiler_stop(rt->gc);
+}
+
+bool mjs_write_allocation_profile(mjs_runtime_t* rt, const char* path, bool live_only) {
+    if (!rt || !rt->gc || !rt->gc->alloc_profiler || !path) return false;
+    
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+    
+    bool ok = mjs_alloc_profiler_write_folded(rt->gc->alloc_profiler, file, live_only);
+    ok = fclose(file) == 0 && ok;
+    return ok;
 }
 
 size_t mjs_get_memory_usage(mjs_context_t* ctx) {
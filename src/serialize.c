@@ -0,0 +1,636 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Structured Clone Serializer
+ * Single pass binary writer and reader for value graphs
+ */
+
+#include "serialize.h"
+#include "gc.h"
+#include <math.h>
+
+/* Open-addressed table from an object's address, or a string's contents,
+ * to the number it was first written under */
+typedef struct {
+    const void* key;
+    size_t length;                /* string byte length; 0 for objects */
+    size_t hash;
+    size_t index;
+} serialize_slot_t;
+
+typedef struct {
+    serialize_slot_t* slots;
+    size_t capacity;              /* power of two, or 0 */
+    size_t count;
+} serialize_table_t;
+
+typedef struct {
+    mjs_context_t* ctx;
+    uint8_t* data;
+    size_t length;
+    size_t capacity;
+    serialize_table_t objects;
+    serialize_table_t strings;
+    size_t depth;
+    mjs_result_t error;
+    const char* message;
+} serializer_t;
+
+typedef struct {
+    mjs_context_t* ctx;
+    mjs_gc_t* gc;
+    const uint8_t* pos;
+    const uint8_t* end;
+    mjs_value_t* objects;         /* objects and arrays by index */
+    size_t object_count;
+    size_t object_capacity;
+    mjs_string_t** strings;       /* strings by index */
+    size_t string_count;
+    size_t string_capacity;
+    size_t roots;                 /* pushed on the GC root stack */
+    size_t depth;
+    mjs_result_t error;
+    const char* message;
+} deserializer_t;
+
+static size_t serialize_hash_pointer(const void* ptr) {
+    uint64_t hash = (uint64_t)(uintptr_t)ptr;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return (size_t)hash;
+}
+
+static size_t serialize_hash_bytes(const char* data, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return (size_t)hash;
+}
+
+static bool serialize_table_grow(serialize_table_t* table) {
+    size_t new_capacity = table->capacity == 0 ? 64 : table->capacity * 2;
+    serialize_slot_t* new_slots = MJS_CALLOC(new_capacity, sizeof(serialize_slot_t));
+    if (!new_slots) return false;
+    
+    for (size_t i = 0; i < table->capacity; i++) {
+        serialize_slot_t* slot = &table->slots[i];
+        if (!slot->key) continue;
+        
+        size_t j = slot->hash & (new_capacity - 1);
+        while (new_slots[j].key) {
+            j = (j + 1) & (new_capacity - 1);
+        }
+        new_slots[j] = *slot;
+    }
+    
+    MJS_FREE(table->slots);
+    table->slots = new_slots;
+    table->capacity = new_capacity;
+    return true;
+}
+
+/* Look a key up, numbering it next if it is new. Strings match by
+ * contents, objects by address. */
+static bool serialize_table_intern(serialize_table_t* table, const void* key, size_t length,
+                                   bool is_string, size_t* index, bool* found) {
+    if ((table->count + 1) * 4 > table->capacity * 3) {
+        if (!serialize_table_grow(table)) return false;
+    }
+    
+    size_t hash = is_string ? serialize_hash_bytes(key, length) : serialize_hash_pointer(key);
+    size_t i = hash & (table->capacity - 1);
+    for (serialize_slot_t* slot = &table->slots[i]; slot->key;
+         i = (i + 1) & (table->capacity - 1), slot = &table->slots[i]) {
+        if (slot->hash != hash) continue;
+        
+        if (is_string ? (slot->length == length && memcmp(slot->key, key, length) == 0)
+                      : slot->key == key) {
+            *index = slot->index;
+            *found = true;
+            return true;
+        }
+    }
+    
+    serialize_slot_t* slot = &table->slots[i];
+    slot->key = key;
+    slot->length = length;
+    slot->hash = hash;
+    slot->index = table->count++;
+    *index = slot->index;
+    *found = false;
+    return true;
+}
+
+static bool serializer_fail(serializer_t* s, mjs_result_t error, const char* message) {
+    s->error = error;
+    s->message = message;
+    return false;
+}
+
+static bool serializer_reserve(serializer_t* s, size_t extra) {
+    if (s->capacity - s->length >= extra) return true;
+    
+    size_t new_capacity = s->capacity == 0 ? 256 : s->capacity * 2;
+    if (new_capacity < s->length + extra) {
+        new_capacity = s->length + extra;
+    }
+    
+    uint8_t* new_data = MJS_REALLOC(s->data, new_capacity);
+    if (!new_data) return serializer_fail(s, MJS_ERROR_MEMORY, "Out of memory serializing value");
+    
+    s->data = new_data;
+    s->capacity = new_capacity;
+    return true;
+}
+
+static bool serializer_write_byte(serializer_t* s, uint8_t byte) {
+    if (!serializer_reserve(s, 1)) return false;
+    s->data[s->length++] = byte;
+    return true;
+}
+
+static bool serializer_write_varint(serializer_t* s, uint64_t value) {
+    if (!serializer_reserve(s, 10)) return false;
+    
+    while (value >= 0x80) {
+        s->data[s->length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    s->data[s->length++] = (uint8_t)value;
+    return true;
+}
+
+static bool serializer_write_tagged(serializer_t* s, uint8_t tag, uint64_t value) {
+    return serializer_write_byte(s, tag) && serializer_write_varint(s, value);
+}
+
+static bool serializer_write_number(serializer_t* s, double number) {
+    // Integers, by far the most common numbers, take a byte or two rather
+    // than eight; -0 and anything past 2^53 keep their exact bits
+    if (number >= -9007199254740992.0 && number <= 9007199254740992.0 &&
+        number == (double)(int64_t)number && !(number == 0 && signbit(number))) {
+        int64_t integer = (int64_t)number;
+        uint64_t zigzag = integer < 0 ? ~((uint64_t)integer << 1) : (uint64_t)integer << 1;
+        return serializer_write_tagged(s, MJS_SERIALIZE_INT, zigzag);
+    }
+    
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    if (!serializer_write_byte(s, MJS_SERIALIZE_DOUBLE) || !serializer_reserve(s, 8)) return false;
+    
+    for (int i = 0; i < 8; i++) {
+        s->data[s->length++] = (uint8_t)(bits >> (i * 8));
+    }
+    return true;
+}
+
+static bool serializer_write_string(serializer_t* s, const mjs_string_t* str) {
+    if (!str || (!str->data && str->length > 0)) {
+        return serializer_fail(s, MJS_ERROR_TYPE, "Invalid string in cloned value");
+    }
+    
+    // Repeated strings, property names above all, are written once
+    const char* data = str->data ? str->data : "";
+    size_t index;
+    bool found;
+    if (!serialize_table_intern(&s->strings, data, str->length, true, &index, &found)) {
+        return serializer_fail(s, MJS_ERROR_MEMORY, "Out of memory serializing value");
+    }
+    
+    if (found) {
+        return serializer_write_tagged(s, MJS_SERIALIZE_STRING_REF, index);
+    }
+    
+    if (!serializer_write_tagged(s, MJS_SERIALIZE_STRING, str->length) ||
+        !serializer_reserve(s, str->length)) {
+        return false;
+    }
+    
+    memcpy(s->data + s->length, data, str->length);
+    s->length += str->length;
+    return true;
+}
+
+static bool serializer_write_value(serializer_t* s, mjs_value_t value);
+
+static bool serializer_write_object(serializer_t* s, mjs_object_t* obj) {
+    // Own enumerable properties are cloned; prototypes and attributes are not
+    size_t count = 0;
+    for (mjs_property_t* prop = obj->properties; prop; prop = prop->next) {
+        if (prop->key && prop->enumerable) count++;
+    }
+    
+    if (!serializer_write_tagged(s, MJS_SERIALIZE_OBJECT, count)) return false;
+    
+    for (mjs_property_t* prop = obj->properties; prop; prop = prop->next) {
+        if (!prop->key || !prop->enumerable) continue;
+        
+        if (!serializer_write_string(s, prop->key) ||
+            !serializer_write_value(s, prop->value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool serializer_write_array(serializer_t* s, mjs_array_t* arr) {
+    if (!serializer_write_tagged(s, MJS_SERIALIZE_ARRAY, arr->length)) return false;
+    
+    for (size_t i = 0; i < arr->length; i++) {
+        if (!serializer_write_value(s, arr->elements[i])) return false;
+    }
+    return true;
+}
+
+static bool serializer_write_value(serializer_t* s, mjs_value_t value) {
+    switch (value.tag) {
+        case MJS_TAG_UNDEFINED:
+            return serializer_write_byte(s, MJS_SERIALIZE_UNDEFINED);
+        case MJS_TAG_NULL:
+            return serializer_write_byte(s, MJS_SERIALIZE_NULL);
+        case MJS_TAG_BOOLEAN:
+            return serializer_write_byte(s, value.u.boolean ? MJS_SERIALIZE_TRUE : MJS_SERIALIZE_FALSE);
+        case MJS_TAG_NUMBER:
+            return serializer_write_number(s, value.u.number);
+        case MJS_TAG_STRING:
+            return serializer_write_string(s, value.u.string);
+        case MJS_TAG_OBJECT:
+        case MJS_TAG_ARRAY: {
+            if (!value.u.ptr) {
+                return serializer_fail(s, MJS_ERROR_TYPE, "Invalid object in cloned value");
+            }
+            
+            // An object met before, through a cycle or a second path to it,
+            // is written as a reference so the copy shares it the same way
+            size_t index;
+            bool found;
+            if (!serialize_table_intern(&s->objects, value.u.ptr, 0, false, &index, &found)) {
+                return serializer_fail(s, MJS_ERROR_MEMORY, "Out of memory serializing value");
+            }
+            
+            if (found) {
+                return serializer_write_tagged(s, MJS_SERIALIZE_OBJECT_REF, index);
+            }
+            
+            if (s->depth >= MJS_SERIALIZE_MAX_DEPTH) {
+                return serializer_fail(s, MJS_ERROR_RANGE, "Cloned value is nested too deeply");
+            }
+            
+            s->depth++;
+            bool ok = value.tag == MJS_TAG_OBJECT ? serializer_write_object(s, value.u.object)
+                                                  : serializer_write_array(s, value.u.array);
+            s->depth--;
+            return ok;
+        }
+        default:
+            return serializer_fail(s, MJS_ERROR_TYPE, "Value could not be cloned");
+    }
+}
+
+mjs_result_t mjs_serialize(mjs_context_t* ctx, mjs_value_t value, void** data, size_t* length) {
+    if (data) *data = NULL;
+    if (length) *length = 0;
+    if (!ctx || !data || !length) return MJS_ERROR_TYPE;
+    
+    serializer_t s;
+    memset(&s, 0, sizeof(s));
+    s.ctx = ctx;
+    s.error = MJS_OK;
+    
+    bool ok = serializer_write_byte(&s, MJS_SERIALIZE_MAGIC_0) &&
+              serializer_write_byte(&s, MJS_SERIALIZE_MAGIC_1) &&
+              serializer_write_byte(&s, MJS_SERIALIZE_VERSION) &&
+              serializer_write_value(&s, value);
+    
+    MJS_FREE(s.objects.slots);
+    MJS_FREE(s.strings.slots);
+    
+    if (!ok) {
+        MJS_FREE(s.data);
+        mjs_set_error(ctx, s.error, s.message);
+        return s.error;
+    }
+    
+    *data = s.data;
+    *length = s.length;
+    return MJS_OK;
+}
+
+static bool deserializer_fail(deserializer_t* d, mjs_result_t error, const char* message) {
+    d->error = error;
+    d->message = message;
+    return false;
+}
+
+static bool deserializer_truncated(deserializer_t* d) {
+    return deserializer_fail(d, MJS_ERROR_SYNTAX, "Serialized value is truncated");
+}
+
+static bool deserializer_read_byte(deserializer_t* d, uint8_t* byte) {
+    if (d->pos >= d->end) return deserializer_truncated(d);
+    *byte = *d->pos++;
+    return true;
+}
+
+static bool deserializer_read_varint(deserializer_t* d, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t byte;
+        if (!deserializer_read_byte(d, &byte)) return false;
+        
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return deserializer_fail(d, MJS_ERROR_SYNTAX, "Malformed varint in serialized value");
+}
+
+/* Counts are checked against the bytes left, each entry taking at least
+ * min_size of them, so corrupt input cannot ask for huge allocations */
+static bool deserializer_read_count(deserializer_t* d, size_t min_size, size_t* count) {
+    uint64_t value;
+    if (!deserializer_read_varint(d, &value)) return false;
+    
+    if (value > (uint64_t)(d->end - d->pos) / min_size) return deserializer_truncated(d);
+    *count = (size_t)value;
+    return true;
+}
+
+static bool deserializer_grow(deserializer_t* d, void** items, size_t* capacity,
+                              size_t count, size_t item_size) {
+    if (count < *capacity) return true;
+    
+    size_t new_capacity = *capacity == 0 ? 16 : *capacity * 2;
+    void* new_items = MJS_REALLOC(*items, new_capacity * item_size);
+    if (!new_items) return deserializer_fail(d, MJS_ERROR_MEMORY, "Out of memory deserializing value");
+    
+    *items = new_items;
+    *capacity = new_capacity;
+    return true;
+}
+
+/* Everything built stays on the GC root stack until the whole graph is
+ * linked; the roots also pin it, so the tables' raw pointers stay valid */
+static void deserializer_protect(deserializer_t* d, void* obj) {
+    MJS_GC_PROTECT(d->gc, obj);
+    d->roots++;
+}
+
+static bool deserializer_read_string(deserializer_t* d, uint8_t tag, mjs_string_t** result) {
+    if (tag == MJS_SERIALIZE_STRING_REF) {
+        uint64_t index;
+        if (!deserializer_read_varint(d, &index)) return false;
+        
+        if (index >= d->string_count) {
+            return deserializer_fail(d, MJS_ERROR_SYNTAX, "Bad string reference in serialized value");
+        }
+        *result = d->strings[index];
+        return true;
+    }
+    
+    if (tag != MJS_SERIALIZE_STRING) {
+        return deserializer_fail(d, MJS_ERROR_SYNTAX, "Expected a string in serialized value");
+    }
+    
+    size_t length;
+    if (!deserializer_read_count(d, 1, &length)) return false;
+    if (!deserializer_grow(d, (void**)&d->strings, &d->string_capacity,
+                           d->string_count, sizeof(mjs_string_t*))) {
+        return false;
+    }
+    
+    mjs_string_t* str = mjs_string_new(d->ctx, (const char*)d->pos, length);
+    if (!str) return deserializer_fail(d, MJS_ERROR_MEMORY, "Out of memory deserializing value");
+    
+    deserializer_protect(d, str);
+    d->strings[d->string_count++] = str;
+    d->pos += length;
+    *result = str;
+    return true;
+}
+
+static bool deserializer_add_object(deserializer_t* d, mjs_value_t value) {
+    if (!deserializer_grow(d, (void**)&d->objects, &d->object_capacity,
+                           d->object_count, sizeof(mjs_value_t))) {
+        return false;
+    }
+    
+    deserializer_protect(d, value.u.ptr);
+    d->objects[d->object_count++] = value;
+    return true;
+}
+
+static bool deserializer_read_value(deserializer_t* d, mjs_value_t* result);
+
+static bool deserializer_read_object(deserializer_t* d, mjs_value_t* result) {
+    mjs_object_t* obj = mjs_object_new(d->ctx);
+    if (!obj) return deserializer_fail(d, MJS_ERROR_MEMORY, "Out of memory deserializing value");
+    
+    // Numbered before its properties are read so they can refer back to it
+    *result = mjs_value_object(obj);
+    if (!deserializer_add_object(d, *result)) return false;
+    
+    // Each pair is at least a key reference and a one byte value
+    size_t count;
+    if (!deserializer_read_count(d, 3, &count)) return false;
+    
+    // The property count is known up front, so nodes are appended in
+    // order without the duplicate lookup a property store would do
+    mjs_property_t** link = &obj->properties;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t tag;
+        mjs_string_t* key;
+        mjs_value_t value;
+        if (!deserializer_read_byte(d, &tag) ||
+            !deserializer_read_string(d, tag, &key) ||
+            !deserializer_read_value(d, &value)) {
+            return false;
+        }
+        
+        mjs_property_t* prop = MJS_MALLOC(sizeof(mjs_property_t));
+        if (!prop) return deserializer_fail(d, MJS_ERROR_MEMORY, "Out of memory deserializing value");
+        
+        prop->key = key;
+        prop->value = value;
+        prop->writable = true;
+        prop->enumerable = true;
+        prop->configurable = true;
+        prop->next = NULL;
+        
+        MJS_GC_WRITE_BARRIER(d->gc, obj, key);
+        MJS_GC_WRITE_BARRIER_VALUE(d->gc, obj, value);
+        
+        bool heap_locked = mjs_gc_lock_heap(d->gc);
+        *link = prop;
+        obj->property_count++;
+        mjs_gc_unlock_heap(d->gc, heap_locked);
+        link = &prop->next;
+    }
+    return true;
+}
+
+static bool deserializer_read_array(deserializer_t* d, mjs_value_t* result) {
+    size_t length;
+    if (!deserializer_read_count(d, 1, &length)) return false;
+    
+    // Sized exactly once; elements start out undefined
+    mjs_array_t* arr = mjs_array_new(d->ctx, length, sizeof(mjs_value_t));
+    if (!arr) return deserializer_fail(d, MJS_ERROR_MEMORY, "Out of memory deserializing value");
+    
+    arr->length = length;
+    *result = mjs_value_array(arr);
+    if (!deserializer_add_object(d, *result)) return false;
+    
+    for (size_t i = 0; i < length; i++) {
+        mjs_value_t value;
+        if (!deserializer_read_value(d, &value)) return false;
+        
+        MJS_GC_WRITE_BARRIER_VALUE(d->gc, arr, value);
+        bool heap_locked = mjs_gc_lock_heap(d->gc);
+        arr->elements[i] = value;
+        mjs_gc_unlock_heap(d->gc, heap_locked);
+    }
+    return true;
+}
+
+static bool deserializer_read_value(deserializer_t* d, mjs_value_t* result) {
+    uint8_t tag;
+    if (!deserializer_read_byte(d, &tag)) return false;
+    
+    switch (tag) {
+        case MJS_SERIALIZE_UNDEFINED:
+            *result = mjs_value_undefined();
+            return true;
+        case MJS_SERIALIZE_NULL:
+            *result = mjs_value_null();
+            return true;
+        case MJS_SERIALIZE_FALSE:
+        case MJS_SERIALIZE_TRUE:
+            *result = mjs_value_boolean(tag == MJS_SERIALIZE_TRUE);
+            return true;
+        case MJS_SERIALIZE_INT: {
+            uint64_t zigzag;
+            if (!deserializer_read_varint(d, &zigzag)) return false;
+            
+            int64_t integer = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+            *result = mjs_value_number((double)integer);
+            return true;
+        }
+        case MJS_SERIALIZE_DOUBLE: {
+            if (d->end - d->pos < 8) return deserializer_truncated(d);
+            
+            uint64_t bits = 0;
+            for (int i = 0; i < 8; i++) {
+                bits |= (uint64_t)d->pos[i] << (i * 8);
+            }
+            d->pos += 8;
+            
+            double number;
+            memcpy(&number, &bits, sizeof(number));
+            *result = mjs_value_number(number);
+            return true;
+        }
+        case MJS_SERIALIZE_STRING:
+        case MJS_SERIALIZE_STRING_REF: {
+            mjs_string_t* str;
+            if (!deserializer_read_string(d, tag, &str)) return false;
+            
+            *result = mjs_value_string(str);
+            return true;
+        }
+        case MJS_SERIALIZE_OBJECT_REF: {
+            uint64_t index;
+            if (!deserializer_read_varint(d, &index)) return false;
+            
+            if (index >= d->object_count) {
+                return deserializer_fail(d, MJS_ERROR_SYNTAX, "Bad object reference in serialized value");
+            }
+            *result = d->objects[index];
+            return true;
+        }
+        case MJS_SERIALIZE_OBJECT:
+        case MJS_SERIALIZE_ARRAY: {
+            if (d->depth >= MJS_SERIALIZE_MAX_DEPTH) {
+                return deserializer_fail(d, MJS_ERROR_RANGE, "Serialized value is nested too deeply");
+            }
+            
+            d->depth++;
+            bool ok = tag == MJS_SERIALIZE_OBJECT ? deserializer_read_object(d, result)
+                                                  : deserializer_read_array(d, result);
+            d->depth--;
+            return ok;
+        }
+        default:
+            return deserializer_fail(d, MJS_ERROR_SYNTAX, "Unknown tag in serialized value");
+    }
+}
+
+mjs_result_t mjs_deserialize(mjs_context_t* ctx, const void* data, size_t length, mjs_value_t* result) {
+    if (result) *result = mjs_undefined();
+    if (!ctx || !data || !result) return MJS_ERROR_TYPE;
+    
+    const uint8_t* bytes = data;
+    if (length < MJS_SERIALIZE_HEADER_SIZE ||
+        bytes[0] != MJS_SERIALIZE_MAGIC_0 || bytes[1] != MJS_SERIALIZE_MAGIC_1) {
+        mjs_set_error(ctx, MJS_ERROR_SYNTAX, "Not a serialized value");
+        return MJS_ERROR_SYNTAX;
+    }
+    
+    if (bytes[2] != MJS_SERIALIZE_VERSION) {
+        mjs_set_error(ctx, MJS_ERROR_SYNTAX, "Unsupported serialized value version");
+        return MJS_ERROR_SYNTAX;
+    }
+    
+    deserializer_t d;
+    memset(&d, 0, sizeof(d));
+    d.ctx = ctx;
+    d.gc = ctx->runtime->gc;
+    d.pos = bytes + MJS_SERIALIZE_HEADER_SIZE;
+    d.end = bytes + length;
+    d.error = MJS_OK;
+    
+    mjs_value_t value = mjs_value_undefined();
+    bool ok = deserializer_read_value(&d, &value);
+    if (ok && d.pos != d.end) {
+        ok = deserializer_fail(&d, MJS_ERROR_SYNTAX, "Trailing bytes after serialized value");
+    }
+    
+    for (size_t i = 0; i < d.roots; i++) {
+        MJS_GC_UNPROTECT(d.gc);
+    }
+    MJS_FREE(d.objects);
+    MJS_FREE(d.strings);
+    
+    if (!ok) {
+        mjs_set_error(ctx, d.error, d.message);
+        return d.error;
+    }
+    
+    *result = value;
+    return MJS_OK;
+}
@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Structured Clone Serializer
+ * Compact binary encoding of value graphs for messages and caches
+ */
+
+#ifndef MIKOJS_SERIALIZE_H
+#define MIKOJS_SERIALIZE_H
+
+#include "mikojs_internal.h"
+
+/* Every buffer starts with the magic bytes and the format version */
+#define MJS_SERIALIZE_MAGIC_0 'M'
+#define MJS_SERIALIZE_MAGIC_1 'J'
+#define MJS_SERIALIZE_VERSION 1
+#define MJS_SERIALIZE_HEADER_SIZE 3
+
+/* Objects and arrays nested deeper than this are refused */
+#define MJS_SERIALIZE_MAX_DEPTH 1024
+
+/* One byte tags. Lengths, counts and indices that follow them are
+ * unsigned LEB128 varints; integers are zigzag varints and other numbers
+ * eight little-endian bytes. Objects and arrays are numbered in the order
+ * they are first written, strings likewise, and a later occurrence of
+ * either is written as a reference to that number, which is how cycles
+ * and shared substructure survive the round trip. */
+typedef enum {
+    MJS_SERIALIZE_UNDEFINED = 0x00,
+    MJS_SERIALIZE_NULL = 0x01,
+    MJS_SERIALIZE_FALSE = 0x02,
+    MJS_SERIALIZE_TRUE = 0x03,
+    MJS_SERIALIZE_INT = 0x04,          /* zigzag varint, integral doubles within 2^53 */
+    MJS_SERIALIZE_DOUBLE = 0x05,       /* 8 bytes */
+    MJS_SERIALIZE_STRING = 0x06,       /* varint byte length, bytes */
+    MJS_SERIALIZE_STRING_REF = 0x07,   /* varint string index */
+    MJS_SERIALIZE_OBJECT = 0x08,       /* varint count, count (key string, value) pairs */
+    MJS_SERIALIZE_ARRAY = 0x09,        /* varint length, length values */
+    MJS_SERIALIZE_OBJECT_REF = 0x0a    /* varint object index */
+    /* 0x10-0x13 are held for BigInt, typed arrays, Map and Set */
+} mjs_serialize_tag_t;
+
+#endif /* MIKOJS_SERIALIZE_H */
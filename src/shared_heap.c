@@ -0,0 +1,288 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Shared Heap
+ * Process-wide read-only builtins, atoms and library bytecode
+ */
+
+#include "shared_heap.h"
+#include "gc.h"
+#include "thread.h"
+#include "vm.h"
+
+#define SHARED_ATOM_INITIAL_CAPACITY 256
+
+/* FNV-1a */
+static size_t shared_atom_hash(const char* data, size_t length) {
+    size_t hash = (size_t)14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= (size_t)1099511628211ULL;
+    }
+    return hash;
+}
+
+/* The atom's slot, or the free slot it would take */
+static mjs_string_t** shared_atom_slot(mjs_string_t** atoms, size_t capacity,
+                                       const char* data, size_t length) {
+    size_t i = shared_atom_hash(data, length) & (capacity - 1);
+    while (atoms[i]) {
+        if (atoms[i]->length == length && memcmp(atoms[i]->data, data, length) == 0) {
+            return &atoms[i];
+        }
+        i = (i + 1) & (capacity - 1);
+    }
+    return &atoms[i];
+}
+
+static bool shared_atom_grow(mjs_shared_heap_t* heap) {
+    size_t capacity = heap->atom_capacity ? heap->atom_capacity * 2 : SHARED_ATOM_INITIAL_CAPACITY;
+    mjs_string_t** atoms = MJS_CALLOC(capacity, sizeof(mjs_string_t*));
+    if (!atoms) return false;
+    
+    for (size_t i = 0; i < heap->atom_capacity; i++) {
+        mjs_string_t* atom = heap->atoms[i];
+        if (atom) {
+            *shared_atom_slot(atoms, capacity, atom->data, atom->length) = atom;
+        }
+    }
+    
+    MJS_FREE(heap->atoms);
+    heap->atoms = atoms;
+    heap->atom_capacity = capacity;
+    return true;
+}
+
+static mjs_string_t* shared_atom_intern(mjs_shared_heap_t* heap, const char* data, size_t length) {
+    mjs_string_t* atom = mjs_shared_heap_find_atom(heap, data, length);
+    if (atom) return atom;
+    
+    if ((heap->atom_count + 1) * 2 > heap->atom_capacity && !shared_atom_grow(heap)) {
+        return NULL;
+    }
+    
+    atom = MJS_GC_ALLOC(heap->gc, mjs_string_t, GC_TYPE_STRING);
+    if (!atom) return NULL;
+    
+    atom->data = MJS_MALLOC(length + 1);
+    if (!atom->data) {
+        MJS_GC_FREE(heap->gc, atom);
+        return NULL;
+    }
+    memcpy(atom->data, data, length);
+    atom->data[length] = '\0';
+    atom->length = length;
+    atom->capacity = length + 1;
+    atom->is_interned = true;
+    
+    *shared_atom_slot(heap->atoms, heap->atom_capacity, data, length) = atom;
+    heap->atom_count++;
+    return atom;
+}
+
+/* Builder calls are refused once the heap is sealed */
+static bool shared_heap_building(mjs_shared_heap_t* heap) {
+    return heap && !mjs_atomic_load_int(&heap->sealed);
+}
+
+/* Shared objects may only refer to primitives and each other */
+static bool shared_heap_holds(mjs_shared_heap_t* heap, mjs_value_t value) {
+    switch (value.tag) {
+        case MJS_TAG_STRING:
+        case MJS_TAG_OBJECT:
+        case MJS_TAG_FUNCTION:
+        case MJS_TAG_ARRAY:
+            return mjs_gc_is_valid_object(heap->gc, value.u.ptr);
+        default:
+            return true;
+    }
+}
+
+mjs_string_t* mjs_shared_heap_find_atom(mjs_shared_heap_t* heap, const char* data, size_t length) {
+    if (!heap || !data || heap->atom_count == 0) return NULL;
+    return *shared_atom_slot(heap->atoms, heap->atom_capacity, data, length);
+}
+
+bool mjs_shared_heap_add_library(mjs_shared_heap_t* heap, const char* name, mjs_bytecode_t* bytecode) {
+    if (!shared_heap_building(heap) || !name || !bytecode || mjs_shared_heap_library(heap, name)) {
+        return false;
+    }
+    
+    mjs_shared_library_t* library = MJS_MALLOC(sizeof(mjs_shared_library_t));
+    if (!library) return false;
+    
+    library->name = MJS_STRDUP(name);
+    if (!library->name) {
+        MJS_FREE(library);
+        return false;
+    }
+    library->bytecode = bytecode;
+    library->next = heap->libraries;
+    heap->libraries = library;
+    return true;
+}
+
+mjs_bytecode_t* mjs_shared_heap_library(mjs_shared_heap_t* heap, const char* name) {
+    if (!heap || !name) return NULL;
+    
+    for (mjs_shared_library_t* library = heap->libraries; library; library = library->next) {
+        if (MJS_STREQ(library->name, name)) {
+            return library->bytecode;
+        }
+    }
+    return NULL;
+}
+
+void mjs_shared_heap_release(mjs_shared_heap_t* heap) {
+    if (!heap || mjs_atomic_fetch_add_size(&heap->references, (size_t)-1) != 1) return;
+    
+    while (heap->libraries) {
+        mjs_shared_library_t* next = heap->libraries->next;
+        mjs_bytecode_free(heap->libraries->bytecode);
+        MJS_FREE(heap->libraries->name);
+        MJS_FREE(heap->libraries);
+        heap->libraries = next;
+    }
+    
+    // The heap's own teardown frees every shared object
+    mjs_gc_free(heap->gc);
+    MJS_FREE(heap->atoms);
+    MJS_FREE(heap);
+}
+
+/* Public API */
+mjs_shared_heap_t* mjs_new_shared_heap(void) {
+    mjs_shared_heap_t* heap = MJS_CALLOC(1, sizeof(mjs_shared_heap_t));
+    if (!heap) return NULL;
+    
+    heap->references = 1;
+    heap->gc = mjs_gc_new(NULL);
+    if (!heap->gc) {
+        MJS_FREE(heap);
+        return NULL;
+    }
+    
+    // Everything allocated is kept; the budget is never spent
+    heap->gc->allocation_budget = SIZE_MAX;
+    
+    heap->globals = MJS_GC_ALLOC(heap->gc, mjs_object_t, GC_TYPE_OBJECT);
+    if (!heap->globals || !shared_atom_grow(heap)) {
+        mjs_shared_heap_release(heap);
+        return NULL;
+    }
+    heap->globals->extensible = true;
+    
+    return heap;
+}
+
+void mjs_free_shared_heap(mjs_shared_heap_t* heap) {
+    mjs_shared_heap_release(heap);
+}
+
+mjs_value_t mjs_shared_atom(mjs_shared_heap_t* heap, const char* str) {
+    if (!shared_heap_building(heap) || !str) return mjs_undefined();
+    
+    mjs_string_t* atom = shared_atom_intern(heap, str, strlen(str));
+    return atom ? mjs_value_string(atom) : mjs_undefined();
+}
+
+mjs_value_t mjs_shared_object(mjs_shared_heap_t* heap) {
+    if (!shared_heap_building(heap)) return mjs_undefined();
+    
+    mjs_object_t* obj = MJS_GC_ALLOC(heap->gc, mjs_object_t, GC_TYPE_OBJECT);
+    if (!obj) return mjs_undefined();
+    
+    obj->extensible = true;
+    return mjs_value_object(obj);
+}
+
+mjs_value_t mjs_shared_function(mjs_shared_heap_t* heap, const char* name, mjs_native_function_t func) {
+    if (!shared_heap_building(heap) || !func) return mjs_undefined();
+    
+    mjs_string_t* atom = name ? shared_atom_intern(heap, name, strlen(name)) : NULL;
+    if (name && !atom) return mjs_undefined();
+    
+    mjs_function_t* function = MJS_GC_ALLOC(heap->gc, mjs_function_t, GC_TYPE_FUNCTION);
+    if (!function) return mjs_undefined();
+    
+    function->type = MJS_FUNCTION_NATIVE;
+    function->u.native = func;
+    function->name = atom;
+    
+    mjs_value_t value;
+    value.tag = MJS_TAG_FUNCTION;
+    value.u.function = function;
+    return value;
+}
+
+bool mjs_shared_set_property(mjs_shared_heap_t* heap, mjs_value_t object, const char* key, mjs_value_t value) {
+    if (!shared_heap_building(heap) || !key || object.tag != MJS_TAG_OBJECT ||
+        !shared_heap_holds(heap, object) || !shared_heap_holds(heap, value)) {
+        return false;
+    }
+    
+    mjs_object_t* obj = object.u.object;
+    mjs_property_t* prop = mjs_object_get_property(obj, key);
+    if (prop) {
+        prop->value = value;
+        return true;
+    }
+    
+    mjs_string_t* atom = shared_atom_intern(heap, key, strlen(key));
+    if (!atom) return false;
+    
+    prop = MJS_MALLOC(sizeof(mjs_property_t));
+    if (!prop) return false;
+    
+    prop->key = atom;
+    prop->value = value;
+    prop->writable = true;
+    prop->enumerable = true;
+    prop->configurable = true;
+    prop->next = obj->properties;
+    obj->properties = prop;
+    obj->property_count++;
+    return true;
+}
+
+bool mjs_shared_define_global(mjs_shared_heap_t* heap, const char* name, mjs_value_t value) {
+    if (!heap) return false;
+    return mjs_shared_set_property(heap, mjs_value_object(heap->globals), name, value);
+}
+
+void mjs_shared_heap_seal(mjs_shared_heap_t* heap) {
+    if (heap) {
+        mjs_atomic_store_int(&heap->sealed, 1);
+    }
+}
+
+bool mjs_runtime_attach_shared_heap(mjs_runtime_t* rt, mjs_shared_heap_t* heap) {
+    if (!rt || !heap || rt->shared_heap || rt->contexts || !mjs_atomic_load_int(&heap->sealed)) {
+        return false;
+    }
+    
+    mjs_atomic_fetch_add_size(&heap->references, 1);
+    rt->shared_heap = heap;
+    rt->gc->shared = heap->gc;
+    return true;
+}
@@ -0,0 +1,59 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Shared Heap
+ * Process-wide read-only builtins, atoms and library bytecode
+ */
+
+#ifndef MIKOJS_SHARED_HEAP_H
+#define MIKOJS_SHARED_HEAP_H
+
+#include "mikojs_internal.h"
+
+/* Precompiled library code, shared as is: bytecode holds no heap references */
+typedef struct mjs_shared_library {
+    struct mjs_shared_library* next;
+    char* name;
+    mjs_bytecode_t* bytecode;
+} mjs_shared_library_t;
+
+/* Objects live in a heap of their own that never collects. Once sealed
+ * nothing in it changes, so runtimes on any thread read it without
+ * locking; each attached runtime and the creator hold a reference. */
+struct mjs_shared_heap {
+    struct mjs_gc* gc;
+    mjs_object_t* globals;        /* prototype of attached contexts' global objects */
+    mjs_string_t** atoms;         /* open addressing, NULL marks a free slot */
+    size_t atom_count;
+    size_t atom_capacity;
+    mjs_shared_library_t* libraries;
+    volatile int sealed;
+    volatile size_t references;
+};
+
+mjs_string_t* mjs_shared_heap_find_atom(mjs_shared_heap_t* heap, const char* data, size_t length);
+bool mjs_shared_heap_add_library(mjs_shared_heap_t* heap, const char* name, mjs_bytecode_t* bytecode);
+mjs_bytecode_t* mjs_shared_heap_library(mjs_shared_heap_t* heap, const char* name);
+void mjs_shared_heap_release(mjs_shared_heap_t* heap);
+
+#endif /* MIKOJS_SHARED_HEAP_H */
@@ -27,6 +27,7 @@
 
 #include "mikojs_internal.h"
 #include "gc.h"
+#include "shared_heap.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -60,6 +61,8 @@ mjs_string_t* mjs_string_new(mjs_context_t* ctx, const char* data, size_t length
     str->data[length] = '\0';
     str->is_interned = false;
     str->next = NULL;
+    str->data_owner = NULL;
+    str->data_shared = false;
     
     return str;
 }
@@ -67,6 +70,10 @@ mjs_string_t* mjs_string_new(mjs_context_t* ctx, const char* data, size_t length
 mjs_string_t* mjs_string_intern(mjs_context_t* ctx, const char* data, size_t length) {
     if (!ctx || !data) return NULL;
     
+    // Atoms of a shared heap are the same string in every runtime
+    mjs_string_t* atom = mjs_shared_heap_find_atom(ctx->runtime->shared_heap, data, length);
+    if (atom) return atom;
+    
     // Check if string is already interned
     mjs_string_t* current = ctx->runtime->string_table;
     while (current) {
@@ -80,6 +87,8 @@ mjs_string_t* mjs_string_intern(mjs_context_t* ctx, const char* data, size_t len
     mjs_string_t* str = mjs_string_new(ctx, data, length);
     if (!str) return NULL;
     
+    // The string table is global state; the string outlives any region
+    MJS_GC_WRITE_BARRIER(ctx->runtime->gc, NULL, str);
     str->is_interned = true;
     str->next = ctx->runtime->string_table;
     ctx->runtime->string_table = str;
@@ -90,7 +99,8 @@ mjs_string_t* mjs_string_intern(mjs_context_t* ctx, const char* data, size_t len
 void mjs_string_free(mjs_string_t* str) {
     if (!str) return;
     
-    if (str->data) {
+    // A deduplicated string shares its owner's characters
+    if (str->data && !str->data_owner) {
         MJS_FREE(str->data);
     }
     
@@ -134,6 +144,8 @@ mjs_string_t* mjs_string_concat(mjs_context_t* ctx, const mjs_string_t* a, const
     result->data[total_length] = '\0';
     result->is_interned = false;
     result->next = NULL;
+    result->data_owner = NULL;
+    result->data_shared = false;
     
     return result;
 }
@@ -233,7 +245,7 @@ mjs_array_t* mjs_string_split(mjs_context_t* ctx, const mjs_string_t* str, const
     
     if (!separator || separator->length == 0) {
         // Split into individual characters
-        mjs_array_resize(result, str->length);
+        mjs_array_resize(ctx, result, str->length);
         for (size_t i = 0; i < str->length; i++) {
             mjs_string_t* char_str = mjs_string_new(ctx, str->data + i, 1);
             if (char_str) {
@@ -257,7 +269,7 @@ mjs_array_t* mjs_string_split(mjs_context_t* ctx, const mjs_string_t* str, const
             if (start < str->length) {
                 mjs_string_t* part = mjs_string_substring(ctx, str, start, str->length - start);
                 if (part) {
-                    mjs_array_resize(result, result->length + 1);
+                    mjs_array_resize(ctx, result, result->length + 1);
                     mjs_value_t part_value;
                     part_value.tag = MJS_TAG_STRING;
                     part_value.u.string = part;
@@ -270,7 +282,7 @@ mjs_array_t* mjs_string_split(mjs_context_t* ctx, const mjs_string_t* str, const
         // Add substring before separator
         mjs_string_t* part = mjs_string_substring(ctx, str, start, found - start);
         if (part) {
-            mjs_array_resize(result, result->length + 1);
+            mjs_array_resize(ctx, result, result->length + 1);
             mjs_value_t part_value;
             part_value.tag = MJS_TAG_STRING;
             part_value.u.string = part;
@@ -432,6 +444,8 @@ mjs_string_t* mjs_string_escape(mjs_context_t* ctx, const mjs_string_t* str) {
     result->data[pos] = '\0';
     result->is_interned = false;
     result->next = NULL;
+    result->data_owner = NULL;
+    result->data_shared = false;
     
     return result;
 }
\ No newline at end of file
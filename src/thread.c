@@ -0,0 +1,187 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Threading Primitives Implementation
+ */
+
+#include "thread.h"
+#include "trace.h"
+
+#ifndef _WIN32
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+/* Trampoline state: the platform entry signatures differ from ours */
+typedef struct {
+    mjs_thread_func_t func;
+    void* arg;
+} mjs_thread_start_t;
+
+#ifdef _WIN32
+static DWORD WINAPI thread_trampoline(LPVOID param) {
+#else
+static void* thread_trampoline(void* param) {
+#endif
+    mjs_thread_start_t start = *(mjs_thread_start_t*)param;
+    MJS_FREE(param);
+    
+    start.func(start.arg);
+    mjs_trace_thread_exit();
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+/* Threads */
+bool mjs_thread_create(mjs_thread_t* thread, mjs_thread_func_t func, void* arg) {
+    if (!thread || !func) return false;
+    
+    mjs_thread_start_t* start = MJS_MALLOC(sizeof(mjs_thread_start_t));
+    if (!start) return false;
+    
+    start->func = func;
+    start->arg = arg;
+
+#ifdef _WIN32
+    *thread = CreateThread(NULL, 0, thread_trampoline, start, 0, NULL);
+    if (!*thread) {
+        MJS_FREE(start);
+        return false;
+    }
+#else
+    if (pthread_create(thread, NULL, thread_trampoline, start) != 0) {
+        MJS_FREE(start);
+        return false;
+    }
+#endif
+    
+    return true;
+}
+
+void mjs_thread_join(mjs_thread_t thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+void mjs_thread_yield(void) {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+size_t mjs_thread_hardware_concurrency(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (size_t)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t)count : 1;
+#endif
+}
+
+/* Mutexes */
+bool mjs_mutex_init(mjs_mutex_t* mutex) {
+#ifdef _WIN32
+    InitializeCriticalSection(mutex);
+    return true;
+#else
+    return pthread_mutex_init(mutex, NULL) == 0;
+#endif
+}
+
+void mjs_mutex_destroy(mjs_mutex_t* mutex) {
+#ifdef _WIN32
+    DeleteCriticalSection(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+void mjs_mutex_lock(mjs_mutex_t* mutex) {
+#ifdef _WIN32
+    EnterCriticalSection(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+void mjs_mutex_unlock(mjs_mutex_t* mutex) {
+#ifdef _WIN32
+    LeaveCriticalSection(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+/* Condition variables */
+bool mjs_cond_init(mjs_cond_t* cond) {
+#ifdef _WIN32
+    InitializeConditionVariable(cond);
+    return true;
+#else
+    return pthread_cond_init(cond, NULL) == 0;
+#endif
+}
+
+void mjs_cond_destroy(mjs_cond_t* cond) {
+#ifdef _WIN32
+    (void)cond; // Win32 condition variables need no cleanup
+#else
+    pthread_cond_destroy(cond);
+#endif
+}
+
+void mjs_cond_wait(mjs_cond_t* cond, mjs_mutex_t* mutex) {
+#ifdef _WIN32
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+#else
+    pthread_cond_wait(cond, mutex);
+#endif
+}
+
+void mjs_cond_signal(mjs_cond_t* cond) {
+#ifdef _WIN32
+    WakeConditionVariable(cond);
+#else
+    pthread_cond_signal(cond);
+#endif
+}
+
+void mjs_cond_broadcast(mjs_cond_t* cond) {
+#ifdef _WIN32
+    WakeAllConditionVariable(cond);
+#else
+    pthread_cond_broadcast(cond);
+#endif
+}
@@ -0,0 +1,192 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Threading Primitives
+ * Thin portable layer over pthreads / Win32 threads and compiler atomics
+ */
+
+#ifndef MIKOJS_THREAD_H
+#define MIKOJS_THREAD_H
+
+#include "mikojs_internal.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/* Storage class for per-thread variables */
+#ifdef _MSC_VER
+#define MJS_THREAD_LOCAL __declspec(thread)
+#else
+#define MJS_THREAD_LOCAL _Thread_local
+#endif
+
+/* Thread entry point */
+typedef void (*mjs_thread_func_t)(void* arg);
+
+#ifdef _WIN32
+typedef HANDLE mjs_thread_t;
+typedef CRITICAL_SECTION mjs_mutex_t;
+typedef CONDITION_VARIABLE mjs_cond_t;
+#else
+typedef pthread_t mjs_thread_t;
+typedef pthread_mutex_t mjs_mutex_t;
+typedef pthread_cond_t mjs_cond_t;
+#endif
+
+/* Threads */
+bool mjs_thread_create(mjs_thread_t* thread, mjs_thread_func_t func, void* arg);
+void mjs_thread_join(mjs_thread_t thread);
+void mjs_thread_yield(void);
+size_t mjs_thread_hardware_concurrency(void);
+
+/* Mutexes and condition variables */
+bool mjs_mutex_init(mjs_mutex_t* mutex);
+void mjs_mutex_destroy(mjs_mutex_t* mutex);
+void mjs_mutex_lock(mjs_mutex_t* mutex);
+void mjs_mutex_unlock(mjs_mutex_t* mutex);
+
+bool mjs_cond_init(mjs_cond_t* cond);
+void mjs_cond_destroy(mjs_cond_t* cond);
+void mjs_cond_wait(mjs_cond_t* cond, mjs_mutex_t* mutex);
+void mjs_cond_signal(mjs_cond_t* cond);
+void mjs_cond_broadcast(mjs_cond_t* cond);
+
+/* Atomics on plain machine words. Loads acquire, stores release and
+ * read-modify-write operations are sequentially consistent. */
+#ifdef _MSC_VER
+static inline void* mjs_atomic_load_ptr(void* volatile* ptr) {
+    return InterlockedCompareExchangePointer(ptr, NULL, NULL);
+}
+
+static inline void mjs_atomic_store_ptr(void* volatile* ptr, void* value) {
+    InterlockedExchangePointer(ptr, value);
+}
+
+static inline void* mjs_atomic_exchange_ptr(void* volatile* ptr, void* value) {
+    return InterlockedExchangePointer(ptr, value);
+}
+
+static inline bool mjs_atomic_cas_ptr(void* volatile* ptr, void* expected, void* desired) {
+    return InterlockedCompareExchangePointer(ptr, desired, expected) == expected;
+}
+
+static inline size_t mjs_atomic_fetch_add_size(volatile size_t* ptr, size_t value) {
+#ifdef _WIN64
+    return (size_t)InterlockedExchangeAdd64((volatile LONG64*)ptr, (LONG64)value);
+#else
+    return (size_t)InterlockedExchangeAdd((volatile LONG*)ptr, (LONG)value);
+#endif
+}
+
+static inline size_t mjs_atomic_load_size(volatile size_t* ptr) {
+    return mjs_atomic_fetch_add_size(ptr, 0);
+}
+
+static inline bool mjs_atomic_cas_size(volatile size_t* ptr, size_t expected, size_t desired) {
+#ifdef _WIN64
+    return (size_t)InterlockedCompareExchange64((volatile LONG64*)ptr, (LONG64)desired, (LONG64)expected) == expected;
+#else
+    return (size_t)InterlockedCompareExchange((volatile LONG*)ptr, (LONG)desired, (LONG)expected) == expected;
+#endif
+}
+
+static inline void mjs_atomic_store_size(volatile size_t* ptr, size_t value) {
+#ifdef _WIN64
+    InterlockedExchange64((volatile LONG64*)ptr, (LONG64)value);
+#else
+    InterlockedExchange((volatile LONG*)ptr, (LONG)value);
+#endif
+}
+
+static inline bool mjs_atomic_cas_int(volatile int* ptr, int expected, int desired) {
+    return InterlockedCompareExchange((volatile LONG*)ptr, desired, expected) == expected;
+}
+
+static inline int mjs_atomic_load_int(volatile int* ptr) {
+    return InterlockedCompareExchange((volatile LONG*)ptr, 0, 0);
+}
+
+static inline void mjs_atomic_store_int(volatile int* ptr, int value) {
+    InterlockedExchange((volatile LONG*)ptr, value);
+}
+
+static inline void mjs_atomic_fence(void) {
+    MemoryBarrier();
+}
+#else
+static inline void* mjs_atomic_load_ptr(void* volatile* ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void mjs_atomic_store_ptr(void* volatile* ptr, void* value) {
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+static inline void* mjs_atomic_exchange_ptr(void* volatile* ptr, void* value) {
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+static inline bool mjs_atomic_cas_ptr(void* volatile* ptr, void* expected, void* desired) {
+    return __atomic_compare_exchange_n(ptr, &expected, desired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline size_t mjs_atomic_load_size(volatile size_t* ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void mjs_atomic_store_size(volatile size_t* ptr, size_t value) {
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+static inline size_t mjs_atomic_fetch_add_size(volatile size_t* ptr, size_t value) {
+    return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+static inline bool mjs_atomic_cas_size(volatile size_t* ptr, size_t expected, size_t desired) {
+    return __atomic_compare_exchange_n(ptr, &expected, desired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline bool mjs_atomic_cas_int(volatile int* ptr, int expected, int desired) {
+    return __atomic_compare_exchange_n(ptr, &expected, desired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline int mjs_atomic_load_int(volatile int* ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void mjs_atomic_store_int(volatile int* ptr, int value) {
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+static inline void mjs_atomic_fence(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+#endif
+
+#endif /* MIKOJS_THREAD_H */
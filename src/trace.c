@@ -0,0 +1,237 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Tracing Implementation
+ */
+
+#include "trace.h"
+#include "gc.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Per-thread event buffer. Only the owning thread writes events; it
+ * publishes each one by storing the new count, so an exporter reading
+ * count events sees them complete. Buffers are never freed: a thread that
+ * exits leaves its buffer for the next session's threads to claim. */
+typedef struct mjs_trace_buffer {
+    struct mjs_trace_buffer* next;
+    volatile int owned;
+    volatile size_t session;          /* session the events belong to */
+    volatile size_t count;
+    volatile size_t dropped;          /* events lost to a full buffer */
+    size_t thread_id;
+    mjs_trace_event_t events[MJS_TRACE_BUFFER_EVENTS];
+} mjs_trace_buffer_t;
+
+volatile int mjs_trace_active = 0;
+
+static void* volatile trace_buffers = NULL;
+static volatile size_t trace_session = 0;
+static volatile size_t trace_thread_ids = 0;
+static MJS_THREAD_LOCAL mjs_trace_buffer_t* trace_local = NULL;
+
+/* Take a buffer for the calling thread: one an exited thread released,
+ * unless it still holds events of the running session, or a new one */
+static mjs_trace_buffer_t* trace_claim_buffer(size_t session) {
+    mjs_trace_buffer_t* buffer = mjs_atomic_load_ptr(&trace_buffers);
+    for (; buffer; buffer = buffer->next) {
+        if (mjs_atomic_load_size(&buffer->session) != session &&
+            mjs_atomic_cas_int(&buffer->owned, 0, 1)) {
+            buffer->thread_id = mjs_atomic_fetch_add_size(&trace_thread_ids, 1) + 1;
+            return buffer;
+        }
+    }
+    
+    buffer = MJS_MALLOC(sizeof(mjs_trace_buffer_t));
+    if (!buffer) return NULL;
+    
+    buffer->owned = 1;
+    buffer->session = 0;
+    buffer->count = 0;
+    buffer->dropped = 0;
+    buffer->thread_id = mjs_atomic_fetch_add_size(&trace_thread_ids, 1) + 1;
+    
+    void* head;
+    do {
+        head = mjs_atomic_load_ptr(&trace_buffers);
+        buffer->next = head;
+    } while (!mjs_atomic_cas_ptr(&trace_buffers, head, buffer));
+    
+    return buffer;
+}
+
+void mjs_trace_record(char phase, const char* category, const char* name,
+                      const char* arg_name, int64_t arg_value) {
+    uint64_t now_us = mjs_gc_now_us();
+    size_t session = mjs_atomic_load_size(&trace_session);
+    
+    mjs_trace_buffer_t* buffer = trace_local;
+    if (!buffer) {
+        buffer = trace_claim_buffer(session);
+        if (!buffer) return;
+        trace_local = buffer;
+    }
+    
+    // The first event of a session drops what the last one recorded
+    if (mjs_atomic_load_size(&buffer->session) != session) {
+        mjs_atomic_store_size(&buffer->count, 0);
+        mjs_atomic_store_size(&buffer->dropped, 0);
+        mjs_atomic_store_size(&buffer->session, session);
+    }
+    
+    size_t count = buffer->count;
+    if (count >= MJS_TRACE_BUFFER_EVENTS) {
+        mjs_atomic_store_size(&buffer->dropped, buffer->dropped + 1);
+        return;
+    }
+    
+    mjs_trace_event_t* event = &buffer->events[count];
+    event->category = category;
+    event->name = name;
+    event->arg_name = arg_name;
+    event->arg_value = arg_value;
+    event->timestamp_us = now_us;
+    event->phase = phase;
+    mjs_atomic_store_size(&buffer->count, count + 1);
+}
+
+void mjs_trace_thread_exit(void) {
+    mjs_trace_buffer_t* buffer = trace_local;
+    if (!buffer) return;
+    
+    trace_local = NULL;
+    mjs_atomic_store_int(&buffer->owned, 0);
+}
+
+/* Sessions */
+void mjs_trace_start(void) {
+    mjs_atomic_fetch_add_size(&trace_session, 1);
+    mjs_atomic_store_int(&mjs_trace_active, 1);
+}
+
+void mjs_trace_stop(void) {
+    mjs_atomic_store_int(&mjs_trace_active, 0);
+}
+
+/* JSON export */
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} trace_output_t;
+
+static void trace_append(trace_output_t* out, const char* fmt, ...) {
+    if (out->failed) return;
+    
+    for (;;) {
+        va_list args;
+        va_start(args, fmt);
+        int written = vsnprintf(out->data + out->length, out->capacity - out->length, fmt, args);
+        va_end(args);
+        
+        if (written < 0) {
+            out->failed = true;
+            return;
+        }
+        if (out->length + (size_t)written < out->capacity) {
+            out->length += (size_t)written;
+            return;
+        }
+        
+        size_t new_capacity = out->capacity * 2 + (size_t)written;
+        char* new_data = MJS_REALLOC(out->data, new_capacity);
+        if (!new_data) {
+            out->failed = true;
+            return;
+        }
+        out->data = new_data;
+        out->capacity = new_capacity;
+    }
+}
+
+/* Events of the current session from every thread, in the Chrome trace
+ * event format. Safe while other threads keep recording. */
+char* mjs_trace_to_json(size_t* length) {
+    trace_output_t out = { MJS_MALLOC(4096), 0, 4096, false };
+    if (!out.data) return NULL;
+    out.data[0] = '\0';
+    
+    size_t session = mjs_atomic_load_size(&trace_session);
+    size_t dropped = 0;
+    bool first = true;
+    
+    trace_append(&out, "{\"traceEvents\":[");
+    mjs_trace_buffer_t* buffer = mjs_atomic_load_ptr(&trace_buffers);
+    for (; buffer; buffer = buffer->next) {
+        if (mjs_atomic_load_size(&buffer->session) != session) continue;
+        
+        size_t count = mjs_atomic_load_size(&buffer->count);
+        dropped += mjs_atomic_load_size(&buffer->dropped);
+        
+        for (size_t i = 0; i < count; i++) {
+            mjs_trace_event_t* event = &buffer->events[i];
+            trace_append(&out, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%zu",
+                         first ? "" : ",", event->name, event->category, event->phase,
+                         (unsigned long long)event->timestamp_us, buffer->thread_id);
+            if (event->phase == MJS_TRACE_INSTANT_PHASE) {
+                trace_append(&out, ",\"s\":\"t\"");
+            }
+            if (event->arg_name) {
+                trace_append(&out, ",\"args\":{\"%s\":%lld}", event->arg_name, (long long)event->arg_value);
+            }
+            trace_append(&out, "}");
+            first = false;
+        }
+    }
+    trace_append(&out, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":%zu}}\n", dropped);
+    
+    if (out.failed) {
+        MJS_FREE(out.data);
+        return NULL;
+    }
+    
+    if (length) *length = out.length;
+    return out.data;
+}
+
+bool mjs_trace_write_json(const char* path) {
+    if (!path) return false;
+    
+    size_t length = 0;
+    char* json = mjs_trace_to_json(&length);
+    if (!json) return false;
+    
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        MJS_FREE(json);
+        return false;
+    }
+    
+    bool ok = fwrite(json, 1, length, file) == length;
+    ok = fclose(file) == 0 && ok;
+    MJS_FREE(json);
+    
+    return ok;
+}
@@ -0,0 +1,91 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Tracing
+ * Begin/end events recorded per thread and exported as Chrome trace JSON
+ */
+
+#ifndef MIKOJS_TRACE_H
+#define MIKOJS_TRACE_H
+
+#include "thread.h"
+
+/* Events a thread can record before the rest of its session is dropped */
+#define MJS_TRACE_BUFFER_EVENTS 8192
+
+/* Event phases, as in the Chrome trace format */
+#define MJS_TRACE_BEGIN_PHASE 'B'
+#define MJS_TRACE_END_PHASE 'E'
+#define MJS_TRACE_INSTANT_PHASE 'i'
+
+/* One recorded event. Names, categories and argument names must be string
+ * literals: only the pointers are stored. */
+typedef struct {
+    const char* category;
+    const char* name;
+    const char* arg_name;
+    int64_t arg_value;
+    uint64_t timestamp_us;
+    char phase;
+} mjs_trace_event_t;
+
+/* Set while a tracing session records events */
+extern volatile int mjs_trace_active;
+
+static inline bool mjs_trace_enabled(void) {
+    return mjs_atomic_load_int(&mjs_trace_active) != 0;
+}
+
+void mjs_trace_record(char phase, const char* category, const char* name,
+                      const char* arg_name, int64_t arg_value);
+
+/* Release the calling thread's buffer to threads started later. The
+ * events stay for export. */
+void mjs_trace_thread_exit(void);
+
+/* Instrumentation. With tracing off each costs a single branch. */
+#define MJS_TRACE_BEGIN(category, name) \
+    MJS_TRACE_BEGIN1(category, name, NULL, 0)
+
+#define MJS_TRACE_BEGIN1(category, name, arg_name, arg_value) do { \
+    if (mjs_trace_enabled()) { \
+        mjs_trace_record(MJS_TRACE_BEGIN_PHASE, category, name, arg_name, (int64_t)(arg_value)); \
+    } \
+} while (0)
+
+#define MJS_TRACE_END(category, name) \
+    MJS_TRACE_END1(category, name, NULL, 0)
+
+#define MJS_TRACE_END1(category, name, arg_name, arg_value) do { \
+    if (mjs_trace_enabled()) { \
+        mjs_trace_record(MJS_TRACE_END_PHASE, category, name, arg_name, (int64_t)(arg_value)); \
+    } \
+} while (0)
+
+#define MJS_TRACE_INSTANT1(category, name, arg_name, arg_value) do { \
+    if (mjs_trace_enabled()) { \
+        mjs_trace_record(MJS_TRACE_INSTANT_PHASE, category, name, arg_name, (int64_t)(arg_value)); \
+    } \
+} while (0)
+
+#endif /* MIKOJS_TRACE_H */
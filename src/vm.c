@@ -28,6 +28,7 @@
 #include "vm.h"
 #include "mikojs_internal.h"
 #include "gc.h"
+#include "trace.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -90,18 +91,50 @@ mjs_vm_t* mjs_vm_new(mjs_context_t* ctx) {
     vm->exception_stack_top = 0;
     vm->state = VM_STATE_READY;
     
+    // The collector scans every VM's stacks for roots
+    if (ctx->runtime) {
+        vm->next_vm = ctx->runtime->vms;
+        ctx->runtime->vms = vm;
+    }
+    
     return vm;
 }
 
 void mjs_vm_free(mjs_vm_t* vm) {
     if (!vm) return;
     
+    if (vm->context && vm->context->runtime) {
+        mjs_vm_t** link = &vm->context->runtime->vms;
+        while (*link && *link != vm) {
+            link = &(*link)->next_vm;
+        }
+        if (*link) {
+            *link = vm->next_vm;
+        }
+    }
+    
     free(vm->stack);
     free(vm->call_stack);
     free(vm->exception_stack);
     free(vm);
 }
 
+/* Drop all execution state but keep the stacks allocated */
+void mjs_vm_reset(mjs_vm_t* vm) {
+    if (!vm) return;
+    
+    vm->stack_top = 0;
+    vm->call_stack_top = 0;
+    vm->exception_stack_top = 0;
+    vm->call_depth = 0;
+    vm->exception_handlers = NULL;
+    vm->exception_value = mjs_undefined();
+    vm->has_exception = false;
+    vm->running = false;
+    vm->halted = false;
+    vm->state = VM_STATE_READY;
+}
+
 /* Stack operations */
 static bool vm_push(mjs_vm_t* vm, mjs_value_t value) {
     if (!vm || vm->stack_top >= vm->stack_capacity) {
@@ -176,12 +209,19 @@ mjs_result_t mjs_vm_execute(mjs_vm_t* vm, mjs_bytecode_t* bytecode, mjs_value_t*
         return MJS_ERROR;
     }
     
+    // Everything this run leaves on the stacks is dropped on the way out;
+    // the collector scans them as roots up to the current depth
+    size_t stack_base = vm->stack_top;
+    size_t call_stack_base = vm->call_stack_top;
+    
     // Push initial call frame
     if (!vm_push_frame(vm, bytecode, 0)) {
         return MJS_ERROR;
     }
     
     vm->state = VM_STATE_RUNNING;
+    size_t instructions_before = vm->stats.instructions_executed;
+    MJS_TRACE_BEGIN1("execute", "execute", "instructions", bytecode->instruction_count);
     
     while (vm->state == VM_STATE_RUNNING && vm->call_stack_top > 0) {
         mjs_call_frame_t* frame = vm_current_frame(vm);
@@ -198,6 +238,16 @@ mjs_result_t mjs_vm_execute(mjs_vm_t* vm, mjs_bytecode_t* bytecode, mjs_value_t*
         // Execute instruction
         if (!vm_execute_instruction(vm, instr)) {
             vm->state = VM_STATE_ERROR;
+            vm->stack_top = stack_base;
+            vm->call_stack_top = call_stack_base;
+            MJS_TRACE_END1("execute", "execute", "executed",
+                           vm->stats.instructions_executed - instructions_before);
+            
+            // An allocation hit the runtime's memory limit
+            if (vm->context && mjs_gc_take_out_of_memory(vm->context->runtime->gc)) {
+                mjs_set_error(vm->context, MJS_ERROR_MEMORY, "Out of memory");
+                return MJS_ERROR_MEMORY;
+            }
             return MJS_ERROR;
         }
     }
@@ -206,13 +256,17 @@ mjs_result_t mjs_vm_execute(mjs_vm_t* vm, mjs_bytecode_t* bytecode, mjs_value_t*
     
     // Set result to top of stack if available
     if (result) {
-        if (vm->stack_top > 0) {
+        if (vm->stack_top > stack_base) {
             *result = vm_peek(vm, 0);
         } else {
             *result = mjs_value_undefined();
         }
     }
     
+    vm->stack_top = stack_base;
+    vm->call_stack_top = call_stack_base;
+    
+    MJS_TRACE_END1("execute", "execute", "executed", vm->stats.instructions_executed - instructions_before);
     return MJS_OK;
 }
 
@@ -256,9 +310,13 @@ static bool vm_execute_instruction(mjs_vm_t* vm, mjs_instruction_t* instr) {
                 return false;
             }
             const char* name = frame->bytecode->strings[instr->operand.u32]->data;
-            mjs_value_t value = vm_pop(vm);
             
-            return mjs_context_set_variable(vm->context, name, value);
+            // Storing a new variable allocates its key; the value stays on
+            // the stack until then so the collector can see it
+            mjs_value_t value = vm_peek(vm, 0);
+            bool stored = mjs_context_set_variable(vm->context, name, value);
+            vm_drop(vm, 1);
+            return stored;
         }
         
         case OP_POP:
@@ -281,9 +339,12 @@ static bool vm_execute_instruction(mjs_vm_t* vm, mjs_instruction_t* instr) {
         
         // Arithmetic operations
         case OP_ADD: {
-            mjs_value_t b = vm_pop(vm);
-            mjs_value_t a = vm_pop(vm);
+            // String operands are converted, which can allocate, so both
+            // stay on the stack until the result is ready
+            mjs_value_t b = vm_peek(vm, 0);
+            mjs_value_t a = vm_peek(vm, 1);
             mjs_value_t result = vm_add(vm, a, b);
+            vm_drop(vm, 2);
             return vm_push(vm, result);
         }
         
@@ -466,22 +527,24 @@ static bool vm_execute_instruction(mjs_vm_t* vm, mjs_instruction_t* instr) {
                 return false;
             }
             const char* prop = frame->bytecode->strings[instr->operand.u32]->data;
-            mjs_value_t value = vm_pop(vm);
-            mjs_value_t obj = vm_pop(vm);
+            mjs_value_t value = vm_peek(vm, 0);
+            mjs_value_t obj = vm_peek(vm, 1);
             
             if (!mjs_is_object(obj)) {
                 return false;
             }
             
-            mjs_object_set_property(mjs_get_object(obj), prop, value);
-            break;
+            bool stored = mjs_object_set_property(vm->context, mjs_get_object(obj), prop, value) == MJS_OK;
+            vm_drop(vm, 2);
+            return stored;
         }
         
         case OP_GET_PROP_COMPUTED: {
-            mjs_value_t prop = vm_pop(vm);
-            mjs_value_t obj = vm_pop(vm);
+            mjs_value_t prop = vm_peek(vm, 0);
+            mjs_value_t obj = vm_peek(vm, 1);
             
             if (!mjs_is_object(obj)) {
+                vm_drop(vm, 2);
                 return vm_push(vm, mjs_value_undefined());
             }
             
@@ -489,13 +552,14 @@ static bool vm_execute_instruction(mjs_vm_t* vm, mjs_instruction_t* instr) {
             if (!prop_str) return false;
             
             mjs_value_t result = mjs_object_get_property_value(mjs_get_object(obj), prop_str);
+            vm_drop(vm, 2);
             return vm_push(vm, result);
         }
         
         case OP_SET_PROP_COMPUTED: {
-            mjs_value_t value = vm_pop(vm);
-            mjs_value_t prop = vm_pop(vm);
-            mjs_value_t obj = vm_pop(vm);
+            mjs_value_t value = vm_peek(vm, 0);
+            mjs_value_t prop = vm_peek(vm, 1);
+            mjs_value_t obj = vm_peek(vm, 2);
             
             if (!mjs_is_object(obj)) {
                 return false;
@@ -504,20 +568,23 @@ static bool vm_execute_instruction(mjs_vm_t* vm, mjs_instruction_t* instr) {
             const char* prop_str = mjs_to_string(vm->context, prop);
             if (!prop_str) return false;
             
-            mjs_object_set_property(mjs_get_object(obj), prop_str, value);
-            break;
+            bool stored = mjs_object_set_property(vm->context, mjs_get_object(obj), prop_str, value) == MJS_OK;
+            vm_drop(vm, 3);
+            return stored;
         }
         
         // Array operations
         case OP_ARRAY_PUSH: {
-            mjs_value_t value = vm_pop(vm);
-            mjs_value_t arr = vm_peek(vm, 0); // Keep array on stack
+            mjs_value_t value = vm_peek(vm, 0);
+            mjs_value_t arr = vm_peek(vm, 1); // Keep array on stack
             
             if (!mjs_is_array(arr)) {
                 return false;
             }
             
-            return mjs_array_push(mjs_get_array(arr), value);
+            bool pushed = mjs_array_push(vm->context, mjs_get_array(arr), value);
+            vm_drop(vm, 1);
+            return pushed;
         }
         
         case OP_ARRAY_POP: {
@@ -527,7 +594,7 @@ static bool vm_execute_instruction(mjs_vm_t* vm, mjs_instruction_t* instr) {
                 return vm_push(vm, mjs_value_undefined());
             }
             
-            mjs_value_t result = mjs_array_pop(mjs_get_array(arr));
+            mjs_value_t result = mjs_array_pop(vm->context, mjs_get_array(arr));
             return vm_push(vm, result);
         }
         
@@ -545,16 +612,18 @@ static bool vm_execute_instruction(mjs_vm_t* vm, mjs_instruction_t* instr) {
         }
         
         case OP_ARRAY_SET: {
-            mjs_value_t value = vm_pop(vm);
-            mjs_value_t index = vm_pop(vm);
-            mjs_value_t arr = vm_pop(vm);
+            mjs_value_t value = vm_peek(vm, 0);
+            mjs_value_t index = vm_peek(vm, 1);
+            mjs_value_t arr = vm_peek(vm, 2);
             
             if (!mjs_is_array(arr)) {
                 return false;
             }
             
             size_t idx = (size_t)mjs_to_number(index);
-            return mjs_array_set(mjs_get_array(arr), idx, value);
+            bool stored = mjs_array_set(vm->context, mjs_get_array(arr), idx, value);
+            vm_drop(vm, 3);
+            return stored;
         }
         
         // Function operations
@@ -797,6 +866,7 @@ void mjs_bytecode_free(mjs_bytecode_t* bytecode) {
     // Free string pool
     if (bytecode->strings) {
         for (size_t i = 0; i < bytecode->string_count; i++) {
+            MJS_FREE(bytecode->strings[i]->data);
             free(bytecode->strings[i]);
         }
         free(bytecode->strings);
@@ -875,6 +945,8 @@ uint32_t mjs_bytecode_add_string(mjs_bytecode_t* bytecode, const char* str) {
     mjs_str->capacity = mjs_str->length + 1;
     mjs_str->is_interned = false;
     mjs_str->next = NULL;
+    mjs_str->data_owner = NULL;
+    mjs_str->data_shared = false;
     
     if (!mjs_str->data) {
         free(mjs_str);
@@ -268,11 +268,14 @@ struct mjs_vm {
     /* Performance counters */
     size_t instruction_count;
     size_t gc_count;
+    
+    struct mjs_vm* next_vm; /* runtime's list of VMs */
 };
 
 /* VM functions */
 mjs_vm_t* mjs_vm_new(mjs_context_t* ctx);
 void mjs_vm_free(mjs_vm_t* vm);
+void mjs_vm_reset(mjs_vm_t* vm);
 
 mjs_result_t mjs_vm_execute(mjs_vm_t* vm, mjs_bytecode_t* bytecode, mjs_value_t* result);
 mjs_result_t mjs_vm_call_function(mjs_vm_t* vm, mjs_function_t* func, mjs_value_t this_arg, int argc, mjs_value_t* argv, mjs_value_t* result);
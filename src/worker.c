@@ -0,0 +1,371 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Workers
+ * Runtimes on pooled threads exchanging messages through lock-free queues
+ */
+
+#include "worker.h"
+
+/* Message queues */
+void mjs_message_queue_init(mjs_message_queue_t* queue) {
+    queue->stub.next = NULL;
+    queue->head = &queue->stub;
+    queue->tail = &queue->stub;
+    queue->pending = 0;
+}
+
+static void message_queue_link(mjs_message_queue_t* queue, mjs_message_t* message) {
+    message->next = NULL;
+    mjs_message_t* prev = mjs_atomic_exchange_ptr(&queue->head, message);
+    
+    // Until this store the consumer sees the queue end at prev
+    mjs_atomic_store_ptr((void* volatile*)&prev->next, message);
+}
+
+void mjs_message_queue_push(mjs_message_queue_t* queue, mjs_message_t* message) {
+    // Counted first, so pending never trails what the consumer can pop
+    mjs_atomic_fetch_add_size(&queue->pending, 1);
+    message_queue_link(queue, message);
+}
+
+/* Consumer only. NULL when empty, or when a producer has not linked its
+ * message yet; pending then says one is on its way. */
+mjs_message_t* mjs_message_queue_pop(mjs_message_queue_t* queue) {
+    mjs_message_t* tail = queue->tail;
+    mjs_message_t* next = mjs_atomic_load_ptr((void* volatile*)&tail->next);
+    
+    if (tail == &queue->stub) {
+        if (!next) return NULL;
+        queue->tail = next;
+        tail = next;
+        next = mjs_atomic_load_ptr((void* volatile*)&next->next);
+    }
+    
+    if (!next) {
+        // tail is the last node; put the stub behind it to take it out
+        if (tail != mjs_atomic_load_ptr(&queue->head)) return NULL;
+        message_queue_link(queue, &queue->stub);
+        next = mjs_atomic_load_ptr((void* volatile*)&tail->next);
+        if (!next) return NULL;
+    }
+    
+    queue->tail = next;
+    mjs_atomic_fetch_add_size(&queue->pending, (size_t)-1);
+    return tail;
+}
+
+static void message_free(mjs_message_t* message) {
+    MJS_FREE(message->data);
+    MJS_FREE(message);
+}
+
+/* Consumer only, or once no producer is left */
+void mjs_message_queue_clear(mjs_message_queue_t* queue) {
+    mjs_message_t* message;
+    while ((message = mjs_message_queue_pop(queue))) {
+        message_free(message);
+    }
+}
+
+static bool message_post(mjs_message_queue_t* queue, void* data, size_t length, bool transfer) {
+    if (!data && length > 0) return false;
+    
+    mjs_message_t* message = MJS_MALLOC(sizeof(mjs_message_t));
+    if (!message) return false;
+    
+    if (transfer) {
+        message->data = data;
+    } else {
+        message->data = MJS_MALLOC(length ? length : 1);
+        if (!message->data) {
+            MJS_FREE(message);
+            return false;
+        }
+        if (length) memcpy(message->data, data, length);
+    }
+    message->length = length;
+    
+    mjs_message_queue_push(queue, message);
+    return true;
+}
+
+/* Hand a message to its handler, which may keep the buffer */
+static void message_deliver(mjs_worker_t* worker, mjs_context_t* ctx, mjs_message_t* message,
+                            mjs_message_handler_t handler, void* opaque) {
+    bool kept = handler && handler(worker, ctx, message->data, message->length, opaque);
+    if (kept) {
+        message->data = NULL;
+    }
+    message_free(message);
+}
+
+/* Scheduling. Called with the pool lock held. */
+static void worker_enqueue_runnable(mjs_worker_pool_t* pool, mjs_worker_t* worker) {
+    worker->next_runnable = NULL;
+    if (pool->runnable_tail) {
+        pool->runnable_tail->next_runnable = worker;
+    } else {
+        pool->runnable_head = worker;
+    }
+    pool->runnable_tail = worker;
+    mjs_cond_signal(&pool->work_cond);
+}
+
+/* Put an idle worker with messages on the run queue */
+static void worker_schedule(mjs_worker_t* worker) {
+    if (!mjs_atomic_cas_int(&worker->state, MJS_WORKER_IDLE, MJS_WORKER_SCHEDULED)) return;
+    
+    mjs_worker_pool_t* pool = worker->pool;
+    mjs_mutex_lock(&pool->lock);
+    worker_enqueue_runnable(pool, worker);
+    mjs_mutex_unlock(&pool->lock);
+}
+
+/* One turn of a worker: deliver a bounded batch of its messages */
+static void worker_run_turn(mjs_worker_t* worker) {
+    mjs_atomic_store_int(&worker->state, MJS_WORKER_RUNNING);
+    
+    for (size_t i = 0; i < MJS_WORKER_TURN_MESSAGES; i++) {
+        mjs_message_t* message = mjs_message_queue_pop(&worker->inbox);
+        if (!message) break;
+        message_deliver(worker, worker->context, message, worker->on_message, worker->opaque);
+    }
+    
+    // A message posted after the last pop found the worker running and
+    // left scheduling to us
+    mjs_atomic_store_int(&worker->state, MJS_WORKER_IDLE);
+    if (mjs_atomic_load_size(&worker->inbox.pending) > 0) {
+        worker_schedule(worker);
+    }
+}
+
+static void worker_pool_thread(void* arg) {
+    mjs_worker_pool_t* pool = arg;
+    
+    mjs_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->runnable_head && !pool->shutdown) {
+            mjs_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        if (pool->shutdown) break;
+        
+        mjs_worker_t* worker = pool->runnable_head;
+        pool->runnable_head = worker->next_runnable;
+        if (!pool->runnable_head) {
+            pool->runnable_tail = NULL;
+        }
+        if (worker->closing) continue;
+        worker->running = true;
+        mjs_mutex_unlock(&pool->lock);
+        
+        worker_run_turn(worker);
+        
+        mjs_mutex_lock(&pool->lock);
+        worker->running = false;
+        mjs_cond_broadcast(&pool->idle_cond);
+    }
+    mjs_mutex_unlock(&pool->lock);
+}
+
+/* Public API */
+mjs_worker_pool_t* mjs_new_worker_pool(size_t threads) {
+    mjs_worker_pool_t* pool = MJS_CALLOC(1, sizeof(mjs_worker_pool_t));
+    if (!pool) return NULL;
+    
+    if (threads == 0) {
+        threads = mjs_thread_hardware_concurrency();
+    }
+    
+    pool->threads = MJS_MALLOC(sizeof(mjs_thread_t) * threads);
+    if (!pool->threads || !mjs_mutex_init(&pool->lock)) {
+        MJS_FREE(pool->threads);
+        MJS_FREE(pool);
+        return NULL;
+    }
+    mjs_cond_init(&pool->work_cond);
+    mjs_cond_init(&pool->idle_cond);
+    
+    while (pool->thread_count < threads &&
+           mjs_thread_create(&pool->threads[pool->thread_count], worker_pool_thread, pool)) {
+        pool->thread_count++;
+    }
+    if (pool->thread_count == 0) {
+        mjs_free_worker_pool(pool);
+        return NULL;
+    }
+    
+    return pool;
+}
+
+void mjs_free_worker_pool(mjs_worker_pool_t* pool) {
+    if (!pool) return;
+    
+    while (pool->workers) {
+        mjs_free_worker(pool->workers);
+    }
+    
+    mjs_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    mjs_cond_broadcast(&pool->work_cond);
+    mjs_mutex_unlock(&pool->lock);
+    
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        mjs_thread_join(pool->threads[i]);
+    }
+    
+    mjs_cond_destroy(&pool->idle_cond);
+    mjs_cond_destroy(&pool->work_cond);
+    mjs_mutex_destroy(&pool->lock);
+    MJS_FREE(pool->threads);
+    MJS_FREE(pool);
+}
+
+mjs_worker_t* mjs_new_worker(mjs_worker_pool_t* pool, mjs_shared_heap_t* shared_heap,
+                             mjs_context_setup_t setup, mjs_message_handler_t on_message, void* opaque) {
+    if (!pool || !on_message) return NULL;
+    
+    mjs_worker_t* worker = MJS_CALLOC(1, sizeof(mjs_worker_t));
+    if (!worker) return NULL;
+    
+    worker->pool = pool;
+    worker->on_message = on_message;
+    worker->opaque = opaque;
+    worker->state = MJS_WORKER_IDLE;
+    mjs_message_queue_init(&worker->inbox);
+    mjs_message_queue_init(&worker->outbox);
+    
+    // The runtime is built here; pool threads take it over with the
+    // first message, which the run queue's lock orders after this
+    worker->runtime = mjs_new_runtime();
+    if (!worker->runtime ||
+        (shared_heap && !mjs_runtime_attach_shared_heap(worker->runtime, shared_heap)) ||
+        !(worker->context = mjs_new_context(worker->runtime)) ||
+        (setup && !setup(worker->context, opaque)) ||
+        !mjs_mutex_init(&worker->wait_lock)) {
+        if (worker->context) mjs_free_context(worker->context);
+        if (worker->runtime) mjs_free_runtime(worker->runtime);
+        MJS_FREE(worker);
+        return NULL;
+    }
+    mjs_cond_init(&worker->wait_cond);
+    
+    mjs_mutex_lock(&pool->lock);
+    worker->next_worker = pool->workers;
+    if (pool->workers) {
+        pool->workers->prev_worker = worker;
+    }
+    pool->workers = worker;
+    mjs_mutex_unlock(&pool->lock);
+    
+    return worker;
+}
+
+void mjs_free_worker(mjs_worker_t* worker) {
+    if (!worker) return;
+    
+    mjs_worker_pool_t* pool = worker->pool;
+    mjs_mutex_lock(&pool->lock);
+    worker->closing = true;
+    
+    // Out of any pool thread's hands, then off the run queue a last turn
+    // may have put it back on
+    while (worker->running) {
+        mjs_cond_wait(&pool->idle_cond, &pool->lock);
+    }
+    for (mjs_worker_t** link = &pool->runnable_head; *link; link = &(*link)->next_runnable) {
+        if (*link == worker) {
+            *link = worker->next_runnable;
+            break;
+        }
+    }
+    pool->runnable_tail = NULL;
+    for (mjs_worker_t* runnable = pool->runnable_head; runnable; runnable = runnable->next_runnable) {
+        pool->runnable_tail = runnable;
+    }
+    
+    if (worker->prev_worker) {
+        worker->prev_worker->next_worker = worker->next_worker;
+    } else {
+        pool->workers = worker->next_worker;
+    }
+    if (worker->next_worker) {
+        worker->next_worker->prev_worker = worker->prev_worker;
+    }
+    mjs_mutex_unlock(&pool->lock);
+    
+    mjs_message_queue_clear(&worker->inbox);
+    mjs_message_queue_clear(&worker->outbox);
+    mjs_free_context(worker->context);
+    mjs_free_runtime(worker->runtime);
+    mjs_cond_destroy(&worker->wait_cond);
+    mjs_mutex_destroy(&worker->wait_lock);
+    MJS_FREE(worker);
+}
+
+bool mjs_worker_post_message(mjs_worker_t* worker, void* data, size_t length, bool transfer) {
+    if (!worker || !message_post(&worker->inbox, data, length, transfer)) return false;
+    
+    worker_schedule(worker);
+    return true;
+}
+
+bool mjs_worker_post_to_parent(mjs_worker_t* worker, void* data, size_t length, bool transfer) {
+    if (!worker || !message_post(&worker->outbox, data, length, transfer)) return false;
+    
+    // Waking takes the lock only when the parent sleeps. The fences pair
+    // up so that either the parent sees the message or we see it waiting.
+    mjs_atomic_fence();
+    if (mjs_atomic_load_int(&worker->parent_waiting)) {
+        mjs_mutex_lock(&worker->wait_lock);
+        mjs_cond_broadcast(&worker->wait_cond);
+        mjs_mutex_unlock(&worker->wait_lock);
+    }
+    return true;
+}
+
+size_t mjs_worker_dispatch(mjs_worker_t* worker, mjs_context_t* ctx,
+                           mjs_message_handler_t handler, void* opaque) {
+    if (!worker) return 0;
+    
+    size_t delivered = 0;
+    mjs_message_t* message;
+    while ((message = mjs_message_queue_pop(&worker->outbox))) {
+        message_deliver(worker, ctx, message, handler, opaque);
+        delivered++;
+    }
+    return delivered;
+}
+
+void mjs_worker_wait(mjs_worker_t* worker) {
+    if (!worker || mjs_atomic_load_size(&worker->outbox.pending) > 0) return;
+    
+    mjs_mutex_lock(&worker->wait_lock);
+    mjs_atomic_store_int(&worker->parent_waiting, 1);
+    mjs_atomic_fence();
+    while (mjs_atomic_load_size(&worker->outbox.pending) == 0) {
+        mjs_cond_wait(&worker->wait_cond, &worker->wait_lock);
+    }
+    mjs_atomic_store_int(&worker->parent_waiting, 0);
+    mjs_mutex_unlock(&worker->wait_lock);
+}
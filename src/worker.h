@@ -0,0 +1,100 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Ariz Kamizuki
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * MikoJSCore Workers
+ * Runtimes on pooled threads exchanging messages through lock-free queues
+ */
+
+#ifndef MIKOJS_WORKER_H
+#define MIKOJS_WORKER_H
+
+#include "mikojs_internal.h"
+#include "thread.h"
+
+/* Messages a worker runs per turn before others get the thread */
+#define MJS_WORKER_TURN_MESSAGES 64
+
+/* A queued message; the node and its buffer are separate allocations so a
+ * transferred buffer is queued as is */
+typedef struct mjs_message {
+    struct mjs_message* volatile next;
+    void* data;
+    size_t length;
+} mjs_message_t;
+
+/* Intrusive multi-producer single-consumer queue (Vyukov). Producers swap
+ * themselves in at head; the one consumer follows next links from tail.
+ * The stub node keeps the queue from ever being empty of nodes. */
+typedef struct {
+    void* volatile head;
+    mjs_message_t* tail;
+    mjs_message_t stub;
+    volatile size_t pending;      /* pushed and not yet popped */
+} mjs_message_queue_t;
+
+/* Worker scheduling states */
+typedef enum {
+    MJS_WORKER_IDLE,              /* nothing to run */
+    MJS_WORKER_SCHEDULED,         /* on the pool's run queue */
+    MJS_WORKER_RUNNING            /* a pool thread is delivering its messages */
+} mjs_worker_state_t;
+
+struct mjs_worker {
+    mjs_worker_pool_t* pool;
+    mjs_runtime_t* runtime;
+    mjs_context_t* context;
+    mjs_message_handler_t on_message;
+    void* opaque;
+    mjs_message_queue_t inbox;    /* to the worker, drained on pool threads */
+    mjs_message_queue_t outbox;   /* to the parent, drained by mjs_worker_dispatch */
+    volatile int state;           /* mjs_worker_state_t */
+    volatile int parent_waiting;  /* the parent sleeps in mjs_worker_wait */
+    mjs_mutex_t wait_lock;
+    mjs_cond_t wait_cond;
+    bool closing;                 /* being freed; guarded by the pool lock */
+    bool running;                 /* a pool thread holds it; guarded by the pool lock */
+    struct mjs_worker* next_runnable;
+    struct mjs_worker* next_worker;
+    struct mjs_worker* prev_worker;
+};
+
+/* A fixed set of threads running whichever workers have messages. A
+ * worker's runtime is only ever used by one of them at a time. */
+struct mjs_worker_pool {
+    mjs_thread_t* threads;
+    size_t thread_count;
+    mjs_mutex_t lock;
+    mjs_cond_t work_cond;         /* a worker became runnable, or shutdown */
+    mjs_cond_t idle_cond;         /* a worker's turn ended */
+    mjs_worker_t* runnable_head;
+    mjs_worker_t* runnable_tail;
+    mjs_worker_t* workers;
+    bool shutdown;
+};
+
+void mjs_message_queue_init(mjs_message_queue_t* queue);
+void mjs_message_queue_push(mjs_message_queue_t* queue, mjs_message_t* message);
+mjs_message_t* mjs_message_queue_pop(mjs_message_queue_t* queue);
+void mjs_message_queue_clear(mjs_message_queue_t* queue);
+
+#endif /* MIKOJS_WORKER_H */
@@ -25,10 +25,19 @@
  */
 
 #include "../src/gc.h"
+#include "../src/heap_snapshot.h"
+#include "../src/alloc_profiler.h"
+#include "../src/context_pool.h"
+#include "../src/serialize.h"
+#include "../src/shared_heap.h"
+#include "../src/vm.h"
+#include "../src/worker.h"
+#include "../src/thread.h"
 #include "../include/mikojs.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #define TEST_ASSERT(condition, message) do { \
     if (condition) { \
@@ -100,7 +109,7 @@ static int test_root_management(void) {
 static int test_basic_collection(void) {
     TEST_SUITE_BEGIN("Basic Garbage Collection");
     
-    mjs_gc_t* gc = mjs_gc_new();
+    mjs_gc_t* gc = mjs_gc_new(NULL);
     
     // Allocate some objects
     void* obj1 = mjs_gc_alloc(gc, 64, MJS_GC_TYPE_OBJECT);
@@ -113,8 +122,11 @@ static int test_basic_collection(void) {
     mjs_gc_add_root(gc, obj1);
     
     // Trigger collection
-    size_t collected = mjs_gc_collect(gc);
-    TEST_ASSERT(collected >= 0, "Garbage collection execution");
+    TEST_ASSERT(mjs_gc_collect(gc), "Garbage collection execution");
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(mjs_gc_is_valid_object(gc, obj1) && !mjs_gc_is_valid_object(gc, obj2) &&
+                !mjs_gc_is_valid_object(gc, obj3),
+                "Root kept, garbage freed");
     
     mjs_gc_free(gc);
     
@@ -124,7 +136,7 @@ static int test_basic_collection(void) {
 static int test_generational_collection(void) {
     TEST_SUITE_BEGIN("Generational Collection");
     
-    mjs_gc_t* gc = mjs_gc_new();
+    mjs_gc_t* gc = mjs_gc_new(NULL);
     
     // Allocate young objects
     void* young_obj1 = mjs_gc_alloc(gc, 64, MJS_GC_TYPE_OBJECT);
@@ -136,8 +148,9 @@ static int test_generational_collection(void) {
     mjs_gc_add_root(gc, young_obj1);
     
     // Trigger young generation collection
-    size_t collected = mjs_gc_collect_young(gc);
-    TEST_ASSERT(collected >= 0, "Young generation collection");
+    TEST_ASSERT(mjs_gc_collect_young(gc), "Young generation collection");
+    TEST_ASSERT(mjs_gc_is_valid_object(gc, young_obj1) && !mjs_gc_is_valid_object(gc, young_obj2),
+                "Young root kept, young garbage freed");
     
     mjs_gc_free(gc);
     
@@ -147,30 +160,1628 @@ static int test_generational_collection(void) {
 static int test_incremental_collection(void) {
     TEST_SUITE_BEGIN("Incremental Collection");
     
-    mjs_gc_t* gc = mjs_gc_new();
+    mjs_gc_t* gc = mjs_gc_new(NULL);
     
     // Allocate some objects
+    void* root = NULL;
     for (int i = 0; i < 10; i++) {
         void* obj = mjs_gc_alloc(gc, 64, MJS_GC_TYPE_OBJECT);
         if (i == 0) {
             // Keep first object as root
+            root = obj;
+            mjs_gc_add_root(gc, obj);
+        }
+    }
+    
+    // Run the cycle in 100 microsecond steps until it completes
+    while (mjs_gc_collect_incremental(gc, 100)) {}
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(mjs_gc_get_stats(gc).collections > 0, "Incremental collection execution");
+    TEST_ASSERT(mjs_gc_is_valid_object(gc, root), "Root survived the incremental cycle");
+    
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static bool gc_test_is_live(mjs_gc_t* gc, void* obj) {
+    return mjs_gc_is_valid_object(gc, obj);
+}
+
+static int test_incremental_write_barrier(void) {
+    TEST_SUITE_BEGIN("Incremental Marking Write Barrier");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    
+    mjs_object_t* parent = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_object_t* child = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_gc_add_root(gc, parent);
+    
+    // A long prototype chain keeps the marker busy past a 1us step
+    mjs_object_t* tail = parent;
+    for (int i = 0; i < 1000; i++) {
+        tail->prototype = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+        tail = tail->prototype;
+    }
+    
+    // Check the clock after every object so the step stops early in the chain
+    mjs_gc_set_incremental_step_size(gc, 1);
+    bool more_work = mjs_gc_collect_incremental(gc, 1);
+    TEST_ASSERT(more_work, "Cycle still in progress after a short step");
+    TEST_ASSERT(mjs_gc_get_mark(parent) == GC_MARK_BLACK, "Root scanned black");
+    
+    // Hide a white object behind the end of the chain
+    tail = parent;
+    while (tail->prototype && mjs_gc_get_mark(tail->prototype) == GC_MARK_BLACK) {
+        tail = tail->prototype;
+    }
+    MJS_GC_WRITE_BARRIER(gc, tail, child);
+    tail->prototype = child;
+    TEST_ASSERT(mjs_gc_get_mark(child) == GC_MARK_GRAY, "Barrier shades stored child");
+    
+    while (mjs_gc_collect_incremental(gc, 1000)) {}
+    TEST_ASSERT(gc_test_is_live(gc, child), "Child survived the cycle");
+    TEST_ASSERT(gc->stats.incremental_steps >= 2, "Cycle took several steps");
+    
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static int test_lazy_sweeping(void) {
+    TEST_SUITE_BEGIN("Lazy Sweeping");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    
+    mjs_object_t* root = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_gc_add_root(gc, root);
+    
+    // Fill one page of a size class with garbage
+    void* garbage = mjs_gc_alloc(gc, 48, GC_TYPE_FUNCTION);
+    mjs_gc_page_t* page = mjs_gc_page_of(gc, garbage);
+    while (page->free_cells) {
+        mjs_gc_alloc(gc, 48, GC_TYPE_FUNCTION);
+    }
+    void* large = mjs_gc_alloc(gc, 64 * 1024, GC_TYPE_FUNCTION);
+    TEST_ASSERT(mjs_gc_page_of(gc, large)->size_class == GC_LARGE_SIZE_CLASS, "Large object gets its own page");
+    
+    // The pause only marks; pages are queued for the sweeper
+    mjs_gc_collect(gc);
+    TEST_ASSERT(gc->state == GC_STATE_SWEEPING, "Sweeping deferred after the pause");
+    TEST_ASSERT(gc_test_is_live(gc, garbage), "Garbage not reclaimed yet");
+    
+    // Allocating from the size class sweeps its page and reuses a dead cell
+    size_t freed = gc->stats.objects_freed;
+    void* reused = mjs_gc_alloc(gc, 48, GC_TYPE_FUNCTION);
+    TEST_ASSERT(gc->stats.objects_freed >= freed + page->cell_count, "Allocation swept the page");
+    TEST_ASSERT(mjs_gc_page_of(gc, reused) == page, "Dead cell reused");
+    
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(gc->state == GC_STATE_IDLE, "Sweeping finished");
+    TEST_ASSERT(gc_test_is_live(gc, root), "Root survived");
+    TEST_ASSERT(mjs_gc_page_of(gc, large) == NULL, "Dead large page released");
+    
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static int test_concurrent_marking(void) {
+    TEST_SUITE_BEGIN("Concurrent Marking");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    mjs_gc_set_concurrent_marking(gc, true);
+    
+    mjs_object_t* root = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_gc_add_root(gc, root);
+    mjs_object_t* tail = root;
+    for (int i = 0; i < 10000; i++) {
+        tail->prototype = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+        tail = tail->prototype;
+    }
+    mjs_object_t* moved = root->prototype->prototype;
+    
+    mjs_gc_collect_incremental(gc, 0);
+    TEST_ASSERT(gc->marker_active, "Marker thread took over the cycle");
+    
+    // Cut the chain while the marker runs; the deletion barrier must
+    // keep the snapshot alive
+    bool heap_locked = mjs_gc_lock_heap(gc);
+    mjs_gc_satb_barrier(gc, root->prototype);
+    root->prototype = NULL;
+    mjs_gc_unlock_heap(gc, heap_locked);
+    
+    while (mjs_gc_collect_incremental(gc, 1000)) {}
+    TEST_ASSERT(gc_test_is_live(gc, moved), "Object reachable at the snapshot survived");
+    TEST_ASSERT(gc->stats.concurrent_cycles == 1, "One concurrent cycle");
+    
+    // The next cycle sees the chain as garbage
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(!gc_test_is_live(gc, moved), "Detached chain collected next cycle");
+    
+    mjs_gc_free(gc);
+    
+    // Object and array mutators lock the heap and log what they drop, so
+    // C code can change them while the marker thread runs
+    mjs_runtime_t* rt = mjs_new_runtime();
+    mjs_context_t* ctx = mjs_new_context(rt);
+    mjs_gc_set_concurrent_marking(rt->gc, true);
+    mjs_value_t list = mjs_array(ctx);
+    mjs_context_set_variable(ctx, "list", list);
+    mjs_value_t holder = mjs_object(ctx);
+    mjs_context_set_variable(ctx, "holder", holder);
+    for (int i = 0; i < 2000; i++) {
+        mjs_array_push(ctx, mjs_get_array(list), mjs_object(ctx));
+    }
+    mjs_object_set_property(ctx, mjs_get_object(holder), "kept", mjs_object(ctx));
+    
+    mjs_gc_collect_incremental(rt->gc, 0);
+    TEST_ASSERT(rt->gc->marker_active, "Marker thread running under a runtime");
+    
+    mjs_value_t popped = mjs_array_pop(ctx, mjs_get_array(list));
+    mjs_value_t overwritten = mjs_array_get(mjs_get_array(list), 0);
+    mjs_value_t deleted = mjs_object_get_property_value(mjs_get_object(holder), "kept");
+    TEST_ASSERT(mjs_object_delete_property(ctx, mjs_get_object(holder), "kept") &&
+                mjs_array_set(ctx, mjs_get_array(list), 0, mjs_number(0)),
+                "Stores and deletes made during concurrent marking");
+    for (int i = 0; i < 4000; i++) {
+        mjs_array_push(ctx, mjs_get_array(list), mjs_number(i));
+    }
+    
+    while (mjs_gc_collect_incremental(rt->gc, 1000)) {}
+    TEST_ASSERT(gc_test_is_live(rt->gc, popped.u.ptr) && gc_test_is_live(rt->gc, overwritten.u.ptr) &&
+                gc_test_is_live(rt->gc, deleted.u.ptr),
+                "Values dropped during the cycle survived it");
+    
+    mjs_free_context(ctx);
+    mjs_free_runtime(rt);
+    
+    return 0;
+}
+
+static int test_parallel_collection(void) {
+    TEST_SUITE_BEGIN("Parallel Collection");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    mjs_gc_set_parallel_threads(gc, 4);
+    gc->config.incremental = false;
+    
+    // Enough chains to keep every worker busy and a heap well past the
+    // parallel threshold; every other chain is unrooted again
+    mjs_object_t* heads[64];
+    mjs_object_t* tails[64];
+    for (int c = 0; c < 64; c++) {
+        heads[c] = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+        mjs_gc_add_root(gc, heads[c]);
+        tails[c] = heads[c];
+        for (int i = 0; i < 2000; i++) {
+            tails[c]->prototype = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+            tails[c] = tails[c]->prototype;
+        }
+    }
+    for (int c = 1; c < 64; c += 2) {
+        mjs_gc_remove_root(gc, heads[c]);
+    }
+    TEST_ASSERT(gc->heap_size >= GC_PARALLEL_MIN_HEAP, "Heap is large enough to go parallel");
+    
+    mjs_gc_finish_sweeping(gc);
+    size_t parallel_marks = gc->stats.parallel_marks;
+    size_t parallel_sweeps = gc->stats.parallel_sweeps;
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    
+    TEST_ASSERT(gc->stats.parallel_marks == parallel_marks + 1, "Marking ran on the workers");
+    TEST_ASSERT(gc->stats.parallel_sweeps == parallel_sweeps + 1, "Sweeping ran on the workers");
+    TEST_ASSERT(gc_test_is_live(gc, tails[0]) && gc_test_is_live(gc, tails[62]), "Rooted chains survived");
+    TEST_ASSERT(!gc_test_is_live(gc, tails[1]) && !gc_test_is_live(gc, tails[63]), "Unrooted chains collected");
+    TEST_ASSERT(mjs_gc_get_object_count(gc) == 32 * 2001, "Object count matches the live chains");
+    
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static int test_compaction(void) {
+    TEST_SUITE_BEGIN("Old Generation Compaction");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    gc->config.incremental = false;
+    
+    // Fill several pages, age them into the old generation, then drop nine
+    // objects in ten so the pages end up sparse
+    enum { COUNT = 8000 };
+    mjs_object_t** objects = malloc(sizeof(mjs_object_t*) * COUNT);
+    mjs_object_t* root = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_gc_add_root(gc, root);
+    mjs_object_t* tail = root;
+    for (int i = 0; i < COUNT; i++) {
+        objects[i] = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+        tail->prototype = objects[i];
+        tail = objects[i];
+    }
+    mjs_gc_collect_young(gc);
+    mjs_gc_collect_young(gc);
+    TEST_ASSERT(mjs_gc_get_generation(objects[0]) == 1, "Chain promoted to the old generation");
+    
+    tail = root;
+    for (int i = 0; i < COUNT; i += 10) {
+        tail->prototype = objects[i];
+        tail = objects[i];
+    }
+    tail->prototype = NULL;
+    
+    mjs_object_t* pinned = objects[COUNT / 2];
+    mjs_gc_pin_object(gc, pinned);
+    mjs_weak_ref_t* weak_ref = mjs_gc_create_weak_ref(gc, objects[10]);
+    mjs_ephemeron_table_t* table = mjs_gc_create_ephemeron_table(gc);
+    mjs_ephemeron_table_set(table, objects[20], mjs_value_number(20));
+    size_t pages_before = gc->old_generation.page_count;
+    
+    gc->config.compact = true;
+    mjs_gc_collect(gc);
+    
+    TEST_ASSERT(gc->stats.compactions == 1 && gc->stats.objects_moved > 0, "Sparse pages were evacuated");
+    TEST_ASSERT(gc->old_generation.page_count < pages_before, "Emptied pages were released");
+    TEST_ASSERT(gc_test_is_live(gc, pinned), "Pinned object stayed in place");
+    
+    // The chain must be intact through the moved objects
+    size_t length = 0;
+    bool valid = true;
+    bool found_pinned = false;
+    for (mjs_object_t* obj = root->prototype; obj; obj = obj->prototype) {
+        valid = valid && gc_test_is_live(gc, obj);
+        found_pinned = found_pinned || obj == pinned;
+        length++;
+    }
+    TEST_ASSERT(valid && length == COUNT / 10, "References were forwarded to the copies");
+    TEST_ASSERT(found_pinned, "Pinned object still linked at its old address");
+    TEST_ASSERT(mjs_weak_ref_get(weak_ref) == root->prototype->prototype, "Weak reference follows the move");
+    mjs_value_t cached;
+    TEST_ASSERT(mjs_ephemeron_table_get(table, root->prototype->prototype->prototype, &cached) &&
+                cached.u.number == 20, "Ephemeron table rehashed after the move");
+    TEST_ASSERT(mjs_gc_get_object_count(gc) == COUNT / 10 + 1, "No object lost or duplicated");
+    
+    mjs_gc_unpin_object(gc, pinned);
+    free(objects);
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static int test_object_header(void) {
+    TEST_SUITE_BEGIN("Compact Object Header");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    
+    TEST_ASSERT(sizeof(mjs_gc_object_t) == 8, "Header is 8 bytes");
+    
+    // Neighbouring cells share a bitmap word but keep their own colors
+    mjs_object_t* a = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_object_t* b = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    TEST_ASSERT(mjs_gc_page_of(gc, a) == mjs_gc_page_of(gc, b), "Objects share a page");
+    TEST_ASSERT(mjs_gc_page_of(gc, a)->cell_size == sizeof(mjs_gc_object_t) + 32, "Cell is payload plus header");
+    
+    mjs_gc_add_root(gc, a);
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(gc_test_is_live(gc, a) && !gc_test_is_live(gc, b), "Only the rooted neighbour survived");
+    TEST_ASSERT(mjs_gc_get_mark(a) == GC_MARK_WHITE, "Sweeping reset the side marks");
+    
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static int test_pacing_and_memory_limit(void) {
+    TEST_SUITE_BEGIN("GC Pacing and Memory Limit");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    gc->config.incremental = false;
+    
+    // A small live heap gets the minimum budget
+    mjs_gc_collect(gc);
+    size_t small_budget = gc->stats.allocation_budget;
+    TEST_ASSERT(small_budget > 0, "Budget set after a cycle");
+    
+    // A large live heap that fully survives lets the heap grow with it
+    mjs_object_t* root = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_gc_add_root(gc, root);
+    mjs_object_t* tail = root;
+    for (int i = 0; i < 100000; i++) {
+        tail->prototype = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+        tail = tail->prototype;
+    }
+    mjs_gc_collect(gc);
+    mjs_gc_collect(gc);
+    TEST_ASSERT(gc->stats.allocation_budget > small_budget, "Budget grows with the surviving heap");
+    TEST_ASSERT(gc->stats.allocation_budget <= gc->marked_bytes * 3, "Budget capped by the growth factor");
+    
+    // Allocating past the hard limit fails and is reported once
+    mjs_gc_set_memory_limit(gc, gc->heap_size + 1024 * 1024);
+    size_t allocated = 0;
+    while (tail) {
+        tail->prototype = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+        tail = tail->prototype;
+        allocated++;
+    }
+    TEST_ASSERT(allocated > 1000, "Allocation continued up to the limit");
+    TEST_ASSERT(gc->heap_size <= gc->memory_limit, "Heap stayed under the limit");
+    TEST_ASSERT(gc->stats.out_of_memory_errors == 1, "Failure counted");
+    TEST_ASSERT(mjs_gc_take_out_of_memory(gc), "Failure reported");
+    TEST_ASSERT(!mjs_gc_take_out_of_memory(gc), "Failure reported only once");
+    
+    // Dropping the live set makes room again
+    mjs_gc_remove_root(gc, root);
+    TEST_ASSERT(mjs_gc_alloc(gc, 4096, GC_TYPE_OBJECT) != NULL, "Allocation succeeds after collection");
+    
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+/* Age a chain into the old generation and keep one object in ten, then
+ * collect once so the pages' occupancy shows them sparse */
+static void idle_test_fragment(mjs_gc_t* gc, mjs_object_t* root) {
+    enum { COUNT = 8000 };
+    mjs_object_t** objects = malloc(sizeof(mjs_object_t*) * COUNT);
+    mjs_object_t* tail = root;
+    for (int i = 0; i < COUNT; i++) {
+        objects[i] = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+        objects[i]->prototype = NULL;
+        tail->prototype = objects[i];
+        tail = objects[i];
+    }
+    mjs_gc_collect_young(gc);
+    mjs_gc_collect_young(gc);
+    
+    tail = root;
+    for (int i = 0; i < COUNT; i += 10) {
+        tail->prototype = objects[i];
+        tail = objects[i];
+    }
+    tail->prototype = NULL;
+    free(objects);
+    
+    bool compact = gc->config.compact;
+    gc->config.compact = false;
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    gc->config.compact = compact;
+}
+
+static int test_idle_notification(void) {
+    TEST_SUITE_BEGIN("Idle-Time GC");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    gc->config.incremental = true;
+    gc->config.concurrent_marking = false;
+    
+    mjs_object_t* root = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_gc_add_root(gc, root);
+    for (int i = 0; i < 20000; i++) {
+        mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    }
+    
+    // A deadline already passed does nothing
+    mjs_gc_collect_incremental(gc, 1);
+    TEST_ASSERT(gc->state != GC_STATE_IDLE, "Cycle left in progress");
+    TEST_ASSERT(!mjs_gc_idle_notification(gc, mjs_gc_now_us() - 1), "No work before an expired deadline");
+    TEST_ASSERT(gc->stats.idle_notifications == 0, "Expired deadline not counted");
+    
+    // Idle time finishes the cycle, sweeps and gives the pages back
+    size_t heap_before = gc->heap_size;
+    TEST_ASSERT(mjs_gc_idle_notification(gc, mjs_gc_now_us() + 1000000), "Idle work completed");
+    TEST_ASSERT(gc->state == GC_STATE_IDLE && gc->unswept_count == 0, "Cycle finished and swept");
+    TEST_ASSERT(gc_test_is_live(gc, root), "Rooted object survived");
+    TEST_ASSERT(gc->heap_size < heap_before, "Empty pages released");
+    TEST_ASSERT(gc->stats.idle_notifications == 1, "Notification counted");
+    
+    // Memory pressure frees the marking caches too
+    mjs_gc_memory_pressure(gc, MJS_MEMORY_PRESSURE_CRITICAL);
+    TEST_ASSERT(gc->gray_stack == NULL && gc->workers == NULL, "Marking caches released");
+    TEST_ASSERT(gc_test_is_live(gc, root), "Rooted object survived pressure");
+    TEST_ASSERT(gc->stats.memory_pressure_collections == 1, "Pressure collection counted");
+    TEST_ASSERT(gc->stats.compactions == 0, "Nothing compacted unless configured");
+    
+    // With compaction configured, idle time and critical pressure evacuate
+    // sparse old pages as full collections do
+    gc->config.compact = true;
+    idle_test_fragment(gc, root);
+    TEST_ASSERT(mjs_gc_idle_notification(gc, mjs_gc_now_us() + 10000000) &&
+                gc->stats.compactions == 1 && gc->stats.objects_moved > 0,
+                "Idle time compacted sparse pages");
+    
+    idle_test_fragment(gc, root);
+    size_t moved = gc->stats.objects_moved;
+    mjs_gc_memory_pressure(gc, MJS_MEMORY_PRESSURE_CRITICAL);
+    TEST_ASSERT(gc->stats.compactions == 2 && gc->stats.objects_moved > moved,
+                "Critical pressure compacted sparse pages");
+    
+    size_t length = 0;
+    bool valid = true;
+    for (mjs_object_t* obj = root->prototype; obj; obj = obj->prototype) {
+        valid = valid && gc_test_is_live(gc, obj);
+        length++;
+    }
+    TEST_ASSERT(valid && length == 800, "Chain intact through the moves");
+    
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static size_t count_occurrences(const char* text, const char* pattern) {
+    size_t count = 0;
+    for (const char* p = strstr(text, pattern); p; p = strstr(p + 1, pattern)) {
+        count++;
+    }
+    return count;
+}
+
+static int test_tracing(void) {
+    TEST_SUITE_BEGIN("Trace Events");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    mjs_object_t* root = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_gc_add_root(gc, root);
+    
+    mjs_trace_start();
+    mjs_gc_collect(gc);
+    mjs_gc_collect_young(gc);
+    mjs_trace_stop();
+    
+    size_t length = 0;
+    char* json = mjs_trace_to_json(&length);
+    TEST_ASSERT(json != NULL && length == strlen(json), "Trace exported");
+    TEST_ASSERT(strncmp(json, "{\"traceEvents\":[", 16) == 0, "Chrome trace format");
+    TEST_ASSERT(strstr(json, "\"name\":\"gc.full\"") && strstr(json, "\"name\":\"gc.mark\"") &&
+                strstr(json, "\"name\":\"gc.young\""), "GC phases recorded");
+    TEST_ASSERT(count_occurrences(json, "\"ph\":\"B\"") == count_occurrences(json, "\"ph\":\"E\""),
+                "Every span is closed");
+    
+    // Nothing is recorded once stopped
+    mjs_gc_collect(gc);
+    char* after = mjs_trace_to_json(NULL);
+    TEST_ASSERT(after && strcmp(json, after) == 0, "Stopped session records nothing");
+    free(after);
+    free(json);
+    
+    // A new session starts empty
+    mjs_trace_start();
+    mjs_trace_stop();
+    json = mjs_trace_to_json(NULL);
+    TEST_ASSERT(json && !strstr(json, "gc.full"), "New session drops old events");
+    free(json);
+    
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static size_t snapshot_node_of(mjs_heap_snapshot_t* snapshot, void* object) {
+    for (size_t i = 0; i < snapshot->node_count; i++) {
+        if (snapshot->nodes[i].object == object) return i;
+    }
+    return SIZE_MAX;
+}
+
+static int test_heap_snapshot(void) {
+    TEST_SUITE_BEGIN("Heap Snapshot");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    
+    // a -> [b, c] and d -> c: a alone retains b, nobody alone retains c
+    mjs_array_t* a = mjs_gc_alloc(gc, sizeof(mjs_array_t), GC_TYPE_ARRAY);
+    mjs_object_t* b = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_object_t* c = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_object_t* d = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_object_t* garbage = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    a->elements = malloc(2 * sizeof(mjs_value_t));
+    a->length = a->capacity = 2;
+    a->elements[0] = (mjs_value_t){ .tag = MJS_TAG_OBJECT, .u.object = b };
+    a->elements[1] = (mjs_value_t){ .tag = MJS_TAG_OBJECT, .u.object = c };
+    d->prototype = c;
+    mjs_gc_add_root(gc, a);
+    mjs_gc_add_root(gc, d);
+    
+    mjs_heap_snapshot_t* snapshot = mjs_heap_snapshot_take(gc);
+    TEST_ASSERT(snapshot != NULL, "Snapshot taken");
+    
+    size_t na = snapshot_node_of(snapshot, a), nb = snapshot_node_of(snapshot, b);
+    size_t nc = snapshot_node_of(snapshot, c), nd = snapshot_node_of(snapshot, d);
+    TEST_ASSERT(na != SIZE_MAX && nb != SIZE_MAX && nc != SIZE_MAX && nd != SIZE_MAX, "Live objects are nodes");
+    TEST_ASSERT(snapshot_node_of(snapshot, garbage) == SIZE_MAX, "Garbage collected first");
+    
+    mjs_snapshot_node_t* nodes = snapshot->nodes;
+    TEST_ASSERT(nodes[na].type == MJS_SNAPSHOT_NODE_ARRAY && nodes[na].edge_count == 2, "Array with element edges");
+    TEST_ASSERT(nodes[nb].dominator == na, "Only path dominated by its parent");
+    TEST_ASSERT(nodes[nc].dominator == nodes[na].dominator && nodes[nc].dominator == nodes[nd].dominator,
+                "Shared object dominated by the roots");
+    TEST_ASSERT(nodes[na].retained_size == nodes[na].self_size + nodes[nb].self_size, "Retained size counts the dominated tree");
+    TEST_ASSERT(nodes[nd].retained_size == nodes[nd].self_size, "Shared object not retained by one referrer");
+    TEST_ASSERT(nodes[0].retained_size >= nodes[na].retained_size + nodes[nc].self_size + nodes[nd].self_size,
+                "Root retains everything");
+    
+    FILE* file = tmpfile();
+    TEST_ASSERT(file && mjs_heap_snapshot_write(snapshot, file), "Snapshot written");
+    long length = ftell(file);
+    char* json = malloc((size_t)length + 1);
+    rewind(file);
+    json[fread(json, 1, (size_t)length, file)] = '\0';
+    fclose(file);
+    TEST_ASSERT(strncmp(json, "{\"snapshot\":{\"meta\":", 20) == 0 && strstr(json, "\"strings\":["),
+                "DevTools heapsnapshot layout");
+    free(json);
+    
+    mjs_heap_snapshot_free(snapshot);
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static int test_allocation_profiler(void) {
+    TEST_SUITE_BEGIN("Allocation Profiler");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    TEST_ASSERT(mjs_alloc_profiler_start(gc, 4096), "Profiler started");
+    mjs_alloc_profiler_t* profiler = gc->alloc_profiler;
+    
+    // Every other object stays reachable
+    void* kept[2000];
+    size_t kept_count = 0;
+    size_t allocated = 0;
+    for (int i = 0; i < 4000; i++) {
+        void* obj = mjs_gc_alloc(gc, 64, GC_TYPE_OBJECT);
+        allocated += mjs_gc_page_of(gc, obj)->cell_size;
+        if (i % 2 == 0) {
+            kept[kept_count++] = obj;
             mjs_gc_add_root(gc, obj);
         }
     }
     
-    // Trigger incremental collection
-    bool more_work = mjs_gc_collect_incremental(gc, 100); // 100 microseconds
-    TEST_ASSERT(more_work >= 0, "Incremental collection execution");
+    size_t expected = allocated / 4096;
+    TEST_ASSERT(profiler->sample_count > expected / 2 && profiler->sample_count < expected * 2,
+                "Sample count follows the interval");
+    TEST_ASSERT(profiler->stack_count == 1 && strcmp(profiler->stacks[0], "(root);(native)") == 0,
+                "Native allocations share one stack");
+    
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(profiler->live_count > 0 && profiler->live_count < profiler->sample_count,
+                "Collected samples are no longer live");
+    
+    FILE* file = tmpfile();
+    TEST_ASSERT(file && mjs_alloc_profiler_write_folded(profiler, file, false), "Profile written");
+    char line[256] = "";
+    rewind(file);
+    double bytes = 0;
+    TEST_ASSERT(fscanf(file, "(root);(native);(object) %lf", &bytes) == 1, "Folded stack line");
+    TEST_ASSERT(bytes > allocated / 2.0 && bytes < allocated * 2.0, "Estimate scaled to allocated bytes");
+    TEST_ASSERT(fgets(line, sizeof(line), file) && !fgets(line, sizeof(line), file), "One stack and type");
+    fclose(file);
+    
+    for (size_t i = 0; i < kept_count; i++) {
+        mjs_gc_remove_root(gc, kept[i]);
+    }
+    mjs_alloc_profiler_stop(gc);
+    TEST_ASSERT(gc->alloc_profiler == NULL && gc->weak_ref_count == 0, "Stopping drops the samples");
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static int test_ephemerons(void) {
+    TEST_SUITE_BEGIN("Ephemerons");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    gc->config.incremental = false;
+    mjs_ephemeron_table_t* table = mjs_gc_create_ephemeron_table(gc);
+    
+    // Reachable key keeps its value; a value pointing back at an otherwise
+    // unreachable key does not keep the key
+    mjs_object_t* key = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_object_t* value = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_object_t* dead_key = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_object_t* dead_value = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    dead_value->prototype = dead_key;
+    mjs_gc_add_root(gc, key);
+    TEST_ASSERT(mjs_ephemeron_table_set(table, key, (mjs_value_t){ .tag = MJS_TAG_OBJECT, .u.object = value }) &&
+                mjs_ephemeron_table_set(table, dead_key, (mjs_value_t){ .tag = MJS_TAG_OBJECT, .u.object = dead_value }),
+                "Entries added");
+    
+    // A chain of keys each reachable only through the previous entry
+    enum { CHAIN = 2000 };
+    mjs_object_t* links[CHAIN];
+    for (int i = 0; i < CHAIN; i++) {
+        links[i] = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+        if (i > 0) {
+            mjs_ephemeron_table_set(table, links[i - 1], (mjs_value_t){ .tag = MJS_TAG_OBJECT, .u.object = links[i] });
+        }
+    }
+    mjs_gc_add_root(gc, links[0]);
+    TEST_ASSERT(table->count == CHAIN + 1, "Chain entries added");
+    
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    
+    mjs_value_t found;
+    TEST_ASSERT(gc_test_is_live(gc, value) && mjs_ephemeron_table_get(table, key, &found) && found.u.object == value,
+                "Value of a live key survives");
+    TEST_ASSERT(!gc_test_is_live(gc, dead_key) && !gc_test_is_live(gc, dead_value) && table->count == CHAIN,
+                "Key cycle through its value collected");
+    TEST_ASSERT(gc_test_is_live(gc, links[CHAIN - 1]), "Chain resolved to its end");
+    
+    // Cutting the chain's root frees every link and drops the entries
+    mjs_gc_remove_root(gc, links[0]);
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(table->count == 1, "Entries with collected keys removed");
+    
+    TEST_ASSERT(mjs_ephemeron_table_delete(table, key) && !mjs_ephemeron_table_get(table, key, NULL),
+                "Entry deleted");
+    mjs_gc_destroy_ephemeron_table(table);
+    mjs_gc_remove_root(gc, key);
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static int test_background_freeing(void) {
+    TEST_SUITE_BEGIN("Background Freeing");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    TEST_ASSERT(gc->config.background_freeing, "Background freeing on by default");
+    
+    // Dead objects whose side buffers live on the malloc heap
+    for (int i = 0; i < 3000; i++) {
+        mjs_string_t* str = mjs_gc_alloc(gc, sizeof(mjs_string_t), GC_TYPE_STRING);
+        str->data = malloc(16);
+        mjs_array_t* arr = mjs_gc_alloc(gc, sizeof(mjs_array_t), GC_TYPE_ARRAY);
+        arr->elements = malloc(sizeof(mjs_value_t) * 4);
+        mjs_object_t* obj = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+        obj->properties = calloc(1, sizeof(mjs_property_t));
+        obj->properties->next = calloc(1, sizeof(mjs_property_t));
+    }
+    
+    mjs_string_t* kept = mjs_gc_alloc(gc, sizeof(mjs_string_t), GC_TYPE_STRING);
+    kept->data = malloc(16);
+    strcpy(kept->data, "survivor");
+    mjs_gc_add_root(gc, kept);
+    
+    // The sweep records the buffers; memory pressure waits for the thread
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(gc->finalizer_started, "Finalizer thread started by the sweep");
+    mjs_gc_memory_pressure(gc, MJS_MEMORY_PRESSURE_MODERATE);
+    
+    mjs_gc_stats_t stats = mjs_gc_get_stats(gc);
+    TEST_ASSERT(stats.background_frees == 3000 * 4, "Every side buffer freed in the background");
+    TEST_ASSERT(strcmp(kept->data, "survivor") == 0, "Live buffer untouched");
+    
+    // With background freeing off the sweep frees inline
+    gc->config.background_freeing = false;
+    mjs_string_t* str = mjs_gc_alloc(gc, sizeof(mjs_string_t), GC_TYPE_STRING);
+    str->data = malloc(16);
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(mjs_gc_get_stats(gc).background_frees == stats.background_frees, "Inline free when disabled");
+    
+    mjs_gc_remove_root(gc, kept);
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static int test_large_object_space(void) {
+    TEST_SUITE_BEGIN("Large Object Space");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    
+    // Below the threshold a large object still comes from malloc
+    void* medium = mjs_gc_alloc(gc, 64 * 1024, GC_TYPE_FUNCTION);
+    TEST_ASSERT(!mjs_gc_page_of(gc, medium)->mapped, "Medium object not mapped");
+    
+    void* big = mjs_gc_alloc(gc, 4 * 1024 * 1024, GC_TYPE_FUNCTION);
+    mjs_gc_page_t* page = mjs_gc_page_of(gc, big);
+    TEST_ASSERT(page && page->mapped, "Big object mapped");
+    TEST_ASSERT(((uintptr_t)page & (GC_PAGE_SIZE - 1)) == 0, "Mapping aligned to a heap page");
+    memset(big, 0xAB, 4 * 1024 * 1024);
+    mjs_gc_add_root(gc, big);
+    
+    mjs_gc_alloc(gc, 1024 * 1024, GC_TYPE_FUNCTION);
+    TEST_ASSERT(gc->large_object_count == 2, "Both mappings tracked");
+    
+    // Dead mappings are unmapped by the sweep
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    mjs_gc_stats_t stats = mjs_gc_get_stats(gc);
+    TEST_ASSERT(stats.large_objects == 1, "Dead mapping released");
+    TEST_ASSERT(stats.large_object_bytes >= 4 * 1024 * 1024, "Live mapping accounted");
+    TEST_ASSERT(gc->large_objects == page && ((unsigned char*)big)[4 * 1024 * 1024 - 1] == 0xAB, "Live mapping untouched");
+    
+    mjs_gc_remove_root(gc, big);
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(gc->large_objects == NULL && gc->large_object_bytes == 0, "Large-object space empty");
+    
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static int test_page_decommit(void) {
+    TEST_SUITE_BEGIN("Page Decommit");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    gc->config.decommit_delay_us = 60 * 1000000ULL;
+    
+    // A few pages' worth of garbage
+    void* garbage = mjs_gc_alloc(gc, 48, GC_TYPE_FUNCTION);
+    mjs_gc_page_t* page = mjs_gc_page_of(gc, garbage);
+    for (size_t i = 0; i < page->cell_count * 4; i++) {
+        mjs_gc_alloc(gc, 48, GC_TYPE_FUNCTION);
+    }
+    size_t heap_size = gc->heap_size;
+    
+    // Empty pages are kept until the delay has passed
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(gc->heap_size == heap_size, "Fresh empty pages kept");
+    TEST_ASSERT(page->empty_since_us != 0, "Empty page stamped by the sweep");
+    
+    gc->config.decommit_delay_us = 0;
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    mjs_gc_stats_t stats = mjs_gc_get_stats(gc);
+    TEST_ASSERT(gc->heap_size < heap_size, "Idle pages left the heap");
+    TEST_ASSERT(stats.pages_decommitted >= 4, "Pages decommitted");
+    TEST_ASSERT(stats.decommitted_bytes == gc->page_cache_count * GC_PAGE_SIZE, "Decommitted ranges cached");
+    
+    // A new page reuses a cached range
+    size_t cached = gc->page_cache_count;
+    void* fresh = mjs_gc_alloc(gc, 48, GC_TYPE_FUNCTION);
+    TEST_ASSERT(fresh && gc->page_cache_count == cached - 1, "Cached range recommitted");
+    memset(fresh, 0xCD, 48);
+    
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static int test_heap_cage(void) {
+    TEST_SUITE_BEGIN("Heap Cage");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    if (!mjs_gc_reserve_cage(gc)) {
+        // 32-bit host or no address space to reserve
+        mjs_gc_free(gc);
+        return 0;
+    }
+    
+    mjs_object_t* obj = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    void* medium = mjs_gc_alloc(gc, 32 * 1024, GC_TYPE_FUNCTION);
+    void* big = mjs_gc_alloc(gc, 1024 * 1024, GC_TYPE_FUNCTION);
+    TEST_ASSERT(obj && medium && big, "Objects allocated in the cage");
+    TEST_ASSERT((uint64_t)((char*)big - gc->cage_base) < GC_CAGE_SIZE, "Large object inside the cage");
+    TEST_ASSERT(mjs_gc_page_of(gc, medium)->mapped, "Medium object mapped in the cage");
+    
+    int local = 0;
+    TEST_ASSERT(mjs_gc_is_valid_object(gc, obj), "Page found through the cage map");
+    TEST_ASSERT(!mjs_gc_is_valid_object(gc, &local), "Pointer outside the cage rejected");
+    
+    // Released chunks go back to the cage and are reused
+    mjs_gc_add_root(gc, obj);
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(!mjs_gc_is_valid_object(gc, big), "Dead large object released");
+    void* again = mjs_gc_alloc(gc, 1024 * 1024, GC_TYPE_FUNCTION);
+    TEST_ASSERT(again == big, "Released range reused");
+    memset(again, 0, 1024 * 1024);
+    
+    mjs_gc_remove_root(gc, obj);
+    mjs_gc_free(gc);
+    
+    // A heap that already has pages cannot move into a cage
+    gc = mjs_gc_new(NULL);
+    mjs_gc_alloc(gc, 64, GC_TYPE_FUNCTION);
+    TEST_ASSERT(!mjs_gc_reserve_cage(gc), "Cage refused after the first allocation");
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+static int test_string_dedup(void) {
+    TEST_SUITE_BEGIN("String Deduplication");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    gc->config.string_dedup = true;
+    
+    // The same JSON key parsed over and over, plus one distinct string
+    const char* contents[] = { "\"customer_id\"", "\"customer_id\"", "\"customer_id\"", "\"order_total\"" };
+    mjs_string_t* strings[4];
+    
+    // Holds a cell ahead of the strings for a later one to take
+    void* placeholder = mjs_gc_alloc(gc, sizeof(mjs_string_t), GC_TYPE_OBJECT);
+    mjs_gc_add_root(gc, placeholder);
+    for (int i = 0; i < 4; i++) {
+        strings[i] = mjs_gc_alloc(gc, sizeof(mjs_string_t), GC_TYPE_STRING);
+        strings[i]->length = strlen(contents[i]);
+        strings[i]->capacity = strings[i]->length + 1;
+        strings[i]->data = malloc(strings[i]->capacity);
+        memcpy(strings[i]->data, contents[i], strings[i]->capacity);
+        mjs_gc_add_root(gc, strings[i]);
+    }
+    
+    // Young strings are left alone
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(mjs_gc_get_stats(gc).strings_deduplicated == 0, "Young strings not deduplicated");
+    
+    mjs_gc_collect_young(gc);
+    mjs_gc_collect_young(gc);
+    TEST_ASSERT(mjs_gc_get_generation(strings[0]) == 1, "Strings promoted");
+    
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    mjs_gc_stats_t stats = mjs_gc_get_stats(gc);
+    TEST_ASSERT(stats.strings_deduplicated == 2, "Two duplicates found");
+    TEST_ASSERT(stats.dedup_bytes_saved == 2 * strings[0]->capacity, "Their buffers freed");
+    
+    // One of the three is canonical; the others share its characters
+    mjs_string_t* canonical = strings[0]->data_owner ? strings[0]->data_owner : strings[0];
+    int shared = 0;
+    for (int i = 0; i < 3; i++) {
+        if (strings[i]->data_owner) {
+            TEST_ASSERT(strings[i]->data_owner == canonical && strings[i]->data == canonical->data, "Buffer shared");
+            shared++;
+        }
+    }
+    TEST_ASSERT(shared == 2 && !strings[3]->data_owner, "Distinct string untouched");
+    
+    // A later pass finds a newer equal string, in a cell it visits before
+    // the canonical one; the canonical keeps its buffer, which its
+    // duplicates still point into
+    mjs_gc_remove_root(gc, placeholder);
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    mjs_string_t* newer = mjs_gc_alloc(gc, sizeof(mjs_string_t), GC_TYPE_STRING);
+    newer->length = strlen(contents[0]);
+    newer->capacity = newer->length + 1;
+    newer->data = malloc(newer->capacity);
+    memcpy(newer->data, contents[0], newer->capacity);
+    mjs_gc_add_root(gc, newer);
+    mjs_gc_collect_young(gc);
+    mjs_gc_collect_young(gc);
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(mjs_gc_get_stats(gc).strings_deduplicated == 3 &&
+                newer->data_owner == canonical && !canonical->data_owner,
+                "Second pass makes the newer string a duplicate of the first canonical");
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT(strings[i]->data == canonical->data &&
+                    strcmp(strings[i]->data, "\"customer_id\"") == 0,
+                    "Earlier duplicates still share a live buffer");
+    }
+    mjs_gc_remove_root(gc, newer);
+    
+    // A duplicate keeps the canonical string alive
+    mjs_string_t* dup = strings[0] == canonical ? strings[1] : strings[0];
+    for (int i = 0; i < 4; i++) {
+        if (strings[i] != dup) {
+            mjs_gc_remove_root(gc, strings[i]);
+        }
+    }
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(gc_test_is_live(gc, canonical), "Canonical string kept by its duplicate");
+    TEST_ASSERT(strcmp(dup->data, "\"customer_id\"") == 0, "Shared characters intact");
+    
+    mjs_gc_remove_root(gc, dup);
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(!gc_test_is_live(gc, canonical), "Both collected together");
     
     mjs_gc_free(gc);
     
     return 0;
 }
 
+static int test_allocation_regions(void) {
+    TEST_SUITE_BEGIN("Allocation Regions");
+    
+    mjs_gc_t* gc = mjs_gc_new(NULL);
+    gc->allocation_budget = 1024;
+    
+    mjs_object_t* global = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_gc_add_root(gc, global);
+    
+    // A request allocating well past the budget triggers no collection
+    size_t collections = gc->stats.collections;
+    TEST_ASSERT(mjs_gc_region_begin(gc), "Region opened");
+    mjs_object_t* temp = NULL;
+    for (int i = 0; i < 5000; i++) {
+        temp = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    }
+    mjs_gc_create_weak_ref(gc, temp);
+    TEST_ASSERT(gc->stats.collections == collections, "No collection inside the region");
+    TEST_ASSERT(mjs_gc_get_generation(temp) == 0 && mjs_gc_page_of(gc, temp)->region == gc->region,
+                "Allocated on a region page");
+    
+    // Storing into an object from before the region lets the value escape,
+    // along with what it refers to
+    mjs_object_t* kept = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_object_t* inner = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    kept->prototype = inner;
+    MJS_GC_WRITE_BARRIER(gc, global, kept);
+    global->prototype = kept;
+    TEST_ASSERT(mjs_gc_get_header(kept)->escaped_to == 1 && mjs_gc_get_header(inner)->escaped_to == 1,
+                "Stored object escaped with its referent");
+    TEST_ASSERT(mjs_gc_get_header(temp)->escaped_to == 0, "Page neighbours did not");
+    TEST_ASSERT(gc->stats.region_objects_escaped == 2, "Escapes counted");
+    
+    // A temporary root escapes when the region ends
+    mjs_object_t* protected_obj = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_gc_push_root(gc, (mjs_gc_object_t*)protected_obj);
+    
+    TEST_ASSERT(mjs_gc_region_end(gc), "Region closed");
+    TEST_ASSERT(!mjs_gc_region_end(gc), "No region left to close");
+    TEST_ASSERT(gc_test_is_live(gc, kept) && gc_test_is_live(gc, inner), "Escaped objects survive");
+    TEST_ASSERT(mjs_gc_page_of(gc, kept)->region == NULL && mjs_gc_get_generation(kept) == 0,
+                "Their page joined the young generation");
+    TEST_ASSERT(gc_test_is_live(gc, protected_obj), "Rooted object survives");
+    TEST_ASSERT(gc->weak_ref_count == 0, "Weak reference into the region cleared");
+    mjs_gc_stats_t stats = mjs_gc_get_stats(gc);
+    TEST_ASSERT(stats.regions_released == 1 && stats.region_objects_released > 0, "Rest released in bulk");
+    TEST_ASSERT(gc->region_pool.pages.page_count > 0, "Pages kept for the next region");
+    mjs_gc_pop_root(gc);
+    
+    // Later requests reuse the same pages
+    size_t heap_size = 0;
+    for (int request = 0; request < 10; request++) {
+        mjs_gc_region_begin(gc);
+        for (int i = 0; i < 1000; i++) {
+            mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+        }
+        mjs_gc_region_end(gc);
+        if (request == 0) {
+            heap_size = gc->heap_size;
+        }
+    }
+    TEST_ASSERT(gc->heap_size == heap_size, "Heap does not grow across requests");
+    
+    // A nested region's object stored into its outer region's object
+    // lives as long as the outer region
+    mjs_gc_region_begin(gc);
+    mjs_object_t* outer_obj = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    mjs_gc_push_root(gc, (mjs_gc_object_t*)outer_obj);
+    mjs_gc_region_begin(gc);
+    mjs_object_t* nested = mjs_gc_alloc(gc, sizeof(mjs_object_t), GC_TYPE_OBJECT);
+    MJS_GC_WRITE_BARRIER(gc, outer_obj, nested);
+    outer_obj->prototype = nested;
+    mjs_gc_region_end(gc);
+    TEST_ASSERT(gc_test_is_live(gc, nested) && mjs_gc_page_of(gc, nested)->region == gc->region,
+                "Nested object moved to the outer region");
+    mjs_gc_pop_root(gc);
+    mjs_gc_region_end(gc);
+    TEST_ASSERT(!gc_test_is_live(gc, nested) && !gc_test_is_live(gc, outer_obj), "Freed with the outer region");
+    
+    // Escaped objects are ordinary heap objects afterwards
+    global->prototype = NULL;
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    TEST_ASSERT(!gc_test_is_live(gc, kept) && !gc_test_is_live(gc, inner), "Escaped objects collected normally");
+    
+    mjs_gc_free(gc);
+    
+    return 0;
+}
+
+#define CONCURRENT_RUNTIME_THREADS 8
+#define CONCURRENT_RUNTIME_ROUNDS 200
+
+typedef struct {
+    int id;
+    int failures;
+    size_t collections;
+} concurrent_runtime_job_t;
+
+/* One runtime per thread: build garbage and survivors, collect, and check
+ * that values and number formatting never see another thread's state */
+static void concurrent_runtime_worker(void* arg) {
+    concurrent_runtime_job_t* job = arg;
+    mjs_runtime_t* rt = mjs_new_runtime();
+    mjs_context_t* ctx = rt ? mjs_new_context(rt) : NULL;
+    if (!ctx) {
+        job->failures++;
+        if (rt) mjs_free_runtime(rt);
+        return;
+    }
+    
+    for (int round = 0; round < CONCURRENT_RUNTIME_ROUNDS; round++) {
+        double number = job->id * 1000000.0 + round + 0.5;
+        char expected[32];
+        snprintf(expected, sizeof(expected), "%.15g", number);
+        
+        char key[32];
+        snprintf(key, sizeof(key), "k%d", round % 16);
+        mjs_context_set_variable(ctx, key, mjs_string(ctx, expected));
+        
+        for (int i = 0; i < 64; i++) {
+            mjs_value_t garbage = mjs_object(ctx);
+            MJS_GC_PROTECT(rt->gc, garbage.u.ptr);
+            mjs_object_set_property(ctx, mjs_get_object(garbage), "n", mjs_number(number + i));
+            MJS_GC_UNPROTECT(rt->gc);
+        }
+        
+        if (mjs_region_begin(ctx)) {
+            for (int i = 0; i < 16; i++) mjs_string(ctx, expected);
+            mjs_region_end(ctx);
+        }
+        
+        if (round % 10 == 0) {
+            mjs_gc(ctx);
+            job->collections++;
+        }
+        
+        if (strcmp(mjs_to_string(ctx, mjs_number(number)), expected) != 0) job->failures++;
+        
+        mjs_value_t value;
+        if (!mjs_context_get_variable(ctx, key, &value) ||
+            strcmp(mjs_to_string(ctx, value), expected) != 0) {
+            job->failures++;
+        }
+    }
+    
+    mjs_free_context(ctx);
+    mjs_free_runtime(rt);
+}
+
+static int test_concurrent_runtimes(void) {
+    TEST_SUITE_BEGIN("Concurrent Runtimes");
+    
+    concurrent_runtime_job_t jobs[CONCURRENT_RUNTIME_THREADS];
+    mjs_thread_t threads[CONCURRENT_RUNTIME_THREADS];
+    int started = 0;
+    for (int i = 0; i < CONCURRENT_RUNTIME_THREADS; i++) {
+        jobs[i].id = i;
+        jobs[i].failures = 0;
+        jobs[i].collections = 0;
+        if (mjs_thread_create(&threads[i], concurrent_runtime_worker, &jobs[i])) started++;
+        else break;
+    }
+    TEST_ASSERT(started == CONCURRENT_RUNTIME_THREADS, "One runtime started per thread");
+    
+    int failures = 0;
+    size_t collections = 0;
+    for (int i = 0; i < started; i++) {
+        mjs_thread_join(threads[i]);
+        failures += jobs[i].failures;
+        collections += jobs[i].collections;
+    }
+    
+    TEST_ASSERT(collections == (size_t)started * ((CONCURRENT_RUNTIME_ROUNDS + 9) / 10),
+                "Every runtime collected independently");
+    TEST_ASSERT(failures == 0, "No runtime saw another thread's values or buffers");
+    
+    return 0;
+}
+
+static bool context_pool_test_setup(mjs_context_t* ctx, void* opaque) {
+    int* setups = opaque;
+    (*setups)++;
+    mjs_value_t settings = mjs_object(ctx);
+    mjs_value_t tiers = mjs_array(ctx);
+    return mjs_object_define_property(ctx, mjs_get_object(settings), "secret",
+                                      mjs_string(ctx, "none"), true, true, true) == MJS_OK &&
+           mjs_array_push(ctx, mjs_get_array(tiers), mjs_number(1)) &&
+           mjs_object_define_property(ctx, mjs_get_object(settings), "tiers",
+                                      tiers, true, true, true) == MJS_OK &&
+           mjs_context_set_variable(ctx, "config", mjs_string(ctx, "production")) &&
+           mjs_context_set_variable(ctx, "limit", mjs_number(10)) &&
+           mjs_context_set_variable(ctx, "settings", settings) &&
+           mjs_context_set_variable(ctx, "tiers", tiers);
+}
+
+static int test_context_pool(void) {
+    TEST_SUITE_BEGIN("Context Pool");
+    
+    mjs_runtime_t* rt = mjs_new_runtime();
+    int setups = 0;
+    mjs_context_pool_t* pool = mjs_new_context_pool(rt, 2, context_pool_test_setup, &setups);
+    TEST_ASSERT(pool != NULL, "Pool created");
+    TEST_ASSERT(setups == 1 && pool->idle_count == 2, "Template set up once and contexts pre-warmed");
+    
+    mjs_context_t* ctx = mjs_context_pool_acquire(pool);
+    mjs_value_t value;
+    TEST_ASSERT(ctx && mjs_context_get_variable(ctx, "config", &value) &&
+                strcmp(mjs_to_string(ctx, value), "production") == 0,
+                "Checked-out context has the template's globals");
+    
+    // A request that defines, overwrites, mutates template objects and fails
+    mjs_value_t settings;
+    mjs_value_t tiers;
+    TEST_ASSERT(mjs_context_get_variable(ctx, "settings", &settings) &&
+                mjs_context_get_variable(ctx, "tiers", &tiers) &&
+                mjs_object_get_property_value(mjs_get_object(settings), "tiers").u.array ==
+                    mjs_get_array(tiers),
+                "Copied template objects share each other as the template's do");
+    mjs_value_t template_settings;
+    mjs_context_get_variable(pool->template_context, "settings", &template_settings);
+    TEST_ASSERT(mjs_get_object(settings) != mjs_get_object(template_settings),
+                "Context has its own copy of template objects");
+    mjs_object_define_property(ctx, mjs_get_object(settings), "secret",
+                               mjs_string(ctx, "first tenant's"), true, true, true);
+    mjs_array_push(ctx, mjs_get_array(tiers), mjs_number(2));
+    
+    mjs_context_t* neighbour = mjs_context_pool_acquire(pool);
+    mjs_value_t seen;
+    TEST_ASSERT(neighbour && mjs_context_get_variable(neighbour, "settings", &seen) &&
+                strcmp(mjs_to_string(neighbour,
+                                     mjs_object_get_property_value(mjs_get_object(seen), "secret")),
+                       "none") == 0,
+                "Concurrent check-out does not see another's object mutation");
+    mjs_context_pool_release(pool, neighbour);
+    
+    mjs_context_set_variable(ctx, "tenant", mjs_string(ctx, "first"));
+    mjs_context_set_variable(ctx, "limit", mjs_number(99));
+    mjs_set_error(ctx, MJS_ERROR_TYPE, "request failed");
+    mjs_handle_new(ctx, mjs_object(ctx));
+    mjs_context_pool_release(pool, ctx);
+    
+    // Moving collections must keep the template and idle contexts intact
+    rt->gc->config.incremental = false;
+    mjs_gc_collect_young(rt->gc);
+    mjs_gc_collect_young(rt->gc);
+    rt->gc->config.compact = true;
+    mjs_gc_collect(rt->gc);
+    
+    mjs_context_t* again = mjs_context_pool_acquire(pool);
+    TEST_ASSERT(again == ctx, "Most recently returned context reused");
+    TEST_ASSERT(!mjs_context_get_variable(again, "tenant", &value), "Request's globals dropped");
+    TEST_ASSERT(mjs_context_get_variable(again, "limit", &value) && mjs_get_number(value) == 10,
+                "Overwritten global restored");
+    TEST_ASSERT(mjs_context_get_variable(again, "config", &value) &&
+                strcmp(mjs_to_string(again, value), "production") == 0,
+                "Template string survived collection");
+    TEST_ASSERT(!again->has_error && again->handle_count == 0, "Error and handles cleared");
+    TEST_ASSERT(mjs_context_get_variable(again, "settings", &settings) &&
+                strcmp(mjs_to_string(again,
+                                     mjs_object_get_property_value(mjs_get_object(settings), "secret")),
+                       "none") == 0 &&
+                mjs_context_get_variable(again, "tiers", &tiers) &&
+                mjs_get_array(tiers)->length == 1,
+                "Next check-out does not see the last request's object mutations");
+    
+    // Beyond capacity, returned contexts are freed rather than kept
+    mjs_context_t* extra[3];
+    for (int i = 0; i < 3; i++) extra[i] = mjs_context_pool_acquire(pool);
+    TEST_ASSERT(extra[0] && extra[1] && extra[2] && pool->checked_out == 4,
+                "Check-outs past the pre-warmed contexts create new ones");
+    for (int i = 0; i < 3; i++) mjs_context_pool_release(pool, extra[i]);
+    mjs_context_pool_release(pool, again);
+    TEST_ASSERT(pool->idle_count == 2 && pool->checked_out == 0, "Idle contexts capped at capacity");
+    
+    int iterations = 10000;
+    uint64_t start = mjs_now_us();
+    for (int i = 0; i < iterations; i++) {
+        mjs_context_t* request = mjs_context_pool_acquire(pool);
+        mjs_context_set_variable(request, "tenant", mjs_number(i));
+        mjs_context_pool_release(pool, request);
+    }
+    double per_request_us = (double)(mjs_now_us() - start) / iterations;
+    printf("  Check-out and reset: %.2f us per request\n", per_request_us);
+    TEST_ASSERT(per_request_us < 100.0, "Request setup takes microseconds");
+    
+    mjs_free_context_pool(pool);
+    mjs_free_runtime(rt);
+    
+    return 0;
+}
+
+static mjs_value_t shared_heap_test_native(mjs_context_t* ctx, int argc, mjs_value_t* argv) {
+    (void)ctx;
+    (void)argv;
+    return mjs_number(argc);
+}
+
+static int test_shared_heap(void) {
+    TEST_SUITE_BEGIN("Shared Read-Only Heap");
+    
+    mjs_shared_heap_t* heap = mjs_new_shared_heap();
+    TEST_ASSERT(heap != NULL, "Shared heap created");
+    
+    mjs_value_t builtins = mjs_shared_object(heap);
+    mjs_value_t version = mjs_shared_atom(heap, "1.0.0");
+    mjs_value_t native = mjs_shared_function(heap, "count", shared_heap_test_native);
+    TEST_ASSERT(mjs_shared_set_property(heap, builtins, "pi", mjs_number(3.14159)) &&
+                mjs_shared_set_property(heap, builtins, "count", native) &&
+                mjs_shared_define_global(heap, "Builtins", builtins) &&
+                mjs_shared_define_global(heap, "version", version),
+                "Builtins defined");
+    TEST_ASSERT(mjs_shared_atom(heap, "1.0.0").u.string == version.u.string, "Atoms are unique");
+    
+    mjs_runtime_t* other = mjs_new_runtime();
+    mjs_context_t* other_ctx = mjs_new_context(other);
+    TEST_ASSERT(!mjs_shared_define_global(heap, "leak", mjs_string(other_ctx, "private")),
+                "Runtime objects cannot be stored in the shared heap");
+    mjs_free_context(other_ctx);
+    mjs_free_runtime(other);
+    
+    mjs_bytecode_t* prelude = mjs_bytecode_new();
+    mjs_bytecode_add_constant(prelude, mjs_number(42));
+    TEST_ASSERT(mjs_shared_heap_add_library(heap, "prelude", prelude), "Library bytecode added");
+    
+    mjs_runtime_t* early = mjs_new_runtime();
+    TEST_ASSERT(!mjs_runtime_attach_shared_heap(early, heap), "Only a sealed heap can be attached");
+    mjs_free_runtime(early);
+    
+    mjs_shared_heap_seal(heap);
+    TEST_ASSERT(mjs_is_undefined(mjs_shared_atom(heap, "late")) &&
+                !mjs_shared_define_global(heap, "late", mjs_number(1)),
+                "Sealed heap refuses changes");
+    size_t shared_objects = mjs_gc_get_object_count(heap->gc);
+    
+    mjs_runtime_t* runtimes[2];
+    mjs_context_t* contexts[2];
+    for (int i = 0; i < 2; i++) {
+        runtimes[i] = mjs_new_runtime();
+        TEST_ASSERT(mjs_runtime_attach_shared_heap(runtimes[i], heap), "Runtime attached");
+        contexts[i] = mjs_new_context(runtimes[i]);
+    }
+    
+    // The creator's reference goes; the runtimes keep the heap
+    mjs_free_shared_heap(heap);
+    
+    mjs_value_t seen[2];
+    for (int i = 0; i < 2; i++) {
+        mjs_context_get_variable(contexts[i], "version", &seen[i]);
+    }
+    TEST_ASSERT(seen[0].u.string == version.u.string && seen[1].u.string == version.u.string,
+                "Every runtime sees the same shared global");
+    TEST_ASSERT(mjs_string_intern(contexts[0], "1.0.0", 5) == version.u.string &&
+                mjs_string_intern(contexts[1], "1.0.0", 5) == version.u.string,
+                "Interning finds shared atoms");
+    TEST_ASSERT(mjs_shared_heap_library(runtimes[0]->shared_heap, "prelude") == prelude &&
+                mjs_shared_heap_library(runtimes[1]->shared_heap, "prelude") == prelude,
+                "Library bytecode shared");
+    
+    mjs_context_set_variable(contexts[0], "version", mjs_string(contexts[0], "local"));
+    mjs_context_get_variable(contexts[0], "version", &seen[0]);
+    mjs_context_get_variable(contexts[1], "version", &seen[1]);
+    TEST_ASSERT(strcmp(mjs_to_string(contexts[0], seen[0]), "local") == 0 &&
+                seen[1].u.string == version.u.string,
+                "A context shadows a builtin without touching the others");
+    
+    mjs_gc_t* gc = runtimes[0]->gc;
+    mjs_weak_ref_t* weak_ref = mjs_gc_create_weak_ref(gc, builtins.u.object);
+    gc->config.incremental = false;
+    mjs_gc_collect_young(gc);
+    mjs_gc_collect_young(gc);
+    gc->config.compact = true;
+    mjs_gc_collect(gc);
+    mjs_gc_finish_sweeping(gc);
+    
+    TEST_ASSERT(!mjs_gc_is_valid_object(gc, builtins.u.object) &&
+                mjs_gc_is_shared_object(gc, builtins.u.object),
+                "Shared objects are outside the runtime's heap");
+    TEST_ASSERT(mjs_weak_ref_get(weak_ref) == builtins.u.object, "Shared objects never die");
+    TEST_ASSERT(mjs_gc_get_object_count(runtimes[0]->shared_heap->gc) == shared_objects,
+                "Runtime collections leave the shared heap alone");
+    
+    mjs_value_t pi;
+    mjs_context_get_variable(contexts[1], "Builtins", &seen[1]);
+    pi = mjs_object_get_property_value(mjs_get_object(seen[1]), "pi");
+    TEST_ASSERT(mjs_get_number(pi) == 3.14159, "Builtin properties readable after collection");
+    mjs_gc_destroy_weak_ref(gc, weak_ref);
+    
+    // Scripts reach builtins through the global's prototype; stores into them fail
+    mjs_bytecode_t* store = mjs_bytecode_new();
+    uint32_t builtins_name = mjs_bytecode_add_string(store, "Builtins");
+    uint32_t pi_name = mjs_bytecode_add_string(store, "pi");
+    uint32_t e_value = mjs_bytecode_add_constant(store, mjs_number(2.71828));
+    mjs_bytecode_emit(store, (mjs_instruction_t){OP_LOAD_VAR, .operand.u32 = builtins_name});
+    mjs_bytecode_emit(store, (mjs_instruction_t){OP_LOAD_CONST, .operand.u32 = e_value});
+    mjs_bytecode_emit(store, (mjs_instruction_t){OP_SET_PROP, .operand.u32 = pi_name});
+    mjs_bytecode_emit(store, (mjs_instruction_t){OP_RETURN, .operand.u32 = 0});
+    
+    mjs_bytecode_t* store_computed = mjs_bytecode_new();
+    builtins_name = mjs_bytecode_add_string(store_computed, "Builtins");
+    uint32_t key = mjs_bytecode_add_constant(store_computed, mjs_number(7));
+    e_value = mjs_bytecode_add_constant(store_computed, mjs_number(2.71828));
+    mjs_bytecode_emit(store_computed, (mjs_instruction_t){OP_LOAD_VAR, .operand.u32 = builtins_name});
+    mjs_bytecode_emit(store_computed, (mjs_instruction_t){OP_LOAD_CONST, .operand.u32 = key});
+    mjs_bytecode_emit(store_computed, (mjs_instruction_t){OP_LOAD_CONST, .operand.u32 = e_value});
+    mjs_bytecode_emit(store_computed, (mjs_instruction_t){OP_SET_PROP_COMPUTED, .operand.u32 = 0});
+    mjs_bytecode_emit(store_computed, (mjs_instruction_t){OP_RETURN, .operand.u32 = 0});
+    
+    mjs_value_t store_result;
+    mjs_vm_t* vm = mjs_vm_new(contexts[0]);
+    TEST_ASSERT(mjs_vm_execute(vm, store, &store_result) != MJS_OK, "VM store into a shared object refused");
+    mjs_vm_free(vm);
+    vm = mjs_vm_new(contexts[0]);
+    TEST_ASSERT(mjs_vm_execute(vm, store_computed, &store_result) != MJS_OK,
+                "VM computed store into a shared object refused");
+    mjs_vm_free(vm);
+    pi = mjs_object_get_property_value(builtins.u.object, "pi");
+    TEST_ASSERT(mjs_get_number(pi) == 3.14159 && !mjs_object_get_property(builtins.u.object, "7"),
+                "Shared object unchanged");
+    
+    // The same code still stores into the context's own objects
+    mjs_value_t own = mjs_object(contexts[0]);
+    mjs_object_define_property(contexts[0], mjs_get_object(own), "pi", mjs_number(0), true, true, true);
+    mjs_context_set_variable(contexts[0], "Builtins", own);
+    vm = mjs_vm_new(contexts[0]);
+    TEST_ASSERT(mjs_vm_execute(vm, store, &store_result) == MJS_OK &&
+                mjs_get_number(mjs_object_get_property_value(mjs_get_object(own), "pi")) == 2.71828,
+                "VM store into a private object succeeds");
+    mjs_vm_free(vm);
+    mjs_bytecode_free(store);
+    mjs_bytecode_free(store_computed);
+    
+    for (int i = 0; i < 2; i++) {
+        mjs_free_context(contexts[i]);
+        mjs_free_runtime(runtimes[i]);
+    }
+    
+    return 0;
+}
+
+#define WORKER_TEST_WORKERS 8
+#define WORKER_TEST_MESSAGES 10
+#define WORKER_TEST_VALUES 4096
+
+typedef struct {
+    uint64_t sum;
+    const void* received;         /* the buffer the worker was handed */
+    double sequence;              /* messages the worker had seen, itself included */
+} worker_test_reply_t;
+
+typedef struct {
+    const void* sent[WORKER_TEST_MESSAGES];
+    worker_test_reply_t replies[WORKER_TEST_MESSAGES];
+    size_t reply_count;
+} worker_test_parent_t;
+
+static bool worker_test_setup(mjs_context_t* ctx, void* opaque) {
+    (void)opaque;
+    return mjs_context_set_variable(ctx, "processed", mjs_number(0));
+}
+
+/* Worker side: sum the numbers and report back, state kept in the
+ * worker's own globals */
+static bool worker_test_on_message(mjs_worker_t* worker, mjs_context_t* ctx,
+                                   void* data, size_t length, void* opaque) {
+    (void)opaque;
+    worker_test_reply_t* reply = malloc(sizeof(worker_test_reply_t));
+    if (!reply) return false;
+    
+    const uint64_t* values = data;
+    reply->sum = 0;
+    for (size_t i = 0; i < length / sizeof(uint64_t); i++) {
+        reply->sum += values[i];
+    }
+    
+    mjs_value_t processed;
+    mjs_context_get_variable(ctx, "processed", &processed);
+    reply->sequence = mjs_get_number(processed) + 1;
+    mjs_context_set_variable(ctx, "processed", mjs_number(reply->sequence));
+    reply->received = data;
+    
+    if (!mjs_worker_post_to_parent(worker, reply, sizeof(*reply), true)) {
+        free(reply);
+    }
+    return false;
+}
+
+static bool worker_test_on_reply(mjs_worker_t* worker, mjs_context_t* ctx,
+                                 void* data, size_t length, void* opaque) {
+    (void)worker;
+    (void)ctx;
+    worker_test_parent_t* parent = opaque;
+    if (length == sizeof(worker_test_reply_t) && parent->reply_count < WORKER_TEST_MESSAGES) {
+        parent->replies[parent->reply_count++] = *(worker_test_reply_t*)data;
+    }
+    return false;
+}
+
+static int test_workers(void) {
+    TEST_SUITE_BEGIN("Workers");
+    
+    mjs_worker_pool_t* pool = mjs_new_worker_pool(4);
+    TEST_ASSERT(pool != NULL && pool->thread_count == 4, "Pool threads started");
+    
+    mjs_worker_t* workers[WORKER_TEST_WORKERS];
+    worker_test_parent_t* parents = calloc(WORKER_TEST_WORKERS, sizeof(worker_test_parent_t));
+    int created = 0;
+    for (int i = 0; i < WORKER_TEST_WORKERS; i++) {
+        workers[i] = mjs_new_worker(pool, NULL, worker_test_setup, worker_test_on_message, NULL);
+        if (workers[i]) created++;
+    }
+    TEST_ASSERT(created == WORKER_TEST_WORKERS, "Workers created with runtimes of their own");
+    
+    // Transferred buffers; every worker gets its own numbers
+    bool posted = true;
+    for (int m = 0; m < WORKER_TEST_MESSAGES; m++) {
+        for (int i = 0; i < WORKER_TEST_WORKERS; i++) {
+            uint64_t* values = malloc(sizeof(uint64_t) * WORKER_TEST_VALUES);
+            for (int v = 0; v < WORKER_TEST_VALUES; v++) {
+                values[v] = (uint64_t)(i * 1000 + m * 10 + v);
+            }
+            parents[i].sent[m] = values;
+            posted &= mjs_worker_post_message(workers[i], values, sizeof(uint64_t) * WORKER_TEST_VALUES, true);
+        }
+    }
+    TEST_ASSERT(posted, "Messages posted");
+    
+    for (int i = 0; i < WORKER_TEST_WORKERS; i++) {
+        while (parents[i].reply_count < WORKER_TEST_MESSAGES) {
+            mjs_worker_wait(workers[i]);
+            mjs_worker_dispatch(workers[i], NULL, worker_test_on_reply, &parents[i]);
+        }
+    }
+    
+    bool sums = true, moved = true, ordered = true;
+    for (int i = 0; i < WORKER_TEST_WORKERS; i++) {
+        for (int m = 0; m < WORKER_TEST_MESSAGES; m++) {
+            uint64_t expected = 0;
+            for (int v = 0; v < WORKER_TEST_VALUES; v++) {
+                expected += (uint64_t)(i * 1000 + m * 10 + v);
+            }
+            worker_test_reply_t* reply = &parents[i].replies[m];
+            sums &= reply->sum == expected;
+            moved &= reply->received == parents[i].sent[m];
+            ordered &= reply->sequence == m + 1;
+        }
+    }
+    TEST_ASSERT(sums, "Every worker computed its results");
+    TEST_ASSERT(moved, "Transferred buffers arrived without a copy");
+    TEST_ASSERT(ordered, "Messages delivered in order, worker state kept between them");
+    
+    uint64_t copied[2] = {20, 22};
+    worker_test_parent_t parent = {{0}, {{0}}, 0};
+    mjs_worker_post_message(workers[0], copied, sizeof(copied), false);
+    mjs_worker_wait(workers[0]);
+    while (mjs_worker_dispatch(workers[0], NULL, worker_test_on_reply, &parent) == 0) {
+        mjs_worker_wait(workers[0]);
+    }
+    TEST_ASSERT(parent.replies[0].sum == 42 && parent.replies[0].received != (void*)copied,
+                "Posted buffers are copied unless transferred");
+    
+    // Freeing a worker with messages still queued, and the pool with
+    // workers still on it
+    mjs_worker_post_message(workers[1], copied, sizeof(copied), false);
+    mjs_free_worker(workers[1]);
+    mjs_free_worker_pool(pool);
+    TEST_ASSERT(1, "Pool and workers freed");
+    
+    free(parents);
+    return 0;
+}
+
+static void serialize_test_define(mjs_context_t* ctx, mjs_value_t object, const char* key, mjs_value_t value) {
+    mjs_object_define_property(ctx, mjs_get_object(object), key, value, true, true, true);
+}
+
+static int test_serialize(void) {
+    TEST_SUITE_BEGIN("Structured Clone Serializer");
+    
+    mjs_runtime_t* rt = mjs_new_runtime();
+    mjs_context_t* ctx = mjs_new_context(rt);
+    
+    // A graph with a cycle, an object reached twice and every scalar kind
+    mjs_value_t root = mjs_object(ctx);
+    mjs_context_set_variable(ctx, "root", root);
+    mjs_value_t shared = mjs_object(ctx);
+    serialize_test_define(ctx, shared, "name", mjs_string(ctx, "part"));
+    serialize_test_define(ctx, shared, "id", mjs_number(7));
+    mjs_value_t list = mjs_array(ctx);
+    mjs_array_push(ctx, mjs_get_array(list), mjs_number(1));
+    mjs_array_push(ctx, mjs_get_array(list), mjs_string(ctx, "two"));
+    mjs_array_push(ctx, mjs_get_array(list), shared);
+    mjs_array_push(ctx, mjs_get_array(list), mjs_undefined());
+    serialize_test_define(ctx, root, "name", mjs_string(ctx, "widget"));
+    serialize_test_define(ctx, root, "count", mjs_number(42));
+    serialize_test_define(ctx, root, "offset", mjs_number(-7));
+    serialize_test_define(ctx, root, "ratio", mjs_number(0.5));
+    serialize_test_define(ctx, root, "zero", mjs_number(-0.0));
+    serialize_test_define(ctx, root, "huge", mjs_number(1e300));
+    serialize_test_define(ctx, root, "flag", mjs_boolean(true));
+    serialize_test_define(ctx, root, "nothing", mjs_null());
+    serialize_test_define(ctx, root, "list", list);
+    serialize_test_define(ctx, root, "shared", shared);
+    serialize_test_define(ctx, root, "self", root);
+    
+    void* data = NULL;
+    size_t length = 0;
+    TEST_ASSERT(mjs_serialize(ctx, root, &data, &length) == MJS_OK && data != NULL, "Graph serialized");
+    TEST_ASSERT(length < 160, "Encoding is compact");
+    
+    // Rebuilt in another runtime, surviving a collection there
+    mjs_runtime_t* other = mjs_new_runtime();
+    mjs_context_t* other_ctx = mjs_new_context(other);
+    mjs_value_t copy;
+    TEST_ASSERT(mjs_deserialize(other_ctx, data, length, &copy) == MJS_OK && mjs_is_object(copy),
+                "Graph deserialized");
+    mjs_context_set_variable(other_ctx, "copy", copy);
+    mjs_gc_collect(other->gc);
+    
+    mjs_object_t* obj = mjs_get_object(copy);
+    mjs_value_t name = mjs_object_get_property_value(obj, "name");
+    mjs_value_t zero = mjs_object_get_property_value(obj, "zero");
+    TEST_ASSERT(mjs_is_string(name) && strcmp(name.u.string->data, "widget") == 0 &&
+                mjs_object_get_property_value(obj, "count").u.number == 42 &&
+                mjs_object_get_property_value(obj, "offset").u.number == -7 &&
+                mjs_object_get_property_value(obj, "ratio").u.number == 0.5 &&
+                zero.u.number == 0 && signbit(zero.u.number) &&
+                mjs_object_get_property_value(obj, "huge").u.number == 1e300 &&
+                mjs_object_get_property_value(obj, "flag").u.boolean &&
+                mjs_is_null(mjs_object_get_property_value(obj, "nothing")),
+                "Scalars round trip exactly");
+    
+    mjs_array_t* copied_list = mjs_get_array(mjs_object_get_property_value(obj, "list"));
+    mjs_value_t copied_shared = mjs_object_get_property_value(obj, "shared");
+    TEST_ASSERT(copied_list && copied_list->length == 4 &&
+                strcmp(mjs_array_get(copied_list, 1).u.string->data, "two") == 0 &&
+                mjs_is_undefined(mjs_array_get(copied_list, 3)), "Arrays round trip");
+    TEST_ASSERT(mjs_get_object(mjs_object_get_property_value(obj, "self")) == obj, "Cycles preserved");
+    TEST_ASSERT(mjs_get_object(mjs_array_get(copied_list, 2)) == mjs_get_object(copied_shared) &&
+                mjs_get_object(copied_shared) != mjs_get_object(shared), "Shared references preserved");
+    
+    // Same property order and strings, so the copy encodes identically
+    void* again = NULL;
+    size_t again_length = 0;
+    mjs_serialize(other_ctx, copy, &again, &again_length);
+    TEST_ASSERT(again_length == length && memcmp(again, data, length) == 0, "Copy serializes to the same bytes");
+    free(again);
+    
+    bool truncated = true;
+    for (size_t cut = 0; cut < length; cut++) {
+        mjs_value_t partial;
+        truncated &= mjs_deserialize(other_ctx, data, cut, &partial) == MJS_ERROR_SYNTAX &&
+                     mjs_is_undefined(partial);
+    }
+    TEST_ASSERT(truncated, "Truncated buffers rejected");
+    
+    unsigned char* corrupt = malloc(length + 1);
+    memcpy(corrupt, data, length);
+    corrupt[length] = 0;
+    mjs_value_t rejected;
+    TEST_ASSERT(mjs_deserialize(other_ctx, corrupt, length + 1, &rejected) == MJS_ERROR_SYNTAX,
+                "Trailing bytes rejected");
+    corrupt[3] = 0x7f;
+    TEST_ASSERT(mjs_deserialize(other_ctx, corrupt, length, &rejected) == MJS_ERROR_SYNTAX,
+                "Unknown tags rejected");
+    free(corrupt);
+    free(data);
+    
+    mjs_shared_heap_t* heap = mjs_new_shared_heap();
+    serialize_test_define(ctx, root, "callback", mjs_shared_function(heap, "count", shared_heap_test_native));
+    TEST_ASSERT(mjs_serialize(ctx, root, &data, &length) == MJS_ERROR_TYPE && data == NULL,
+                "Functions cannot be cloned");
+    mjs_free_shared_heap(heap);
+    
+    mjs_value_t nested = mjs_array(ctx);
+    mjs_context_set_variable(ctx, "nested", nested);
+    for (int i = 0; i < MJS_SERIALIZE_MAX_DEPTH + 8; i++) {
+        mjs_value_t inner = mjs_array(ctx);
+        mjs_array_push(ctx, mjs_get_array(inner), nested);
+        nested = inner;
+        mjs_context_set_variable(ctx, "nested", nested);
+    }
+    TEST_ASSERT(mjs_serialize(ctx, nested, &data, &length) == MJS_ERROR_RANGE, "Nesting depth limited");
+    
+    mjs_free_context(other_ctx);
+    mjs_free_runtime(other);
+    mjs_free_context(ctx);
+    mjs_free_runtime(rt);
+    return 0;
+}
+
 static int test_weak_references(void) {
     TEST_SUITE_BEGIN("Weak References");
     
-    mjs_gc_t* gc = mjs_gc_new();
+    mjs_gc_t* gc = mjs_gc_new(NULL);
     
     // Allocate an object
     void* obj = mjs_gc_alloc(gc, 64, MJS_GC_TYPE_OBJECT);
@@ -185,7 +1796,7 @@ static int test_weak_references(void) {
     TEST_ASSERT(retrieved == obj, "Weak reference retrieval");
     
     // Clean up weak reference
-    mjs_weak_ref_free(weak_ref);
+    mjs_gc_destroy_weak_ref(gc, weak_ref);
     
     mjs_gc_free(gc);
     
@@ -195,13 +1806,12 @@ static int test_weak_references(void) {
 static int test_gc_statistics(void) {
     TEST_SUITE_BEGIN("GC Statistics");
     
-    mjs_gc_t* gc = mjs_gc_new();
+    mjs_gc_t* gc = mjs_gc_new(NULL);
     
     // Get initial statistics
-    mjs_gc_stats_t stats;
-    mjs_gc_get_stats(gc, &stats);
+    mjs_gc_stats_t stats = mjs_gc_get_stats(gc);
     
-    TEST_ASSERT(stats.total_allocated >= 0, "Initial statistics retrieval");
+    TEST_ASSERT(stats.total_allocations == 0 && stats.collections == 0, "Initial statistics retrieval");
     
     // Allocate some objects
     for (int i = 0; i < 5; i++) {
@@ -209,27 +1819,30 @@ static int test_gc_statistics(void) {
     }
     
     // Get updated statistics
-    mjs_gc_get_stats(gc, &stats);
-    TEST_ASSERT(stats.total_allocated > 0, "Updated statistics after allocation");
+    stats = mjs_gc_get_stats(gc);
+    TEST_ASSERT(stats.total_allocations > 0, "Updated statistics after allocation");
     
     // Trigger collection and check stats
     mjs_gc_collect(gc);
-    mjs_gc_get_stats(gc, &stats);
-    TEST_ASSERT(stats.collections_performed > 0, "Collection statistics");
+    stats = mjs_gc_get_stats(gc);
+    TEST_ASSERT(stats.collections > 0, "Collection statistics");
     
     mjs_gc_free(gc);
     
     return 0;
 }
 
+/* 1 KB objects, several times the heap size the first collection waits for */
+#define MEMORY_PRESSURE_TEST_OBJECTS 4096
+
 static int test_memory_pressure(void) {
     TEST_SUITE_BEGIN("Memory Pressure Handling");
     
-    mjs_gc_t* gc = mjs_gc_new();
+    mjs_gc_t* gc = mjs_gc_new(NULL);
     
     // Allocate many objects to trigger automatic collection
     void* roots[10];
-    for (int i = 0; i < 100; i++) {
+    for (int i = 0; i < MEMORY_PRESSURE_TEST_OBJECTS; i++) {
         void* obj = mjs_gc_alloc(gc, 1024, MJS_GC_TYPE_OBJECT);
         if (i < 10) {
             roots[i] = obj;
@@ -238,9 +1851,10 @@ static int test_memory_pressure(void) {
     }
     
     // Check that GC handled memory pressure
-    mjs_gc_stats_t stats;
-    mjs_gc_get_stats(gc, &stats);
-    TEST_ASSERT(stats.collections_performed >= 0, "Automatic collection under pressure");
+    mjs_gc_stats_t stats = mjs_gc_get_stats(gc);
+    TEST_ASSERT(stats.collections > 0, "Automatic collection under pressure");
+    TEST_ASSERT(mjs_gc_is_valid_object(gc, roots[0]) && mjs_gc_is_valid_object(gc, roots[9]),
+                "Roots survived the automatic collections");
     
     // Clean up roots
     for (int i = 0; i < 10; i++) {
@@ -263,6 +1877,29 @@ int test_gc_run(void) {
     result |= test_basic_collection();
     result |= test_generational_collection();
     result |= test_incremental_collection();
+    result |= test_incremental_write_barrier();
+    result |= test_lazy_sweeping();
+    result |= test_concurrent_marking();
+    result |= test_parallel_collection();
+    result |= test_compaction();
+    result |= test_object_header();
+    result |= test_pacing_and_memory_limit();
+    result |= test_idle_notification();
+    result |= test_tracing();
+    result |= test_heap_snapshot();
+    result |= test_allocation_profiler();
+    result |= test_ephemerons();
+    result |= test_background_freeing();
+    result |= test_large_object_space();
+    result |= test_page_decommit();
+    result |= test_heap_cage();
+    result |= test_string_dedup();
+    result |= test_allocation_regions();
+    result |= test_concurrent_runtimes();
+    result |= test_context_pool();
+    result |= test_shared_heap();
+    result |= test_workers();
+    result |= test_serialize();
     result |= test_weak_references();
     result |= test_gc_statistics();
     result |= test_memory_pressure();
@@ -54,7 +54,7 @@ static int test_lexer_basic_tokens(void) {
     TEST_SUITE_BEGIN("Basic Token Recognition");
     
     const char* source = "123 \"hello\" true false null undefined";
-    mjs_lexer_t* lexer = mjs_lexer_new(source);
+    mjs_lexer_t* lexer = mjs_lexer_new(source, strlen(source));
     
     TEST_ASSERT(lexer != NULL, "Lexer creation");
     
@@ -95,7 +95,7 @@ static int test_lexer_operators(void) {
     TEST_SUITE_BEGIN("Operator Recognition");
     
     const char* source = "+ - * / % == != < <= > >= && || ! = += -= *= /=";
-    mjs_lexer_t* lexer = mjs_lexer_new(source);
+    mjs_lexer_t* lexer = mjs_lexer_new(source, strlen(source));
     
     TEST_ASSERT(lexer != NULL, "Lexer creation");
     
@@ -168,43 +168,43 @@ static int test_lexer_identifiers_keywords(void) {
     TEST_SUITE_BEGIN("Identifiers and Keywords");
     
     const char* source = "var let const function if else while for return break continue";
-    mjs_lexer_t* lexer = mjs_lexer_new(source);
+    mjs_lexer_t* lexer = mjs_lexer_new(source, strlen(source));
     
     TEST_ASSERT(lexer != NULL, "Lexer creation");
     
     // Test keywords
     mjs_token_t token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_VAR, "var keyword");
+    TEST_ASSERT(token.type == TOKEN_KEYWORD_VAR, "var keyword");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_LET, "let keyword");
+    TEST_ASSERT(token.type == TOKEN_KEYWORD_LET, "let keyword");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_CONST, "const keyword");
+    TEST_ASSERT(token.type == TOKEN_KEYWORD_CONST, "const keyword");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_FUNCTION, "function keyword");
+    TEST_ASSERT(token.type == TOKEN_KEYWORD_FUNCTION, "function keyword");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_IF, "if keyword");
+    TEST_ASSERT(token.type == TOKEN_KEYWORD_IF, "if keyword");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_ELSE, "else keyword");
+    TEST_ASSERT(token.type == TOKEN_KEYWORD_ELSE, "else keyword");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_WHILE, "while keyword");
+    TEST_ASSERT(token.type == TOKEN_KEYWORD_WHILE, "while keyword");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_FOR, "for keyword");
+    TEST_ASSERT(token.type == TOKEN_KEYWORD_FOR, "for keyword");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_RETURN, "return keyword");
+    TEST_ASSERT(token.type == TOKEN_KEYWORD_RETURN, "return keyword");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_BREAK, "break keyword");
+    TEST_ASSERT(token.type == TOKEN_KEYWORD_BREAK, "break keyword");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_CONTINUE, "continue keyword");
+    TEST_ASSERT(token.type == TOKEN_KEYWORD_CONTINUE, "continue keyword");
     
     mjs_lexer_free(lexer);
     return 0;
@@ -214,27 +214,27 @@ static int test_lexer_punctuation(void) {
     TEST_SUITE_BEGIN("Punctuation");
     
     const char* source = "( ) { } [ ] ; , . :";
-    mjs_lexer_t* lexer = mjs_lexer_new(source);
+    mjs_lexer_t* lexer = mjs_lexer_new(source, strlen(source));
     
     TEST_ASSERT(lexer != NULL, "Lexer creation");
     
     mjs_token_t token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_LPAREN, "Left parenthesis");
+    TEST_ASSERT(token.type == TOKEN_LEFT_PAREN, "Left parenthesis");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_RPAREN, "Right parenthesis");
+    TEST_ASSERT(token.type == TOKEN_RIGHT_PAREN, "Right parenthesis");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_LBRACE, "Left brace");
+    TEST_ASSERT(token.type == TOKEN_LEFT_BRACE, "Left brace");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_RBRACE, "Right brace");
+    TEST_ASSERT(token.type == TOKEN_RIGHT_BRACE, "Right brace");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_LBRACKET, "Left bracket");
+    TEST_ASSERT(token.type == TOKEN_LEFT_BRACKET, "Left bracket");
     
     token = mjs_lexer_next_token(lexer);
-    TEST_ASSERT(token.type == TOKEN_RBRACKET, "Right bracket");
+    TEST_ASSERT(token.type == TOKEN_RIGHT_BRACKET, "Right bracket");
     
     token = mjs_lexer_next_token(lexer);
     TEST_ASSERT(token.type == TOKEN_SEMICOLON, "Semicolon");
@@ -257,17 +257,17 @@ static int test_lexer_error_handling(void) {
     
     // Test unterminated string
     const char* source1 = "\"unterminated string";
-    mjs_lexer_t* lexer1 = mjs_lexer_new(source1);
+    mjs_lexer_t* lexer1 = mjs_lexer_new(source1, strlen(source1));
     TEST_ASSERT(lexer1 != NULL, "Lexer creation for error test");
     
     mjs_token_t token = mjs_lexer_next_token(lexer1);
-    TEST_ASSERT(mjs_lexer_has_error(lexer1), "Unterminated string error detected");
+    TEST_ASSERT(token.type == TOKEN_ERROR && mjs_lexer_has_error(lexer1), "Unterminated string error detected");
     
     mjs_lexer_free(lexer1);
     
     // Test invalid character
     const char* source2 = "@invalid";
-    mjs_lexer_t* lexer2 = mjs_lexer_new(source2);
+    mjs_lexer_t* lexer2 = mjs_lexer_new(source2, strlen(source2));
     TEST_ASSERT(lexer2 != NULL, "Lexer creation for invalid char test");
     
     token = mjs_lexer_next_token(lexer2);
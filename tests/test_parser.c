@@ -47,8 +47,9 @@ static int test_parser_basic_expressions(void) {
     TEST_SUITE_BEGIN("Basic Expression Parsing");
     
     const char* source = "2 + 3 * 4";
-    mjs_lexer_t* lexer = mjs_lexer_new(source);
-    mjs_parser_t* parser = mjs_parser_new(lexer);
+    mjs_runtime_t* runtime = mjs_new_runtime();
+    mjs_context_t* ctx = mjs_new_context(runtime);
+    mjs_parser_t* parser = mjs_parser_new(ctx, source, strlen(source));
     
     TEST_ASSERT(parser != NULL, "Parser creation");
     
@@ -58,6 +59,8 @@ static int test_parser_basic_expressions(void) {
     
     mjs_ast_node_free(ast);
     mjs_parser_free(parser);
+    mjs_free_context(ctx);
+    mjs_free_runtime(runtime);
     
     return 0;
 }
@@ -66,8 +69,9 @@ static int test_parser_statements(void) {
     TEST_SUITE_BEGIN("Statement Parsing");
     
     const char* source = "var x = 42;";
-    mjs_lexer_t* lexer = mjs_lexer_new(source);
-    mjs_parser_t* parser = mjs_parser_new(lexer);
+    mjs_runtime_t* runtime = mjs_new_runtime();
+    mjs_context_t* ctx = mjs_new_context(runtime);
+    mjs_parser_t* parser = mjs_parser_new(ctx, source, strlen(source));
     
     TEST_ASSERT(parser != NULL, "Parser creation");
     
@@ -77,6 +81,8 @@ static int test_parser_statements(void) {
     
     mjs_ast_node_free(ast);
     mjs_parser_free(parser);
+    mjs_free_context(ctx);
+    mjs_free_runtime(runtime);
     
     return 0;
 }
@@ -85,8 +91,9 @@ static int test_parser_functions(void) {
     TEST_SUITE_BEGIN("Function Parsing");
     
     const char* source = "function add(a, b) { return a + b; }";
-    mjs_lexer_t* lexer = mjs_lexer_new(source);
-    mjs_parser_t* parser = mjs_parser_new(lexer);
+    mjs_runtime_t* runtime = mjs_new_runtime();
+    mjs_context_t* ctx = mjs_new_context(runtime);
+    mjs_parser_t* parser = mjs_parser_new(ctx, source, strlen(source));
     
     TEST_ASSERT(parser != NULL, "Parser creation");
     
@@ -96,6 +103,8 @@ static int test_parser_functions(void) {
     
     mjs_ast_node_free(ast);
     mjs_parser_free(parser);
+    mjs_free_context(ctx);
+    mjs_free_runtime(runtime);
     
     return 0;
 }
@@ -25,6 +25,8 @@
  */
 
 #include "../include/mikojs.h"
+#include "../src/mikojs_internal.h"
+#include "../src/gc.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -136,13 +138,12 @@ static int test_object_operations(void) {
     
     // Test property operations
     mjs_value_t prop_val = mjs_value_number(123);
-    bool set_result = mjs_object_set_property(obj, "testProp", prop_val);
-    TEST_ASSERT(set_result, "Property setting");
+    mjs_result_t set_result = mjs_object_define_property(ctx, obj, "testProp", prop_val, true, true, true);
+    TEST_ASSERT(set_result == MJS_OK, "Property setting");
     
-    mjs_value_t retrieved_val;
-    bool get_result = mjs_object_get_property(obj, "testProp", &retrieved_val);
-    TEST_ASSERT(get_result, "Property retrieval");
-    TEST_ASSERT(mjs_get_number(retrieved_val) == 123, "Property value correctness");
+    mjs_property_t* prop = mjs_object_get_property(obj, "testProp");
+    TEST_ASSERT(prop != NULL, "Property retrieval");
+    TEST_ASSERT(mjs_get_number(prop->value) == 123, "Property value correctness");
     
     mjs_free_context(ctx);
     mjs_free_runtime(runtime);
@@ -157,7 +158,7 @@ static int test_array_operations(void) {
     mjs_context_t* ctx = mjs_new_context(runtime);
     
     // Test array creation
-    mjs_array_t* arr = mjs_array_new(ctx);
+    mjs_array_t* arr = mjs_array_new(ctx, 0, sizeof(mjs_value_t));
     TEST_ASSERT(arr != NULL, "Array creation");
     
     mjs_value_t arr_val = mjs_value_array(arr);
@@ -167,7 +168,7 @@ static int test_array_operations(void) {
     TEST_ASSERT(mjs_array_length(arr) == 0, "Initial array length");
     
     mjs_value_t elem = mjs_value_number(42);
-    bool push_result = mjs_array_push(arr, elem);
+    bool push_result = mjs_array_push(ctx, arr, elem);
     TEST_ASSERT(push_result, "Array push operation");
     TEST_ASSERT(mjs_array_length(arr) == 1, "Array length after push");
     
@@ -180,6 +181,95 @@ static int test_array_operations(void) {
     return 0;
 }
 
+static int test_handle_scopes(void) {
+    TEST_SUITE_BEGIN("Handle Scopes and Persistent Handles");
+    
+    mjs_runtime_t* runtime = mjs_new_runtime();
+    mjs_context_t* ctx = mjs_new_context(runtime);
+    mjs_gc_t* gc = runtime->gc;
+    
+    mjs_gc(ctx);
+    size_t baseline = mjs_gc_get_object_count(gc);
+    
+    // More handles than fit in one block
+    const int count = 3000;
+    mjs_handle_scope_t outer;
+    mjs_handle_scope_open(ctx, &outer);
+    
+    mjs_handle_scope_t inner;
+    mjs_handle_scope_open(ctx, &inner);
+    mjs_value_t* first = NULL;
+    for (int i = 0; i < count; i++) {
+        mjs_value_t* handle = mjs_handle_new(ctx, mjs_object(ctx));
+        if (i == 0) first = handle;
+    }
+    mjs_gc(ctx);
+    TEST_ASSERT(mjs_gc_get_object_count(gc) == baseline + count, "Open scope keeps its handles alive");
+    
+    mjs_value_t* escaped = mjs_handle_scope_escape(&inner, *first);
+    TEST_ASSERT(escaped != NULL, "Handle escapes to the enclosing scope");
+    
+    mjs_persistent_t persistent = mjs_persistent_new(ctx, mjs_object(ctx));
+    TEST_ASSERT(persistent != 0, "Persistent handle creation");
+    
+    mjs_gc(ctx);
+    TEST_ASSERT(mjs_gc_get_object_count(gc) == baseline + 2, "Closed scope releases its handles");
+    TEST_ASSERT(mjs_gc_is_valid_object(gc, mjs_get_object(*escaped)), "Escaped handle survives collection");
+    TEST_ASSERT(mjs_gc_is_valid_object(gc, mjs_get_object(mjs_persistent_get(ctx, persistent))),
+                "Persistent handle survives collection");
+    
+    mjs_handle_scope_close(&outer);
+    mjs_persistent_release(ctx, persistent);
+    TEST_ASSERT(mjs_is_undefined(mjs_persistent_get(ctx, persistent)), "Released handle reads undefined");
+    
+    mjs_gc(ctx);
+    TEST_ASSERT(mjs_gc_get_object_count(gc) == baseline, "Released handles no longer keep values alive");
+    TEST_ASSERT(mjs_persistent_new(ctx, mjs_null()) == persistent, "Released slot is reused");
+    
+    mjs_free_context(ctx);
+    mjs_free_runtime(runtime);
+    
+    return 0;
+}
+
+static int test_memory_pressure(void) {
+    TEST_SUITE_BEGIN("Memory Pressure");
+    
+    mjs_runtime_t* runtime = mjs_new_runtime();
+    mjs_context_t* ctx = mjs_new_context(runtime);
+    
+    mjs_handle_scope_t scope;
+    mjs_handle_scope_open(ctx, &scope);
+    
+    // Only the interned string a handle refers to stays in the table
+    mjs_string_t* kept = mjs_string_intern(ctx, "kept", 4);
+    mjs_string_t* dropped = mjs_string_intern(ctx, "dropped", 7);
+    mjs_value_t kept_value = { .tag = MJS_TAG_STRING, .u.ptr = kept };
+    mjs_handle_new(ctx, kept_value);
+    (void)dropped;
+    
+    mjs_memory_pressure(runtime, MJS_MEMORY_PRESSURE_MODERATE);
+    bool found_kept = false, found_dropped = false;
+    for (mjs_string_t* str = runtime->string_table; str; str = str->next) {
+        found_kept |= str == kept;
+        found_dropped |= str->length == 7 && memcmp(str->data, "dropped", 7) == 0;
+    }
+    TEST_ASSERT(found_kept && kept->is_interned, "Referenced interned string kept");
+    TEST_ASSERT(!found_dropped, "Unreferenced interned string dropped");
+    TEST_ASSERT(mjs_string_intern(ctx, "kept", 4) == kept, "Kept string still interned");
+    
+    mjs_handle_scope_close(&scope);
+    
+    // Idle time with nothing pending reports no work left
+    mjs_gc(ctx);
+    TEST_ASSERT(mjs_idle_notification(runtime, mjs_now_us() + 100000), "Idle notification finds no work");
+    
+    mjs_free_context(ctx);
+    mjs_free_runtime(runtime);
+    
+    return 0;
+}
+
 int test_runtime_run(void) {
     printf("\n=== Running Runtime Tests ===\n");
     
@@ -190,6 +280,8 @@ int test_runtime_run(void) {
     result |= test_type_conversion();
     result |= test_object_operations();
     result |= test_array_operations();
+    result |= test_handle_scopes();
+    result |= test_memory_pressure();
     
     if (result == 0) {
         printf("\n✅ All runtime tests passed!\n");
@@ -25,6 +25,7 @@
  */
 
 #include "../src/vm.h"
+#include "../src/gc.h"
 #include "../include/mikojs.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -68,7 +69,7 @@ static int test_bytecode_creation(void) {
     // Test instruction emission
     mjs_instruction_t instr;
     instr.opcode = OP_LOAD_CONST;
-    instr.operand = 0;
+    instr.operand.u32 = 0;
     
     bool emit_result = mjs_bytecode_emit(bytecode, instr);
     TEST_ASSERT(emit_result, "Instruction emission");
@@ -102,8 +103,8 @@ static int test_basic_execution(void) {
     uint32_t const_index = mjs_bytecode_add_constant(bytecode, const_val);
     
     // Emit instructions
-    mjs_instruction_t load_instr = {OP_LOAD_CONST, const_index};
-    mjs_instruction_t return_instr = {OP_RETURN, 0};
+    mjs_instruction_t load_instr = {OP_LOAD_CONST, {.u32 = const_index}};
+    mjs_instruction_t return_instr = {OP_RETURN, {.u32 = 0}};
     
     mjs_bytecode_emit(bytecode, load_instr);
     mjs_bytecode_emit(bytecode, return_instr);
@@ -136,10 +137,10 @@ static int test_arithmetic_operations(void) {
     uint32_t const2 = mjs_bytecode_add_constant(bytecode, mjs_value_number(3));
     
     // Emit instructions: LOAD_CONST 0, LOAD_CONST 1, ADD, RETURN
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, const1});
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, const2});
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_ADD, 0});
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_RETURN, 0});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, {.u32 = const1}});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, {.u32 = const2}});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_ADD, {.u32 = 0}});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_RETURN, {.u32 = 0}});
     
     // Execute
     mjs_value_t exec_result;
@@ -169,10 +170,10 @@ static int test_comparison_operations(void) {
     uint32_t const2 = mjs_bytecode_add_constant(bytecode, mjs_value_number(3));
     
     // Emit instructions: LOAD_CONST 0, LOAD_CONST 1, GT, RETURN
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, const1});
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, const2});
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_GT, 0});
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_RETURN, 0});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, {.u32 = const1}});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, {.u32 = const2}});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_GT, {.u32 = 0}});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_RETURN, {.u32 = 0}});
     
     // Execute
     mjs_value_t exec_result;
@@ -202,12 +203,12 @@ static int test_control_flow(void) {
     uint32_t result_const = mjs_bytecode_add_constant(bytecode, mjs_value_number(42));
     
     // Emit instructions: LOAD_CONST true, JUMP_IF_TRUE 4, LOAD_CONST 0, JUMP 5, LOAD_CONST result, RETURN
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, true_const});
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_JUMP_IF_TRUE, 4});
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, 0});
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_JUMP, 5});
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, result_const});
-    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_RETURN, 0});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, {.u32 = true_const}});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_JUMP_IF_TRUE, {.u32 = 4}});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, {.u32 = 0}});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_JUMP, {.u32 = 5}});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, {.u32 = result_const}});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_RETURN, {.u32 = 0}});
     
     // Execute
     mjs_value_t exec_result;
@@ -222,6 +223,53 @@ static int test_control_flow(void) {
     return 0;
 }
 
+static int test_gc_roots(void) {
+    TEST_SUITE_BEGIN("Precise GC Roots");
+    
+    mjs_runtime_t* runtime = mjs_new_runtime();
+    mjs_context_t* ctx = mjs_new_context(runtime);
+    mjs_vm_t* vm = mjs_vm_new(ctx);
+    mjs_gc_t* gc = runtime->gc;
+    
+    // A value on the operand stack is live, one that was popped is not
+    mjs_object_t* on_stack = mjs_object_new(ctx);
+    mjs_object_t* popped = mjs_object_new(ctx);
+    vm->stack[vm->stack_top++] = mjs_value_object(on_stack);
+    vm->stack[vm->stack_top++] = mjs_value_object(popped);
+    vm->stack_top--;
+    
+    mjs_gc(ctx);
+    TEST_ASSERT(mjs_gc_is_valid_object(gc, ctx->global_object.u.ptr), "Global object found through the context");
+    TEST_ASSERT(mjs_gc_is_valid_object(gc, on_stack), "Stack slot below stack_top kept alive");
+    TEST_ASSERT(!mjs_gc_is_valid_object(gc, popped), "Slot above stack_top not scanned");
+    vm->stack_top = 0;
+    
+    // A string constant stored into a new global survives the allocation
+    // of the variable's key and later collections
+    mjs_bytecode_t* bytecode = mjs_bytecode_new();
+    mjs_string_t* str = mjs_string_new(ctx, "kept", 4);
+    uint32_t str_const = mjs_bytecode_add_constant(bytecode, mjs_value_string(str));
+    uint32_t name = mjs_bytecode_add_string(bytecode, "x");
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_LOAD_CONST, {.u32 = str_const}});
+    mjs_bytecode_emit(bytecode, (mjs_instruction_t){OP_STORE_VAR, {.u32 = name}});
+    
+    mjs_value_t exec_result;
+    mjs_result_t result = mjs_vm_execute(vm, bytecode, &exec_result);
+    TEST_ASSERT(result == MJS_OK && vm->stack_top == 0, "Execution leaves the stack as it found it");
+    
+    mjs_gc(ctx);
+    mjs_value_t x;
+    TEST_ASSERT(mjs_context_get_variable(ctx, "x", &x) && x.u.ptr == str, "Stored value reachable from the global object");
+    TEST_ASSERT(mjs_gc_is_valid_object(gc, str), "Stored string survived collection");
+    
+    mjs_bytecode_free(bytecode);
+    mjs_vm_free(vm);
+    mjs_free_context(ctx);
+    mjs_free_runtime(runtime);
+    
+    return 0;
+}
+
 int test_vm_run(void) {
     printf("\n=== Running VM Tests ===\n");
     
@@ -233,6 +281,7 @@ int test_vm_run(void) {
     result |= test_arithmetic_operations();
     result |= test_comparison_operations();
     result |= test_control_flow();
+    result |= test_gc_roots();
     
     if (result == 0) {
         printf("\n✅ All VM tests passed!\n");